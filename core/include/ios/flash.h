@@ -0,0 +1,27 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	flash - nand block health as seen by the modules
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __IOS_FLASH_H__
+#define __IOS_FLASH_H__
+
+#include "types.h"
+
+typedef struct
+{
+	u32 Bad;
+	u16 CorrectedErrors;
+	u16 UncorrectableErrors;
+} FlashBlockStats;
+CHECK_SIZE(FlashBlockStats, 0x08);
+CHECK_OFFSET(FlashBlockStats, 0x00, Bad);
+CHECK_OFFSET(FlashBlockStats, 0x04, CorrectedErrors);
+CHECK_OFFSET(FlashBlockStats, 0x06, UncorrectableErrors);
+
+#endif
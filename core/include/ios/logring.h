@@ -0,0 +1,38 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	logring - per process log buffer, drained to the gecko by the kernel
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __LOGRING_H__
+#define __LOGRING_H__
+
+#include "types.h"
+
+//has to be a power of 2
+#define LOG_RING_SIZE 0x800
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+//Head and Tail are free running byte counters. only the process moves Head and
+//only the kernel moves Tail, so neither side needs to wait on the other.
+//Lock is only taken between threads of the same process, and never waited on
+typedef struct
+{
+	volatile u32 Head;
+	volatile u32 Tail;
+	volatile u32 Lock;
+	volatile u32 DroppedMessages;
+	u8 Data[LOG_RING_SIZE];
+} LogRing;
+CHECK_SIZE(LogRing, 0x810);
+CHECK_OFFSET(LogRing, 0x00, Head);
+CHECK_OFFSET(LogRing, 0x04, Tail);
+CHECK_OFFSET(LogRing, 0x08, Lock);
+CHECK_OFFSET(LogRing, 0x0C, DroppedMessages);
+CHECK_OFFSET(LogRing, 0x10, Data);
+
+#endif
@@ -184,6 +184,7 @@ static inline u8 mask8(u32 addr, u8 clear, u8 set)
 u32 GetCurrentStatusRegister(void);
 u32 GetSavedStatusRegister();
 void BusyDelay(u32 delay);
+u32 SwapWord(volatile u32 *address, u32 value);
 void debug_output(u8 byte);
 int sprintf(char *str, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 int snprintf(char *str, size_t size, const char *fmt, ...)
@@ -15,6 +15,8 @@
 #include "types.h"
 #include "ios/ipc.h"
 #include "ios/ahb.h"
+#include "ios/flash.h"
+#include "ios/logring.h"
 #include "ios/sha.h"
 #include "ios/messageQueue.h"
 
@@ -80,12 +82,24 @@ s32 OSClearAndEnableEvent(u32 event);
 
 void OSDCInvalidateRange(const void *start, u32 size);
 void OSDCFlushRange(const void *start, u32 size);
+void *OSAllocateIOBuf(u32 size, u32 alignment);
+s32 OSFreeIOBuf(void *ptr);
+s32 OSIOBufToDevice(void *ptr, AHBDEV device);
+s32 OSIOBufFromDevice(void *ptr, AHBDEV device);
+s32 OSReadFlashPage(u32 page, void *data, void *spare);
+s32 OSWriteFlashPage(u32 page, const void *data, const void *spare);
+s32 OSEraseFlashBlock(u32 block);
+s32 OSGetFlashBlockStats(u32 block, FlashBlockStats *stats);
+s32 OSMarkFlashBlockBad(u32 block);
+s32 OSRegisterLogRing(LogRing *ring);
+s32 OSUnregisterLogRing(void);
 
 u32 OSVirtualToPhysical(u32 virtualAddress);
 
 // IOSC Crypto syscalls
 s32 OSIOSCCreateObject(u32 *keyHandle, u32 type, u32 subtype);
 s32 OSIOSCDeleteObject(u32 keyHandle);
+s32 OSIOSCImportPublicKey(const void *publicKeyData, const void *exponent, u32 publicKeyHandle);
 s32 OSSetIOSCData(u32 keyHandle, u32 value);
 s32 OSGetIOSCData(u32 keyHandle, u32 *value);
 s32 OSIOSCGetKeySize(u32 *keySize, u32 keyHandle);
@@ -98,6 +112,8 @@ s32 OSIOSCDecrypt(u32 keyHandle, void *ivData, const void *inputData,
                   u32 dataSize, void *outputData);
 s32 OSIOSCDecryptAsync(u32 keyHandle, void *ivData, const void *inputData, u32 dataSize,
                        void *outputData, s32 messageQueueId, IpcMessage *message);
+s32 OSIOSCDecryptAndHash(u32 keyHandle, void *ivData, const void *inputData, u32 dataSize,
+                         void *outputData, void *hashData);
 s32 OSIOSCGenerateBlockMAC(ShaContext *context, const void *inputData, u32 inputSize,
                            const void *customData, u32 customDataSize, u32 keyHandle,
                            HMacCommandType hmacCommand, void *signData);
@@ -105,6 +121,14 @@ s32 OSIOSCGenerateBlockMACAsync(ShaContext *context, const void *inputData, u32
                                 const void *customData, u32 customDataSize, u32 keyHandle,
                                 HMacCommandType hmacCommand, void *signData,
                                 s32 messageQueueId, IpcMessage *message);
+s32 OSIOSCVerifyPublicKeySign(const void *inputData, u32 inputSize, u32 publicKeyHandle,
+                              const void *signData);
+s32 OSIOSCVerifyPublicKeySignAsync(const void *inputData, u32 inputSize, u32 publicKeyHandle,
+                                   const void *signData, s32 messageQueueId, IpcMessage *message);
+s32 OSIOSCGeneratePublicKey(u32 privateKeyHandle, u32 publicKeyHandle);
+s32 OSIOSCGenerateSharedKey(u32 privateKeyHandle, u32 publicKeyHandle, u32 sharedKeyHandle);
+s32 OSIOSCGenerateSignature(const void *inputData, u32 inputSize, u32 privateKeyHandle,
+                            void *signData);
 
 // Special IOS syscall to print something to debug device
 void OSPrintk(const char *str);
@@ -16,6 +16,144 @@ Copyright (C) 2025	Alberto Mardegan <mardy@users.sourceforge.net>
 
 #define EHCI_REG_BASE         0x0d040000
 #define EHCI_CHICKENBITS_INIT 0xe1800
+#define EHCI_MAX_PORTS        0x0F
+
+/* HcsParameters */
+#define EHCI_HCS_N_PORTS(p)   ((p) & 0x0F)
+
+/* UsbCommand */
+#define EHCI_CMD_RUN          (1U << 0)
+#define EHCI_CMD_RESET        (1U << 1)
+#define EHCI_CMD_FLS_MASK     (3U << 2) /* frame list size, 0 = 1024 entries */
+#define EHCI_CMD_PSE          (1U << 4) /* periodic schedule enable */
+#define EHCI_CMD_ASE          (1U << 5) /* async schedule enable */
+#define EHCI_CMD_IAAD         (1U << 6) /* interrupt on async advance doorbell */
+#define EHCI_CMD_ITC_SHIFT    16 /* interrupt threshold, in micro frames */
+#define EHCI_CMD_ITC_MASK     (0xFFU << EHCI_CMD_ITC_SHIFT)
+
+/* UsbStatus & UsbInterrupt */
+#define EHCI_STS_INT          (1U << 0) /* transfer completed (IOC or short packet) */
+#define EHCI_STS_ERR          (1U << 1) /* transfer error */
+#define EHCI_STS_PCD          (1U << 2) /* port change detect */
+#define EHCI_STS_FLR          (1U << 3) /* frame list rollover */
+#define EHCI_STS_HSE          (1U << 4) /* host system error */
+#define EHCI_STS_IAA          (1U << 5) /* interrupt on async advance */
+#define EHCI_STS_HALT         (1U << 12)
+#define EHCI_STS_RECL         (1U << 13)
+#define EHCI_STS_PSS          (1U << 14) /* periodic schedule status */
+#define EHCI_STS_ASS          (1U << 15) /* async schedule status */
+#define EHCI_STS_INTR_MASK    0x3FU
+
+/* PortConfigFlag */
+#define EHCI_CF_ROUTE_EHCI    (1U << 0)
+
+/* PortControl, the bits marked as "change" are cleared by writing 1 */
+#define EHCI_PORT_CONNECT     (1U << 0)
+#define EHCI_PORT_CSC         (1U << 1) /* connect status change */
+#define EHCI_PORT_PE          (1U << 2) /* port enabled */
+#define EHCI_PORT_PEC         (1U << 3) /* port enable change */
+#define EHCI_PORT_OCA         (1U << 4) /* over current active */
+#define EHCI_PORT_OCC         (1U << 5) /* over current change */
+#define EHCI_PORT_RESUME      (1U << 6)
+#define EHCI_PORT_SUSPEND     (1U << 7)
+#define EHCI_PORT_RESET       (1U << 8)
+#define EHCI_PORT_LS_MASK     (3U << 10) /* line status */
+#define EHCI_PORT_LS_K        (1U << 10) /* K-state means a low speed device */
+#define EHCI_PORT_POWER       (1U << 12)
+#define EHCI_PORT_OWNER       (1U << 13) /* port belongs to the companion ohci */
+#define EHCI_PORT_RWC         (EHCI_PORT_CSC | EHCI_PORT_PEC | EHCI_PORT_OCC)
+
+/* Link pointers, lower 5 bits are flags */
+#define EHCI_LINK_TERMINATE   (1U << 0)
+#define EHCI_LINK_QH          (1U << 1)
+#define EHCI_LINK_MASK        0xFFFFFFE0U
+
+#define QTD_SET(field, value) \
+	(((u32)(value) & QTD_##field##_MASK) << QTD_##field##_SHIFT)
+#define QTD_GET(field, var) (((var) >> QTD_##field##_SHIFT) & QTD_##field##_MASK)
+
+/* qTD token */
+#define QTD_STS_PING          (1U << 0)
+#define QTD_STS_STS           (1U << 1) /* split transaction state */
+#define QTD_STS_MMF           (1U << 2) /* missed micro frame */
+#define QTD_STS_XACT          (1U << 3) /* transaction error */
+#define QTD_STS_BABBLE        (1U << 4)
+#define QTD_STS_DBE           (1U << 5) /* data buffer error */
+#define QTD_STS_HALTED        (1U << 6)
+#define QTD_STS_ACTIVE        (1U << 7)
+#define QTD_PID_SHIFT         8
+#define QTD_PID_MASK          0x03
+#define QTD_PID_OUT           0
+#define QTD_PID_IN            1
+#define QTD_PID_SETUP         2
+#define QTD_CERR_SHIFT        10
+#define QTD_CERR_MASK         0x03
+#define QTD_IOC               (1U << 15)
+#define QTD_BYTES_SHIFT       16
+#define QTD_BYTES_MASK        0x7FFF
+#define QTD_TOGGLE            (1U << 31)
+
+/* a qTD has 5 page pointers, so it can always hold 16KB no matter how the buffer is aligned */
+#define QTD_MAX_PAGES         5
+#define QTD_PAGE_SIZE         0x1000
+
+typedef struct EhciTransferDescriptor_t
+{
+	u32 Next;
+	u32 AlternateNext;
+	u32 Token;
+	u32 Buffer[QTD_MAX_PAGES];
+} EhciTransferDescriptor;
+CHECK_SIZE(EhciTransferDescriptor, 0x20);
+CHECK_OFFSET(EhciTransferDescriptor, 0x00, Next);
+CHECK_OFFSET(EhciTransferDescriptor, 0x04, AlternateNext);
+CHECK_OFFSET(EhciTransferDescriptor, 0x08, Token);
+CHECK_OFFSET(EhciTransferDescriptor, 0x0C, Buffer);
+
+#define QH_SET(field, value) \
+	(((u32)(value) & QH_##field##_MASK) << QH_##field##_SHIFT)
+#define QH_GET(field, var) (((var) >> QH_##field##_SHIFT) & QH_##field##_MASK)
+
+/* queue head characteristics */
+#define QH_ADDRESS_SHIFT      0
+#define QH_ADDRESS_MASK       0x7F
+#define QH_ENDPOINT_SHIFT     8
+#define QH_ENDPOINT_MASK      0x0F
+#define QH_SPEED_SHIFT        12
+#define QH_SPEED_MASK         0x03
+#define QH_SPEED_FULL         0
+#define QH_SPEED_LOW          1
+#define QH_SPEED_HIGH         2
+#define QH_DTC                (1U << 14) /* data toggle comes from the qTD */
+#define QH_HEAD               (1U << 15) /* head of the async reclamation list */
+#define QH_MPS_SHIFT          16
+#define QH_MPS_MASK           0x7FF
+#define QH_CONTROL            (1U << 27) /* only for full/low speed control endpoints */
+#define QH_NAK_RELOAD_SHIFT   28
+#define QH_NAK_RELOAD_MASK    0x0F
+/* queue head capabilities */
+#define QH_SMASK_SHIFT        0
+#define QH_SMASK_MASK         0xFF
+#define QH_MULT_SHIFT         30
+#define QH_MULT_MASK          0x03
+
+/* hollywood's ehci reads its data structures big endian, so unlike the ohci
+ * nothing in here needs swapping */
+typedef struct EhciQueueHead_t
+{
+	u32 HorizontalLink;
+	u32 Characteristics;
+	u32 Capabilities;
+	u32 CurrentTransfer;
+	/* the transfer overlay, the controller's working copy of the current qTD */
+	EhciTransferDescriptor Overlay;
+} EhciQueueHead;
+CHECK_SIZE(EhciQueueHead, 0x30);
+CHECK_OFFSET(EhciQueueHead, 0x00, HorizontalLink);
+CHECK_OFFSET(EhciQueueHead, 0x04, Characteristics);
+CHECK_OFFSET(EhciQueueHead, 0x08, Capabilities);
+CHECK_OFFSET(EhciQueueHead, 0x0C, CurrentTransfer);
+CHECK_OFFSET(EhciQueueHead, 0x10, Overlay);
 
 /* This structure is located at address 0x0d040000 and its registers are
  * documented in https://wiibrew.org/wiki/Hardware/USB_Host_Controller. 
@@ -36,8 +174,7 @@ typedef struct
 	u32 AsyncListAddr; //0x0d040028
 	u32 Unknown[0x09]; //0x0d04002c - 0x0d04004c
 	u32 PortConfigFlag; //0x0d040050
-	u32 PortControl; //0x0d040054 PORTSC or PORT_CTRL
-	u32 Unknown2[0x0E]; //0x0d040058 - 0x0d04008C
+	u32 PortControl[0x0F]; //0x0d040054 - 0x0d04008C PORTSC or PORT_CTRL, one per port
 	u32 MiscelaneousControl0; //0x0d040090
 	u32 PacketBufferThreshold; //0x0d040094
 	u32 PhysicalStatus0; //0x0d040098
@@ -69,7 +206,6 @@ CHECK_OFFSET(EhciRegisters, 0x28, AsyncListAddr);
 CHECK_OFFSET(EhciRegisters, 0x2C, Unknown);
 CHECK_OFFSET(EhciRegisters, 0x50, PortConfigFlag);
 CHECK_OFFSET(EhciRegisters, 0x54, PortControl);
-CHECK_OFFSET(EhciRegisters, 0x58, Unknown2);
 CHECK_OFFSET(EhciRegisters, 0x90, MiscelaneousControl0);
 CHECK_OFFSET(EhciRegisters, 0x94, PacketBufferThreshold);
 CHECK_OFFSET(EhciRegisters, 0x98, PhysicalStatus0);
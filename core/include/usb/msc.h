@@ -0,0 +1,84 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage bulk-only transport & the scsi commands it carries
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __USB_MSC_H__
+#define __USB_MSC_H__
+
+#include "types.h"
+
+/* Interface subclass & protocol of a bulk-only scsi device */
+#define MSC_SUBCLASS_SCSI           0x06
+#define MSC_PROTOCOL_BULK_ONLY      0x50
+
+/* Class specific requests, sent to the interface */
+#define MSC_REQ_GET_MAX_LUN         0xFE
+#define MSC_REQ_BULK_ONLY_RESET     0xFF
+
+/* All fields of the wrappers are little endian */
+#define MSC_CBW_SIGNATURE           0x43425355 /* "USBC" */
+#define MSC_CBW_SIZE                31
+#define MSC_CBW_DATA_IN             0x80
+#define MSC_CBW_MAX_COMMAND_LENGTH  16
+
+#define MSC_CSW_SIGNATURE           0x53425355 /* "USBS" */
+#define MSC_CSW_SIZE                13
+#define MSC_CSW_PASSED              0x00
+#define MSC_CSW_FAILED              0x01
+#define MSC_CSW_PHASE_ERROR         0x02
+
+/* Scsi commands used on top of the transport */
+#define SCSI_TEST_UNIT_READY        0x00
+#define SCSI_REQUEST_SENSE          0x03
+#define SCSI_INQUIRY                0x12
+#define SCSI_READ_CAPACITY_10       0x25
+#define SCSI_READ_10                0x28
+#define SCSI_WRITE_10               0x2A
+
+#define SCSI_TYPE_MASK              0x1F
+#define SCSI_TYPE_DIRECT_ACCESS     0x00
+
+#define SCSI_SENSE_KEY_MASK         0x0F
+#define SCSI_SENSE_NOT_READY        0x02
+#define SCSI_SENSE_UNIT_ATTENTION   0x06
+#define SCSI_ASC_MEDIUM_NOT_PRESENT 0x3A
+
+typedef struct
+{
+	u32 Signature;
+	u32 Tag;
+	u32 DataTransferLength;
+	u8 Flags;
+	u8 Lun;
+	u8 CommandLength;
+	u8 Command[MSC_CBW_MAX_COMMAND_LENGTH];
+} __attribute__((packed)) MscCommandBlockWrapper;
+CHECK_SIZE(MscCommandBlockWrapper, MSC_CBW_SIZE);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x00, Signature);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x04, Tag);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x08, DataTransferLength);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x0C, Flags);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x0D, Lun);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x0E, CommandLength);
+CHECK_OFFSET(MscCommandBlockWrapper, 0x0F, Command);
+
+typedef struct
+{
+	u32 Signature;
+	u32 Tag;
+	u32 DataResidue;
+	u8 Status;
+} __attribute__((packed)) MscCommandStatusWrapper;
+CHECK_SIZE(MscCommandStatusWrapper, MSC_CSW_SIZE);
+CHECK_OFFSET(MscCommandStatusWrapper, 0x00, Signature);
+CHECK_OFFSET(MscCommandStatusWrapper, 0x04, Tag);
+CHECK_OFFSET(MscCommandStatusWrapper, 0x08, DataResidue);
+CHECK_OFFSET(MscCommandStatusWrapper, 0x0C, Status);
+
+#endif
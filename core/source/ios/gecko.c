@@ -50,7 +50,7 @@ Copyright (C) 2009		Andre Heider "dhewg" <dhewg@wiibrew.org>
 u8 gecko_found = 0;
 static u8 gecko_console_enabled = 0;
 
-static u32 _gecko_command(u32 command)
+static inline u32 _gecko_command(u32 command)
 {
 	u32 i;
  // Memory Card Port B (Channel 1, Device 0, Frequency 3 (32Mhz Clock))
@@ -90,6 +90,9 @@ u32 _gecko_recvbyte(u8 *recvbyte)
 {
 	u32 i = 0;
 	*recvbyte = 0;
+	if (!gecko_found)
+		return 0;
+
 	i = _gecko_command(0xA0000000);
 	if (i & 0x08000000)
 	{
@@ -114,6 +117,9 @@ static u32 _gecko_checksend(void)
 u32 gecko_checkrecv(void)
 {
 	u32 i = 0;
+	if (!gecko_found)
+		return 0;
+
 	i = _gecko_command(0xD0000000);
 	if (i & 0x04000000)
 		return 1; // Return 1 if safe to recv
@@ -141,49 +147,35 @@ void gecko_flush(void)
 	while (_gecko_recvbyte(&tmp));
 }
 
-#if !defined(GECKO_SAFE)
+// the gecko only takes a single byte per exi command, so there is no dma or multi byte transfer
+// to be had. what we can do is not ask for fifo room before every byte, and only poll the
+// fifo status once it refused a byte
 static u32 gecko_sendbuffer(const void *buffer, u32 size)
 {
-	u32 left = size;
-	char *ptr = (char *)buffer;
-
-	while (left > 0)
-	{
-		if (!_gecko_sendbyte(*ptr))
-			break;
-		if (*ptr == '\n')
-			break;
-		ptr++;
-		left--;
-	}
-	return (size - left);
-}
-#endif
+	const u8 *ptr = (const u8 *)buffer;
+	u32 sent = 0;
 
 #if defined(GECKO_SAFE)
-static u32 gecko_sendbuffer_safe(const void *buffer, u32 size)
-{
-	u32 left = size;
-	char *ptr = (char *)buffer;
-
 	if ((read32(HW_EXICTRL) & EXICTRL_ENABLE_EXI) == 0)
-		return left;
+		return 0;
+#endif
 
-	while (left > 0)
+	while (sent < size)
 	{
-		if (_gecko_checksend())
+		if (_gecko_sendbyte(ptr[sent]))
 		{
-			if (!_gecko_sendbyte(*ptr))
-				break;
-			if (*ptr == '\n')
-				break;
-			ptr++;
-			left--;
+			sent++;
+			continue;
 		}
+
+#if defined(GECKO_SAFE)
+		while (!_gecko_checksend());
+#else
+		break;
+#endif
 	}
-	return (size - left);
+	return sent;
 }
-#endif
 
 void gecko_init(void)
 {
@@ -213,10 +205,19 @@ u8 gecko_enable_console(const u8 enable)
 	return gecko_console_enabled;
 }
 
+// sends the whole buffer, newlines included
+u32 gecko_write(const void *buffer, u32 size)
+{
+	if (!gecko_found || !gecko_console_enabled)
+		return 0;
+
+	return gecko_sendbuffer(buffer, size);
+}
+
 #ifndef NDEBUG
 u32 gecko_printf(const char *fmt, ...)
 {
-	if (!gecko_console_enabled)
+	if (!gecko_found || !gecko_console_enabled)
 		return 0;
 
 	va_list args;
@@ -227,11 +228,9 @@ u32 gecko_printf(const char *fmt, ...)
 	va_start(args, fmt);
 	i = vsnprintf(buffer, sizeof(buffer), fmt, args);
 	va_end(args);
+	if (i >= (s32)sizeof(buffer))
+		i = sizeof(buffer) - 1;
 
-#ifdef GECKO_SAFE
-	return gecko_sendbuffer_safe(buffer, (u32)i);
-#else
 	return gecko_sendbuffer(buffer, (u32)i);
-#endif
 }
 #endif
\ No newline at end of file
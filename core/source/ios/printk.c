@@ -16,6 +16,17 @@
 #include "ios/syscalls.h"
 #include "ios/printk.h"
 #include "ios/gecko.h"
+#include "ios/logring.h"
+
+//user mode logging goes into this ring, which the kernel drains to the gecko.
+//every module links its own copy, so every process gets its own ring
+static LogRing ProcessLogRing ALIGNED(32);
+static s32 ProcessLogRingState = 0;
+
+static inline u32 buffer_needs_newline(const char *buffer, s32 len)
+{
+	return len > 0 && buffer[len - 1] != '\n';
+}
 
 static inline void _printk_output(const char *str)
 {
@@ -25,6 +36,42 @@ static inline void _printk_output(const char *str)
 		gecko_printf(str);
 }
 
+//returns 1 if the message was taken care of, be it written or dropped
+static u32 _printk_ring_write(const char *str, s32 len)
+{
+	if (ProcessLogRingState == 0)
+		ProcessLogRingState = OSRegisterLogRing(&ProcessLogRing) >= 0 ? 1 : -1;
+
+	if (ProcessLogRingState < 0)
+		return 0;
+
+	//another thread of ours is writing. rather than waiting on it, take the syscall path
+	if (SwapWord(&ProcessLogRing.Lock, 1) != 0)
+		return 0;
+
+	const u32 addNewline = buffer_needs_newline(str, len);
+	const u32 size = (u32)len + addNewline;
+	const u32 head = ProcessLogRing.Head;
+	if (size > LOG_RING_SIZE - (head - ProcessLogRing.Tail))
+	{
+		ProcessLogRing.DroppedMessages++;
+		ProcessLogRing.Lock = 0;
+		return 1;
+	}
+
+	for (u32 i = 0; i < (u32)len; i++)
+		ProcessLogRing.Data[(head + i) & LOG_RING_MASK] = (u8)str[i];
+
+	if (addNewline)
+		ProcessLogRing.Data[(head + (u32)len) & LOG_RING_MASK] = '\n';
+
+	//the data has to be in place before the kernel can see the new head
+	__asm__ volatile("" ::: "memory");
+	ProcessLogRing.Head = head + size;
+	ProcessLogRing.Lock = 0;
+	return 1;
+}
+
 int printk(const char *fmt, ...)
 {
 	va_list args;
@@ -35,6 +82,12 @@ int printk(const char *fmt, ...)
 	s32 len = vsnprintf(buffer, sizeof(buffer), fmt, args);
 	va_end(args);
 
+	//vsnprintf returns the length it wanted, which can be more than what fit in the buffer
+	const s32 bufferedLength = len < (s32)sizeof(buffer) ? len : (s32)sizeof(buffer) - 1;
+	if (len > 0 && SPSR_MODE_MASK(GetCurrentStatusRegister()) == SPSR_USER_MODE &&
+	    _printk_ring_write(buffer, bufferedLength))
+		return len;
+
  //nintendo's debug interface is super fun
  //it expects data to be sent in chunks of 16 bytes
  //it buffers this untill a newline is sent.
@@ -52,7 +105,7 @@ int printk(const char *fmt, ...)
 		index += chunkSize;
 	}
 
-	if (len > 0 && buffer[len - 1] != '\n')
+	if (buffer_needs_newline(buffer, len))
 		_printk_output("\n");
 
 	return len;
@@ -15,6 +15,7 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 .globl GetCurrentStatusRegister
 .globl GetSavedStatusRegister
 .globl BusyDelay
+.globl SwapWord
 .text
 
 BEGIN_ASM_FUNC debug_output
@@ -42,6 +43,13 @@ BEGIN_ASM_FUNC GetSavedStatusRegister
 	bx		lr
 END_ASM_FUNC
 
+@ atomically stores r1 at [r0] and returns the old value
+BEGIN_ASM_FUNC SwapWord
+	swp		r2, r1, [r0]
+	mov		r0, r2
+	bx		lr
+END_ASM_FUNC
+
 .thumb
 BEGIN_ASM_FUNC BusyDelay
 	push {lr}
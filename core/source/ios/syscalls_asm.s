@@ -83,6 +83,8 @@ _SYSCALL OSVirtualToPhysical,		0x004F
 
 _SYSCALL OSIOSCCreateObject,		0x005B
 _SYSCALL OSIOSCDeleteObject,		0x005C
+_SYSCALL OSIOSCImportPublicKey,	0x005F
+_SYSCALL OSIOSCGenerateSharedKey,	0x0061
 _SYSCALL OSSetIOSCData,				0x0062
 _SYSCALL OSGetIOSCData,				0x0063
 _SYSCALL OSIOSCGetKeySize,			0x0064
@@ -91,8 +93,26 @@ _SYSCALL OSIOSCEncryptAsync,		0x0068
 _SYSCALL OSIOSCEncrypt,				0x0069
 _SYSCALL OSIOSCDecryptAsync,		0x006A
 _SYSCALL OSIOSCDecrypt,				0x006B
+_SYSCALL OSIOSCVerifyPublicKeySign, 0x006C
 _SYSCALL OSIOSCGenerateBlockMAC,	0x006D
 _SYSCALL OSIOSCGenerateBlockMACAsync, 0x006E
+_SYSCALL OSIOSCGenerateSignature, 0x0075
+_SYSCALL OSIOSCVerifyPublicKeySignAsync, 0x0078
+
+/* starstruck only syscalls, kept out of the IOS numbering */
+_SYSCALL OSAllocateIOBuf,			0x00C0
+_SYSCALL OSFreeIOBuf,				0x00C1
+_SYSCALL OSIOBufToDevice,			0x00C2
+_SYSCALL OSIOBufFromDevice,			0x00C3
+_SYSCALL OSReadFlashPage,			0x00C4
+_SYSCALL OSWriteFlashPage,			0x00C5
+_SYSCALL OSEraseFlashBlock,			0x00C6
+_SYSCALL OSGetFlashBlockStats,		0x00C7
+_SYSCALL OSRegisterLogRing,			0x00C8
+_SYSCALL OSIOSCGeneratePublicKey,	0x00C9
+_SYSCALL OSIOSCDecryptAndHash,		0x00CA
+_SYSCALL OSMarkFlashBlockBad,		0x00CB
+_SYSCALL OSUnregisterLogRing,		0x00CC
 
 /* this is a special svc syscall. its the only syscall left in IOS. only used for printk too */
 .thumb
@@ -173,6 +173,12 @@ static int read_to(u32 bytes)
 	}
 	while(bytes > ((u32)pages_read * PAGE_SIZE)) {
 		u32 page = boot2_page_translate(pages_read);
+		// a block that went bad after the blockmap was written can't be skipped without
+		// shifting the rest of boot2, so leave it to the other copy instead of reading it
+		if(nand_block_is_bad(page / BLOCK_SIZE)) {
+			gecko_printf("boot2 page %d (NAND 0x%x) is in a bad block\n", pages_read, page);
+			return -1;
+		}
 		nand_read_page(page, page_ptr, ecc_buf);
 		nand_wait();
 		if(nand_correct(page, page_ptr, ecc_buf) < 0) {
@@ -203,6 +209,8 @@ int boot2_load(u8 copy)
 
 	// find the best blockmap
 	for(block=BOOT2_START; block<=BOOT2_END; block++) {
+		if(nand_block_is_bad(block))
+			continue;
 		page = (block+1)*BLOCK_SIZE - 1;
 		nand_read_page(page, sector_buf, ecc_buf);
 		nand_wait();
@@ -284,7 +292,7 @@ int boot2_load(u8 copy)
 	memcpy(iv, &tik.titleid, 8);
 
 	STACK_ALIGN(u8, commonKey, OTP_COMMONKEY_SIZE, 32);
-	OTP_FetchData(5, commonKey, OTP_COMMONKEY_SIZE);
+	OTP_GetCommonKey(commonKey);
 	aes_reset();
 	aes_set_iv(iv);
 	aes_set_key(commonKey);
@@ -0,0 +1,64 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	bootprofile - timestamps of the kernel's boot phases
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <types.h>
+#include <ios/gecko.h>
+#include <ios/processor.h>
+
+#include "core/hollywood.h"
+#include "interrupt/irq.h"
+#include "scheduler/timer.h"
+#include "bootprofile.h"
+
+typedef struct
+{
+	const char *Name;
+	u32 Timestamp;
+} BootCheckpoint;
+
+//plain static data, so it can be used before the heaps and threads exist
+static BootCheckpoint BootCheckpoints[BOOT_PROFILE_MAX_CHECKPOINTS];
+static u32 BootCheckpointCount = 0;
+static u8 BootProfileDone = 0;
+
+void BootProfileCheckpoint(const char *name)
+{
+	const u32 timestamp = read32(HW_TIMER);
+	if (BootProfileDone || BootCheckpointCount >= BOOT_PROFILE_MAX_CHECKPOINTS)
+		return;
+
+	BootCheckpoints[BootCheckpointCount].Name = name;
+	BootCheckpoints[BootCheckpointCount].Timestamp = timestamp;
+	BootCheckpointCount++;
+}
+
+void BootProfileDump(void)
+{
+	BootProfileDone = 1;
+	if (BootCheckpointCount == 0)
+		return;
+
+	//the timer runs at a rate depending on the core clock, so let the timer code tell us what it is
+	const u64 ticksPerSecond = ConvertDelayToTicks(1000000);
+	const u32 start = BootCheckpoints[0].Timestamp;
+	u32 previous = start;
+
+	gecko_printf("boot profile (%u ticks/s):\n", (u32)ticksPerSecond);
+	for (u32 i = 0; i < BootCheckpointCount; i++)
+	{
+		//differences survive the timer wrapping around, as long as a phase is shorter than a wrap
+		const u32 phaseTicks = BootCheckpoints[i].Timestamp - previous;
+		const u32 totalTicks = BootCheckpoints[i].Timestamp - start;
+		gecko_printf("  %-20s %8u us (at %8u us)\n", BootCheckpoints[i].Name,
+		             (u32)(phaseTicks * 1000000ULL / ticksPerSecond),
+		             (u32)(totalTicks * 1000000ULL / ticksPerSecond));
+		previous = BootCheckpoints[i].Timestamp;
+	}
+}
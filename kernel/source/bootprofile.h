@@ -0,0 +1,24 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	bootprofile - timestamps of the kernel's boot phases
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __BOOTPROFILE_H__
+#define __BOOTPROFILE_H__
+
+#include <types.h>
+
+#define BOOT_PROFILE_MAX_CHECKPOINTS 32
+
+//marks the end of the boot phase called name. name has to be a string literal,
+//only the pointer is kept. checkpoints after the table is full or dumped are ignored
+void BootProfileCheckpoint(const char *name);
+//prints every phase and how long it took over the gecko, and stops recording
+void BootProfileDump(void);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	aes software - aes-128-cbc on the cpu, for inputs too small to be worth the engine
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+
+#include "crypto/aes_software.h"
+
+#ifndef MIOS
+
+#define AES_ROUNDS    10
+#define AES_KEY_WORDS (4 * (AES_ROUNDS + 1))
+
+//tables are built on first use instead of taking up space in the binary
+static u8 Sbox[0x100];
+static u8 InverseSbox[0x100];
+static u32 EncryptTable[0x100];
+static u32 DecryptTable[0x100];
+static u8 TablesReady = 0;
+
+//callers are serialised by iosc, and the schedules would not fit the iosc stack
+static u32 EncryptKeys[AES_KEY_WORDS];
+static u32 DecryptKeys[AES_KEY_WORDS];
+
+static inline u32 AES_RotateRight(u32 value, u32 bits)
+{
+	return value >> bits | value << (32 - bits);
+}
+
+static inline u8 AES_RotateByte(u8 value, u32 bits)
+{
+	return (u8)(value << bits | value >> (8 - bits));
+}
+
+static inline u8 AES_Double(u8 value)
+{
+	return (u8)(value << 1 ^ ((value & 0x80) ? 0x1B : 0x00));
+}
+
+static u8 AES_Multiply(u8 left, u8 right)
+{
+	u8 result = 0;
+	for (; right != 0; right >>= 1, left = AES_Double(left))
+	{
+		if (right & 1)
+			result ^= left;
+	}
+
+	return result;
+}
+
+static void AES_BuildTables(void)
+{
+	//walk the multiplicative group with generator 3 and its inverse to build the sbox
+	u8 power = 1, inverse = 1;
+	do
+	{
+		power = power ^ AES_Double(power);
+		inverse ^= (u8)(inverse << 1);
+		inverse ^= (u8)(inverse << 2);
+		inverse ^= (u8)(inverse << 4);
+		if (inverse & 0x80)
+			inverse ^= 0x09;
+
+		Sbox[power] = inverse ^ AES_RotateByte(inverse, 1) ^ AES_RotateByte(inverse, 2) ^
+		              AES_RotateByte(inverse, 3) ^ AES_RotateByte(inverse, 4) ^ 0x63;
+	}
+	while (power != 1);
+	Sbox[0] = 0x63;
+
+	for (u32 i = 0; i < 0x100; i++)
+		InverseSbox[Sbox[i]] = (u8)i;
+
+	for (u32 i = 0; i < 0x100; i++)
+	{
+		const u8 value = Sbox[i];
+		EncryptTable[i] = (u32)AES_Double(value) << 24 | (u32)value << 16 | (u32)value << 8 |
+		                  (u8)(AES_Double(value) ^ value);
+
+		const u8 inverseValue = InverseSbox[i];
+		DecryptTable[i] = (u32)AES_Multiply(inverseValue, 0x0E) << 24 |
+		                  (u32)AES_Multiply(inverseValue, 0x09) << 16 |
+		                  (u32)AES_Multiply(inverseValue, 0x0D) << 8 |
+		                  AES_Multiply(inverseValue, 0x0B);
+	}
+
+	TablesReady = 1;
+}
+
+static inline u32 AES_LoadWord(const u8 *data)
+{
+	return (u32)data[0] << 24 | (u32)data[1] << 16 | (u32)data[2] << 8 | data[3];
+}
+
+static inline void AES_StoreWord(u8 *data, u32 value)
+{
+	data[0] = (u8)(value >> 24);
+	data[1] = (u8)(value >> 16);
+	data[2] = (u8)(value >> 8);
+	data[3] = (u8)value;
+}
+
+static inline u32 AES_SubstituteWord(u32 word)
+{
+	return (u32)Sbox[word >> 24] << 24 | (u32)Sbox[(word >> 16) & 0xFF] << 16 |
+	       (u32)Sbox[(word >> 8) & 0xFF] << 8 | Sbox[word & 0xFF];
+}
+
+static void AES_ExpandKey(const u8 key[AES_KEY_SIZE], u8 decrypt)
+{
+	if (!TablesReady)
+		AES_BuildTables();
+
+	u8 roundConstant = 1;
+	for (u32 i = 0; i < AES_KEY_WORDS; i++)
+	{
+		if (i < 4)
+		{
+			EncryptKeys[i] = AES_LoadWord(&key[i * 4]);
+			continue;
+		}
+
+		u32 word = EncryptKeys[i - 1];
+		if ((i & 3) == 0)
+		{
+			word = AES_SubstituteWord(AES_RotateRight(word, 24)) ^ (u32)roundConstant << 24;
+			roundConstant = AES_Double(roundConstant);
+		}
+
+		EncryptKeys[i] = EncryptKeys[i - 4] ^ word;
+	}
+
+	if (!decrypt)
+		return;
+
+	//equivalent inverse cipher: reversed round keys, with the inner ones run through InvMixColumns
+	for (u32 round = 0; round <= AES_ROUNDS; round++)
+	{
+		for (u32 i = 0; i < 4; i++)
+		{
+			u32 word = EncryptKeys[(AES_ROUNDS - round) * 4 + i];
+			if (round != 0 && round != AES_ROUNDS)
+			{
+				word = DecryptTable[Sbox[word >> 24]] ^
+				       AES_RotateRight(DecryptTable[Sbox[(word >> 16) & 0xFF]], 8) ^
+				       AES_RotateRight(DecryptTable[Sbox[(word >> 8) & 0xFF]], 16) ^
+				       AES_RotateRight(DecryptTable[Sbox[word & 0xFF]], 24);
+			}
+
+			DecryptKeys[round * 4 + i] = word;
+		}
+	}
+}
+
+static void AES_EncryptBlock(const u8 *input, u8 *output)
+{
+	u32 state[4], temp[4];
+	for (u32 i = 0; i < 4; i++)
+		state[i] = AES_LoadWord(&input[i * 4]) ^ EncryptKeys[i];
+
+	for (u32 round = 1; round < AES_ROUNDS; round++)
+	{
+		for (u32 i = 0; i < 4; i++)
+		{
+			temp[i] = EncryptTable[state[i] >> 24] ^
+			          AES_RotateRight(EncryptTable[(state[(i + 1) & 3] >> 16) & 0xFF], 8) ^
+			          AES_RotateRight(EncryptTable[(state[(i + 2) & 3] >> 8) & 0xFF], 16) ^
+			          AES_RotateRight(EncryptTable[state[(i + 3) & 3] & 0xFF], 24) ^
+			          EncryptKeys[round * 4 + i];
+		}
+
+		memcpy(state, temp, sizeof(state));
+	}
+
+	for (u32 i = 0; i < 4; i++)
+	{
+		const u32 word = (u32)Sbox[state[i] >> 24] << 24 |
+		                 (u32)Sbox[(state[(i + 1) & 3] >> 16) & 0xFF] << 16 |
+		                 (u32)Sbox[(state[(i + 2) & 3] >> 8) & 0xFF] << 8 |
+		                 Sbox[state[(i + 3) & 3] & 0xFF];
+		AES_StoreWord(&output[i * 4], word ^ EncryptKeys[AES_ROUNDS * 4 + i]);
+	}
+}
+
+static void AES_DecryptBlock(const u8 *input, u8 *output)
+{
+	u32 state[4], temp[4];
+	for (u32 i = 0; i < 4; i++)
+		state[i] = AES_LoadWord(&input[i * 4]) ^ DecryptKeys[i];
+
+	for (u32 round = 1; round < AES_ROUNDS; round++)
+	{
+		for (u32 i = 0; i < 4; i++)
+		{
+			temp[i] = DecryptTable[state[i] >> 24] ^
+			          AES_RotateRight(DecryptTable[(state[(i + 3) & 3] >> 16) & 0xFF], 8) ^
+			          AES_RotateRight(DecryptTable[(state[(i + 2) & 3] >> 8) & 0xFF], 16) ^
+			          AES_RotateRight(DecryptTable[state[(i + 1) & 3] & 0xFF], 24) ^
+			          DecryptKeys[round * 4 + i];
+		}
+
+		memcpy(state, temp, sizeof(state));
+	}
+
+	for (u32 i = 0; i < 4; i++)
+	{
+		const u32 word = (u32)InverseSbox[state[i] >> 24] << 24 |
+		                 (u32)InverseSbox[(state[(i + 3) & 3] >> 16) & 0xFF] << 16 |
+		                 (u32)InverseSbox[(state[(i + 2) & 3] >> 8) & 0xFF] << 8 |
+		                 InverseSbox[state[(i + 1) & 3] & 0xFF];
+		AES_StoreWord(&output[i * 4], word ^ DecryptKeys[AES_ROUNDS * 4 + i]);
+	}
+}
+
+void AES_SoftwareEncrypt(const u8 key[AES_KEY_SIZE], u8 iv[AES_BLOCK_SIZE], const void *input,
+                         void *output, u32 size)
+{
+	const u8 *in = (const u8 *)input;
+	u8 *out = (u8 *)output;
+	u8 block[AES_BLOCK_SIZE];
+
+	AES_ExpandKey(key, 0);
+	for (u32 offset = 0; offset + AES_BLOCK_SIZE <= size; offset += AES_BLOCK_SIZE)
+	{
+		for (u32 i = 0; i < AES_BLOCK_SIZE; i++)
+			block[i] = in[offset + i] ^ iv[i];
+
+		AES_EncryptBlock(block, &out[offset]);
+		memcpy(iv, &out[offset], AES_BLOCK_SIZE);
+	}
+}
+
+void AES_SoftwareDecrypt(const u8 key[AES_KEY_SIZE], u8 iv[AES_BLOCK_SIZE], const void *input,
+                         void *output, u32 size)
+{
+	const u8 *in = (const u8 *)input;
+	u8 *out = (u8 *)output;
+	u8 block[AES_BLOCK_SIZE], nextIv[AES_BLOCK_SIZE];
+
+	AES_ExpandKey(key, 1);
+	for (u32 offset = 0; offset + AES_BLOCK_SIZE <= size; offset += AES_BLOCK_SIZE)
+	{
+		//input and output may be the same buffer, so keep the ciphertext around for chaining
+		memcpy(nextIv, &in[offset], AES_BLOCK_SIZE);
+		AES_DecryptBlock(&in[offset], block);
+		for (u32 i = 0; i < AES_BLOCK_SIZE; i++)
+			out[offset + i] = block[i] ^ iv[i];
+
+		memcpy(iv, nextIv, AES_BLOCK_SIZE);
+	}
+}
+
+#endif
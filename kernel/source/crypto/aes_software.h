@@ -0,0 +1,28 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	aes software - aes-128-cbc on the cpu, for the smallest requests
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+#ifndef MIOS
+
+#include <types.h>
+
+#define AES_BLOCK_SIZE 0x10
+#define AES_KEY_SIZE   0x10
+
+//largest synchronous request kept off the engine. picked by hand, it hasn't been timed on hardware
+#define AES_SOFTWARE_MAX_SIZE 0x40
+
+//cbc over whole blocks. like the engine, iv is updated to the last ciphertext block
+void AES_SoftwareEncrypt(const u8 key[AES_KEY_SIZE], u8 iv[AES_BLOCK_SIZE], const void *input,
+                         void *output, u32 size);
+void AES_SoftwareDecrypt(const u8 key[AES_KEY_SIZE], u8 iv[AES_BLOCK_SIZE], const void *input,
+                         void *output, u32 size);
+
+#endif
@@ -0,0 +1,738 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ecc - sect233r1 elliptic curve operations
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+
+#include "crypto/ecc.h"
+#include "crypto/sha_software.h"
+
+#ifndef MIOS
+
+//field elements of GF(2^233) and scalars are both kept as 8 little endian u32 words.
+//the field polynomial is the trinomial x^233 + x^74 + 1, the curve y^2 + xy = x^3 + x^2 + b
+#define ECC_WORDS          8
+#define ECC_WNAF_WIDTH     4
+#define ECC_WNAF_POINTS    (1 << (ECC_WNAF_WIDTH - 2))
+#define ECC_MAX_DIGITS     (ECC_WORDS * 32 + 1)
+#define ECC_MAX_SIGN_TRIES 0x10
+
+typedef u32 EccNumber[ECC_WORDS];
+
+//affine point, (0,0) is not on the curve and is used as the point at infinity
+typedef struct
+{
+	EccNumber X;
+	EccNumber Y;
+} EccPoint;
+
+//lopez-dahab projective point (X/Z, Y/Z^2), Z = 0 is the point at infinity
+typedef struct
+{
+	EccNumber X;
+	EccNumber Y;
+	EccNumber Z;
+} EccProjectivePoint;
+
+static const EccNumber ECC_CurveB = { 0x7D8F90AD, 0x81FE115F, 0x20E9CE42, 0x213B333B,
+	                                  0x0923BB58, 0x332C7F8C, 0x647EDE6C, 0x00000066 };
+static const EccNumber ECC_Order = { 0x03CFE0D7, 0x22031D26, 0xE72F8A69, 0x0013E974,
+	                                 0x00000000, 0x00000000, 0x00000000, 0x00000100 };
+static const EccPoint ECC_Generator = {
+	.X = { 0x71FD558B, 0xF8F8EB73, 0x391F8B36, 0x5FEF65BC, 0x39F1BB75, 0x8313BB21, 0xC9DFCBAC,
+	       0x000000FA },
+	.Y = { 0x01F81052, 0x36716F7E, 0xF867A7CA, 0xBF8A0BEF, 0xE58528BE, 0x03350678, 0x6A08A419,
+	       0x00000100 },
+};
+
+//scratch space is static as the iosc stack is tiny, and the iosc syscalls are serialised anyway
+static u32 ECC_MultiplyTable[16][ECC_WORDS];
+static EccPoint ECC_PointTable[ECC_WNAF_POINTS];
+static s8 ECC_Digits[ECC_MAX_DIGITS];
+
+static void ECC_ImportNumber(EccNumber number, const u8 *data, u32 size)
+{
+	memset(number, 0, sizeof(EccNumber));
+	for (u32 i = 0; i < size; i++)
+	{
+		const u32 bit = (size - 1 - i) * 8;
+		number[bit / 32] |= (u32)data[i] << (bit % 32);
+	}
+}
+static void ECC_ExportNumber(u8 *data, const EccNumber number)
+{
+	for (u32 i = 0; i < ECC_NUMBER_SIZE; i++)
+	{
+		const u32 bit = (ECC_NUMBER_SIZE - 1 - i) * 8;
+		data[i] = (u8)(number[bit / 32] >> (bit % 32));
+	}
+}
+
+static bool ECC_IsZero(const EccNumber number)
+{
+	u32 bits = 0;
+	for (u32 i = 0; i < ECC_WORDS; i++)
+		bits |= number[i];
+
+	return bits == 0;
+}
+static bool ECC_IsOne(const EccNumber number)
+{
+	u32 bits = number[0] ^ 1;
+	for (u32 i = 1; i < ECC_WORDS; i++)
+		bits |= number[i];
+
+	return bits == 0;
+}
+static s32 ECC_Compare(const EccNumber a, const EccNumber b)
+{
+	for (s32 i = ECC_WORDS - 1; i >= 0; i--)
+	{
+		if (a[i] != b[i])
+			return a[i] > b[i] ? 1 : -1;
+	}
+	return 0;
+}
+static u32 ECC_Add(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	u32 carry = 0;
+	for (u32 i = 0; i < ECC_WORDS; i++)
+	{
+		const u32 sum = a[i] + b[i] + carry;
+		carry = sum < a[i] || (sum == a[i] && carry);
+		out[i] = sum;
+	}
+	return carry;
+}
+static u32 ECC_Subtract(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	u32 borrow = 0;
+	for (u32 i = 0; i < ECC_WORDS; i++)
+	{
+		const u32 difference = a[i] - b[i] - borrow;
+		borrow = a[i] < b[i] || (a[i] == b[i] && borrow);
+		out[i] = difference;
+	}
+	return borrow;
+}
+static void ECC_ShiftRight(EccNumber number, u32 topBit)
+{
+	for (u32 i = 0; i < ECC_WORDS - 1; i++)
+		number[i] = number[i] >> 1 | number[i + 1] << 31;
+
+	number[ECC_WORDS - 1] = number[ECC_WORDS - 1] >> 1 | topBit << 31;
+}
+
+//field arithmetic. addition is a plain xor
+static inline void ECC_FieldAdd(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	for (u32 i = 0; i < ECC_WORDS; i++)
+		out[i] = a[i] ^ b[i];
+}
+
+//folds the bits above 233 back in, using x^233 = x^74 + 1
+static void ECC_FieldReduce(EccNumber out, u32 product[ECC_WORDS * 2])
+{
+	for (u32 i = ECC_WORDS * 2 - 1; i >= ECC_WORDS; i--)
+	{
+		const u32 word = product[i];
+		product[i - 8] ^= word << 23;
+		product[i - 7] ^= word >> 9;
+		product[i - 5] ^= word << 1;
+		product[i - 4] ^= word >> 31;
+	}
+
+	const u32 word = product[7] >> 9;
+	product[0] ^= word;
+	product[2] ^= word << 10;
+	product[3] ^= word >> 22;
+	product[7] &= 0x1FF;
+	memcpy(out, product, sizeof(EccNumber));
+}
+
+//carry-less comb multiplication. the table holds b times every 4 bit polynomial,
+//so every nibble of a costs a table lookup and a xor instead of 4 shift and xor steps
+static void ECC_FieldMultiply(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	memset(ECC_MultiplyTable[0], 0, sizeof(EccNumber));
+	memcpy(ECC_MultiplyTable[1], b, sizeof(EccNumber));
+	for (u32 u = 2; u < 16; u += 2)
+	{
+		const u32 *half = ECC_MultiplyTable[u / 2];
+		u32 *even = ECC_MultiplyTable[u];
+		u32 *odd = ECC_MultiplyTable[u + 1];
+		for (u32 i = ECC_WORDS - 1; i > 0; i--)
+			even[i] = half[i] << 1 | half[i - 1] >> 31;
+		even[0] = half[0] << 1;
+
+		for (u32 i = 0; i < ECC_WORDS; i++)
+			odd[i] = even[i] ^ b[i];
+	}
+
+	u32 product[ECC_WORDS * 2];
+	memset(product, 0, sizeof(product));
+	for (s32 shift = 28; shift >= 0; shift -= 4)
+	{
+		for (u32 k = 0; k < ECC_WORDS; k++)
+		{
+			const u32 *entry = ECC_MultiplyTable[(a[k] >> shift) & 0x0F];
+			for (u32 j = 0; j < ECC_WORDS; j++)
+				product[k + j] ^= entry[j];
+		}
+
+		if (shift == 0)
+			break;
+
+		for (u32 i = ECC_WORDS * 2 - 1; i > 0; i--)
+			product[i] = product[i] << 4 | product[i - 1] >> 28;
+		product[0] <<= 4;
+	}
+
+	ECC_FieldReduce(out, product);
+}
+
+//squaring in a binary field just puts a zero bit between every bit
+static inline u32 ECC_SpreadBits(u32 value)
+{
+	value = (value | value << 8) & 0x00FF00FF;
+	value = (value | value << 4) & 0x0F0F0F0F;
+	value = (value | value << 2) & 0x33333333;
+	return (value | value << 1) & 0x55555555;
+}
+static void ECC_FieldSquare(EccNumber out, const EccNumber a)
+{
+	u32 product[ECC_WORDS * 2];
+	for (u32 i = 0; i < ECC_WORDS; i++)
+	{
+		product[i * 2] = ECC_SpreadBits(a[i] & 0xFFFF);
+		product[i * 2 + 1] = ECC_SpreadBits(a[i] >> 16);
+	}
+
+	ECC_FieldReduce(out, product);
+}
+static void ECC_FieldSquareTimes(EccNumber out, const EccNumber a, u32 count)
+{
+	memcpy(out, a, sizeof(EccNumber));
+	while (count-- > 0)
+		ECC_FieldSquare(out, out);
+}
+
+//a^-1 = a^(2^233 - 2). itoh-tsujii builds a^(2^k - 1) along the chain below with
+//a^(2^(k+j) - 1) = (a^(2^k - 1))^(2^j) * a^(2^j - 1), costing 10 multiplications
+static void ECC_FieldInvert(EccNumber out, const EccNumber a)
+{
+	static const u8 chain[] = { 2, 3, 6, 7, 14, 28, 29, 58, 116, 232 };
+	EccNumber power, squared;
+	memcpy(power, a, sizeof(EccNumber));
+
+	u32 k = 1;
+	for (u32 i = 0; i < sizeof(chain); i++)
+	{
+		//every step either doubles k or adds 1 to it
+		const u32 step = chain[i] - k;
+		ECC_FieldSquareTimes(squared, power, step);
+		ECC_FieldMultiply(power, squared, step == k ? power : a);
+		k = chain[i];
+	}
+
+	ECC_FieldSquare(out, power);
+}
+
+//affine point arithmetic, used to set up the window table and for the final combination
+static inline bool ECC_PointIsInfinity(const EccPoint *point)
+{
+	return ECC_IsZero(point->X) && ECC_IsZero(point->Y);
+}
+static bool ECC_PointIsOnCurve(const EccPoint *point)
+{
+	EccNumber left, right, xPlusOne;
+
+	//y^2 + xy = y(y + x) and x^3 + x^2 + b = x^2(x + 1) + b
+	ECC_FieldAdd(left, point->Y, point->X);
+	ECC_FieldMultiply(left, left, point->Y);
+	memcpy(xPlusOne, point->X, sizeof(EccNumber));
+	xPlusOne[0] ^= 1;
+	ECC_FieldSquare(right, point->X);
+	ECC_FieldMultiply(right, right, xPlusOne);
+	ECC_FieldAdd(right, right, ECC_CurveB);
+	return ECC_Compare(left, right) == 0;
+}
+static void ECC_PointDouble(EccPoint *out, const EccPoint *point)
+{
+	//x = 0 is the point of order 2, doubling it (or infinity) ends up at infinity
+	if (ECC_IsZero(point->X))
+	{
+		memset(out, 0, sizeof(EccPoint));
+		return;
+	}
+
+	//lambda = x + y/x, x3 = lambda^2 + lambda + 1, y3 = x^2 + (lambda + 1)x3
+	EccNumber lambda, x, temp;
+	ECC_FieldInvert(temp, point->X);
+	ECC_FieldMultiply(lambda, point->Y, temp);
+	ECC_FieldAdd(lambda, lambda, point->X);
+	ECC_FieldSquare(x, lambda);
+	ECC_FieldAdd(x, x, lambda);
+	x[0] ^= 1;
+
+	ECC_FieldSquare(temp, point->X);
+	lambda[0] ^= 1;
+	ECC_FieldMultiply(lambda, lambda, x);
+	ECC_FieldAdd(out->Y, temp, lambda);
+	memcpy(out->X, x, sizeof(EccNumber));
+}
+static void ECC_PointAdd(EccPoint *out, const EccPoint *a, const EccPoint *b)
+{
+	if (ECC_PointIsInfinity(a) || ECC_PointIsInfinity(b))
+	{
+		const EccPoint *point = ECC_PointIsInfinity(a) ? b : a;
+		if (out != point)
+			memcpy(out, point, sizeof(EccPoint));
+		return;
+	}
+
+	//same x means either the same point, or its negative (x, x + y)
+	EccNumber dx, dy, lambda, x;
+	ECC_FieldAdd(dx, a->X, b->X);
+	ECC_FieldAdd(dy, a->Y, b->Y);
+	if (ECC_IsZero(dx))
+	{
+		if (ECC_IsZero(dy))
+			ECC_PointDouble(out, a);
+		else
+			memset(out, 0, sizeof(EccPoint));
+		return;
+	}
+
+	//lambda = dy/dx, x3 = lambda^2 + lambda + dx + 1, y3 = lambda(x1 + x3) + x3 + y1
+	ECC_FieldInvert(lambda, dx);
+	ECC_FieldMultiply(lambda, lambda, dy);
+	ECC_FieldSquare(x, lambda);
+	ECC_FieldAdd(x, x, lambda);
+	ECC_FieldAdd(x, x, dx);
+	x[0] ^= 1;
+
+	ECC_FieldAdd(dx, a->X, x);
+	ECC_FieldMultiply(dy, lambda, dx);
+	ECC_FieldAdd(dy, dy, x);
+	ECC_FieldAdd(out->Y, dy, a->Y);
+	memcpy(out->X, x, sizeof(EccNumber));
+}
+
+//projective doubling and mixed addition, which need no inversions at all
+static void ECC_ProjectiveDouble(EccProjectivePoint *point)
+{
+	if (ECC_IsZero(point->Z))
+		return;
+
+	//Z3 = X^2 Z^2, X3 = X^4 + bZ^4, Y3 = bZ^4 Z3 + X3(Z3 + Y^2 + bZ^4)
+	EccNumber t1, t2;
+	ECC_FieldSquare(t1, point->Z);
+	ECC_FieldSquare(t2, point->X);
+	ECC_FieldMultiply(point->Z, t1, t2);
+	ECC_FieldSquare(point->X, t2);
+	ECC_FieldSquare(t1, t1);
+	ECC_FieldMultiply(t2, t1, ECC_CurveB);
+	ECC_FieldAdd(point->X, point->X, t2);
+	ECC_FieldSquare(t1, point->Y);
+	ECC_FieldAdd(t1, t1, point->Z);
+	ECC_FieldAdd(t1, t1, t2);
+	ECC_FieldMultiply(point->Y, point->X, t1);
+	ECC_FieldMultiply(t1, t2, point->Z);
+	ECC_FieldAdd(point->Y, point->Y, t1);
+}
+static void ECC_ProjectiveAdd(EccProjectivePoint *point, const EccPoint *affine)
+{
+	if (ECC_PointIsInfinity(affine))
+		return;
+
+	if (ECC_IsZero(point->Z))
+	{
+		memcpy(point->X, affine->X, sizeof(EccNumber));
+		memcpy(point->Y, affine->Y, sizeof(EccNumber));
+		memset(point->Z, 0, sizeof(EccNumber));
+		point->Z[0] = 1;
+		return;
+	}
+
+	EccNumber t1, t2, t3;
+	ECC_FieldMultiply(t1, point->Z, affine->X);
+	ECC_FieldSquare(t2, point->Z);
+	ECC_FieldAdd(point->X, point->X, t1);
+	ECC_FieldMultiply(t1, point->Z, point->X);
+	ECC_FieldMultiply(t3, t2, affine->Y);
+	ECC_FieldAdd(point->Y, point->Y, t3);
+
+	//both points share their x coordinate: doubling when they are equal, infinity otherwise
+	if (ECC_IsZero(point->X))
+	{
+		memset(point->Z, 0, sizeof(EccNumber));
+		if (!ECC_IsZero(point->Y))
+			return;
+
+		ECC_ProjectiveAdd(point, affine);
+		ECC_ProjectiveDouble(point);
+		return;
+	}
+
+	ECC_FieldSquare(point->Z, t1);
+	ECC_FieldMultiply(t3, t1, point->Y);
+	ECC_FieldAdd(t1, t1, t2);
+	ECC_FieldSquare(t2, point->X);
+	ECC_FieldMultiply(point->X, t2, t1);
+	ECC_FieldSquare(t2, point->Y);
+	ECC_FieldAdd(point->X, point->X, t2);
+	ECC_FieldAdd(point->X, point->X, t3);
+	ECC_FieldMultiply(t2, affine->X, point->Z);
+	ECC_FieldAdd(t2, t2, point->X);
+	ECC_FieldSquare(t1, point->Z);
+	ECC_FieldAdd(t3, t3, point->Z);
+	ECC_FieldMultiply(point->Y, t3, t2);
+	ECC_FieldAdd(t2, affine->X, affine->Y);
+	ECC_FieldMultiply(t3, t1, t2);
+	ECC_FieldAdd(point->Y, point->Y, t3);
+}
+static void ECC_ProjectiveToAffine(EccPoint *out, const EccProjectivePoint *point)
+{
+	if (ECC_IsZero(point->Z))
+	{
+		memset(out, 0, sizeof(EccPoint));
+		return;
+	}
+
+	EccNumber inverse, squared;
+	ECC_FieldInvert(inverse, point->Z);
+	ECC_FieldMultiply(out->X, point->X, inverse);
+	ECC_FieldSquare(squared, inverse);
+	ECC_FieldMultiply(out->Y, point->Y, squared);
+}
+
+//width 4 non adjacent form: odd digits in -7..7 with at least 3 zeroes after each of them
+static u32 ECC_RecodeScalar(s8 *digits, const EccNumber scalar)
+{
+	u32 number[ECC_WORDS + 1];
+	memcpy(number, scalar, sizeof(EccNumber));
+	number[ECC_WORDS] = 0;
+
+	u32 length = 0;
+	while (true)
+	{
+		u32 bits = 0;
+		for (u32 i = 0; i <= ECC_WORDS; i++)
+			bits |= number[i];
+		if (bits == 0)
+			break;
+
+		s32 digit = 0;
+		if (number[0] & 1)
+		{
+			digit = (s32)(number[0] & ((1 << ECC_WNAF_WIDTH) - 1));
+			if (digit >= 1 << (ECC_WNAF_WIDTH - 1))
+				digit -= 1 << ECC_WNAF_WIDTH;
+
+			//a positive digit matches the low bits so it never borrows, a negative one can carry up
+			if (digit > 0)
+				number[0] -= (u32)digit;
+			else
+			{
+				u32 carry = (u32)-digit;
+				for (u32 i = 0; i <= ECC_WORDS && carry != 0; i++)
+				{
+					number[i] += carry;
+					carry = number[i] < carry;
+				}
+			}
+		}
+
+		digits[length++] = (s8)digit;
+		for (u32 i = 0; i < ECC_WORDS; i++)
+			number[i] = number[i] >> 1 | number[i + 1] << 31;
+		number[ECC_WORDS] >>= 1;
+	}
+
+	return length;
+}
+
+static void ECC_PointMultiply(EccPoint *out, const EccNumber scalar, const EccPoint *point)
+{
+	//odd multiples P, 3P, 5P, 7P for the window digits
+	EccPoint doubled;
+	memcpy(&ECC_PointTable[0], point, sizeof(EccPoint));
+	ECC_PointDouble(&doubled, point);
+	for (u32 i = 1; i < ECC_WNAF_POINTS; i++)
+		ECC_PointAdd(&ECC_PointTable[i], &ECC_PointTable[i - 1], &doubled);
+
+	EccProjectivePoint result;
+	memset(&result, 0, sizeof(result));
+	for (s32 i = (s32)ECC_RecodeScalar(ECC_Digits, scalar) - 1; i >= 0; i--)
+	{
+		ECC_ProjectiveDouble(&result);
+		const s32 digit = ECC_Digits[i];
+		if (digit == 0)
+			continue;
+
+		EccPoint *addend = &ECC_PointTable[(digit < 0 ? -digit : digit) / 2];
+		if (digit > 0)
+		{
+			ECC_ProjectiveAdd(&result, addend);
+			continue;
+		}
+
+		//-(x, y) = (x, x + y)
+		memcpy(doubled.X, addend->X, sizeof(EccNumber));
+		ECC_FieldAdd(doubled.Y, addend->Y, addend->X);
+		ECC_ProjectiveAdd(&result, &doubled);
+	}
+
+	ECC_ProjectiveToAffine(out, &result);
+}
+
+//arithmetic modulo the group order, for the ecdsa scalars
+static void ECC_ScalarReduce(EccNumber out, const u32 *value, u32 count)
+{
+	//shift the value in bit by bit. the remainder stays below the order, so it never overflows
+	EccNumber remainder;
+	memset(remainder, 0, sizeof(EccNumber));
+	for (s32 bit = (s32)(count * 32) - 1; bit >= 0; bit--)
+	{
+		for (u32 i = ECC_WORDS - 1; i > 0; i--)
+			remainder[i] = remainder[i] << 1 | remainder[i - 1] >> 31;
+		remainder[0] = remainder[0] << 1 | ((value[bit / 32] >> (bit % 32)) & 1);
+
+		if (ECC_Compare(remainder, ECC_Order) >= 0)
+			ECC_Subtract(remainder, remainder, ECC_Order);
+	}
+
+	memcpy(out, remainder, sizeof(EccNumber));
+}
+static void ECC_ScalarMultiply(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	u32 product[ECC_WORDS * 2];
+	memset(product, 0, sizeof(product));
+	for (u32 i = 0; i < ECC_WORDS; i++)
+	{
+		u64 carry = 0;
+		for (u32 j = 0; j < ECC_WORDS; j++)
+		{
+			carry += (u64)a[i] * b[j] + product[i + j];
+			product[i + j] = (u32)carry;
+			carry >>= 32;
+		}
+		product[i + ECC_WORDS] = (u32)carry;
+	}
+
+	ECC_ScalarReduce(out, product, ECC_WORDS * 2);
+}
+static void ECC_ScalarAdd(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	if (ECC_Add(out, a, b) != 0 || ECC_Compare(out, ECC_Order) >= 0)
+		ECC_Subtract(out, out, ECC_Order);
+}
+static void ECC_ScalarSubtract(EccNumber out, const EccNumber a, const EccNumber b)
+{
+	if (ECC_Subtract(out, a, b) != 0)
+		ECC_Add(out, out, ECC_Order);
+}
+static void ECC_ScalarHalve(EccNumber number)
+{
+	u32 carry = 0;
+	if (number[0] & 1)
+		carry = ECC_Add(number, number, ECC_Order);
+
+	ECC_ShiftRight(number, carry);
+}
+//binary extended euclid, a has to be non zero
+static void ECC_ScalarInvert(EccNumber out, const EccNumber a)
+{
+	EccNumber u, v, x1, x2;
+	memcpy(u, a, sizeof(EccNumber));
+	memcpy(v, ECC_Order, sizeof(EccNumber));
+	memset(x1, 0, sizeof(EccNumber));
+	memset(x2, 0, sizeof(EccNumber));
+	x1[0] = 1;
+
+	while (!ECC_IsOne(u) && !ECC_IsOne(v))
+	{
+		while ((u[0] & 1) == 0)
+		{
+			ECC_ShiftRight(u, 0);
+			ECC_ScalarHalve(x1);
+		}
+		while ((v[0] & 1) == 0)
+		{
+			ECC_ShiftRight(v, 0);
+			ECC_ScalarHalve(x2);
+		}
+
+		if (ECC_Compare(u, v) >= 0)
+		{
+			ECC_Subtract(u, u, v);
+			ECC_ScalarSubtract(x1, x1, x2);
+		}
+		else
+		{
+			ECC_Subtract(v, v, u);
+			ECC_ScalarSubtract(x2, x2, x1);
+		}
+	}
+
+	memcpy(out, ECC_IsOne(u) ? x1 : x2, sizeof(EccNumber));
+}
+
+static s32 ECC_ImportPoint(EccPoint *point, const u8 *data)
+{
+	//coordinates only have 233 bits
+	if ((data[0] & 0xFE) != 0 || (data[ECC_NUMBER_SIZE] & 0xFE) != 0)
+		return IOSC_INVALID_FORMAT;
+
+	ECC_ImportNumber(point->X, data, ECC_NUMBER_SIZE);
+	ECC_ImportNumber(point->Y, &data[ECC_NUMBER_SIZE], ECC_NUMBER_SIZE);
+	if (ECC_PointIsInfinity(point) || !ECC_PointIsOnCurve(point))
+		return IOSC_INVALID_FORMAT;
+
+	return IPC_SUCCESS;
+}
+
+//deterministic nonce in the spirit of rfc 6979: hashing the private key together with
+//the message hash gives every message its own secret nonce, without needing a random source
+static void ECC_GenerateNonce(EccNumber nonce, const u8 *privateKey, const u8 *hash, u8 counter)
+{
+	u8 input[ECC_PRIVATE_KEY_SIZE + SHA_HASH_SIZE + 2];
+	u8 digests[SHA_HASH_SIZE * 2];
+	memcpy(input, privateKey, ECC_PRIVATE_KEY_SIZE);
+	memcpy(&input[ECC_PRIVATE_KEY_SIZE], hash, SHA_HASH_SIZE);
+	input[ECC_PRIVATE_KEY_SIZE + SHA_HASH_SIZE] = counter;
+	for (u32 i = 0; i < 2; i++)
+	{
+		input[ECC_PRIVATE_KEY_SIZE + SHA_HASH_SIZE + 1] = (u8)i;
+		SHA_SoftwareCalculate(input, sizeof(input), &digests[i * SHA_HASH_SIZE]);
+	}
+
+	//only 232 bits are taken, which keeps the nonce below the order without reducing it
+	ECC_ImportNumber(nonce, digests, ECC_NUMBER_SIZE - 1);
+	memset(input, 0, sizeof(input));
+	memset(digests, 0, sizeof(digests));
+}
+
+s32 ECC_GeneratePublicKey(const u8 *privateKey, u8 *publicKey)
+{
+	EccNumber scalar;
+	EccPoint point;
+	ECC_ImportNumber(scalar, privateKey, ECC_PRIVATE_KEY_SIZE);
+	ECC_PointMultiply(&point, scalar, &ECC_Generator);
+	memset(scalar, 0, sizeof(EccNumber));
+	if (ECC_PointIsInfinity(&point))
+		return IOSC_INVALID_FORMAT;
+
+	ECC_ExportNumber(publicKey, point.X);
+	ECC_ExportNumber(&publicKey[ECC_NUMBER_SIZE], point.Y);
+	return IPC_SUCCESS;
+}
+
+s32 ECC_GenerateSharedSecret(const u8 *privateKey, const u8 *publicKey, u8 *sharedSecret)
+{
+	EccNumber scalar;
+	EccPoint point;
+	s32 ret = ECC_ImportPoint(&point, publicKey);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	ECC_ImportNumber(scalar, privateKey, ECC_PRIVATE_KEY_SIZE);
+	ECC_PointMultiply(&point, scalar, &point);
+	memset(scalar, 0, sizeof(EccNumber));
+	if (ECC_PointIsInfinity(&point))
+		return IOSC_INVALID_FORMAT;
+
+	ECC_ExportNumber(sharedSecret, point.X);
+	return IPC_SUCCESS;
+}
+
+s32 ECC_GenerateSignature(const u8 *privateKey, const u8 *hash, u32 hashSize, u8 *signature)
+{
+	if (hashSize != SHA_HASH_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	EccNumber key, digest, nonce, r, s;
+	EccPoint point;
+	ECC_ImportNumber(key, privateKey, ECC_PRIVATE_KEY_SIZE);
+	ECC_ScalarReduce(key, key, ECC_WORDS);
+	if (ECC_IsZero(key))
+		return IOSC_INVALID_FORMAT;
+
+	ECC_ImportNumber(digest, hash, hashSize);
+
+	//r = (kG).x mod n, s = (e + rd) / k mod n. a zero r or s needs a new nonce
+	s32 ret = IOSC_FAIL_INTERNAL;
+	for (u32 counter = 0; counter < ECC_MAX_SIGN_TRIES; counter++)
+	{
+		ECC_GenerateNonce(nonce, privateKey, hash, (u8)counter);
+		if (ECC_IsZero(nonce))
+			continue;
+
+		ECC_PointMultiply(&point, nonce, &ECC_Generator);
+		memcpy(r, point.X, sizeof(EccNumber));
+		if (ECC_Compare(r, ECC_Order) >= 0)
+			ECC_Subtract(r, r, ECC_Order);
+		if (ECC_IsZero(r))
+			continue;
+
+		ECC_ScalarMultiply(s, r, key);
+		ECC_ScalarAdd(s, s, digest);
+		ECC_ScalarInvert(nonce, nonce);
+		ECC_ScalarMultiply(s, s, nonce);
+		if (ECC_IsZero(s))
+			continue;
+
+		ECC_ExportNumber(signature, r);
+		ECC_ExportNumber(&signature[ECC_NUMBER_SIZE], s);
+		ret = IPC_SUCCESS;
+		break;
+	}
+
+	memset(key, 0, sizeof(EccNumber));
+	memset(nonce, 0, sizeof(EccNumber));
+	return ret;
+}
+
+s32 ECC_VerifySignature(const u8 *publicKey, const u8 *hash, u32 hashSize, const u8 *signature)
+{
+	if (hashSize != SHA_HASH_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	EccPoint key, point;
+	s32 ret = ECC_ImportPoint(&key, publicKey);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	EccNumber r, s, digest, scalar;
+	ECC_ImportNumber(r, signature, ECC_NUMBER_SIZE);
+	ECC_ImportNumber(s, &signature[ECC_NUMBER_SIZE], ECC_NUMBER_SIZE);
+	if (ECC_IsZero(r) || ECC_IsZero(s) || ECC_Compare(r, ECC_Order) >= 0 ||
+	    ECC_Compare(s, ECC_Order) >= 0)
+		return IOSC_FAIL_CHECKVALUE;
+
+	//(e/s)G + (r/s)Q has to end up with r as its x coordinate
+	ECC_ImportNumber(digest, hash, hashSize);
+	ECC_ScalarInvert(s, s);
+	ECC_ScalarMultiply(scalar, r, s);
+	ECC_PointMultiply(&key, scalar, &key);
+	ECC_ScalarMultiply(scalar, digest, s);
+	ECC_PointMultiply(&point, scalar, &ECC_Generator);
+	ECC_PointAdd(&point, &point, &key);
+	if (ECC_PointIsInfinity(&point))
+		return IOSC_FAIL_CHECKVALUE;
+
+	if (ECC_Compare(point.X, ECC_Order) >= 0)
+		ECC_Subtract(point.X, point.X, ECC_Order);
+
+	return ECC_Compare(point.X, r) == 0 ? IPC_SUCCESS : IOSC_FAIL_CHECKVALUE;
+}
+
+#endif
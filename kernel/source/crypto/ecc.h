@@ -0,0 +1,29 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ecc - sect233r1 elliptic curve operations
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+#ifndef MIOS
+
+#include <types.h>
+
+//keys and signatures use the console formats: 30 byte big endian numbers,
+//public keys and signatures are 2 of them (x,y and r,s)
+#define ECC_NUMBER_SIZE      0x1E
+#define ECC_PRIVATE_KEY_SIZE ECC_NUMBER_SIZE
+#define ECC_PUBLIC_KEY_SIZE  (ECC_NUMBER_SIZE * 2)
+#define ECC_SIGNATURE_SIZE   (ECC_NUMBER_SIZE * 2)
+
+s32 ECC_GeneratePublicKey(const u8 *privateKey, u8 *publicKey);
+//x coordinate of privateKey * publicKey
+s32 ECC_GenerateSharedSecret(const u8 *privateKey, const u8 *publicKey, u8 *sharedSecret);
+s32 ECC_GenerateSignature(const u8 *privateKey, const u8 *hash, u32 hashSize, u8 *signature);
+s32 ECC_VerifySignature(const u8 *publicKey, const u8 *hash, u32 hashSize, const u8 *signature);
+
+#endif
@@ -9,22 +9,28 @@
 # see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
+#include <string.h>
 #include <ios/errno.h>
 #include <ios/ipc.h>
 #include <ios/keyring.h>
 
 #include "crypto/aes.h"
+#include "crypto/aes_software.h"
+#include "crypto/ecc.h"
 #include "crypto/iosc.h"
 #include "crypto/otp.h"
 #include "crypto/keyring.h"
 #include "crypto/boot2.h"
 #include "crypto/nand.h"
+#include "crypto/rsa.h"
 #include "crypto/seeprom.h"
+#include "crypto/sha_software.h"
 #include "interrupt/irq.h"
 #include "filedesc/calls_inner.h"
 #include "memory/memory.h"
 #include "memory/heaps.h"
 #include "messaging/messageQueue.h"
+#include "panic.h"
 
 #ifndef MIOS
 
@@ -44,12 +50,39 @@ typedef struct
 } IOSC_InformationHolder;
 
 static IOSC_InformationHolder IOSC_Information;
+
+//DecryptAndHash keeps the aes engine a chunk ahead of the sha engine.
+//both engines reply on a queue of our own, so we can wait on whichever finishes first
+#define IOSC_PIPELINE_CHUNK_SIZE 0x10000
+
+typedef struct
+{
+	IpcMessage AesReply;
+	IpcMessage ShaReply;
+	void *AesKey;
+	IoctlvMessageData *AesVectors;
+	IoctlvMessageData *ShaVectors;
+	u8 AesPending;
+	u8 ShaPending;
+	u8 Busy;
+} IOSC_PipelineState;
+
+static IOSC_PipelineState IOSC_Pipeline;
+static ShaContext IOSC_PipelineContext;
+static void *IOSC_PipelineQueueMessages[2];
+static s32 IOSC_PipelineQueueId = -1;
 // provisional size, is located at the end of the kernel section
 extern u32 __ioscstack_addr[];
 #define IOSC_SafeStackEnd (u32) __ioscstack_addr
 
 extern void IOSC_SwapStack(u32 currentStackBase, u32 newStackBase);
 
+#ifdef ROOTKEY
+// modulus of the root key, linked in from the file given as ROOTKEY
+extern const u8 rootkey_bin[];
+extern const u32 rootkey_bin_size;
+#endif
+
 static s32 IOSC_BOOT2_UpdateVersion(void);
 static s32 IOSC_BOOT2_UpdateUnk1(void);
 static s32 IOSC_BOOT2_UpdateUnk2(void);
@@ -133,6 +166,37 @@ _return_cleanup_dispatchIoctlvAsync:
 	return ret;
 }
 
+//tiny requests are done on the cpu, skipping the ipc, heap and irq round trip of the engine
+static inline u32 IOSC_UseSoftwareAes(const u32 dataSize, const s32 messageQueueId)
+{
+	return messageQueueId == -1 && dataSize != 0 && dataSize <= AES_SOFTWARE_MAX_SIZE &&
+	       (dataSize & (AES_BLOCK_SIZE - 1)) == 0;
+}
+static s32 IOSC_SoftwareAes(const u32 keyHandle, void *ivData, const void *inputData,
+                            const u32 dataSize, void *outputData, const AESCommandTypes command)
+{
+	u32 keySize = 0;
+	s32 ret = Keyring_FindKeySize(&keySize, keyHandle);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (keySize != AES_KEY_SIZE)
+		return IPC_EINVAL;
+
+	u8 key[AES_KEY_SIZE];
+	ret = Keyring_GetKey(keyHandle, key, keySize);
+	if (ret != IPC_SUCCESS)
+		return IPC_INTERNALFAIL;
+
+	if (command == AES_DECRYPT)
+		AES_SoftwareDecrypt(key, ivData, inputData, outputData, dataSize);
+	else
+		AES_SoftwareEncrypt(key, ivData, inputData, outputData, dataSize);
+
+	memset(key, 0, sizeof(key));
+	return IPC_SUCCESS;
+}
+
 static s32 _IOSC_Decrypt(const u32 keyHandle, void *ivData, const void *inputData,
                          const u32 dataSize, void *outputData,
                          const s32 MessageQueueId, IpcMessage *message)
@@ -140,6 +204,9 @@ static s32 _IOSC_Decrypt(const u32 keyHandle, void *ivData, const void *inputDat
 	if (((u32)inputData & 0x1F) != 0 || ((u32)outputData & 0x1F) != 0)
 		return -2016;
 
+	if (IOSC_UseSoftwareAes(dataSize, MessageQueueId))
+		return IOSC_SoftwareAes(keyHandle, ivData, inputData, dataSize, outputData, AES_DECRYPT);
+
 	void *keyBlob = AllocateOnHeap(KernelHeapId, 0x10);
 	if (keyBlob == NULL)
 		return IPC_ENOMEM;
@@ -199,6 +266,9 @@ static s32 _IOSC_Encrypt(const u32 keyHandle, void *ivData, const void *inputDat
 	if (((u32)inputData & 0x1F) != 0 || ((u32)outputData & 0x1F) != 0)
 		return -2016;
 
+	if (IOSC_UseSoftwareAes(dataSize, MessageQueueId))
+		return IOSC_SoftwareAes(keyHandle, ivData, inputData, dataSize, outputData, AES_ENCRYPT);
+
 	void *keyBlob = AllocateOnHeap(KernelHeapId, 0x10);
 	if (keyBlob == NULL)
 		return IPC_ENOMEM;
@@ -326,27 +396,15 @@ static s32 IOSC_DeleteKeyringEntry(u32 keyHandle)
 		return IOSC_EINVAL;
 
 	KeyringMetadata[keyHandle].IsUsed = 0;
-	s16 keyringIndex = KeyringMetadata[keyHandle].KeyringIndex;
+	const s16 keyringIndex = KeyringMetadata[keyHandle].KeyringIndex;
 	if (keyringIndex == -1)
 		return IPC_SUCCESS;
 
-	if (keyringIndex >= KEYRING_TOTAL_ENTRIES)
+	if (keyringIndex < 0 || keyringIndex >= KEYRING_ARENA_BLOCKS)
 		return IOSC_EINVAL;
 
-	while (keyringIndex < KEYRING_TOTAL_ENTRIES)
-	{
-		if (!KeyringEntries[keyringIndex].IsUsed)
-			return IOSC_EINVAL;
-
-		KeyringEntries[keyringIndex].IsUsed = 0;
-		const s16 nextKeyringIndex = (s16)KeyringEntries[keyringIndex].KeyNextPartIndex;
-		Keyring_ClearEntryData((u16)keyringIndex);
-
-		keyringIndex = nextKeyringIndex;
-		if (keyringIndex == 0)
-			break;
-	}
-
+	Keyring_FreeKeyIndex(keyringIndex);
+	KeyringMetadata[keyHandle].KeyringIndex = -1;
 	return IPC_SUCCESS;
 }
 static s32 IOSC_DeleteCustomKey(u32 keyHandle)
@@ -375,6 +433,7 @@ void IOSC_InitInformation(void)
 		}
 	}
 	IOSC_Information.messageQueueId = messageQueueId;
+	IOSC_PipelineQueueId = CreateMessageQueue(IOSC_PipelineQueueMessages, 2);
 	IOSC_SEEPROM_UpdatePRNGSeed();
 	IOSC_Information.rngSeed = (u32)IOSC_SEEPROM_GetPRNGSeed();
 	IOSC_Information.val3 = 0;
@@ -640,6 +699,61 @@ s32 IOSC_DeleteObject(u32 keyHandle)
 	return ret;
 }
 
+s32 IOSC_ImportPublicKey(const void *publicKeyData, const void *exponent, u32 publicKeyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet)
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		// the root key is built in and can not be replaced
+		ret = IOSC_EACCES;
+		if (publicKeyHandle == RSA4096_ROOTKEY)
+			break;
+
+		KeyType keyType = PrivateKey;
+		KeySubtype keySubtype = AES_128;
+		Keyring_GetKeyTypes(publicKeyHandle, &keyType, &keySubtype);
+		ret = IOSC_INVALID_OBJTYPE;
+		if (keyType != PublicKey)
+			break;
+
+		u32 keySize = 0;
+		ret = Keyring_FindKeySize(&keySize, publicKeyHandle);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(publicKeyData, keySize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		// rsa keys keep their big endian public exponent in the key metadata
+		if (keySubtype == RSA_2048 || keySubtype == RSA_4096)
+		{
+			ret = IOSC_CheckCurrentProcessCanRead(exponent, sizeof(u32));
+			if (ret != IPC_SUCCESS)
+				break;
+
+			const u8 *exponentData = (const u8 *)exponent;
+			const u32 value = (u32)exponentData[0] << 24 | (u32)exponentData[1] << 16 |
+			                  (u32)exponentData[2] << 8 | exponentData[3];
+			ret = Keyring_SetKeyMetadata(publicKeyHandle, &value);
+			if (ret != IPC_SUCCESS)
+				break;
+		}
+
+		ret = Keyring_SetKey(publicKeyHandle, publicKeyData, keySize);
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
 // Advance a monotonic hardware counter key to the requested value, then update the
 // keyring metadata. Only keys of type Other / UNKNOWN2 subtype (counters) are
 // accepted; attempting to move a counter backwards returns IOSC_INVALID_VERSION.
@@ -889,6 +1003,259 @@ s32 IOSC_DecryptAsync(const u32 keyHandle, void *ivData, const void *inputData,
 	                         messageQueueId, message);
 }
 
+static s32 IOSC_PipelineDispatch(s32 fd, u32 requestId, u32 vectorInputCount,
+                                 u32 vectorIOCount, IoctlvMessageData *vectors,
+                                 IpcMessage *reply)
+{
+	u32 flags = DisableInterrupts();
+	s32 ret = IoctlvFD_InnerWithFlag(fd, requestId, vectorInputCount, vectorIOCount, vectors,
+	                                 &MessageQueues[IOSC_PipelineQueueId], reply, 0);
+
+	RestoreInterrupts(flags);
+	return ret;
+}
+//waits until the engine behind pending has replied, and returns its result
+static s32 IOSC_PipelineWait(u8 *pending, const IpcMessage *reply)
+{
+	while (*pending)
+	{
+		IpcMessage *receivedMessage = NULL;
+		s32 ret = ReceiveMessageUnsafe(IOSC_PipelineQueueId, (void **)&receivedMessage, None);
+		if (ret != IPC_SUCCESS)
+			panic("iosReceiveMessage: %d\n", ret);
+
+		if (receivedMessage == &IOSC_Pipeline.AesReply)
+			IOSC_Pipeline.AesPending = 0;
+		else if (receivedMessage == &IOSC_Pipeline.ShaReply)
+			IOSC_Pipeline.ShaPending = 0;
+	}
+
+	return reply->Request.Result;
+}
+static s32 IOSC_PipelineWaitAes(void)
+{
+	if (!IOSC_Pipeline.AesPending)
+		return IPC_SUCCESS;
+
+	s32 ret = IOSC_PipelineWait(&IOSC_Pipeline.AesPending, &IOSC_Pipeline.AesReply);
+
+	// the engine only frees the request when it succeeded
+	if (ret != IPC_SUCCESS)
+	{
+		FreeOnHeap(KernelHeapId, IOSC_Pipeline.AesKey);
+		FreeOnHeap(KernelHeapId, IOSC_Pipeline.AesVectors);
+	}
+
+	return ret;
+}
+static s32 IOSC_PipelineWaitSha(void)
+{
+	if (!IOSC_Pipeline.ShaPending)
+		return IPC_SUCCESS;
+
+	s32 ret = IOSC_PipelineWait(&IOSC_Pipeline.ShaPending, &IOSC_Pipeline.ShaReply);
+	if (ret != IPC_SUCCESS)
+		FreeOnHeap(KernelHeapId, IOSC_Pipeline.ShaVectors);
+
+	return ret;
+}
+static s32 IOSC_PipelineDecrypt(const u8 *key, void *ivData, const void *inputData,
+                                const u32 dataSize, void *outputData)
+{
+	s32 ret = IPC_SUCCESS;
+	void *keyBlob = AllocateOnHeap(KernelHeapId, AES_KEY_SIZE);
+	IoctlvMessageData *messageData =
+	    (IoctlvMessageData *)AllocateOnHeap(KernelHeapId, 0x20);
+	if (keyBlob == NULL || messageData == NULL)
+	{
+		ret = IPC_ENOMEM;
+		goto _pipeline_decrypt_error_return;
+	}
+
+	memcpy(keyBlob, key, AES_KEY_SIZE);
+	messageData->Data = (void *)inputData;
+	messageData->Length = dataSize;
+	messageData[1].Data = keyBlob;
+	messageData[1].Length = AES_KEY_SIZE;
+	messageData[2].Data = outputData;
+	messageData[2].Length = dataSize;
+	messageData[3].Data = ivData;
+	messageData[3].Length = AES_BLOCK_SIZE;
+
+	IOSC_Pipeline.AesKey = keyBlob;
+	IOSC_Pipeline.AesVectors = messageData;
+	IOSC_Pipeline.AesPending = 1;
+	ret = IOSC_PipelineDispatch(AES_STATIC_FILEDESC, AES_DECRYPT, 2, 2, messageData,
+	                            &IOSC_Pipeline.AesReply);
+	if (ret == IPC_SUCCESS)
+		return IPC_SUCCESS;
+
+	IOSC_Pipeline.AesPending = 0;
+
+_pipeline_decrypt_error_return:
+	if (keyBlob)
+		FreeOnHeap(KernelHeapId, keyBlob);
+
+	if (messageData)
+		FreeOnHeap(KernelHeapId, messageData);
+
+	return ret;
+}
+static s32 IOSC_PipelineHash(const void *inputData, const u32 inputSize,
+                             const ShaCommandType command, void *hashData)
+{
+	IoctlvMessageData *messageData =
+	    (IoctlvMessageData *)AllocateOnHeap(KernelHeapId, 0x18);
+	if (messageData == NULL)
+		return IPC_ENOMEM;
+
+	messageData->Data = (void *)inputData;
+	messageData->Length = inputSize;
+	messageData[1].Data = &IOSC_PipelineContext;
+	messageData[1].Length = sizeof(ShaContext);
+	messageData[2].Data = hashData;
+	messageData[2].Length = hashData == NULL ? 0 : sizeof(FinalShaHash);
+
+	IOSC_Pipeline.ShaVectors = messageData;
+	IOSC_Pipeline.ShaPending = 1;
+	s32 ret = IOSC_PipelineDispatch(SHA_STATIC_FILEDESC, command, 1, 2, messageData,
+	                                &IOSC_Pipeline.ShaReply);
+	if (ret == IPC_SUCCESS)
+		return IPC_SUCCESS;
+
+	IOSC_Pipeline.ShaPending = 0;
+	FreeOnHeap(KernelHeapId, messageData);
+	return ret;
+}
+static s32 _IOSC_DecryptAndHash(const u32 keyHandle, void *ivData, const void *inputData,
+                                const u32 dataSize, void *outputData, void *hashData)
+{
+	// the plaintext is hashed straight from the output buffer, so it has to suit the sha engine
+	if (((u32)inputData & 0x1F) != 0 || ((u32)outputData & 0x3F) != 0)
+		return -2016;
+
+	if (dataSize == 0 || (dataSize & (AES_BLOCK_SIZE - 1)) != 0 || IOSC_PipelineQueueId < 0)
+		return IPC_EINVAL;
+
+	u32 keySize = 0;
+	s32 ret = Keyring_FindKeySize(&keySize, keyHandle);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (keySize != AES_KEY_SIZE)
+		return IPC_EINVAL;
+
+	u8 key[AES_KEY_SIZE];
+	if (Keyring_GetKey(keyHandle, key, keySize) != IPC_SUCCESS)
+		return IPC_INTERNALFAIL;
+
+	// the pipeline state & its reply queue exist once. the iosc lock keeps callers apart for now,
+	// but the waits below yield to other threads, so a second caller is refused rather than trusted
+	u32 flags = DisableInterrupts();
+	const u8 busy = IOSC_Pipeline.Busy;
+	IOSC_Pipeline.Busy = 1;
+	RestoreInterrupts(flags);
+	if (busy)
+	{
+		memset(key, 0, sizeof(key));
+		return IOSC_EMAX;
+	}
+
+	const u8 *input = (const u8 *)inputData;
+	u8 *output = (u8 *)outputData;
+	u32 chunkSize = dataSize < IOSC_PIPELINE_CHUNK_SIZE ? dataSize : IOSC_PIPELINE_CHUNK_SIZE;
+	ret = IOSC_PipelineDecrypt(key, ivData, input, chunkSize, output);
+	for (u32 offset = 0; ret == IPC_SUCCESS && offset < dataSize; offset += chunkSize)
+	{
+		chunkSize = dataSize - offset;
+		if (chunkSize > IOSC_PIPELINE_CHUNK_SIZE)
+			chunkSize = IOSC_PIPELINE_CHUNK_SIZE;
+
+		ret = IOSC_PipelineWaitAes();
+		if (ret != IPC_SUCCESS)
+			break;
+
+		// start on the next chunk before hashing this one, which also gives the aes
+		// engine the iv it left behind
+		const u32 nextOffset = offset + chunkSize;
+		if (nextOffset < dataSize)
+		{
+			const u32 nextSize = dataSize - nextOffset < IOSC_PIPELINE_CHUNK_SIZE ?
+			                         dataSize - nextOffset :
+			                         IOSC_PIPELINE_CHUNK_SIZE;
+			ret = IOSC_PipelineDecrypt(key, ivData, input + nextOffset, nextSize,
+			                           output + nextOffset);
+			if (ret != IPC_SUCCESS)
+				break;
+		}
+
+		// all chunks share the hash context, so the previous one has to be done first
+		ret = IOSC_PipelineWaitSha();
+		if (ret != IPC_SUCCESS)
+			break;
+
+		// only the last chunk can end in a partial block, which is left for the finalize
+		const u32 hashSize = chunkSize & (u32)~(SHA_BLOCK_SIZE - 1);
+		if (offset == 0 || hashSize != 0)
+			ret = IOSC_PipelineHash(output + offset, hashSize,
+			                        offset == 0 ? InitShaState : ContributeShaState, NULL);
+	}
+
+	const s32 aesRet = IOSC_PipelineWaitAes();
+	const s32 shaRet = IOSC_PipelineWaitSha();
+	if (ret == IPC_SUCCESS)
+		ret = aesRet != IPC_SUCCESS ? aesRet : shaRet;
+
+	if (ret == IPC_SUCCESS)
+	{
+		const u32 hashedSize = dataSize & (u32)~(SHA_BLOCK_SIZE - 1);
+		ret = IOSC_PipelineHash(output + hashedSize, dataSize - hashedSize, FinalizeShaState,
+		                        hashData);
+		if (ret == IPC_SUCCESS)
+			ret = IOSC_PipelineWaitSha();
+	}
+
+	memset(key, 0, sizeof(key));
+	IOSC_Pipeline.Busy = 0;
+	return ret;
+}
+s32 IOSC_DecryptAndHash(const u32 keyHandle, void *ivData, const void *inputData,
+                        const u32 dataSize, void *outputData, void *hashData)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(keyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(outputData, dataSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(inputData, dataSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(ivData, AES_BLOCK_SIZE);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(hashData, sizeof(FinalShaHash));
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_DecryptAndHash(keyHandle, ivData, inputData, dataSize, outputData,
+		                           hashData);
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
 static inline s32
 IOSC_GenerateBlockMACInner(const ShaContext *context, const void *inputData,
                            const u32 inputSize, const void *customData,
@@ -953,4 +1320,244 @@ s32 IOSC_GenerateBlockMAC(const ShaContext *context, const void *inputData,
 	                                  keyHandle, hmacCommand, signData, -1, NULL);
 }
 
+static s32 _IOSC_VerifyPublicKeySign(const void *inputData, const u32 inputSize,
+                                     const u32 publicKeyHandle, const void *signData)
+{
+	KeyType keyType = PrivateKey;
+	KeySubtype keySubtype = AES_128;
+	Keyring_GetKeyTypes(publicKeyHandle, &keyType, &keySubtype);
+	if (keyType == PublicKey && keySubtype == ECC_233)
+	{
+		const void *publicKey = Keyring_GetKeyPointer(publicKeyHandle);
+		if (publicKey == NULL)
+			return IOSC_ENOENT;
+
+		return ECC_VerifySignature(publicKey, inputData, inputSize, signData);
+	}
+
+	if (keyType != PublicKey || (keySubtype != RSA_2048 && keySubtype != RSA_4096))
+		return IOSC_INVALID_OBJTYPE;
+
+	// the root key is not in the keyring. its modulus is embedded when building with ROOTKEY
+	if (publicKeyHandle == RSA4096_ROOTKEY)
+	{
+#ifdef ROOTKEY
+		if (rootkey_bin_size != RSA_MAX_MODULUS_SIZE)
+			return IOSC_ENOENT;
+
+		return RSA_VerifySignature(rootkey_bin, RSA_MAX_MODULUS_SIZE, RSA_EXPONENT_F4, inputData,
+		                           inputSize, signData);
+#else
+		return IOSC_ENOENT;
+#endif
+	}
+
+	u32 keySize = 0;
+	u32 exponent = 0;
+	const void *modulus = Keyring_GetKeyPointer(publicKeyHandle);
+	if (modulus == NULL || Keyring_FindKeySize(&keySize, publicKeyHandle) != IPC_SUCCESS ||
+	    Keyring_GetKeyMetadata(publicKeyHandle, &exponent) != IPC_SUCCESS)
+		return IOSC_ENOENT;
+
+	return RSA_VerifySignature(modulus, keySize, exponent, inputData, inputSize, signData);
+}
+static inline s32 IOSC_VerifyPublicKeySignInner(const void *inputData, const u32 inputSize,
+                                                const u32 publicKeyHandle, const void *signData,
+                                                const s32 messageQueueId, IpcMessage *message)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		u32 signatureSize = 0;
+		ret = Keyring_GetSignatureSize(&signatureSize, publicKeyHandle);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(inputData, inputSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(signData, signatureSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		if (message != NULL)
+		{
+			ret = IPC_EINVAL;
+			if (messageQueueId < 0 || messageQueueId >= MAX_MESSAGEQUEUES)
+				break;
+
+			ret = IPC_EACCES;
+			if (MessageQueues[messageQueueId].ProcessId != CurrentThread->ProcessId)
+				break;
+
+			ret = IOSC_CheckCurrentProcessCanReadWrite(message, sizeof(IpcRequest));
+			if (ret != IPC_SUCCESS)
+				break;
+		}
+
+		ret = _IOSC_VerifyPublicKeySign(inputData, inputSize, publicKeyHandle, signData);
+		if (message == NULL)
+			break;
+
+		// there is no engine to hand the work to, so the async variant verifies right away
+		// and only delivers the result as a reply on the callers queue
+		message->Request.Command = IOS_REPLY;
+		message->Request.Result = ret;
+		ret = SendMessage(messageQueueId, message, RegisteredEventHandler);
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+s32 IOSC_VerifyPublicKeySign(const void *inputData, const u32 inputSize,
+                             const u32 publicKeyHandle, const void *signData)
+{
+	return IOSC_VerifyPublicKeySignInner(inputData, inputSize, publicKeyHandle, signData, -1, NULL);
+}
+s32 IOSC_VerifyPublicKeySignAsync(const void *inputData, const u32 inputSize,
+                                  const u32 publicKeyHandle, const void *signData,
+                                  const s32 messageQueueId, IpcMessage *message)
+{
+	return IOSC_VerifyPublicKeySignInner(inputData, inputSize, publicKeyHandle, signData,
+	                                     messageQueueId, message);
+}
+
+// ecc private keys are either on their own or followed by their public key
+static const void *IOSC_GetEccPrivateKey(u32 keyHandle)
+{
+	KeyType keyType = PublicKey;
+	KeySubtype keySubtype = AES_128;
+	Keyring_GetKeyTypes(keyHandle, &keyType, &keySubtype);
+	if (keySubtype != ECC_233 || (keyType != PrivateKey && keyType != PublicAndPrivateKey))
+		return NULL;
+
+	return Keyring_GetKeyPointer(keyHandle);
+}
+static bool IOSC_IsKeyOfKind(u32 keyHandle, KeyType type, KeySubtype subtype)
+{
+	KeyType keyType = Other;
+	KeySubtype keySubtype = UNKNOWN1;
+	Keyring_GetKeyTypes(keyHandle, &keyType, &keySubtype);
+	return keyType == type && keySubtype == subtype;
+}
+
+s32 IOSC_GeneratePublicKey(u32 privateKeyHandle, u32 publicKeyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet)
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(privateKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		const void *privateKey = IOSC_GetEccPrivateKey(privateKeyHandle);
+		ret = IOSC_INVALID_OBJTYPE;
+		if (privateKey == NULL || !IOSC_IsKeyOfKind(publicKeyHandle, PublicKey, ECC_233))
+			break;
+
+		u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+		ret = ECC_GeneratePublicKey(privateKey, publicKey);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = Keyring_SetKey(publicKeyHandle, publicKey, ECC_PUBLIC_KEY_SIZE);
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
+// the shared aes key is the start of the sha-1 of the shared point's x coordinate
+s32 IOSC_GenerateSharedKey(u32 privateKeyHandle, u32 publicKeyHandle, u32 sharedKeyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet)
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(privateKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(sharedKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		const void *privateKey = IOSC_GetEccPrivateKey(privateKeyHandle);
+		const void *publicKey = Keyring_GetKeyPointer(publicKeyHandle);
+		ret = IOSC_INVALID_OBJTYPE;
+		if (privateKey == NULL || publicKey == NULL ||
+		    !IOSC_IsKeyOfKind(publicKeyHandle, PublicKey, ECC_233) ||
+		    !IOSC_IsKeyOfKind(sharedKeyHandle, PrivateKey, AES_128))
+			break;
+
+		u8 sharedSecret[ECC_NUMBER_SIZE];
+		u8 sharedHash[SHA_HASH_SIZE];
+		ret = ECC_GenerateSharedSecret(privateKey, publicKey, sharedSecret);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		SHA_SoftwareCalculate(sharedSecret, sizeof(sharedSecret), sharedHash);
+		ret = Keyring_SetKey(sharedKeyHandle, sharedHash, 0x10);
+		memset(sharedSecret, 0, sizeof(sharedSecret));
+		memset(sharedHash, 0, sizeof(sharedHash));
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
+s32 IOSC_GenerateSignature(const void *inputData, const u32 inputSize,
+                           const u32 privateKeyHandle, void *signData)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet)
+
+	do
+	{
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(privateKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(inputData, inputSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(signData, ECC_SIGNATURE_SIZE);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		const void *privateKey = IOSC_GetEccPrivateKey(privateKeyHandle);
+		ret = IOSC_INVALID_OBJTYPE;
+		if (privateKey == NULL)
+			break;
+
+		ret = ECC_GenerateSignature(privateKey, inputData, inputSize, signData);
+	}
+	while (0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
 #endif
@@ -27,6 +27,7 @@ s32 IOSC_NAND_GetGen(void);
 // Syscalls start here
 s32 IOSC_CreateObject(u32 *key_handle, KeyType type, KeySubtype subtype);
 s32 IOSC_DeleteObject(u32 key_handle);
+s32 IOSC_ImportPublicKey(const void *publicKeyData, const void *exponent, u32 publicKeyHandle);
 s32 IOSC_SetData(u32 keyHandle, u32 value);
 s32 IOSC_GetData(u32 keyHandle, u32 *value);
 s32 IOSC_GetKeySize(u32 *keysize, u32 keyHandle);
@@ -41,6 +42,8 @@ s32 IOSC_Decrypt(const u32 keyHandle, void *ivData, const void *inputData,
 s32 IOSC_DecryptAsync(const u32 keyHandle, void *ivData, const void *inputData,
                       const u32 dataSize, void *outputData,
                       const s32 messageQueueId, IpcMessage *message);
+s32 IOSC_DecryptAndHash(const u32 keyHandle, void *ivData, const void *inputData,
+                        const u32 dataSize, void *outputData, void *hashData);
 s32 IOSC_GenerateBlockMACAsync(const ShaContext *context, const void *inputData,
                                const u32 inputSize, const void *customData,
                                const u32 customDataSize, const u32 keyHandle,
@@ -50,4 +53,13 @@ s32 IOSC_GenerateBlockMAC(const ShaContext *context, const void *inputData,
                           const u32 inputSize, const void *customData,
                           const u32 customDataSize, const u32 keyHandle,
                           const HMacCommandType hmacCommand, const void *signData);
+s32 IOSC_VerifyPublicKeySign(const void *inputData, const u32 inputSize,
+                             const u32 publicKeyHandle, const void *signData);
+s32 IOSC_VerifyPublicKeySignAsync(const void *inputData, const u32 inputSize,
+                                  const u32 publicKeyHandle, const void *signData,
+                                  const s32 messageQueueId, IpcMessage *message);
+s32 IOSC_GeneratePublicKey(u32 privateKeyHandle, u32 publicKeyHandle);
+s32 IOSC_GenerateSharedKey(u32 privateKeyHandle, u32 publicKeyHandle, u32 sharedKeyHandle);
+s32 IOSC_GenerateSignature(const void *inputData, const u32 inputSize,
+                           const u32 privateKeyHandle, void *signData);
 #endif
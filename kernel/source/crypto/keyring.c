@@ -18,9 +18,43 @@
 #include "crypto/seeprom.h"
 #include "crypto/iosc.h"
 
-KeyringEntry KeyringEntries[KEYRING_TOTAL_ENTRIES];
 KeyringMetadataType KeyringMetadata[KEYRING_METADATA_TOTAL_ENTRIES];
 
+static u8 KeyringArena[KEYRING_ARENA_SIZE] ALIGNED(0x20);
+static KeyringBlock KeyringBlocks[KEYRING_ARENA_BLOCKS];
+static s16 KeyringFreeBlocks[KEYRING_ARENA_ORDERS];
+
+static void Keyring_PushFreeBlock(s16 index, u8 order)
+{
+	KeyringBlocks[index].State = KeyringBlockFree;
+	KeyringBlocks[index].Order = order;
+	KeyringBlocks[index].NextFree = KeyringFreeBlocks[order];
+	KeyringFreeBlocks[order] = index;
+}
+static void Keyring_RemoveFreeBlock(s16 index, u8 order)
+{
+	s16 *link = &KeyringFreeBlocks[order];
+	while (*link >= 0 && *link != index)
+		link = &KeyringBlocks[*link].NextFree;
+
+	if (*link == index)
+		*link = KeyringBlocks[index].NextFree;
+	KeyringBlocks[index].State = KeyringBlockInterior;
+}
+static u8 *Keyring_GetKeyData(u32 keyHandle, u32 keySize)
+{
+	if (keyHandle >= KEYRING_METADATA_TOTAL_ENTRIES || !KeyringMetadata[keyHandle].IsUsed)
+		return NULL;
+
+	const s16 index = KeyringMetadata[keyHandle].KeyringIndex;
+	if (index < 0 || index >= KEYRING_ARENA_BLOCKS ||
+	    KeyringBlocks[index].State != KeyringBlockUsed ||
+	    keySize > (u32)KEYRING_ARENA_BLOCK_SIZE << KeyringBlocks[index].Order)
+		return NULL;
+
+	return &KeyringArena[index * KEYRING_ARENA_BLOCK_SIZE];
+}
+
 static inline void Keyring_Init_WithKey(u32 index, KeyType type, KeySubtype subType,
                                         const void *key, const u32 keySize)
 {
@@ -36,7 +70,7 @@ static inline void Keyring_Init_WithMetadata(u32 index, KeyType type,
 	KeyringMetadata[index].IsUsed = 1;
 	KeyringMetadata[index].Kind.Type = type;
 	KeyringMetadata[index].Kind.Subtype = subType;
-	KeyringMetadata[index].KeyringIndex = 0;
+	KeyringMetadata[index].KeyringIndex = -1;
 	Keyring_SetKeyMetadata(index, &metadata);
 }
 
@@ -57,10 +91,16 @@ void Keyring_Init(void)
 		KeyringMetadata[i].Kind.Type = 0xf;
 		KeyringMetadata[i].Kind.Subtype = 0xf;
 	}
-	for (s32 i = 0; i < KEYRING_TOTAL_ENTRIES; ++i)
+	// the whole arena starts out as free blocks of the largest size
+	memset(KeyringArena, 0, sizeof(KeyringArena));
+	for (s32 i = 0; i < KEYRING_ARENA_ORDERS; ++i)
+		KeyringFreeBlocks[i] = -1;
+	for (s16 i = KEYRING_ARENA_BLOCKS - 1; i >= 0; --i)
 	{
-		KeyringEntries[i].IsUsed = 0;
-		KeyringEntries[i].KeyNextPartIndex = 0;
+		KeyringBlocks[i].State = KeyringBlockInterior;
+		KeyringBlocks[i].Order = 0;
+		if ((i & ((1 << (KEYRING_ARENA_ORDERS - 1)) - 1)) == 0)
+			Keyring_PushFreeBlock(i, KEYRING_ARENA_ORDERS - 1);
 	}
 
 	OTP_GetNgId(&ngId);
@@ -101,56 +141,61 @@ void Keyring_Init(void)
 	                     eepromCommonKey, OTP_COMMONKEY_SIZE);
 }
 
-void Keyring_ClearEntryData(u32 keyEntryHandle)
-{
-	memset(&KeyringEntries[keyEntryHandle], 0, sizeof(KeyringEntry));
-}
-
 s16 Keyring_GetKeyIndexFitSize(const u32 keySize)
 {
-	u32 runningKeySize = 0;
-	s32 previousLink = -1;
-	s16 ret = -1;
+	u8 order = 0;
+	while ((u32)KEYRING_ARENA_BLOCK_SIZE << order < keySize)
+	{
+		if (++order >= KEYRING_ARENA_ORDERS)
+			return IOSC_FAIL_ALLOC;
+	}
 
-	for (s16 currentIndex = 0;
-	     currentIndex < KEYRING_TOTAL_ENTRIES && runningKeySize < keySize; ++currentIndex)
+	u8 freeOrder = order;
+	while (KeyringFreeBlocks[freeOrder] < 0)
 	{
-		if (KeyringEntries[currentIndex].IsUsed)
-			continue;
+		if (++freeOrder >= KEYRING_ARENA_ORDERS)
+			return IOSC_FAIL_ALLOC;
+	}
 
-		Keyring_ClearEntryData((u32)currentIndex);
-		KeyringEntries[currentIndex].IsUsed = 1;
-		if (runningKeySize != 0)
-		{ // head found, previousLink valid, link it
-			KeyringEntries[previousLink].KeyNextPartIndex = (u16)currentIndex;
-		}
-		else
-		{ // first/head part: make return value its index
-			ret = currentIndex;
-		}
-		previousLink = currentIndex;
-		runningKeySize += KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE;
+	// split larger blocks until one of the right size is left, the other halves stay free
+	const s16 index = KeyringFreeBlocks[freeOrder];
+	Keyring_RemoveFreeBlock(index, freeOrder);
+	while (freeOrder > order)
+	{
+		--freeOrder;
+		Keyring_PushFreeBlock((s16)(index + (1 << freeOrder)), freeOrder);
 	}
 
-	// could not fit the requested size, clear the temporarily linked entries
-	if (runningKeySize < keySize)
+	KeyringBlocks[index].State = KeyringBlockUsed;
+	KeyringBlocks[index].Order = order;
+	memset(&KeyringArena[index * KEYRING_ARENA_BLOCK_SIZE], 0, KEYRING_ARENA_BLOCK_SIZE << order);
+	return index;
+}
+void Keyring_FreeKeyIndex(s16 keyringIndex)
+{
+	if (keyringIndex < 0 || keyringIndex >= KEYRING_ARENA_BLOCKS ||
+	    KeyringBlocks[keyringIndex].State != KeyringBlockUsed)
+		return;
+
+	u8 order = KeyringBlocks[keyringIndex].Order;
+	memset(&KeyringArena[keyringIndex * KEYRING_ARENA_BLOCK_SIZE], 0,
+	       KEYRING_ARENA_BLOCK_SIZE << order);
+	KeyringBlocks[keyringIndex].State = KeyringBlockInterior;
+
+	// merge with the buddy for as long as it is free, so churn can't fragment the arena
+	while (order < KEYRING_ARENA_ORDERS - 1)
 	{
-		u32 keyringIndex = (u32)ret;
-		do
-		{
-			const u32 currentIndex = keyringIndex;
-			KeyringEntries[currentIndex].IsUsed = 0;
-			keyringIndex = KeyringEntries[currentIndex].KeyNextPartIndex;
-			Keyring_ClearEntryData(currentIndex);
-			if (keyringIndex == 0)
-				return IOSC_FAIL_ALLOC;
-		}
-		while (keyringIndex < KEYRING_TOTAL_ENTRIES);
+		const s16 buddy = keyringIndex ^ (1 << order);
+		if (KeyringBlocks[buddy].State != KeyringBlockFree || KeyringBlocks[buddy].Order != order)
+			break;
 
-		ret = IOSC_FAIL_ALLOC;
+		Keyring_RemoveFreeBlock(buddy, order);
+		if (buddy < keyringIndex)
+			keyringIndex = buddy;
+		order++;
 	}
 
-	return ret;
+	Keyring_PushFreeBlock(keyringIndex, order);
 }
 s32 Keyring_GetHandleFitSize(u32 *keyHandle, const u32 keySize)
 {
@@ -366,62 +411,26 @@ s32 Keyring_GetKeySizeFromType(KeyType keyType, KeySubtype keySubtype, u32 *keyS
 
 s32 Keyring_SetKey(u32 keyHandle, const void *data, u32 keySize)
 {
-	if (keyHandle >= KEYRING_METADATA_TOTAL_ENTRIES)
-		return IOSC_EINVAL;
-
-	if (!KeyringMetadata[keyHandle].IsUsed)
+	u8 *key = Keyring_GetKeyData(keyHandle, keySize);
+	if (key == NULL)
 		return IOSC_EINVAL;
 
-	s32 entryIndex = KeyringMetadata[keyHandle].KeyringIndex;
-	u32 bytesCopied = 0;
-	do
-	{
-		if (0 > entryIndex || entryIndex >= KEYRING_TOTAL_ENTRIES ||
-		    !KeyringEntries[entryIndex].IsUsed)
-			return IOSC_EINVAL;
-
-		u32 bytesToCopy = KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE;
-		if (keySize - bytesCopied <= KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE)
-			bytesToCopy = keySize - bytesCopied;
-
-		memcpy(KeyringEntries[entryIndex].Key, (const char *)data + bytesCopied, bytesToCopy);
-		bytesCopied += bytesToCopy;
-
-		entryIndex = KeyringEntries[entryIndex].KeyNextPartIndex;
-	}
-	while (entryIndex != 0);
-
+	memcpy(key, data, keySize);
 	return IPC_SUCCESS;
 }
 s32 Keyring_GetKey(u32 keyHandle, void *keyPtr, u32 keySize)
 {
-	if (keyHandle >= KEYRING_METADATA_TOTAL_ENTRIES)
-		return IOSC_EINVAL;
-
-	if (!KeyringMetadata[keyHandle].IsUsed)
+	const u8 *key = Keyring_GetKeyData(keyHandle, keySize);
+	if (key == NULL)
 		return IOSC_EINVAL;
 
-	s32 entryIndex = KeyringMetadata[keyHandle].KeyringIndex;
-	u32 bytesCopied = 0;
-	do
-	{
-		if (0 > entryIndex || entryIndex >= KEYRING_TOTAL_ENTRIES ||
-		    !KeyringEntries[entryIndex].IsUsed)
-			return IOSC_EINVAL;
-
-		u32 bytesToCopy = KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE;
-		if (keySize - bytesCopied <= KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE)
-			bytesToCopy = keySize - bytesCopied;
-
-		memcpy((char *)keyPtr + bytesCopied, KeyringEntries[entryIndex].Key, bytesToCopy);
-		bytesCopied += bytesToCopy;
-
-		entryIndex = KeyringEntries[entryIndex].KeyNextPartIndex;
-	}
-	while (entryIndex != 0);
-
+	memcpy(keyPtr, key, keySize);
 	return IPC_SUCCESS;
 }
+const void *Keyring_GetKeyPointer(u32 keyHandle)
+{
+	return Keyring_GetKeyData(keyHandle, 0);
+}
 
 s32 Keyring_SetKeyOwnerProcess(u32 keyHandle, u32 owner)
 {
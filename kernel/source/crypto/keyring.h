@@ -45,21 +45,31 @@ typedef struct
 } KeyKind;
 CHECK_SIZE(KeyKind, 0x01);
 
-#define KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE 0x20
+//keys are stored in one piece, in power of 2 sized blocks of the key arena.
+//the smallest block holds an aes key, the largest an rsa-4096 key
+#define KEYRING_ARENA_BLOCK_SIZE 0x20
+#define KEYRING_ARENA_ORDERS     5
+#define KEYRING_ARENA_MAX_KEY    (KEYRING_ARENA_BLOCK_SIZE << (KEYRING_ARENA_ORDERS - 1))
+#define KEYRING_ARENA_SIZE       0x1000
+#define KEYRING_ARENA_BLOCKS     (KEYRING_ARENA_SIZE / KEYRING_ARENA_BLOCK_SIZE)
 
-typedef struct
+typedef enum
 {
-	u8 IsUsed;
-	u8 Key[KEYRING_SINGLE_ENTRY_KEY_MAX_SIZE];
-	u8 Padding;
-	u16 KeyNextPartIndex;
-} KeyringEntry;
-CHECK_SIZE(KeyringEntry, 0x24);
-CHECK_OFFSET(KeyringEntry, 0x00, IsUsed);
-CHECK_OFFSET(KeyringEntry, 0x01, Key);
-CHECK_OFFSET(KeyringEntry, 0x22, KeyNextPartIndex);
+	KeyringBlockInterior = 0,
+	KeyringBlockFree = 1,
+	KeyringBlockUsed = 2
+} KeyringBlockState;
 
-#define KEYRING_TOTAL_ENTRIES 64
+typedef struct
+{
+	s16 NextFree;
+	u8 Order;
+	u8 State;
+} KeyringBlock;
+CHECK_SIZE(KeyringBlock, 0x04);
+CHECK_OFFSET(KeyringBlock, 0x00, NextFree);
+CHECK_OFFSET(KeyringBlock, 0x02, Order);
+CHECK_OFFSET(KeyringBlock, 0x03, State);
 
 typedef struct
 {
@@ -82,13 +92,12 @@ CHECK_OFFSET(KeyringMetadataType, 0x10, KeyringIndex);
 
 #define KEYRING_METADATA_TOTAL_ENTRIES 32
 
-extern KeyringEntry KeyringEntries[KEYRING_TOTAL_ENTRIES];
 extern KeyringMetadataType KeyringMetadata[KEYRING_METADATA_TOTAL_ENTRIES];
 
 void Keyring_Init(void);
 
-void Keyring_ClearEntryData(u32 keyEntryHandle);
 s16 Keyring_GetKeyIndexFitSize(const u32 keySize);
+void Keyring_FreeKeyIndex(s16 keyringIndex);
 s32 Keyring_GetHandleFitSize(u32 *keyHandle, const u32 keySize);
 
 s32 Keyring_FindKeySize(u32 *keySize, u32 keyHandle);
@@ -105,6 +114,8 @@ s32 Keyring_GetKeyMetadataIfOthers(u32 keyHandle, void *data);
 
 s32 Keyring_SetKey(u32 keyHandle, const void *data, u32 keySize);
 s32 Keyring_GetKey(u32 keyHandle, void *keyPtr, u32 keySize);
+//the key in place, for users that only read it (like the rsa public keys)
+const void *Keyring_GetKeyPointer(u32 keyHandle);
 
 s32 Keyring_SetKeyOwnerProcess(u32 keyHandle, u32 owner);
 s32 Keyring_GetKeyOwnerProcess(u32 keyHandle, u32 *owner);
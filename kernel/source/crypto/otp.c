@@ -91,6 +91,11 @@ CHECK_OFFSET(Otp, 0x68, RngSeed);
 CHECK_OFFSET(Otp, 0x78, unk1);
 CHECK_OFFSET(Otp, 0x7C, unk2);
 
+//the otp is read a word per command, so it is fetched once into kernel memory
+static Otp OTP_Shadow ALIGNED(0x20);
+static u32 OTP_ShadowLoaded = 0;
+static u32 OTP_CommonKeyIsSet = 0;
+
 void OTP_FetchData(u32 addr, void *out, u32 size)
 {
 	u8 *outPtr = out;
@@ -114,63 +119,64 @@ void OTP_FetchData(u32 addr, void *out, u32 size)
 	}
 }
 
-u32 OTP_IsSet(void)
+static void OTP_LoadShadow(void)
 {
-	static u32 OTP_CheckedCommonKeyIsSet = 0;
-	static u32 OTP_CommonKeyIsSet = 0;
+	if (OTP_ShadowLoaded)
+		return;
 
-	if (!OTP_CheckedCommonKeyIsSet)
-	{
-		u32 commonKey[OTP_COMMONKEY_SIZE / sizeof(u32)];
-		OTP_FetchData(5, commonKey, OTP_COMMONKEY_SIZE);
-  // if the key isn't all 0x00
-		if ((commonKey[0] | commonKey[1] | commonKey[2] | commonKey[3]) != 0)
-			OTP_CommonKeyIsSet = 1;
+	const u32 cookie = DisableInterrupts();
+	OTP_FetchData(0, &OTP_Shadow, sizeof(Otp));
+ // if the key isn't all 0x00
+	for (u32 i = 0; i < OTP_COMMONKEY_SIZE; i++)
+		OTP_CommonKeyIsSet |= OTP_Shadow.CommonKey[i] != 0;
+	OTP_ShadowLoaded = 1;
+	RestoreInterrupts(cookie);
+}
 
-		OTP_CheckedCommonKeyIsSet = 1;
-	}
+void OTP_Init(void)
+{
+	OTP_LoadShadow();
+}
 
+u32 OTP_IsSet(void)
+{
+	OTP_LoadShadow();
 	return OTP_CommonKeyIsSet;
 }
 void OTP_GetNgId(u32 *ngId)
 {
-	const u32 cookie = DisableInterrupts();
 	if (OTP_IsSet())
-	{
-		OTP_FetchData(9, ngId, sizeof(u32));
-	}
+		memcpy(ngId, &OTP_Shadow.NgId, sizeof(u32));
 	else
-	{
 		memcpy(ngId, &OTP_Dummy_NgId, sizeof(u32));
-	}
-	RestoreInterrupts(cookie);
 }
 
 void OTP_GetRngSeed(u8 seed[OTP_RNGSEED_SIZE])
 {
-	const u32 cookie = DisableInterrupts();
 	if (OTP_IsSet())
-	{
-		OTP_FetchData(26, seed, OTP_RNGSEED_SIZE);
-	}
+		memcpy(seed, OTP_Shadow.RngSeed, OTP_RNGSEED_SIZE);
 	else
-	{
 		memcpy(seed, OTP_Dummy_RngSeed, OTP_RNGSEED_SIZE);
-	}
-	RestoreInterrupts(cookie);
+}
+
+void OTP_GetCommonKey(u8 key[OTP_COMMONKEY_SIZE])
+{
+	if (OTP_IsSet())
+		memcpy(key, OTP_Shadow.CommonKey, OTP_COMMONKEY_SIZE);
+	else
+		memcpy(key, OTP_Dummy_CommonKey, OTP_COMMONKEY_SIZE);
 }
 
 void OTP_GetKeys(u8 ng_privkey_out[OTP_NGPRIVKEY_SIZE], u8 common_key_out[OTP_COMMONKEY_SIZE],
                  u8 nand_hmac_out[OTP_NANDHMAC_SIZE], u8 nand_key_out[OTP_NANDKEY_SIZE])
 {
-	const u32 cookie = DisableInterrupts();
 	if (OTP_IsSet())
 	{
-		OTP_FetchData(5, common_key_out, OTP_COMMONKEY_SIZE);
+		memcpy(common_key_out, OTP_Shadow.CommonKey, OTP_COMMONKEY_SIZE);
   // overlap on the last/first word
-		OTP_FetchData(10, ng_privkey_out, OTP_NGPRIVKEY_SIZE);
-		OTP_FetchData(17, nand_hmac_out, OTP_NANDHMAC_SIZE);
-		OTP_FetchData(22, nand_key_out, OTP_NANDKEY_SIZE);
+		memcpy(ng_privkey_out, OTP_Shadow.NgPrivateKey, OTP_NGPRIVKEY_SIZE);
+		memcpy(nand_hmac_out, OTP_Shadow.NandHmac, OTP_NANDHMAC_SIZE);
+		memcpy(nand_key_out, OTP_Shadow.NandKey, OTP_NANDKEY_SIZE);
 	}
 	else
 	{
@@ -179,5 +185,4 @@ void OTP_GetKeys(u8 ng_privkey_out[OTP_NGPRIVKEY_SIZE], u8 common_key_out[OTP_CO
 		memcpy(nand_hmac_out, OTP_Dummy_NandHmac, OTP_NANDHMAC_SIZE);
 		memcpy(nand_key_out, OTP_Dummy_NandKey, OTP_NANDKEY_SIZE);
 	}
-	RestoreInterrupts(cookie);
 }
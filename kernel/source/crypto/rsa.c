@@ -0,0 +1,284 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsa - rsa public key signature verification
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/sha.h>
+
+#include "crypto/rsa.h"
+
+#ifndef MIOS
+
+//numbers are kept as little endian u32 words, montgomery math uses R = 2^(32 * words).
+//the work buffers are static: the iosc syscalls are serialised and the buffers for
+//a 4096 bit key would not fit on the iosc stack
+static u32 RSA_Modulus[RSA_MAX_WORDS];
+static u32 RSA_Signature[RSA_MAX_WORDS];
+static u32 RSA_Base[RSA_MAX_WORDS];
+static u32 RSA_Result[RSA_MAX_WORDS];
+static u32 RSA_Product[RSA_MAX_WORDS * 2 + 2];
+static u8 RSA_Message[RSA_MAX_MODULUS_SIZE];
+
+//der encoded DigestInfo that precedes a sha-1 hash in a pkcs#1 v1.5 signature
+static const u8 RSA_Sha1DigestInfo[] = { 0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2B, 0x0E,
+	                                     0x03, 0x02, 0x1A, 0x05, 0x00, 0x04, 0x14 };
+
+//known answer for RSA_SelfTest: a 2048 bit test key with e = 65537 and its signature over
+//the sha-1 of "StarStruck rsa known answer"
+static const u8 RSA_TestModulus[] = {
+	0xB3, 0xB7, 0x3A, 0xF0, 0xD7, 0x93, 0x49, 0xC2, 0x9F, 0x93, 0x05, 0xEC,
+	0x88, 0x29, 0xA5, 0x19, 0xC5, 0xD4, 0x80, 0x03, 0xF1, 0xD6, 0x03, 0x49,
+	0xCC, 0xA1, 0xFB, 0x64, 0xEC, 0xB1, 0xAB, 0xE1, 0xBB, 0xF0, 0x5A, 0xCC,
+	0x95, 0xD6, 0xAF, 0xC9, 0xD3, 0x71, 0x48, 0xEB, 0x70, 0xDE, 0xF5, 0x38,
+	0x56, 0xE6, 0x2A, 0xEC, 0xA2, 0x38, 0x07, 0x4B, 0xB8, 0xB1, 0x0E, 0x26,
+	0xED, 0xB9, 0x5B, 0x50, 0x60, 0x23, 0x94, 0xBB, 0x90, 0x45, 0xA7, 0xBC,
+	0xB3, 0x66, 0x62, 0x46, 0x86, 0x61, 0x0A, 0x9E, 0x82, 0x09, 0x43, 0x4B,
+	0x6E, 0x87, 0x94, 0x8D, 0x62, 0x7B, 0x1D, 0xBC, 0x27, 0x8C, 0x59, 0xEC,
+	0x8D, 0xB9, 0xB4, 0x88, 0xA3, 0x8B, 0xF3, 0x3E, 0x6B, 0x4B, 0x8A, 0x0F,
+	0xF1, 0xBA, 0x33, 0x41, 0x6F, 0xC4, 0x3B, 0x1E, 0xC5, 0x9F, 0x79, 0x29,
+	0x94, 0xB7, 0x94, 0xE1, 0x6C, 0x13, 0x7A, 0x92, 0x5E, 0x10, 0x01, 0xAA,
+	0x4A, 0x0A, 0xC1, 0x0F, 0x3C, 0x45, 0xCB, 0x74, 0x5D, 0xB9, 0xB0, 0x7B,
+	0x4E, 0xC5, 0x36, 0x84, 0x4C, 0x86, 0xEE, 0xB9, 0x65, 0x4D, 0xEC, 0x6D,
+	0x0A, 0x48, 0x1C, 0x4A, 0x66, 0xAC, 0x0C, 0x0E, 0xC8, 0x8D, 0x62, 0x1E,
+	0xDA, 0xE9, 0x43, 0x4F, 0x7A, 0x77, 0x53, 0x0A, 0xE7, 0x8B, 0x29, 0xB8,
+	0x94, 0x25, 0xAE, 0x6C, 0x0B, 0x88, 0x25, 0x0C, 0x6F, 0x50, 0x56, 0x20,
+	0x73, 0xC7, 0xCD, 0x70, 0x76, 0x20, 0xCF, 0x21, 0xB0, 0x82, 0xB1, 0xFA,
+	0x5F, 0x09, 0x49, 0x04, 0x8D, 0x8A, 0x2E, 0x47, 0x4F, 0x53, 0x36, 0x2C,
+	0x5F, 0xE5, 0xDA, 0x3B, 0x2B, 0xF6, 0x68, 0x19, 0xD9, 0x42, 0x79, 0x83,
+	0x5A, 0x2B, 0xD0, 0xC4, 0xC5, 0xB8, 0x1F, 0x2C, 0x31, 0x5C, 0xE6, 0x33,
+	0xFB, 0x59, 0x19, 0x11, 0xF4, 0xD3, 0x4A, 0x8C, 0x6C, 0xAD, 0x19, 0x95,
+	0x12, 0xAC, 0xF6, 0xCF,
+};
+static const u8 RSA_TestHash[] = {
+	0x79, 0x6D, 0xEF, 0x40, 0xDB, 0xAA, 0x5A, 0x7F, 0xB4, 0x6E, 0x2A, 0x80,
+	0x0C, 0xD0, 0x19, 0x10, 0x42, 0x58, 0x47, 0x98,
+};
+static const u8 RSA_TestSignature[] = {
+	0x6C, 0x26, 0xAB, 0x85, 0xA7, 0xDE, 0xA5, 0xDA, 0xC6, 0x0A, 0xDC, 0x6F,
+	0xB9, 0x7A, 0x1B, 0xDD, 0xB6, 0xC5, 0x99, 0x22, 0x35, 0x37, 0x78, 0x3E,
+	0x7D, 0x63, 0x91, 0x74, 0x85, 0x41, 0xFD, 0x3C, 0x19, 0xC9, 0xDC, 0x49,
+	0x5C, 0x05, 0x65, 0x0C, 0xAC, 0xD1, 0x90, 0x33, 0xDB, 0x8E, 0xFE, 0xDE,
+	0x78, 0xB2, 0xB6, 0xD4, 0xE6, 0xF8, 0xE8, 0xBA, 0xF8, 0x1F, 0xEF, 0x56,
+	0x83, 0x62, 0x8C, 0x23, 0xC8, 0x93, 0x53, 0xE3, 0x80, 0x9A, 0xB1, 0xF2,
+	0x41, 0xFD, 0x41, 0x9B, 0x62, 0x76, 0xB0, 0x41, 0x85, 0xAA, 0x70, 0x2B,
+	0x9A, 0x91, 0xAF, 0x54, 0xCC, 0xF1, 0x0D, 0x72, 0x1E, 0x39, 0x13, 0xFE,
+	0xF6, 0xFB, 0x54, 0xA4, 0xF1, 0x5A, 0x77, 0x92, 0x89, 0xD7, 0x78, 0xF6,
+	0x72, 0x12, 0x6F, 0x79, 0x47, 0xAD, 0x9E, 0x64, 0x12, 0x51, 0x6D, 0x96,
+	0x48, 0x3B, 0x20, 0xA4, 0x6C, 0x6D, 0xF4, 0x36, 0xEE, 0xD2, 0xF9, 0xE2,
+	0xE4, 0xCD, 0x06, 0x74, 0xDB, 0xD9, 0x64, 0xED, 0x41, 0x50, 0x54, 0x2A,
+	0xBB, 0xCA, 0x07, 0x8C, 0x22, 0x3B, 0x17, 0x4D, 0x79, 0x99, 0xC8, 0xBF,
+	0xDB, 0xB3, 0xD1, 0x05, 0xE6, 0xD3, 0x90, 0x63, 0x75, 0x0C, 0x5C, 0x69,
+	0xC1, 0x09, 0xAF, 0x6A, 0xF1, 0x4D, 0x4F, 0x8C, 0xE8, 0x52, 0xCB, 0xD6,
+	0x09, 0x8C, 0x09, 0x41, 0x07, 0xED, 0x4E, 0xC2, 0xEB, 0x3E, 0xE1, 0x30,
+	0x0C, 0xBF, 0x25, 0x41, 0xE9, 0xB9, 0xD2, 0x45, 0xFC, 0x6F, 0x8C, 0x3C,
+	0xD3, 0xD2, 0xCD, 0x1F, 0x78, 0xD8, 0xEF, 0x9D, 0x5A, 0xB2, 0xAA, 0x98,
+	0x2E, 0x4A, 0x71, 0xD2, 0x9F, 0x43, 0xAE, 0x07, 0x72, 0x90, 0x1E, 0x8A,
+	0xDE, 0xC5, 0xFC, 0x12, 0xD4, 0x79, 0xD7, 0x68, 0xE8, 0xA2, 0xA6, 0xDA,
+	0x79, 0x7F, 0x98, 0x01, 0xF3, 0xB2, 0x4E, 0x69, 0x2F, 0x9B, 0x76, 0x86,
+	0x91, 0x15, 0x26, 0x1C,
+};
+
+static void RSA_ImportNumber(u32 *number, const u8 *data, u32 words)
+{
+	for (u32 i = 0; i < words; i++)
+	{
+		const u8 *word = &data[(words - 1 - i) * sizeof(u32)];
+		number[i] = (u32)word[0] << 24 | (u32)word[1] << 16 | (u32)word[2] << 8 | word[3];
+	}
+}
+static void RSA_ExportNumber(u8 *data, const u32 *number, u32 words)
+{
+	for (u32 i = 0; i < words; i++)
+	{
+		u8 *word = &data[(words - 1 - i) * sizeof(u32)];
+		word[0] = (u8)(number[i] >> 24);
+		word[1] = (u8)(number[i] >> 16);
+		word[2] = (u8)(number[i] >> 8);
+		word[3] = (u8)number[i];
+	}
+}
+
+static s32 RSA_Compare(const u32 *a, const u32 *b, u32 words)
+{
+	while (words-- > 0)
+	{
+		if (a[words] != b[words])
+			return a[words] > b[words] ? 1 : -1;
+	}
+	return 0;
+}
+static u32 RSA_Subtract(u32 *a, const u32 *b, u32 words)
+{
+	u32 borrow = 0;
+	for (u32 i = 0; i < words; i++)
+	{
+		const u32 value = a[i] - b[i] - borrow;
+		borrow = (a[i] < b[i]) || (a[i] == b[i] && borrow);
+		a[i] = value;
+	}
+	return borrow;
+}
+static inline void RSA_AddCarry(u32 *number, u32 carry)
+{
+	while (carry != 0)
+	{
+		*number += carry;
+		carry = *number < carry;
+		number++;
+	}
+}
+
+//-modulus^-1 mod 2^32. an odd number is its own inverse modulo 8 and
+//every newton step doubles the amount of correct bits
+static u32 RSA_InverseWord(u32 modulusWord)
+{
+	u32 inverse = modulusWord;
+	for (u32 i = 0; i < 4; i++)
+		inverse *= 2 - modulusWord * inverse;
+
+	return 0 - inverse;
+}
+
+//out = a * b / R mod modulus. out may be a or b
+static void RSA_MontgomeryMultiply(u32 *out, const u32 *a, const u32 *b, u32 inverse, u32 words)
+{
+	memset(RSA_Product, 0, (words * 2 + 2) * sizeof(u32));
+
+	//each round adds a * b[i] and a multiple of the modulus that clears the lowest word,
+	//after which the window moves up a word instead of shifting the product down
+	for (u32 i = 0; i < words; i++)
+	{
+		u32 *window = &RSA_Product[i];
+		RSA_AddCarry(&window[words], RSA_MultiplyAccumulate(window, a, words, b[i]));
+		RSA_AddCarry(&window[words],
+		             RSA_MultiplyAccumulate(window, RSA_Modulus, words, window[0] * inverse));
+	}
+
+	//the result is below 2 * modulus, so a single subtraction brings it back in range
+	u32 *result = &RSA_Product[words];
+	if (result[words] != 0 || RSA_Compare(result, RSA_Modulus, words) >= 0)
+		RSA_Subtract(result, RSA_Modulus, words);
+
+	memcpy(out, result, words * sizeof(u32));
+}
+
+//R^2 mod modulus, needed to bring a number into montgomery form
+static void RSA_MontgomerySquareOfR(u32 *out, u32 inverse, u32 words)
+{
+	//with the top bit of the modulus set, R mod modulus is simply R - modulus
+	memset(out, 0, words * sizeof(u32));
+	RSA_Subtract(out, RSA_Modulus, words);
+
+	//double it once to get 2R. squaring R * 2^t in montgomery form gives R * 2^2t,
+	//so log2(32 * words) squarings end up at R * 2^(32 * words) = R^2
+	const u32 carry = out[words - 1] >> 31;
+	for (u32 i = words - 1; i > 0; i--)
+		out[i] = out[i] << 1 | out[i - 1] >> 31;
+	out[0] <<= 1;
+	if (carry != 0 || RSA_Compare(out, RSA_Modulus, words) >= 0)
+		RSA_Subtract(out, RSA_Modulus, words);
+
+	for (u32 bits = 1; bits < words * 32; bits <<= 1)
+		RSA_MontgomeryMultiply(out, out, out, inverse, words);
+}
+
+//RSA_Result = RSA_Signature ^ exponent mod modulus
+static void RSA_ModularExponent(u32 exponent, u32 words)
+{
+	const u32 inverse = RSA_InverseWord(RSA_Modulus[0]);
+	RSA_MontgomerySquareOfR(RSA_Base, inverse, words);
+	RSA_MontgomeryMultiply(RSA_Base, RSA_Signature, RSA_Base, inverse, words);
+	memcpy(RSA_Result, RSA_Base, words * sizeof(u32));
+
+	//left to right square and multiply. the final multiply uses the plain signature,
+	//which drops the result out of montgomery form for free. this makes the common
+	//exponent 65537 cost exactly 16 squarings and 1 multiplication
+	bool inMontgomeryForm = true;
+	for (s32 bit = 30 - __builtin_clz(exponent); bit >= 0; bit--)
+	{
+		RSA_MontgomeryMultiply(RSA_Result, RSA_Result, RSA_Result, inverse, words);
+		if ((exponent & (1u << bit)) == 0)
+			continue;
+
+		inMontgomeryForm = bit != 0;
+		RSA_MontgomeryMultiply(RSA_Result, RSA_Result,
+		                       inMontgomeryForm ? RSA_Base : RSA_Signature, inverse, words);
+	}
+
+	if (!inMontgomeryForm)
+		return;
+
+	memset(RSA_Base, 0, words * sizeof(u32));
+	RSA_Base[0] = 1;
+	RSA_MontgomeryMultiply(RSA_Result, RSA_Result, RSA_Base, inverse, words);
+}
+
+s32 RSA_VerifySignature(const u8 *modulus, u32 modulusSize, u32 exponent,
+                        const u8 *hash, u32 hashSize, const u8 *signature)
+{
+	if (modulusSize != 0x100 && modulusSize != RSA_MAX_MODULUS_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	if (hashSize != sizeof(FinalShaHash))
+		return IOSC_INVALID_SIZE;
+
+	//an even modulus has no montgomery form, and real keys always use their top bit
+	if (exponent == 0 || (modulus[0] & 0x80) == 0 || (modulus[modulusSize - 1] & 0x01) == 0)
+		return IOSC_INVALID_FORMAT;
+
+	const u32 words = modulusSize / sizeof(u32);
+	RSA_ImportNumber(RSA_Modulus, modulus, words);
+	RSA_ImportNumber(RSA_Signature, signature, words);
+	if (RSA_Compare(RSA_Signature, RSA_Modulus, words) >= 0)
+		return IOSC_FAIL_CHECKVALUE;
+
+	RSA_ModularExponent(exponent, words);
+	RSA_ExportNumber(RSA_Message, RSA_Result, words);
+
+	//00 01 ff .. ff 00 DigestInfo hash
+	const u32 hashOffset = modulusSize - hashSize;
+	const u32 digestInfoOffset = hashOffset - sizeof(RSA_Sha1DigestInfo);
+	s32 ret = IPC_SUCCESS;
+	if (RSA_Message[0] != 0x00 || RSA_Message[1] != 0x01 ||
+	    RSA_Message[digestInfoOffset - 1] != 0x00)
+		ret = IOSC_FAIL_CHECKVALUE;
+
+	for (u32 i = 2; i < digestInfoOffset - 1; i++)
+	{
+		if (RSA_Message[i] != 0xFF)
+			ret = IOSC_FAIL_CHECKVALUE;
+	}
+
+	if (memcmp(&RSA_Message[digestInfoOffset], RSA_Sha1DigestInfo,
+	           sizeof(RSA_Sha1DigestInfo)) != 0 ||
+	    memcmp(&RSA_Message[hashOffset], hash, hashSize) != 0)
+		ret = IOSC_FAIL_CHECKVALUE;
+
+	return ret;
+}
+
+//a valid signature has to pass and the same signature over another hash has to fail
+s32 RSA_SelfTest(void)
+{
+	u8 hash[sizeof(RSA_TestHash)];
+
+	s32 ret = RSA_VerifySignature(RSA_TestModulus, sizeof(RSA_TestModulus), RSA_EXPONENT_F4,
+	                              RSA_TestHash, sizeof(RSA_TestHash), RSA_TestSignature);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	memcpy(hash, RSA_TestHash, sizeof(hash));
+	hash[0] ^= 0x01;
+	ret = RSA_VerifySignature(RSA_TestModulus, sizeof(RSA_TestModulus), RSA_EXPONENT_F4, hash,
+	                          sizeof(hash), RSA_TestSignature);
+	return ret == IOSC_FAIL_CHECKVALUE ? IPC_SUCCESS : IOSC_FAIL_INTERNAL;
+}
+
+#endif
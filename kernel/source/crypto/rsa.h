@@ -0,0 +1,31 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsa - rsa public key signature verification
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+#ifndef MIOS
+
+#include <types.h>
+
+#define RSA_MAX_MODULUS_SIZE 0x200
+#define RSA_MAX_WORDS        (RSA_MAX_MODULUS_SIZE / sizeof(u32))
+#define RSA_EXPONENT_F4      0x10001
+
+//out[0..count) += in[0..count) * multiplier, returns the carry word
+u32 RSA_MultiplyAccumulate(u32 *out, const u32 *in, u32 count, u32 multiplier);
+
+//checks a pkcs#1 v1.5 signature over a sha-1 hash against a big endian modulus.
+//the modulus has to be 0x100 or 0x200 bytes long and the signature just as long
+s32 RSA_VerifySignature(const u8 *modulus, u32 modulusSize, u32 exponent,
+                        const u8 *hash, u32 hashSize, const u8 *signature);
+
+//verifies a known signature and rejects it for a different hash
+s32 RSA_SelfTest(void);
+
+#endif
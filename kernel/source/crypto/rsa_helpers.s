@@ -0,0 +1,48 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsa helpers - bignum multiply accumulate loop
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <asminc.h>
+
+.arm
+.globl RSA_MultiplyAccumulate
+
+/* u32 RSA_MultiplyAccumulate(u32 *out: r0, const u32 *in: r1, u32 count: r2, u32 multiplier: r3) */
+BEGIN_ASM_FUNC RSA_MultiplyAccumulate
+	/*
+	 * r4 = carry
+	 * r5 = in[j]
+	 * r6 = out[j]
+	 * r12:r4 = in[j] * multiplier + carry
+	 */
+	push {r4-r6}
+	mov r4, #0
+	cmp r2, #0
+	beq RSA_MultiplyAccumulate_return
+
+	/*
+	 * the carry is preloaded into the low half so umlal does the multiply and the
+	 * carry in one go, leaving only the add of out[j]
+	 */
+RSA_MultiplyAccumulate_loop:
+	ldr r5, [r1], #4
+	mov r12, #0
+	ldr r6, [r0]
+	umlal r4, r12, r5, r3
+	adds r6, r6, r4
+	adc r4, r12, #0
+	str r6, [r0], #4
+	subs r2, r2, #1
+	bne RSA_MultiplyAccumulate_loop
+
+RSA_MultiplyAccumulate_return:
+	mov r0, r4
+	pop {r4-r6}
+	bx lr
+END_ASM_FUNC
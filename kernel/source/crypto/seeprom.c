@@ -79,6 +79,15 @@ CHECK_OFFSET(SeepRom, 0x48, Counters);
 CHECK_OFFSET(SeepRom, 0x5C, Padding);
 CHECK_OFFSET(SeepRom, 0x74, KoreanKey);
 
+#define SEEPROM_WORD_COUNT       (sizeof(SeepRom) / sizeof(u16))
+#define SEEPROM_PRNGSEED_WORD    0x7c
+#define SEEPROM_BOOT2_COUNTERS   0x48
+#define SEEPROM_NAND_COUNTERS    0x5c
+
+//every serial transaction is slow, so the whole chip is read once & written back per word
+static SeepRom SEEPROM_Shadow ALIGNED(0x20);
+static u32 SEEPROM_ShadowLoaded = 0;
+
 #define SEEPROM_ChipSelectHigh() set32(HW_GPIO1OUT, GP_EEP_CS)
 #define SEEPROM_ChipSelectLow()  clear32(HW_GPIO1OUT, GP_EEP_CS)
 
@@ -234,35 +243,86 @@ static s32 SEEPROM_ReadBuffer(u32 word_offset, void *data, u32 word_count)
 	return IPC_SUCCESS;
 }
 
-void SEEPROM_GetKoreanCommonKey(u8 data[OTP_COMMONKEY_SIZE])
+static u16 SEEPROM_GetShadowWord(const u32 word_offset)
+{
+	const u8 *word = &SEEPROM_Shadow.Data[word_offset * sizeof(u16)];
+	return (u16)((word[0] << 8) | word[1]);
+}
+
+static s32 SEEPROM_LoadShadow(void)
 {
+	if (SEEPROM_ShadowLoaded)
+		return IPC_SUCCESS;
+
 	const u32 cookie = DisableInterrupts();
+	s32 ret = SEEPROM_ReadBuffer(0, SEEPROM_Shadow.Data, SEEPROM_WORD_COUNT);
+	if (ret == IPC_SUCCESS)
+		SEEPROM_ShadowLoaded = 1;
+	RestoreInterrupts(cookie);
+
+	return ret;
+}
+
+//only the words that differ from the shadow are sent to the chip
+static s32 SEEPROM_WriteBuffer(const u32 word_offset, const void *data, const u32 word_count)
+{
+	const u8 *source = (const u8 *)data;
+	u32 writeEnabled = 0;
+	s32 ret = SEEPROM_LoadShadow();
+	if (ret != IPC_SUCCESS)
+		return ret;
 
-	if (OTP_IsSet())
+	for (u32 i = 0; i < word_count; ++i, source += sizeof(u16))
 	{
-		SEEPROM_ReadBuffer(0x3a, data, OTP_COMMONKEY_SIZE / sizeof(u16));
+		const u16 value = (u16)((source[0] << 8) | source[1]);
+		if (SEEPROM_GetShadowWord(word_offset + i) == value)
+			continue;
+
+		if (!writeEnabled)
+		{
+			ret = SEEPROM_SendWriteEnable();
+			if (ret != IPC_SUCCESS)
+				return ret;
+			writeEnabled = 1;
+		}
+
+		ret = SEEPROM_SendWord(word_offset + i, value);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		memcpy(&SEEPROM_Shadow.Data[(word_offset + i) * sizeof(u16)], source, sizeof(u16));
 	}
+
+	if (writeEnabled)
+		SEEPROM_SendWriteDisable();
+
+	return ret;
+}
+
+s32 SEEPROM_Init(void)
+{
+	return SEEPROM_LoadShadow();
+}
+
+void SEEPROM_GetKoreanCommonKey(u8 data[OTP_COMMONKEY_SIZE])
+{
+	if (OTP_IsSet() && SEEPROM_LoadShadow() == IPC_SUCCESS)
+		memcpy(data, SEEPROM_Shadow.KoreanKey, OTP_COMMONKEY_SIZE);
 	else
-	{
 		memcpy(data, SEEPROM_Dummy_CommonKey, OTP_COMMONKEY_SIZE);
-	}
-
-	RestoreInterrupts(cookie);
 }
 void SEEPROM_GetIdsAndNg(char ms_id_str[0x40], char ca_id_str[0x40],
                          u32 *ng_key_id, char ng_id_str[0x40], u8 ng_signature[60])
 {
-	const u32 cookie = DisableInterrupts();
 	u32 ng_id;
 	u32 ms_id, ca_id;
 
-	if (OTP_IsSet())
+	if (OTP_IsSet() && SEEPROM_LoadShadow() == IPC_SUCCESS)
 	{
-		SEEPROM_ReadBuffer(0, &ms_id, sizeof(SEEPROM_Dummy_MsId) / sizeof(u16));
-		SEEPROM_ReadBuffer(2, &ca_id, sizeof(SEEPROM_Dummy_CaId) / sizeof(u16));
-		SEEPROM_ReadBuffer(4, ng_key_id, sizeof(SEEPROM_Dummy_NgKeyId) / sizeof(u16));
-		SEEPROM_ReadBuffer(6, ng_signature,
-		                   sizeof(SEEPROM_Dummy_NgSignature) / sizeof(u16));
+		memcpy(&ms_id, &SEEPROM_Shadow.MsId, sizeof(ms_id));
+		memcpy(&ca_id, &SEEPROM_Shadow.CaId, sizeof(ca_id));
+		memcpy(ng_key_id, &SEEPROM_Shadow.NgKeyId, sizeof(*ng_key_id));
+		memcpy(ng_signature, SEEPROM_Shadow.NgSignature, sizeof(SEEPROM_Shadow.NgSignature));
 	}
 	else
 	{
@@ -272,8 +332,6 @@ void SEEPROM_GetIdsAndNg(char ms_id_str[0x40], char ca_id_str[0x40],
 		memcpy(ng_signature, SEEPROM_Dummy_NgSignature, sizeof(SEEPROM_Dummy_NgSignature));
 	}
 
-	RestoreInterrupts(cookie);
-
 	OTP_GetNgId(&ng_id);
 	snprintf(ms_id_str, 0x40, "MS%08x", ms_id);
 	snprintf(ca_id_str, 0x40, "CA%08x", ca_id);
@@ -282,30 +340,22 @@ void SEEPROM_GetIdsAndNg(char ms_id_str[0x40], char ca_id_str[0x40],
 
 s32 SEEPROM_GetPRNGSeed(void)
 {
-	u32 loword = 0;
-	s32 ret = SEEPROM_ReadWord(0x7c, &loword);
-	if (ret != IPC_SUCCESS)
-		return ret;
-
-	u32 hiword = 0;
-	ret = SEEPROM_ReadWord(0x7d, &hiword);
+	s32 ret = SEEPROM_LoadShadow();
 	if (ret != IPC_SUCCESS)
 		return ret;
 
+	const u32 loword = SEEPROM_GetShadowWord(SEEPROM_PRNGSEED_WORD);
+	const u32 hiword = SEEPROM_GetShadowWord(SEEPROM_PRNGSEED_WORD + 1);
 	return (s32)((hiword << 16) | loword);
 }
 s32 SEEPROM_UpdatePRNGSeed(void)
 {
-	u32 hiword = 0;
-	u32 loword = 0;
-
-	s32 ret = SEEPROM_ReadWord(0x7c, &loword);
+	s32 ret = SEEPROM_LoadShadow();
 	if (ret != IPC_SUCCESS)
 		return ret;
 
-	ret = SEEPROM_ReadWord(0x7d, &hiword);
-	if (ret != IPC_SUCCESS)
-		return ret;
+	u32 loword = SEEPROM_GetShadowWord(SEEPROM_PRNGSEED_WORD);
+	u32 hiword = SEEPROM_GetShadowWord(SEEPROM_PRNGSEED_WORD + 1);
 
 	if (loword == 0xFFFF)
 	{
@@ -325,38 +375,17 @@ s32 SEEPROM_UpdatePRNGSeed(void)
 		loword += 1;
 	}
 
-	ret = SEEPROM_SendWriteEnable();
-	if (ret != IPC_SUCCESS)
-		return ret;
-
-	ret = SEEPROM_SendWord(0x7c, loword & 0xffff);
-	if (ret == IPC_SUCCESS)
-		ret = SEEPROM_SendWord(0x7d, hiword & 0xffff);
-
-	SEEPROM_SendWriteDisable();
-
-	return ret;
+	const u8 seed[4] = { (u8)(loword >> 8), (u8)loword, (u8)(hiword >> 8), (u8)hiword };
+	return SEEPROM_WriteBuffer(SEEPROM_PRNGSEED_WORD, seed, 2);
 }
 
 s32 SEEPROM_BOOT2_GetCounter(BOOT2_Counter *data, s32 *counter_write_index)
 {
-	s32 ret = IPC_SUCCESS;
+	s32 ret = SEEPROM_LoadShadow();
 	BOOT2_Counter read_data[2] = { 0 };
 
-	for (u32 current_counter = 0; current_counter < 2; ++current_counter)
-	{
-		char *const data_ptr = (char *)&read_data[current_counter];
-		u32 value = 0;
-		for (u32 i = 0; i < sizeof(BOOT2_Counter); i += sizeof(u16))
-		{
-			ret = SEEPROM_ReadWord(
-			    (0x48 + current_counter * sizeof(BOOT2_Counter) + i) / sizeof(u16), &value);
-			const u16 word_value = value & 0xffff;
-			memcpy(&data_ptr[i], &word_value, sizeof(u16));
-			if (ret != IPC_SUCCESS)
-				break;
-		}
-	}
+	if (ret == IPC_SUCCESS)
+		memcpy(read_data, &SEEPROM_Shadow.Data[SEEPROM_BOOT2_COUNTERS], sizeof(read_data));
 
 	s32 index = -1;
 	void *ptr_out = NULL;
@@ -406,44 +435,18 @@ s32 SEEPROM_BOOT2_UpdateCounter(const BOOT2_Counter *data, s32 counter_write_ind
 	if (0 > counter_write_index || counter_write_index >= 2)
 		return IPC_EINVAL;
 
-	s32 ret = SEEPROM_SendWriteEnable();
-	if (ret != IPC_SUCCESS)
-		return ret;
-
-	const char *const data_ptr = (const char *)data;
-	u16 value = 0;
-	for (u32 i = 0; i < sizeof(*data); i += sizeof(u16))
-	{
-		memcpy(&value, &data_ptr[i], sizeof(u16));
-		ret = SEEPROM_SendWord(
-		    (0x48 + (u32)counter_write_index * sizeof(*data) + i) / sizeof(u16), value);
-		if (ret != IPC_SUCCESS)
-			break;
-	}
-
-	SEEPROM_SendWriteDisable();
-	return ret;
+	return SEEPROM_WriteBuffer(
+	    (SEEPROM_BOOT2_COUNTERS + (u32)counter_write_index * sizeof(*data)) / sizeof(u16), data,
+	    sizeof(*data) / sizeof(u16));
 }
 
 s32 SEEPROM_NAND_GetCounter(NAND_Counter *data, s32 *counter_write_index)
 {
-	s32 ret = IPC_SUCCESS;
+	s32 ret = SEEPROM_LoadShadow();
 	NAND_Counter read_data[3] = { 0 };
 
-	for (u32 current_counter = 0; current_counter < 3; ++current_counter)
-	{
-		char *const data_ptr = (char *)&read_data[current_counter];
-		u32 value = 0;
-		for (u32 i = 0; i < sizeof(NAND_Counter); i += sizeof(u16))
-		{
-			ret = SEEPROM_ReadWord(
-			    (0x5c + current_counter * sizeof(NAND_Counter) + i) / sizeof(u16), &value);
-			const u16 word_value = value & 0xffff;
-			memcpy(&data_ptr[i], &word_value, sizeof(u16));
-			if (ret != IPC_SUCCESS)
-				break;
-		}
-	}
+	if (ret == IPC_SUCCESS)
+		memcpy(read_data, &SEEPROM_Shadow.Data[SEEPROM_NAND_COUNTERS], sizeof(read_data));
 
 	s32 index = -1;
 	void *ptr_out = NULL;
@@ -493,21 +496,7 @@ s32 SEEPROM_NAND_UpdateCounter(const NAND_Counter *data, s32 counter_write_index
 	if (0 > counter_write_index || counter_write_index >= 3)
 		return IPC_EINVAL;
 
-	s32 ret = SEEPROM_SendWriteEnable();
-	if (ret != IPC_SUCCESS)
-		return ret;
-
-	const char *const data_ptr = (const char *)data;
-	u16 value = 0;
-	for (u32 i = 0; i < sizeof(*data); i += sizeof(u16))
-	{
-		memcpy(&value, &data_ptr[i], sizeof(u16));
-		ret = SEEPROM_SendWord(
-		    (0x5c + (u32)counter_write_index * sizeof(*data) + i) / sizeof(u16), value);
-		if (ret != IPC_SUCCESS)
-			break;
-	}
-
-	SEEPROM_SendWriteDisable();
-	return ret;
+	return SEEPROM_WriteBuffer(
+	    (SEEPROM_NAND_COUNTERS + (u32)counter_write_index * sizeof(*data)) / sizeof(u16), data,
+	    sizeof(*data) / sizeof(u16));
 }
@@ -16,6 +16,9 @@
 #include "crypto/boot2.h"
 #include "crypto/nand.h"
 
+//reads the whole chip into ram. all getters are served from that copy
+s32 SEEPROM_Init(void);
+
 void SEEPROM_GetKoreanCommonKey(u8 data[OTP_COMMONKEY_SIZE]);
 void SEEPROM_GetIdsAndNg(char ms_id_str[0x40], char ca_id_str[0x40], u32 *ng_key_id,
                          char ng_id_str[0x40], u8 ng_signature[60]);
@@ -14,6 +14,7 @@
 #include <ios/errno.h>
 
 #include "crypto/sha.h"
+#include "crypto/sha_software.h"
 #include "crypto/hmac.h"
 #include "crypto/keyring.h"
 #include "panic.h"
@@ -42,130 +43,219 @@ typedef union
 	u32 Value;
 } ShaControl;
 
+#define SHA_MAX_SESSIONS    4
+#define SHA_MAX_STEPS       4
+//most a session gets hashed in one go before the next session gets the engine
+#define SHA_SLICE_SIZE      (0x40 * SHA_BLOCK_SIZE)
+#define SHA_SESSION_PENDING 1
+
+typedef struct
+{
+	const void *Input;
+	u32 Size;
+	ShaCommandType Command;
+	u32 *Output;
+} ShaStep;
+
+typedef struct
+{
+	IpcMessage *Message;
+	ShaContext *Context;
+	ShaStep Steps[SHA_MAX_STEPS];
+	u32 StepCount;
+	u32 CurrentStep;
+	u32 Offset;
+	FinalShaHash InnerHash;
+	u8 KeyPad[SHA_BLOCK_SIZE];
+	u8 LastBlocks[(SHA_BLOCK_SIZE * 2)] ALIGNED(SHA_BLOCK_SIZE);
+} ShaSession;
+
 static const u32 Sha1InitialState[SHA_NUM_WORDS] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE,
 	                                                 0x10325476, 0xC3D2E1F0 };
 static u8 LastBlockBuffer[(SHA_BLOCK_SIZE * 2)] ALIGNED(SHA_BLOCK_SIZE) = { 0x00 };
-static FinalShaHash HmacBufferFinal = { 0x00 };
-static u8 HmacKeyPrePad[SHA_BLOCK_SIZE] = { 0x00 };
-static u8 HmacKeyPostPad[SHA_BLOCK_SIZE] = { 0x00 };
 static s32 ShaEventMessageQueueId = 0;
 
-static s32 GenerateSha(ShaContext *hashContext, const void *input, const u32 inputSize,
-                       const ShaCommandType command, FinalShaHash finalHashBuffer)
+//every request is a session with its own pads and buffers, so the engine can switch
+//between them after any slice. the states are reloaded from the context on every run
+static ShaSession ShaSessions[SHA_MAX_SESSIONS];
+static u32 ActiveShaSessions = 0;
+static u32 NextShaSession = 0;
+
+//runs blocks of data through the engine, updating the context
+static s32 HashShaBlocks(ShaContext *hashContext, const void *input, const u32 inputSize)
 {
-	u32 numberOfBlocks = 0;
-	s32 ret = IPC_EINVAL;
+	//small runs are done on the cpu, skipping the flushes and irq round trip of the engine
+	if (inputSize <= SHA_SOFTWARE_MAX_SIZE)
+	{
+		SHA_SoftwareTransform(hashContext->ShaStates, input, inputSize);
+		hashContext->Length += inputSize * 8;
+		return IPC_SUCCESS;
+	}
+
 	write32(SHA_CMD, 0);
+	DCFlushRange(input, inputSize);
+	AhbFlushTo(AHB_SHA1);
 
-	//chainingMode 0 == reset. so we set the internal hash states to the initial state
-	if (command == InitShaState)
+	//copy over the states from the context to the registers
+	for (s8 i = 0; i < SHA_NUM_WORDS; i++)
+		write32((u32)(SHA_H0 + (i * 4)), hashContext->ShaStates[i]);
+
+	write32(SHA_SRC, VirtualToPhysical((u32)input));
+	ShaControl control = { .Fields = { .Execute = 1,
+		                               .GenerateIrq = 1,
+		                               .NumberOfBlocks = ((inputSize / SHA_BLOCK_SIZE) - 1) & 0x3FF } };
+
+	write32(SHA_CMD, control.Value);
+	void *message;
+	s32 ret = ReceiveMessage(ShaEventMessageQueueId, &message, None);
+	if (ret != IPC_SUCCESS)
+		panic("iosReceiveMessage: %d\n", ret);
+
+	control.Value = read32(SHA_CMD);
+	if (control.Fields.HasError != 0)
+		return IPC_EACCES;
+
+	hashContext->Length += inputSize * 8;
+	//copy over the states from the registers to the context
+	for (s8 i = 0; i < SHA_NUM_WORDS; i++)
+		hashContext->ShaStates[i] = read32((u32)(SHA_H0 + (i * 4)));
+
+	return IPC_SUCCESS;
+}
+
+//pads the last partial block in lastBlocks and hashes it, giving the final hash
+static s32 HashShaLastBlocks(ShaContext *hashContext, const void *input, const u32 inputSize,
+                             u8 lastBlocks[SHA_BLOCK_SIZE * 2], FinalShaHash finalHashBuffer)
+{
+	write32(SHA_CMD, 0);
+
+	//This pads the final block (or rather 2 blocks) of data
+	memset(lastBlocks, 0, (SHA_BLOCK_SIZE * 2));
+	if (inputSize != 0)
+		memcpy(lastBlocks, input, inputSize);
+
+	lastBlocks[inputSize] = 0x80; //Demarcates end of last block's data and beginning of padding
+	hashContext->Length += inputSize * 8;
+	const u32 numberOfBlocks = ((inputSize + 1) < (SHA_BLOCK_SIZE - 7)) ? 1 : 2;
+
+	//places the 64-bit length value at the end of the block the data ends in
+	//I think this is what's happening, but the decompiled pseudocode is next to unreadable
+	//winging it for now, should be tested to ensure it behaves as intended
+	u32 index = numberOfBlocks * SHA_BLOCK_SIZE;
+	write32((u32)&lastBlocks[index - 4], (u32)hashContext->Length);
+	write32((u32)&lastBlocks[index - 8], (u32)(hashContext->Length >> 32));
+	if (index <= SHA_SOFTWARE_MAX_SIZE)
 	{
-		memcpy(hashContext->ShaStates, Sha1InitialState, sizeof(Sha1InitialState));
-		hashContext->Length = 0;
-		ret = IPC_SUCCESS;
+		memcpy(finalHashBuffer, hashContext->ShaStates, sizeof(FinalShaHash));
+		SHA_SoftwareTransform(finalHashBuffer, lastBlocks, index);
+		return IPC_SUCCESS;
 	}
 
-	//floors data size to blocks of 512 bits
-	const u32 flooredDataSize = inputSize & (u32)(~(SHA_BLOCK_SIZE - 1));
-	DCFlushRange(input, flooredDataSize);
+	DCFlushRange(lastBlocks, (numberOfBlocks * SHA_BLOCK_SIZE));
 	AhbFlushTo(AHB_SHA1);
 
-	//happens with all commands
-	if (flooredDataSize != 0)
-	{
-		//check the requested blocks to be processed
-		numberOfBlocks = (flooredDataSize / 64) - 1;
-		if (numberOfBlocks >= 1024)
-			return IOSC_INVALID_SIZE;
-
-		//if this isn't the last block contributed, make sure the input data is a whole multiple of blocks large
-		if ((command != FinalizeShaState) && ((inputSize & (SHA_BLOCK_SIZE - 1)) != 0x0))
-			return IOSC_INVALID_SIZE;
-
-		//copy over the states from the context to the registers
-		for (s8 i = 0; i < SHA_NUM_WORDS; i++)
-			write32((u32)(SHA_H0 + (i * 4)), hashContext->ShaStates[i]);
-
-		write32(SHA_SRC, VirtualToPhysical((u32)input));
-		ShaControl control = { .Fields = { .Execute = 1,
-			                               .GenerateIrq = 1,
-			                               .NumberOfBlocks = numberOfBlocks & 0x3FF } };
-
-		write32(SHA_CMD, control.Value);
-		void *message;
-		ret = ReceiveMessage(ShaEventMessageQueueId, &message, None);
-		if (ret != IPC_SUCCESS)
-			panic("iosReceiveMessage: %d\n", ret);
+	//copy over the states from the context to the registers
+	for (s8 i = 0; i < SHA_NUM_WORDS; i++)
+		write32((u32)(SHA_H0 + (i * 4)), hashContext->ShaStates[i]);
 
-		control.Value = read32(SHA_CMD);
-		if (control.Fields.HasError != 0)
-			return IPC_EACCES;
-	}
+	//set up hash engine
+	write32(SHA_SRC, VirtualToPhysical((u32)lastBlocks));
+	ShaControl control = { .Fields = { .Execute = 1,
+		                               .GenerateIrq = 0, //no irq for this one, instead the function idles until it detects the execution has halted
+		                               .NumberOfBlocks = (numberOfBlocks - 1) & 0x3FF } };
 
-	//FinalizeShaState : Last block contributed to hash
-	if (command == FinalizeShaState)
+	//execute hash engine, and while waiting spin idly
+	write32(SHA_CMD, control.Value);
+	while (((ShaControl)read32(SHA_CMD)).Fields.Execute == 1)
 	{
-		hashContext->Length += flooredDataSize * 8;
-
-		//This pads the final block (or rather 2 blocks) of data
-		memset(LastBlockBuffer, 0, (SHA_BLOCK_SIZE * 2));
-		u32 lastBlockLength = inputSize - flooredDataSize;
-		if (lastBlockLength != 0)
-			memcpy(LastBlockBuffer, (u8 *)input + flooredDataSize, lastBlockLength);
-
-		LastBlockBuffer[lastBlockLength] = 0x80; //Demarcates end of last block's data and beginning of padding
-		hashContext->Length += lastBlockLength * 8;
-		numberOfBlocks = ((lastBlockLength + 1) < (SHA_BLOCK_SIZE - 7)) ? 1 : 2;
-
-		//places the 64-bit length value at the end of the block the data ends in
-		//I think this is what's happening, but the decompiled pseudocode is next to unreadable
-		//winging it for now, should be tested to ensure it behaves as intended
-		u32 index = numberOfBlocks * SHA_BLOCK_SIZE;
-		write32((u32)&LastBlockBuffer[index - 4], (u32)hashContext->Length);
-		write32((u32)&LastBlockBuffer[index - 8], (u32)(hashContext->Length >> 32));
-		DCFlushRange(LastBlockBuffer, (numberOfBlocks * SHA_BLOCK_SIZE));
-		AhbFlushTo(AHB_SHA1);
-
-		//copy over the states from the context to the registers
-		if (flooredDataSize == 0)
-		{
-			for (s8 i = 0; i < SHA_NUM_WORDS; i++)
-			{
-				write32((u32)(SHA_H0 + (i * 4)), hashContext->ShaStates[i]);
-			}
-		}
+	}
 
-		//set up hash engine
-		write32(SHA_SRC, VirtualToPhysical((u32)LastBlockBuffer));
-		ShaControl control = { .Fields = { .Execute = 1,
-			                               .GenerateIrq = 0, //no irq for this one, instead the function idles until it detects the execution has halted
-			                               .NumberOfBlocks = (numberOfBlocks - 1) & 0x3FF } };
+	//copy over the states from the registers to the context
+	for (s8 i = 0; i < SHA_NUM_WORDS; i++)
+		finalHashBuffer[i] = read32((u32)(SHA_H0 + (i * 4)));
 
-		//execute hash engine, and while waiting spin idly
-		write32(SHA_CMD, control.Value);
-		while (((ShaControl)read32(SHA_CMD)).Fields.Execute == 1)
-		{
-		}
+	return IPC_SUCCESS;
+}
+
+static s32 CheckShaStep(const u32 inputSize, const ShaCommandType command)
+{
+	//floors data size to blocks of 512 bits
+	const u32 flooredDataSize = inputSize & (u32)(~(SHA_BLOCK_SIZE - 1));
+	if (flooredDataSize == 0)
+		return command == ContributeShaState ? IPC_EINVAL : IPC_SUCCESS;
+
+	//check the requested blocks to be processed
+	if ((flooredDataSize / SHA_BLOCK_SIZE) - 1 >= 1024)
+		return IOSC_INVALID_SIZE;
 
-		//copy over the states from the registers to the context
-		for (s8 i = 0; i < SHA_NUM_WORDS; i++)
-			finalHashBuffer[i] = read32((u32)(SHA_H0 + (i * 4)));
+	//if this isn't the last block contributed, make sure the input data is a whole multiple of blocks large
+	if ((command != FinalizeShaState) && ((inputSize & (SHA_BLOCK_SIZE - 1)) != 0x0))
+		return IOSC_INVALID_SIZE;
 
-		ret = IPC_SUCCESS;
+	return IPC_SUCCESS;
+}
+
+static s32 AddShaStep(ShaSession *session, const void *input, const u32 inputSize,
+                      const ShaCommandType command, u32 *output)
+{
+	s32 ret = CheckShaStep(inputSize, command);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	ShaStep *step = &session->Steps[session->StepCount++];
+	step->Input = input;
+	step->Size = inputSize;
+	step->Command = command;
+	step->Output = output;
+	return IPC_SUCCESS;
+}
+
+//hashes the next slice of the session. returns SHA_SESSION_PENDING while there is work left
+static s32 RunShaSessionSlice(ShaSession *session)
+{
+	if (session->CurrentStep >= session->StepCount)
+		return IPC_SUCCESS;
+
+	ShaStep *step = &session->Steps[session->CurrentStep];
+	ShaContext *hashContext = session->Context;
+	s32 ret = IPC_SUCCESS;
+
+	//chainingMode 0 == reset. so we set the internal hash states to the initial state
+	if (step->Command == InitShaState && session->Offset == 0)
+	{
+		memcpy(hashContext->ShaStates, Sha1InitialState, sizeof(Sha1InitialState));
+		hashContext->Length = 0;
 	}
 
-	//happens in all chaining modes
-	else if (flooredDataSize != 0)
+	const u32 flooredDataSize = step->Size & (u32)(~(SHA_BLOCK_SIZE - 1));
+	if (session->Offset < flooredDataSize)
 	{
-		hashContext->Length += flooredDataSize * 8;
-		//copy over the states from the registers to the context
-		for (s8 i = 0; i < SHA_NUM_WORDS; i++)
-			hashContext->ShaStates[i] = read32((u32)(SHA_H0 + (i * 4)));
+		u32 sliceSize = flooredDataSize - session->Offset;
+		if (sliceSize > SHA_SLICE_SIZE)
+			sliceSize = SHA_SLICE_SIZE;
+
+		ret = HashShaBlocks(hashContext, (const u8 *)step->Input + session->Offset, sliceSize);
+		session->Offset += sliceSize;
+		if (ret != IPC_SUCCESS)
+			return ret;
 
-		ret = IPC_SUCCESS;
+		//let the other sessions have a go before the rest of this step
+		if (session->Offset < flooredDataSize)
+			return SHA_SESSION_PENDING;
 	}
 
-	return ret;
+	//FinalizeShaState : Last block contributed to hash
+	if (step->Command == FinalizeShaState)
+	{
+		ret = HashShaLastBlocks(hashContext, (const u8 *)step->Input + flooredDataSize,
+		                        step->Size - flooredDataSize, session->LastBlocks, step->Output);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	session->CurrentStep++;
+	session->Offset = 0;
+	return session->CurrentStep < session->StepCount ? SHA_SESSION_PENDING : IPC_SUCCESS;
 }
 
 static s32 VerifyHashesArray(const void *hashData, u32 sizeHashElement,
@@ -187,10 +277,13 @@ static s32 VerifyHashesArray(const void *hashData, u32 sizeHashElement,
 
 	for (u32 i = 0; i < amountHashElements; ++i)
 	{
-		ret = GenerateSha(&hashContext, hashDataPtr, inputSize, InitShaState, outputHash);
+		memcpy(hashContext.ShaStates, Sha1InitialState, sizeof(Sha1InitialState));
+		hashContext.Length = 0;
+		if (inputSize != 0)
+			ret = HashShaBlocks(&hashContext, hashDataPtr, inputSize);
 		if (ret == IPC_SUCCESS)
-			ret = GenerateSha(&hashContext, hashDataPtr + inputSize,
-			                  sizeHashElement - inputSize, FinalizeShaState, outputHash);
+			ret = HashShaLastBlocks(&hashContext, hashDataPtr + inputSize,
+			                        sizeHashElement - inputSize, LastBlockBuffer, outputHash);
 
 		if (ret < 0)
 			break;
@@ -209,9 +302,10 @@ static s32 VerifyHashesArray(const void *hashData, u32 sizeHashElement,
 }
 
 /*
- * After returning IPC_SUCCESS, HmacKeyPostPad is usable (inner/outer pad for the given key handle)
+ * After returning IPC_SUCCESS, keyPad is usable (inner/outer pad for the given key handle)
  */
-static s32 GenerateHmac_DerivedKeyPad(const void *signer, const u32 signerSize, const u8 padding)
+static s32 GenerateHmac_DerivedKeyPad(const void *signer, const u32 signerSize, const u8 padding,
+                                      u8 keyPad[SHA_BLOCK_SIZE])
 {
 	if (signerSize != 4)
 		return IPC_EINVAL;
@@ -230,93 +324,223 @@ static s32 GenerateHmac_DerivedKeyPad(const void *signer, const u32 signerSize,
 		return IPC_INTERNALFAIL; /// TODO: figure out error value
 	}
 
-	memcpy(HmacKeyPrePad, HmacKey, 0x14);
-	memset(HmacKeyPrePad + 0x14, 0, SHA_BLOCK_SIZE - 0x14);
-
+	memset(keyPad, 0, SHA_BLOCK_SIZE);
+	memcpy(keyPad, HmacKey, 0x14);
 	for (s32 i = 0; i < SHA_BLOCK_SIZE; ++i)
 	{
-		HmacKeyPostPad[i] = HmacKeyPrePad[i] ^ padding;
+		keyPad[i] ^= padding;
 	}
 
 	return IPC_SUCCESS;
 }
 
-#define GenerateHmac_DerivedKeyPad_Inner(signer, signerSize) \
-	GenerateHmac_DerivedKeyPad(signer, signerSize, 0x36)
-#define GenerateHmac_DerivedKeyPad_Outer(signer, signerSize) \
-	GenerateHmac_DerivedKeyPad(signer, signerSize, 0x5c)
+#define GenerateHmac_DerivedKeyPad_Inner(signer, signerSize, keyPad) \
+	GenerateHmac_DerivedKeyPad(signer, signerSize, 0x36, keyPad)
+#define GenerateHmac_DerivedKeyPad_Outer(signer, signerSize, keyPad) \
+	GenerateHmac_DerivedKeyPad(signer, signerSize, 0x5c, keyPad)
 
 // perform inner hash, start appending message
-static s32 GenerateHmac_Init(ShaContext *const hashContext, const void *input,
-                             const u32 inputSize, const void *signer, const u32 signerSize)
+static s32 GenerateHmac_Init(ShaSession *session, const void *input, const u32 inputSize,
+                             const void *signer, const u32 signerSize)
 {
-	s32 ret = GenerateHmac_DerivedKeyPad_Inner(signer, signerSize);
+	s32 ret = GenerateHmac_DerivedKeyPad_Inner(signer, signerSize, session->KeyPad);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	// inner pad
-	ret = GenerateSha(hashContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
+	ret = AddShaStep(session, session->KeyPad, SHA_BLOCK_SIZE, InitShaState, NULL);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	// start appending message
 	if (inputSize != 0)
-		ret = GenerateSha(hashContext, input, inputSize, ContributeShaState, NULL);
+		ret = AddShaStep(session, input, inputSize, ContributeShaState, NULL);
 
 	return ret;
 }
 
 // continue appending message
-static s32 GenerateHmac_Contribute(ShaContext *const hashContext,
-                                   const void *firstInput, const u32 firstInputSize,
-                                   const void *secondInput, const u32 secondInputsize)
+static s32 GenerateHmac_Contribute(ShaSession *session, const void *firstInput,
+                                   const u32 firstInputSize, const void *secondInput,
+                                   const u32 secondInputsize)
 {
 	s32 ret = IPC_SUCCESS;
 
 	if (firstInputSize != 0)
-		ret = GenerateSha(hashContext, firstInput, firstInputSize, ContributeShaState, NULL);
+		ret = AddShaStep(session, firstInput, firstInputSize, ContributeShaState, NULL);
 
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	if (secondInputsize != 0)
-		ret = GenerateSha(hashContext, secondInput, secondInputsize,
-		                  ContributeShaState, NULL);
+		ret = AddShaStep(session, secondInput, secondInputsize, ContributeShaState, NULL);
 
 	return ret;
 }
 
 // finish the inner hash, perform outer hash, output
-static s32 GenerateHmac_Finalize(ShaContext *const hashContext, const void *firstInput,
+static s32 GenerateHmac_Finalize(ShaSession *session, const void *firstInput,
                                  const u32 firstInputSize, const void *secondInput,
                                  const u32 secondInputsize, const void *signer,
                                  const u32 signerSize, u32 *output)
 {
-	s32 ret = GenerateHmac_DerivedKeyPad_Outer(signer, signerSize);
+	s32 ret = GenerateHmac_DerivedKeyPad_Outer(signer, signerSize, session->KeyPad);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	if (firstInputSize != 0)
-		ret = GenerateSha(hashContext, firstInput, firstInputSize, ContributeShaState, NULL);
+		ret = AddShaStep(session, firstInput, firstInputSize, ContributeShaState, NULL);
 
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	// finish appending message
-	ret = GenerateSha(hashContext, secondInput, secondInputsize,
-	                  FinalizeShaState, HmacBufferFinal);
+	ret = AddShaStep(session, secondInput, secondInputsize, FinalizeShaState, session->InnerHash);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	// outer pad
-	ret = GenerateSha(hashContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
+	ret = AddShaStep(session, session->KeyPad, SHA_BLOCK_SIZE, InitShaState, NULL);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
-	ret = GenerateSha(hashContext, HmacBufferFinal,
+	return AddShaStep(session, session->InnerHash,
 	                  /* sizeof(FinalShaHash) */ 0x14, FinalizeShaState, output);
+}
 
-	return ret;
+//sets up the session for a sha or hmac ioctlv. the hashing itself happens in slices later on
+static s32 StartShaSession(ShaSession *session, IpcMessage *ipcMessage)
+{
+	IoctlvMessage *ioctlvMessage = &ipcMessage->Request.Message.Ioctlv;
+	IoctlvMessageData *messageData = ioctlvMessage->MessageData;
+	const u32 ioctl = ioctlvMessage->Ioctl;
+
+	session->Message = ipcMessage;
+	session->Context = (ShaContext *)messageData[1].Data;
+	session->StepCount = 0;
+	session->CurrentStep = 0;
+	session->Offset = 0;
+
+	/*it seems each of these are split based on whether they handle SHA hashing or HMAC verification.
+	cases 0, 1, 2 handle SHA-1 hashing, with ioctl deciding chainingMode for GenerateSha() call
+	cases 3, 4, 5 handle HMAC verification, with (ioctl - 3) deciding chainingMode for GenerateSha() calls*/
+	switch (ioctl)
+	{
+		case InitShaState: //SHA_InitState:
+		case ContributeShaState:
+		case FinalizeShaState:
+			if (ioctlvMessage->InputArgc != 1 || ioctlvMessage->IoArgc != 2)
+				return IPC_EINVAL;
+
+			return AddShaStep(session, messageData[0].Data, messageData[0].Length,
+			                  (ShaCommandType)ioctl, (u32 *)messageData[2].Data);
+
+		case InitHMacState:
+			return GenerateHmac_Init(session, messageData[4].Data, messageData[4].Length,
+			                         messageData[3].Data, messageData[3].Length);
+
+		case ContributeHMacState:
+			return GenerateHmac_Contribute(session, messageData[4].Data, messageData[4].Length,
+			                               messageData[0].Data, messageData[0].Length);
+
+		case FinalizeHmacState:
+			return GenerateHmac_Finalize(session, messageData[4].Data, messageData[4].Length,
+			                             messageData[0].Data, messageData[0].Length,
+			                             messageData[3].Data, messageData[3].Length,
+			                             (u32 *)messageData[2].Data);
+
+		default:
+			return IPC_EINVAL;
+	}
+}
+
+static void FinishShaSession(ShaSession *session, s32 ret)
+{
+	//remove message data from heap if it came from there
+	if (ret == IPC_SUCCESS)
+		FreeOnHeap(KernelHeapId, session->Message->Request.Message.Ioctlv.MessageData);
+
+	ResourceReply(session->Message, ret);
+	session->Message = NULL;
+	ActiveShaSessions--;
+}
+
+static s32 VerifyHashTree(IoctlvMessageData *messageData)
+{
+	u8 *hashCompareAgainst = (u8 *)messageData[0].Data;
+	const u8 *dataToCheck = (const u8 *)messageData[1].Data;
+	const u32 hash_h0_offset = *(u32 *)messageData[2].Data;
+	const u32 hash_h1_offset = *(u32 *)messageData[3].Data;
+	const u8 *hash_h2_pointer = (const u8 *)messageData[4].Data;
+
+	s32 ret = VerifyHashesArray(hashCompareAgainst, 0x400, 31, dataToCheck);
+	if (ret < 0)
+		HMAC_Panic("MessageData subblock failed to verify against H0 hash\n", hashCompareAgainst);
+
+	ret = VerifyHashesArray(dataToCheck, 0x26c, 1, dataToCheck + hash_h0_offset + 0x280);
+	if (ret < 0)
+		HMAC_Panic("H0 hashes failed to verify\n", hashCompareAgainst);
+
+	ret = VerifyHashesArray(dataToCheck + 0x280, 0xa0, 1, dataToCheck + hash_h1_offset + 0x340);
+	if (ret < 0)
+		HMAC_Panic("H1 hashes failed to verify\n", hashCompareAgainst);
+
+	ret = VerifyHashesArray(dataToCheck + 0x340, 0xa0, 1, hash_h2_pointer);
+	if (ret < 0)
+		HMAC_Panic("H2 hashes failed to verify\n", hashCompareAgainst);
+
+	return IPC_SUCCESS;
+}
+
+static void HandleShaRequest(IpcMessage *ipcMessage)
+{
+	s32 ret = IPC_EINVAL;
+	switch (ipcMessage->Request.Command)
+	{
+		default:
+			break;
+		case IOS_CLOSE:
+			ret = IPC_SUCCESS;
+			break;
+		case IOS_OPEN:
+			ret = memcmp(ipcMessage->Request.Message.Open.Filepath, SHA_DEVICE_NAME,
+			             SHA_DEVICE_NAME_SIZE);
+			if (ret != IPC_SUCCESS)
+				ret = IPC_ENOENT;
+			//not needed, since 0 == IPC_SUCCESS anyway
+			/*else
+				ret = IPC_SUCCESS;*/
+
+			break;
+		case IOS_IOCTLV:
+			//no clue what case 0xF does, but it is done in one go
+			if (ipcMessage->Request.Message.Ioctlv.Ioctl == UnknownShaCommand)
+			{
+				ret = VerifyHashTree(ipcMessage->Request.Message.Ioctlv.MessageData);
+				FreeOnHeap(KernelHeapId, ipcMessage->Request.Message.Ioctlv.MessageData);
+				break;
+			}
+
+			//the handler only takes requests while there is a free session
+			ShaSession *session = NULL;
+			for (u32 i = 0; i < SHA_MAX_SESSIONS && session == NULL; i++)
+			{
+				if (ShaSessions[i].Message == NULL)
+					session = &ShaSessions[i];
+			}
+
+			ret = StartShaSession(session, ipcMessage);
+			if (ret != IPC_SUCCESS)
+			{
+				session->Message = NULL;
+				break;
+			}
+
+			ActiveShaSessions++;
+			return;
+	}
+
+	ResourceReply(ipcMessage, ret);
 }
 
 void ShaEngineHandler(void)
@@ -324,8 +548,6 @@ void ShaEngineHandler(void)
 	u32 eventMessageQueue[1];
 	u32 resourceManagerMessageQueue[0x10];
 	IpcMessage *ipcMessage;
-	IoctlvMessage *ioctlvMessage;
-	IpcMessage *ipcReply;
 
 	s32 ret = CreateMessageQueue((void **)&eventMessageQueue, 1);
 	ShaEventMessageQueueId = ret;
@@ -347,147 +569,33 @@ void ShaEngineHandler(void)
 
 	while (1)
 	{
-		//main loop should start here
-		ret = ReceiveMessage(messageQueueId, (void **)&ipcMessage, None);
-		if (ret != IPC_SUCCESS)
-			goto receiveMessageError;
-
-		ipcReply = ipcMessage;
-		ret = IPC_EINVAL;
-		switch (ipcMessage->Request.Command)
+		//take in new requests while there is room, only blocking when there is nothing to hash
+		while (ActiveShaSessions < SHA_MAX_SESSIONS)
 		{
-			default:
-				goto sendReply;
-			case IOS_CLOSE:
-				ret = IPC_SUCCESS;
-				goto sendReply;
-			case IOS_OPEN:
-				ret = memcmp(ipcMessage->Request.Message.Open.Filepath,
-				             SHA_DEVICE_NAME, SHA_DEVICE_NAME_SIZE);
-				if (ret != IPC_SUCCESS)
-					ret = IPC_ENOENT;
-				//not needed, since 0 == IPC_SUCCESS anyway
-				/*else
-					ret = IPC_SUCCESS;*/
-
-				goto sendReply;
-			case IOS_IOCTLV:
-				ioctlvMessage = &ipcMessage->Request.Message.Ioctlv;
-				u32 ioctl = ioctlvMessage->Ioctl;
-				IoctlvMessageData *messageData = ioctlvMessage->MessageData;
-				switch (ioctl)
-				{
-					/*it seems each of these are split based on whether they handle SHA hashing or HMAC verification.
-					cases 0, 1, 2 handle SHA-1 hashing, with ioctl deciding chainingMode for GenerateSha() call
-					cases 3, 4, 5 handle HMAC verification, with (ioctl - 3) deciding chainingMode for GenerateSha() calls
-					no clue what case 0xF does though*/
-					case InitShaState: //SHA_InitState:
-					case ContributeShaState:
-					case FinalizeShaState:
-						if (ioctlvMessage->InputArgc != 1 || ioctlvMessage->IoArgc != 2)
-							break;
-
-						ret = GenerateSha(
-						    (ShaContext *)ioctlvMessage->MessageData[1].Data,
-						    ioctlvMessage->MessageData[0].Data,
-						    ioctlvMessage->MessageData[0].Length, (ShaCommandType)ioctl,
-						    (u32 *)ioctlvMessage->MessageData[2].Data);
-
-						if (ret != IPC_SUCCESS)
-							goto sendReply;
-
-						break;
-
-					case InitHMacState:
-						ret = GenerateHmac_Init(
-						    (ShaContext *)ioctlvMessage->MessageData[1].Data,
-						    ioctlvMessage->MessageData[4].Data,
-						    ioctlvMessage->MessageData[4].Length,
-						    ioctlvMessage->MessageData[3].Data,
-						    ioctlvMessage->MessageData[3].Length);
-
-						if (ret != IPC_SUCCESS)
-							goto sendReply;
-
-						break;
-
-					case ContributeHMacState:
-						ret = GenerateHmac_Contribute(
-						    (ShaContext *)ioctlvMessage->MessageData[1].Data,
-						    ioctlvMessage->MessageData[4].Data,
-						    ioctlvMessage->MessageData[4].Length,
-						    ioctlvMessage->MessageData[0].Data,
-						    ioctlvMessage->MessageData[0].Length);
-
-						if (ret != IPC_SUCCESS)
-							goto sendReply;
-
-						break;
-
-					case FinalizeHmacState:
-						ret = GenerateHmac_Finalize(
-						    (ShaContext *)ioctlvMessage->MessageData[1].Data,
-						    ioctlvMessage->MessageData[4].Data,
-						    ioctlvMessage->MessageData[4].Length,
-						    ioctlvMessage->MessageData[0].Data,
-						    ioctlvMessage->MessageData[0].Length,
-						    ioctlvMessage->MessageData[3].Data,
-						    ioctlvMessage->MessageData[3].Length,
-						    (u32 *)ioctlvMessage->MessageData[2].Data);
-
-						if (ret != IPC_SUCCESS)
-							goto sendReply;
-
-						break;
-
-					case UnknownShaCommand:
-						u8 *hashCompareAgainst = (u8 *)messageData[0].Data;
-						const u8 *dataToCheck = (const u8 *)messageData[1].Data;
-						const u32 hash_h0_offset = *(u32 *)messageData[2].Data;
-						const u32 hash_h1_offset = *(u32 *)messageData[3].Data;
-						const u8 *hash_h2_pointer = (const u8 *)messageData[4].Data;
-
-						ret = VerifyHashesArray(hashCompareAgainst, 0x400, 31, dataToCheck);
-						if (ret < 0)
-							HMAC_Panic("MessageData subblock failed to verify against H0 hash\n",
-							           hashCompareAgainst);
-
-						ret = VerifyHashesArray(dataToCheck, 0x26c, 1,
-						                        dataToCheck + hash_h0_offset + 0x280);
-						if (ret < 0)
-							HMAC_Panic("H0 hashes failed to verify\n", hashCompareAgainst);
-
-						ret = VerifyHashesArray(dataToCheck + 0x280, 0xa0, 1,
-						                        dataToCheck + hash_h1_offset + 0x340);
-						if (ret < 0)
-							HMAC_Panic("H1 hashes failed to verify\n", hashCompareAgainst);
-
-						ret = VerifyHashesArray(dataToCheck + 0x340, 0xa0, 1, hash_h2_pointer);
-						if (ret < 0)
-							HMAC_Panic("H2 hashes failed to verify\n", hashCompareAgainst);
-
-						ret = IPC_SUCCESS;
-						break;
-
-					default:
-						goto sendReply;
-				}
-
+			ret = ReceiveMessage(messageQueueId, (void **)&ipcMessage,
+			                     ActiveShaSessions == 0 ? None : RegisteredEventHandler);
+			if (ret == IPC_EQUEUEEMPTY)
 				break;
-		}
 
-		//remove message data from heap if it came from there
-		FreeOnHeap(KernelHeapId, ioctlvMessage->MessageData);
+			if (ret != IPC_SUCCESS)
+				panic("iosReceiveMessage: %d\n", ret);
 
-sendReply:
-		ResourceReply(ipcReply, ret);
-		continue;
-receiveMessageError:
-		panic("iosReceiveMessage: %d\n", ret);
-		//not sure why ios does this haha
-		//the panic makes it loop forever...
-		if (ipcMessage->Request.Command == IOS_CLOSE)
+			HandleShaRequest(ipcMessage);
+		}
+
+		//give the next active session a slice of the engine
+		for (u32 i = 0; i < SHA_MAX_SESSIONS; i++)
+		{
+			ShaSession *session = &ShaSessions[NextShaSession];
+			NextShaSession = (NextShaSession + 1) % SHA_MAX_SESSIONS;
+			if (session->Message == NULL)
+				continue;
+
+			ret = RunShaSessionSlice(session);
+			if (ret != SHA_SESSION_PENDING)
+				FinishShaSession(session, ret);
 			break;
+		}
 	}
 }
 
@@ -0,0 +1,104 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	sha software - sha-1 on the cpu, for the few bytes the kernel hashes itself
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+
+#include "crypto/sha_software.h"
+
+#ifndef MIOS
+
+static inline u32 SHA_RotateLeft(u32 value, u32 bits)
+{
+	return value << bits | value >> (32 - bits);
+}
+
+static void SHA_SoftwareTransformBlock(u32 states[SHA_NUM_WORDS], const u8 *block)
+{
+	u32 words[16];
+	for (u32 i = 0; i < 16; i++)
+		words[i] = (u32)block[i * 4] << 24 | (u32)block[i * 4 + 1] << 16 |
+		           (u32)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+
+	u32 a = states[0], b = states[1], c = states[2], d = states[3], e = states[4];
+	for (u32 i = 0; i < 80; i++)
+	{
+		//the message schedule only ever looks 16 words back, so it is kept as a ring
+		u32 word = words[i & 0x0F];
+		if (i >= 16)
+		{
+			word = SHA_RotateLeft(words[(i + 13) & 0x0F] ^ words[(i + 8) & 0x0F] ^
+			                          words[(i + 2) & 0x0F] ^ word,
+			                      1);
+			words[i & 0x0F] = word;
+		}
+
+		u32 function;
+		if (i < 20)
+			function = ((b & c) | (~b & d)) + 0x5A827999;
+		else if (i < 40)
+			function = (b ^ c ^ d) + 0x6ED9EBA1;
+		else if (i < 60)
+			function = ((b & c) | (b & d) | (c & d)) + 0x8F1BBCDC;
+		else
+			function = (b ^ c ^ d) + 0xCA62C1D6;
+
+		const u32 temp = SHA_RotateLeft(a, 5) + function + e + word;
+		e = d;
+		d = c;
+		c = SHA_RotateLeft(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	states[0] += a;
+	states[1] += b;
+	states[2] += c;
+	states[3] += d;
+	states[4] += e;
+}
+
+void SHA_SoftwareTransform(u32 states[SHA_NUM_WORDS], const void *input, u32 inputSize)
+{
+	const u8 *data = (const u8 *)input;
+	for (u32 offset = 0; offset + SHA_BLOCK_SIZE <= inputSize; offset += SHA_BLOCK_SIZE)
+		SHA_SoftwareTransformBlock(states, &data[offset]);
+}
+
+void SHA_SoftwareCalculate(const void *input, u32 inputSize, u8 hash[SHA_HASH_SIZE])
+{
+	u32 states[SHA_NUM_WORDS] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	const u8 *data = (const u8 *)input;
+	const u32 remaining = inputSize & (SHA_BLOCK_SIZE - 1);
+	SHA_SoftwareTransform(states, data, inputSize - remaining);
+	data += inputSize - remaining;
+
+	//the tail gets the 0x80 marker and the length in bits, spilling into a second block if needed
+	u8 lastBlocks[SHA_BLOCK_SIZE * 2];
+	const u32 lastSize = remaining + 9 > SHA_BLOCK_SIZE ? SHA_BLOCK_SIZE * 2 : SHA_BLOCK_SIZE;
+	memset(lastBlocks, 0, lastSize);
+	memcpy(lastBlocks, data, remaining);
+	lastBlocks[remaining] = 0x80;
+
+	const u64 length = (u64)inputSize * 8;
+	for (u32 i = 0; i < 8; i++)
+		lastBlocks[lastSize - 1 - i] = (u8)(length >> (i * 8));
+
+	SHA_SoftwareTransform(states, lastBlocks, lastSize);
+
+	for (u32 i = 0; i < SHA_NUM_WORDS; i++)
+	{
+		hash[i * 4] = (u8)(states[i] >> 24);
+		hash[i * 4 + 1] = (u8)(states[i] >> 16);
+		hash[i * 4 + 2] = (u8)(states[i] >> 8);
+		hash[i * 4 + 3] = (u8)states[i];
+	}
+}
+
+#endif
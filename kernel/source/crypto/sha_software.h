@@ -0,0 +1,28 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	sha software - sha-1 on the cpu, for the few bytes the kernel hashes itself
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+#ifndef MIOS
+
+#include <types.h>
+#include <ios/sha.h>
+
+#define SHA_HASH_SIZE sizeof(FinalShaHash)
+//the padding of a final block can spill into a second one, so this keeps finishing a hash of a
+//few bytes on the cpu. larger runs go to the engine
+#define SHA_SOFTWARE_MAX_SIZE (SHA_BLOCK_SIZE * 2)
+
+//runs whole blocks of input through the states, like a single engine run
+void SHA_SoftwareTransform(u32 states[SHA_NUM_WORDS], const void *input, u32 inputSize);
+
+//hashes input in one go. the hash is written as big endian bytes, like the engine does
+void SHA_SoftwareCalculate(const void *input, u32 inputSize, u8 hash[SHA_HASH_SIZE]);
+
+#endif
@@ -13,7 +13,16 @@ Copyright (C) 2008, 2009	Haxx Enterprises <bushing@gmail.com>
 #include "string.h"
 #include "sdmmc.h"
 
-static u8 buffer[512] ALIGNED(32);
+#define MEM2_BSS __attribute__((section(".bss.mem2")))
+#define SECTOR_SIZE    512
+#define BOUNCE_SECTORS 8
+
+// unaligned buffers go through these. one is copied while the card transfers the other
+static u8 bounce[2][BOUNCE_SECTORS * SECTOR_SIZE] MEM2_BSS ALIGNED(32);
+
+static inline u32 bounce_chunk(u32 left) {
+	return left < BOUNCE_SECTORS ? left : BOUNCE_SECTORS;
+}
 
 // Initialize a Drive
 DSTATUS disk_initialize (BYTE drv) {
@@ -35,12 +44,44 @@ DSTATUS disk_status (BYTE drv) {
 
 // Read Sector(s)
 DRESULT disk_read (BYTE drv, BYTE *buff, DWORD sector, BYTE count) {
-	int i;
+	struct sdmmc_command cmd[2];
+	u32 done = 0, chunk, next_chunk;
+	int current = 0;
 	(void)drv;
-	for (i = 0; i < count; i++) {
-		if (sdmmc_read(sector+i, 1, buffer) != 0)
+
+	if (count == 0)
+		return RES_OK;
+
+	// the card can dma straight into an aligned buffer, all sectors in one command
+	if (((u32)buff & 31) == 0)
+		return sdmmc_read(sector, count, buff) == 0 ? RES_OK : RES_ERROR;
+
+	chunk = bounce_chunk(count);
+	if (sdmmc_read_async(sector, chunk, bounce[current], &cmd[current]) < 0)
+		return RES_ERROR;
+
+	while (1) {
+		// starting the next read finishes this one, then we copy it out while that runs
+		next_chunk = bounce_chunk(count - done - chunk);
+		if (next_chunk > 0 && sdmmc_read_async(sector + done + chunk, next_chunk,
+		                                       bounce[current ^ 1], &cmd[current ^ 1]) < 0) {
+			sdmmc_wait(&cmd[current]);
+			return RES_ERROR;
+		}
+
+		if (sdmmc_wait(&cmd[current]) != 0) {
+			if (next_chunk > 0)
+				sdmmc_wait(&cmd[current ^ 1]);
 			return RES_ERROR;
-		memcpy(buff + i * 512, buffer, 512);
+		}
+
+		memcpy(buff + done * SECTOR_SIZE, bounce[current], chunk * SECTOR_SIZE);
+		if (next_chunk == 0)
+			break;
+
+		done += chunk;
+		chunk = next_chunk;
+		current ^= 1;
 	}
 
 	return RES_OK;
@@ -49,16 +90,38 @@ DRESULT disk_read (BYTE drv, BYTE *buff, DWORD sector, BYTE count) {
 // Write Sector(s)
 #if _READONLY == 0
 DRESULT disk_write (BYTE drv, const BYTE *buff, DWORD sector, BYTE count) {
-	int i;
+	struct sdmmc_command cmd[2];
+	u32 done, chunk;
+	int current = 0, pending = 0;
+	(void)drv;
+
+	if (count == 0)
+		return RES_OK;
 
-	for (i = 0; i < count; i++) {
-		memcpy(buffer, buff + i * 512, 512);
+	if (((u32)buff & 31) == 0)
+		return sdmmc_write(sector, count, (void *)buff) == 0 ? RES_OK : RES_ERROR;
 
-		if(sdmmc_write(sector + i, 1, buffer) != 0)
+	for (done = 0; done < count; done += chunk) {
+		// fill one buffer while the card is still writing out the other
+		chunk = bounce_chunk(count - done);
+		memcpy(bounce[current], buff + done * SECTOR_SIZE, chunk * SECTOR_SIZE);
+
+		if (sdmmc_write_async(sector + done, chunk, bounce[current], &cmd[current]) < 0) {
+			if (pending)
+				sdmmc_wait(&cmd[current ^ 1]);
+			return RES_ERROR;
+		}
+
+		if (pending && sdmmc_wait(&cmd[current ^ 1]) != 0) {
+			sdmmc_wait(&cmd[current]);
 			return RES_ERROR;
+		}
+
+		pending = 1;
+		current ^= 1;
 	}
 
-	return RES_OK;
+	return sdmmc_wait(&cmd[current ^ 1]) == 0 ? RES_OK : RES_ERROR;
 }
 #endif /* _READONLY */
 
@@ -20,6 +20,7 @@
 #include "core/defines.h"
 #include "messaging/ipc.h"
 #include "memory/memory.h"
+#include "memory/iobuf.h"
 
 #ifndef MIOS
 FileDescriptor AesFileDescriptor SRAM_BSS;
@@ -424,6 +425,8 @@ int IoctlvFD_InnerWithFlag(s32 fd, u32 requestId, u32 vectorInputCount, u32 vect
 			ret = CheckMemoryPointer(vectors[j].Data, vectors[j].Length, 4, pid,
 			                         fd_ptr->BelongsToResource->ProcessId);
 		}
+		for (u32 i = 0; i < vectorInputCount + vectorIOCount && ret == IPC_SUCCESS; ++i)
+			LendIOBuf(vectors[i].Data, pid, fd_ptr->BelongsToResource->ProcessId);
 	}
 #endif
 
@@ -338,7 +338,8 @@ void IrqHandler(ThreadContext *context)
 	{
   //gecko_printf("IRQ: SDHC\n");
 		write32(HW_ARMIRQFLAG, IRQF_SDHC);
-		sdhc_irq();
+		if (sdhc_irq())
+			EnqueueEventHandler(IRQ_SDHC);
 	}
 #endif
 
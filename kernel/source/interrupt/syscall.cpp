@@ -18,10 +18,13 @@ extern "C" {
 #include "memory/memory.h"
 #include "memory/heaps.h"
 #include "memory/ahb.h"
+#include "memory/iobuf.h"
 #include "messaging/ipc.h"
+#include "messaging/logRing.h"
 #include "messaging/messageQueue.h"
 #include "messaging/resourceManager.h"
 #include "crypto/iosc.h"
+#include "peripherals/flash.h"
 #include "filedesc/calls.h"
 #include "filedesc/calls_async.h"
 }
@@ -158,9 +161,9 @@ static const SyscallEntry syscall_handlers[] __attribute__((section(".syscalls")
 	SYSCALL(IOSC_DeleteObject), //0x005C
 	SYSCALL_NULL, //0x005D
 	SYSCALL_NULL, //0x005E
-	SYSCALL_NULL, //0x005F
+	SYSCALL(IOSC_ImportPublicKey), //0x005F
 	SYSCALL_NULL, //0x0060
-	SYSCALL_NULL, //0x0061
+	SYSCALL(IOSC_GenerateSharedKey), //0x0061
 	SYSCALL(IOSC_SetData), //0x0062
 	SYSCALL(IOSC_GetData), //0x0063
 	SYSCALL(IOSC_GetKeySize), //0x0064
@@ -171,7 +174,7 @@ static const SyscallEntry syscall_handlers[] __attribute__((section(".syscalls")
 	SYSCALL(IOSC_Encrypt), //0x0069
 	SYSCALL(IOSC_DecryptAsync), //0x006A
 	SYSCALL(IOSC_Decrypt), //0x006B
-	SYSCALL_NULL, //0x006C
+	SYSCALL(IOSC_VerifyPublicKeySign), //0x006C
 	SYSCALL(IOSC_GenerateBlockMAC), //0x006D
 	SYSCALL(IOSC_GenerateBlockMACAsync), //0x006E
 	SYSCALL_NULL, //0x006F
@@ -180,10 +183,10 @@ static const SyscallEntry syscall_handlers[] __attribute__((section(".syscalls")
 	SYSCALL_NULL, //0x0072
 	SYSCALL_NULL, //0x0073
 	SYSCALL_NULL, //0x0074
-	SYSCALL_NULL, //0x0075
+	SYSCALL(IOSC_GenerateSignature), //0x0075
 	SYSCALL_NULL, //0x0076
 	SYSCALL_NULL, //0x0077
-	SYSCALL_NULL, //0x0078
+	SYSCALL(IOSC_VerifyPublicKeySignAsync), //0x0078
 	SYSCALL_NULL, //0x0079
 	SYSCALL_NULL, //0x007A
 	SYSCALL_NULL, //0x007B
@@ -194,6 +197,27 @@ static const SyscallEntry syscall_handlers[] __attribute__((section(".syscalls")
 #endif
 };
 
+#ifndef MIOS
+//syscalls that IOS doesn't have. they live in their own range, so every slot of the IOS table
+//stays free for the syscall IOS itself puts there
+#define STARSTRUCK_SYSCALL_BASE 0xC0
+static const SyscallEntry starstruck_syscall_handlers[] __attribute__((section(".syscalls"))) = {
+	SYSCALL(AllocateIOBuf), //0x00C0
+	SYSCALL(FreeIOBuf), //0x00C1
+	SYSCALL(IOBufToDevice), //0x00C2
+	SYSCALL(IOBufFromDevice), //0x00C3
+	SYSCALL(ReadFlashPage), //0x00C4
+	SYSCALL(WriteFlashPage), //0x00C5
+	SYSCALL(EraseFlashBlock), //0x00C6
+	SYSCALL(GetFlashBlockStats), //0x00C7
+	SYSCALL(RegisterLogRing), //0x00C8
+	SYSCALL(IOSC_GeneratePublicKey), //0x00C9
+	SYSCALL(IOSC_DecryptAndHash), //0x00CA
+	SYSCALL(MarkFlashBlockBad), //0x00CB
+	SYSCALL(UnregisterLogRing), //0x00CC
+};
+#endif
+
 //We implement syscalls using the SVC/SWI instruction.
 //Nintendo/IOS however was using undefined instructions and just caught those in their exception handler lol
 //Both our SWI and (if applicable) undefined instruction handlers call this function (see exception_asm.S & exception.c)
@@ -231,15 +255,26 @@ extern "C" s32 HandleSyscall(u16 syscall)
 	}
 
 	//is the syscall within our range ?
-	constexpr u16 syscallCount = sizeof(syscall_handlers) / sizeof(SyscallEntry);
-	if (syscall >= syscallCount)
+	const SyscallEntry *table = syscall_handlers;
+	u16 index = syscall;
+	u16 syscallCount = sizeof(syscall_handlers) / sizeof(SyscallEntry);
+#ifndef MIOS
+	if (syscall >= STARSTRUCK_SYSCALL_BASE)
+	{
+		table = starstruck_syscall_handlers;
+		index = syscall - STARSTRUCK_SYSCALL_BASE;
+		syscallCount = sizeof(starstruck_syscall_handlers) / sizeof(SyscallEntry);
+	}
+#endif
+
+	if (index >= syscallCount)
 	{
 		gecko_printf("unknown syscall 0x%04X\n", syscall);
 		return -666;
 	}
 
 	u32 *reg = threadContext->Registers;
-	const SyscallEntry &entry = syscall_handlers[syscall];
+	const SyscallEntry &entry = table[index];
 	SyscallHandler handler = reinterpret_cast<SyscallHandler>(entry.Handler);
 	if (handler == NULL)
 	{
@@ -18,6 +18,7 @@ Copyright (C) 2009		John Kelley <wiidev@kelley.ca>
 #include <ios/printk.h>
 #include <ios/gecko.h>
 #include <ios/module.h>
+#include <ios/errno.h>
 
 #include "core/hollywood.h"
 #include "core/gpio.h"
@@ -26,22 +27,29 @@ Copyright (C) 2009		John Kelley <wiidev@kelley.ca>
 #include "memory/memory.h"
 #include "memory/heaps.h"
 #include "memory/ahb.h"
+#include "memory/iobuf.h"
 #include "interrupt/exception.h"
 #include "messaging/ipc.h"
+#include "messaging/logRing.h"
 #include "scheduler/timer.h"
 #include "scheduler/threads.h"
 #include "interrupt/irq.h"
 #include "peripherals/usb.h"
 #include "peripherals/powerpc.h"
+#include "peripherals/emunand.h"
 #include "crypto/aes.h"
 #include "crypto/iosc.h"
+#include "crypto/rsa.h"
 #include "crypto/sha.h"
+#include "crypto/otp.h"
+#include "crypto/seeprom.h"
 #include "utils.h"
 
 #include "sdhc.h"
 #include "ff.h"
 #include "panic.h"
 #include "powerpc_elf.h"
+#include "bootprofile.h"
 #include "nand.h"
 #include "boot2.h"
 
@@ -104,6 +112,9 @@ void kernel_main(void)
 	if (ret < 0 || StartThread(threadId) < 0)
 		panic("failed to start IRQ thread!\n");
 
+	BootProfileCheckpoint("irq thread");
+	BootProfileDump();
+
  //Boot the PPC content
 	PPCStart();
 
@@ -163,7 +174,20 @@ void kernel_main(void)
 	if (ret < 0 || StartThread(threadId) < 0)
 		panic("failed to start SHA thread!\n");
 
+ //create the log ring drain thread. it runs below everything but the idle thread, as a system thread
+	ret = CreateThread((u32)LogRingHandler, NULL, NULL, 0, 0x08, 1);
+	threadId = ret;
+	if (ret >= 0)
+		Threads[threadId].Context.StatusRegister |= SPSR_SYSTEM_MODE;
+
+	if (ret < 0 || StartThread(threadId) < 0)
+		panic("failed to start log ring thread!\n");
+
+	OTP_Init();
+	if (SEEPROM_Init() != IPC_SUCCESS)
+		printk("failed to read the SEEPROM\n");
 	IOSC_InitInformation();
+	BootProfileCheckpoint("engines/otp/seeprom");
 
  //create IPC handler thread & also set it to run as system thread
 	ret = CreateThread((u32)IpcHandler, NULL, NULL, 0, 0x5C, 1);
@@ -177,6 +201,7 @@ void kernel_main(void)
 
 	if (ret < 0 || StartThread(threadId) < 0)
 		panic("failed to start IPC thread!\n");
+	BootProfileCheckpoint("ipc thread");
 
  //loop the program headers and map/launch all modules
 	Elf32_Phdr *headers = (Elf32_Phdr *)__headers_addr;
@@ -204,16 +229,12 @@ void kernel_main(void)
 			section.AccessRights = AP_ROUSER;
 
 		section.IsCached = 1;
-		s32 ret = MapMemory(&section);
-		if (ret != 0)
-			panic("Unable to map region %08x [%d bytes]\n",
-			      section.VirtualAddress, section.Size);
 
-  //map cached version
-		section.VirtualAddress = MEM2_PHY2VIRT(section.VirtualAddress);
-		section.IsCached = 0;
-		ret = MapMemory(&section);
-		if (ret != 0)
+  //map the cached & uncached version in one go
+		MemorySection sections[2] = { section, section };
+		sections[1].VirtualAddress = MEM2_PHY2VIRT(section.VirtualAddress);
+		sections[1].IsCached = 0;
+		if (MapMemorySections(sections, 2) != 0)
 			panic("Unable to map region %08x [%d bytes]\n",
 			      section.VirtualAddress, section.Size);
 
@@ -225,6 +246,17 @@ void kernel_main(void)
 			memset((void *)(header.p_vaddr + header.p_filesz), 0,
 			       header.p_memsz - header.p_filesz);
 	}
+	BootProfileCheckpoint("map segments");
+
+#ifdef EMUNAND
+	//serve the fs module's nand pages from an image on the sd card instead.
+	//this has to be done before the modules exist: the sd waits block, which would let the fs
+	//run and go for the real nand before the image is active
+	sdhc_init();
+	if (f_mount(0, &fatfs) != FR_OK || InitializeEmuNand(EMUNAND_IMAGE_PATH) != IPC_SUCCESS)
+		printk("EmuNAND unavailable, using the NAND\n");
+	BootProfileCheckpoint("emunand");
+#endif
 
 	const u32 modules_cnt = __modules_size / sizeof(ModuleInfo);
 	for (u32 i = 0; i < modules_cnt; i++)
@@ -242,9 +274,19 @@ void kernel_main(void)
 		Threads[threadId].ProcessId = arg;
 		StartThread(threadId);
 	}
+	BootProfileCheckpoint("start modules");
 
 	KernelHeapId = CreateHeap((void *)__headers_addr, 0xC0000);
+	if (InitializeIOBufHeap() < 0)
+		panic("failed to create IOBuf heap!\n");
+
 	printk("$IOSVersion: IOSP: %s %s 64M $", __DATE__, __TIME__);
+
+	//the fs module talks to the nand as soon as it gets to run
+	nand_initialize();
+	printk("NAND initialized.\n");
+	BootProfileCheckpoint("nand");
+
 	SetThreadPriority(0, 0);
 	SetThreadPriority(IpcHandlerThreadId, 0x5C);
 	u32 vector;
@@ -252,10 +294,9 @@ void kernel_main(void)
 
  //while(1){}
 
-	nand_initialize();
-	printk("NAND initialized.\n");
-
 	boot2_init();
+	BootProfileCheckpoint("boot2 init");
+	BootProfileDump();
 
  /*printk("Initializing SDHC...\n");
 	sdhc_init();
@@ -393,7 +434,9 @@ void InitialiseSystem(void)
 
 #ifndef MIOS
 	gecko_printf("Configuring caches and MMU...\n");
+	BootProfileCheckpoint("hardware");
 	InitializeMemory();
+	BootProfileCheckpoint("mmu");
 #else
  //lol, mios explicitly disables the debug interface
 	write32(HW_DBGINTEN, 0);
@@ -402,16 +445,19 @@ void InitialiseSystem(void)
 
 u32 _main(void)
 {
+	BootProfileCheckpoint("start");
 	gecko_init();
 	//don't use printk before our main thread started. our stackpointers are god knows were at that point & thread context isn't init yet
 	gecko_printf("StarStruck %s loading\n", git_version);
 	gecko_printf("Initializing exceptions...\n");
 	initializeExceptions();
+	BootProfileCheckpoint("exceptions");
 
 	AhbFlushFrom(AHB_1);
 	AhbFlushTo(AHB_1);
 
 	InitialiseSystem();
+	BootProfileCheckpoint("system");
 
 #ifndef MIOS
 	gecko_printf("IOSflags: %08x %08x %08x\n", read32(0xffffff00),
@@ -428,6 +474,9 @@ u32 _main(void)
 	IrqInit();
 	IpcInit();
 	IOSC_Init();
+	if (RSA_SelfTest() != IPC_SUCCESS)
+		panic("rsa self test failed!\n");
+	BootProfileCheckpoint("irq/ipc/iosc");
 
  //currently unknown if these values are used in the kernel itself.
 	//if they are, these need to be replaced with actual stuff from the linker script!
@@ -0,0 +1,196 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	iobuf - dma safe buffers for drivers & modules
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/processor.h>
+#include <ios/errno.h>
+
+#include "core/defines.h"
+#include "memory/iobuf.h"
+#include "memory/heaps.h"
+#include "memory/memory.h"
+#include "memory/ahb.h"
+#include "interrupt/irq.h"
+#include "scheduler/threads.h"
+
+extern const u32 __iobuf_heap_area_start[];
+extern const u32 __iobuf_heap_area_size[];
+
+static s32 IOBufHeapId = -1;
+static IOBufInfo IOBufs[MAX_IOBUFS];
+
+static IOBufInfo *GetIOBuf(const void *ptr)
+{
+	if (ptr == NULL)
+		return NULL;
+
+	for (u32 i = 0; i < MAX_IOBUFS; i++)
+	{
+		if (IOBufs[i].Owner != IOBufUnused && IOBufs[i].Data == ptr)
+			return &IOBufs[i];
+	}
+
+	return NULL;
+}
+
+static inline int MayHandOver(const IOBufInfo *ioBuf)
+{
+	return ioBuf->ProcessId == CurrentThread->ProcessId ||
+	       ioBuf->BorrowerProcessId == CurrentThread->ProcessId;
+}
+
+s32 InitializeIOBufHeap(void)
+{
+	memset(IOBufs, 0, sizeof(IOBufs));
+	IOBufHeapId = CreateHeap((void *)__iobuf_heap_area_start, (u32)__iobuf_heap_area_size);
+	return IOBufHeapId < 0 ? IOBufHeapId : IPC_SUCCESS;
+}
+
+void *AllocateIOBuf(u32 size, u32 alignment)
+{
+	u32 irqState = DisableInterrupts();
+	void *ret = NULL;
+	IOBufInfo *ioBuf = NULL;
+
+	if (IOBufHeapId < 0 || size == 0 || (alignment != 0x20 && alignment != 0x40))
+		goto restore_and_return;
+
+	for (u32 i = 0; i < MAX_IOBUFS && ioBuf == NULL; i++)
+	{
+		if (IOBufs[i].Owner == IOBufUnused)
+			ioBuf = &IOBufs[i];
+	}
+
+	if (ioBuf == NULL)
+		goto restore_and_return;
+
+	//pad the buffer to whole cache lines so flushing/invalidating it never touches a neighbour
+	size = (size + (IOBUF_LINESIZE - 1)) & ~(u32)(IOBUF_LINESIZE - 1);
+	ret = MallocateOnHeap(IOBufHeapId, size, alignment);
+	if (ret == NULL)
+		goto restore_and_return;
+
+	//the heap cleared the buffer through the cache, so the cpu owns it until its flushed
+	ioBuf->Data = ret;
+	ioBuf->Size = size;
+	ioBuf->ProcessId = CurrentThread->ProcessId;
+	ioBuf->BorrowerProcessId = CurrentThread->ProcessId;
+	ioBuf->Owner = IOBufCpuOwned;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+s32 FreeIOBuf(void *ptr)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = IPC_SUCCESS;
+	IOBufInfo *ioBuf = GetIOBuf(ptr);
+
+	if (ioBuf == NULL)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+	if (ioBuf->ProcessId != CurrentThread->ProcessId)
+	{
+		ret = IPC_EACCES;
+		goto restore_and_return;
+	}
+
+	ret = FreeOnHeap(IOBufHeapId, ptr);
+	if (ret != IPC_SUCCESS)
+		goto restore_and_return;
+
+	memset(ioBuf, 0, sizeof(IOBufInfo));
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+//called when a buffer is passed along in an ipc request, so the driver behind the resource
+//(like ehc for msc) can hand the buffer to its device without flushing by range.
+//only buffers the sender owns can be lent out & freeing stays up to the owner
+void LendIOBuf(const void *ptr, u32 ownerProcessId, u32 borrowerProcessId)
+{
+	u32 irqState = DisableInterrupts();
+	IOBufInfo *ioBuf = GetIOBuf(ptr);
+
+	if (ioBuf != NULL && ioBuf->ProcessId == ownerProcessId)
+		ioBuf->BorrowerProcessId = borrowerProcessId;
+
+	RestoreInterrupts(irqState);
+}
+
+//hand the buffer over to a device. only flushes the cache & ahb if the cpu might have written to it
+s32 IOBufToDevice(void *ptr, AHBDEV device)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = IPC_SUCCESS;
+	IOBufInfo *ioBuf = GetIOBuf(ptr);
+
+	if (ioBuf == NULL)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+	if (!MayHandOver(ioBuf))
+	{
+		ret = IPC_EACCES;
+		goto restore_and_return;
+	}
+
+	if (ioBuf->Owner == IOBufDeviceOwned)
+		goto restore_and_return;
+
+	DCFlushRange(ioBuf->Data, ioBuf->Size);
+	AhbFlushTo(device);
+	ioBuf->Owner = IOBufDeviceOwned;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+//take the buffer back from a device. only invalidates if a device could have written to it
+s32 IOBufFromDevice(void *ptr, AHBDEV device)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = IPC_SUCCESS;
+	IOBufInfo *ioBuf = GetIOBuf(ptr);
+
+	if (ioBuf == NULL)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+	if (!MayHandOver(ioBuf))
+	{
+		ret = IPC_EACCES;
+		goto restore_and_return;
+	}
+
+	if (ioBuf->Owner == IOBufCpuOwned)
+		goto restore_and_return;
+
+	AhbFlushFrom(device);
+	AhbFlushTo(AHB_STARLET);
+	DCInvalidateRange(ioBuf->Data, ioBuf->Size);
+	ioBuf->Owner = IOBufCpuOwned;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
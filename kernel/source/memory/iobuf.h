@@ -0,0 +1,55 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	iobuf - dma safe buffers for drivers & modules
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __IOBUF_H__
+#define __IOBUF_H__
+
+#include <types.h>
+#include <ios/ahb.h>
+
+#define IOBUF_LINESIZE 0x20
+#define MAX_IOBUFS     0x40
+
+//who currently owns the buffer's memory.
+//the cpu might have dirty cache lines of a cpu owned buffer, while a device owned
+//buffer has been flushed out of the cache and must not be touched by the cpu
+typedef enum
+{
+	IOBufUnused = 0,
+	IOBufCpuOwned = 1,
+	IOBufDeviceOwned = 2,
+} IOBufOwner;
+
+typedef struct
+{
+	void *Data;
+	u32 Size;
+	u32 ProcessId;
+	//process the buffer was last passed to over ipc. it may hand the buffer to & from devices
+	u32 BorrowerProcessId;
+	IOBufOwner Owner;
+} IOBufInfo;
+CHECK_SIZE(IOBufInfo, 0x14);
+CHECK_OFFSET(IOBufInfo, 0x00, Data);
+CHECK_OFFSET(IOBufInfo, 0x04, Size);
+CHECK_OFFSET(IOBufInfo, 0x08, ProcessId);
+CHECK_OFFSET(IOBufInfo, 0x0C, BorrowerProcessId);
+CHECK_OFFSET(IOBufInfo, 0x10, Owner);
+
+s32 InitializeIOBufHeap(void);
+void LendIOBuf(const void *ptr, u32 ownerProcessId, u32 borrowerProcessId);
+
+//Syscalls
+void *AllocateIOBuf(u32 size, u32 alignment);
+s32 FreeIOBuf(void *ptr);
+s32 IOBufToDevice(void *ptr, AHBDEV device);
+s32 IOBufFromDevice(void *ptr, AHBDEV device);
+
+#endif
@@ -31,9 +31,14 @@ Copyright (C) 2021			DacoTaco
 #define PAGE_MASK                   0x13
 #define SECTION_SECTION             0x01
 #define COURSE_SECTION              0x02
+#define LARGE_COURSE_SECTION        0x01
 #define PAGE_TYPE_MASK              (COURSE_SECTION | SECTION_SECTION)
 #define SECTION_PAGE                0x12
 #define COURSE_PAGE                 0x11
+#define COURSEPAGE_ENTRIES          (0x400 / sizeof(u32))
+//a 64KB large page takes up 16 consecutive entries of a course page table
+#define LARGE_PAGE_SIZE             0x10000
+#define LARGE_PAGE_ENTRIES          (LARGE_PAGE_SIZE / 0x1000)
 
 #define NONBUFFERABLE               0x000
 #define BUFFERABLE                  0x004
@@ -272,6 +277,15 @@ void *_kmallocMemorySection(KernelMemoryType type)
 	return ptr;
 }
 
+//write back the cache lines of the page table entries we changed. the mmu reads the tables
+//from memory, but there is no need to flush the whole data cache for a handful of entries
+static void CleanPageTableEntries(const u32 *entries, u32 count)
+{
+	const u32 *start = ALIGN_BACKWARD(entries);
+	const u32 *end = ALIGN_FORWARD(entries + count);
+	_dc_flush_entries(start, MEMBLOCK_COUNT((u32)start, (u32)end));
+}
+
 s32 MapMemoryAsSection(MemorySection *memorySection)
 {
 	/*Example of a mapping : 
@@ -297,7 +311,7 @@ s32 MapMemoryAsSection(MemorySection *memorySection)
 	u32 *page = &MemoryTranslationTable[PAGE_ENTRY(memorySection->VirtualAddress)];
 	*page = translationBase | (memorySection->PhysicalAddress & 0xFFF00000) |
 	        AP_VALUE(memorySection->AccessRights) | PAGE_DOMAIN(memorySection->Domain);
-	DCFlushRange(page, 4);
+	CleanPageTableEntries(page, 1);
 
 	memorySection->Size = memorySection->Size - 0x100000;
 	memorySection->PhysicalAddress = memorySection->PhysicalAddress + 0x100000;
@@ -305,31 +319,8 @@ s32 MapMemoryAsSection(MemorySection *memorySection)
 	return 0;
 }
 
-//In all honesty, i don't full understand what it is doing in here...
-s32 MapMemoryAsCoursePage(MemorySection *memorySection, u8 mode)
+static s32 GetCoursePageTable(const MemorySection *memorySection, u8 mode, u32 **table)
 {
-	/*
-		Example of a mapping : 
-		virtual address : 0x13A70000
-		physical address : 0x13A70000
-		size : 0x00020000
-		domain : 0x0F
-		accessRights : 0x01;
-		IsCached : 0x01;
-		
-		first the page is allocated using _kmallocMemorySection (mem range > 0x13854000)
-		after that its saved as a course page in our translation table :
-			page[0x13A] = ( 0x13854000 & 0xFFFFFC00 ) | domain << 5 (0x01E0) | COURSE_PAGE(0x11)
-			page[0x13A] = 0x138541F1
-			0x138504E8 = 0x138541F1
-			
-		that takes care of the level 1 mapping. 
-		
-	*/
-
-	if (memorySection == NULL)
-		return IPC_EINVAL;
-
 	u32 **entry = (u32 **)&MemoryTranslationTable[PAGE_ENTRY(memorySection->VirtualAddress)];
 	u32 *pageValue = *entry;
 	if (pageValue == NULL)
@@ -338,8 +329,11 @@ s32 MapMemoryAsCoursePage(MemorySection *memorySection, u8 mode)
 		if (pageValue == NULL)
 			return IPC_ENOMEM;
 
+		//the new table was cleared through the cache, so all of it has to reach memory
+		CleanPageTableEntries(pageValue, COURSEPAGE_ENTRIES);
 		*entry = (u32 *)((0xFFFFFC00 & (u32)pageValue) |
 		                 PAGE_DOMAIN(memorySection->Domain) | COURSE_PAGE);
+		CleanPageTableEntries((u32 *)entry, 1);
 	}
 	else
 	{
@@ -350,14 +344,67 @@ s32 MapMemoryAsCoursePage(MemorySection *memorySection, u8 mode)
 			pageValue = (u32 *)((0xFFFFFC00 & (u32)pageValue) |
 			                    PAGE_DOMAIN(memorySection->Domain) | COURSE_PAGE);
 			*entry = pageValue;
+			CleanPageTableEntries((u32 *)entry, 1);
 		}
 
 		pageValue = (u32 *)(0xFFFFFC00 & (u32)pageValue);
 	}
 
+	*table = pageValue;
+	return 0;
+}
+
+//the 16 entries of a large page have to stay identical. before a single page inside one gets
+//remapped, turn the large page into 16 small pages that map the same memory with the same rights
+static void SplitLargePage(u32 *pageTable, u32 index)
+{
+	u32 *entries = &pageTable[index & ~(u32)(LARGE_PAGE_ENTRIES - 1)];
+	const u32 largePage = entries[0];
+	if ((largePage & PAGE_TYPE_MASK) != LARGE_COURSE_SECTION)
+		return;
+
+	for (u32 i = 0; i < LARGE_PAGE_ENTRIES; i++)
+		entries[i] = (largePage & 0xFFFF0000) | (i << 12) | (largePage & 0xFFC) | COURSE_SECTION;
+
+	CleanPageTableEntries(entries, LARGE_PAGE_ENTRIES);
+}
+
+//In all honesty, i don't full understand what it is doing in here...
+s32 MapMemoryAsCoursePage(MemorySection *memorySection, u8 mode)
+{
+	/*
+		Example of a mapping : 
+		virtual address : 0x13A70000
+		physical address : 0x13A70000
+		size : 0x00020000
+		domain : 0x0F
+		accessRights : 0x01;
+		IsCached : 0x01;
+		
+		first the page is allocated using _kmallocMemorySection (mem range > 0x13854000)
+		after that its saved as a course page in our translation table :
+			page[0x13A] = ( 0x13854000 & 0xFFFFFC00 ) | domain << 5 (0x01E0) | COURSE_PAGE(0x11)
+			page[0x13A] = 0x138541F1
+			0x138504E8 = 0x138541F1
+			
+		that takes care of the level 1 mapping. 
+		
+	*/
+
+	if (memorySection == NULL)
+		return IPC_EINVAL;
+
+	u32 *pageValue = NULL;
+	s32 ret = GetCoursePageTable(memorySection, mode, &pageValue);
+	if (ret != 0)
+		return ret;
+
 	if (mode == 0 && pageValue[COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress)] != 0)
 		return IPC_EINVAL;
 
+	if (mode != 0)
+		SplitLargePage(pageValue, COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress));
+
 	u32 accessRights = memorySection->AccessRights;
 	u32 type = COURSE_SECTION;
 	if (memorySection->IsCached != 0)
@@ -367,15 +414,51 @@ s32 MapMemoryAsCoursePage(MemorySection *memorySection, u8 mode)
 	    (memorySection->PhysicalAddress & 0xFFFFF000) | type |
 	    APX_VALUE(3, accessRights) | APX_VALUE(2, accessRights) |
 	    APX_VALUE(1, accessRights) | APX_VALUE(0, accessRights);
-	DCFlushRange(pageValue, 0x1000);
+	CleanPageTableEntries(&pageValue[COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress)], 1);
 	memorySection->Size -= 0x1000;
 	memorySection->PhysicalAddress += 0x1000;
 	memorySection->VirtualAddress += 0x1000;
 	return 0;
 }
 
-//basically mmap
-s32 MapMemory(MemorySection *entry)
+//same as a course page, but 64KB at once. saves 15 tlb entries per large page
+s32 MapMemoryAsLargePage(MemorySection *memorySection, u8 mode)
+{
+	if (memorySection == NULL)
+		return IPC_EINVAL;
+
+	u32 *pageValue = NULL;
+	s32 ret = GetCoursePageTable(memorySection, mode, &pageValue);
+	if (ret != 0)
+		return ret;
+
+	pageValue += COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress);
+	for (u32 i = 0; mode == 0 && i < LARGE_PAGE_ENTRIES; i++)
+	{
+		if (pageValue[i] != 0)
+			return IPC_EINVAL;
+	}
+
+	u32 accessRights = memorySection->AccessRights;
+	u32 type = LARGE_COURSE_SECTION;
+	if (memorySection->IsCached != 0)
+		type |= WRITEBACK_CACHE;
+
+	const u32 entry = (memorySection->PhysicalAddress & 0xFFFF0000) | type |
+	                  APX_VALUE(3, accessRights) | APX_VALUE(2, accessRights) |
+	                  APX_VALUE(1, accessRights) | APX_VALUE(0, accessRights);
+	for (u32 i = 0; i < LARGE_PAGE_ENTRIES; i++)
+		pageValue[i] = entry;
+
+	CleanPageTableEntries(pageValue, LARGE_PAGE_ENTRIES);
+
+	memorySection->Size -= LARGE_PAGE_SIZE;
+	memorySection->PhysicalAddress += LARGE_PAGE_SIZE;
+	memorySection->VirtualAddress += LARGE_PAGE_SIZE;
+	return 0;
+}
+
+static s32 MapMemoryEntry(const MemorySection *entry, u8 mode)
 {
 	if (entry == NULL)
 		return IPC_EINVAL;
@@ -400,17 +483,54 @@ s32 MapMemory(MemorySection *entry)
 			ret = IPC_EINVAL;
 			break;
 		}
+		else if ((memorySection.VirtualAddress & (LARGE_PAGE_SIZE - 1)) == 0 &&
+		         (memorySection.PhysicalAddress & (LARGE_PAGE_SIZE - 1)) == 0 &&
+		         memorySection.Size >= LARGE_PAGE_SIZE)
+			ret = MapMemoryAsLargePage(&memorySection, mode);
 		else
 		{
-			ret = MapMemoryAsCoursePage(&memorySection, 0);
+			ret = MapMemoryAsCoursePage(&memorySection, mode);
 		}
 	}
 
+	return ret;
+}
+
+//basically mmap
+s32 MapMemory(MemorySection *entry)
+{
+	return MapMemorySections(entry, 1);
+}
+
+static s32 MapMemoryEntries(MemorySection *entries, u32 count, u8 mode)
+{
+	if (entries == NULL)
+		return IPC_EINVAL;
+
+	s32 ret = 0;
+	for (u32 index = 0; ret == 0 && index < count; index++)
+		ret = MapMemoryEntry(&entries[index], mode);
+
+	//the changed entries were already written back while mapping, just drain the write buffer
 	FlushMemory();
+	_ahb_flush_from(AHB_1);
 	TlbInvalidate();
 	return ret;
 }
 
+//maps all entries, but only drains the write buffer and invalidates the tlb once at the end
+s32 MapMemorySections(MemorySection *entries, u32 count)
+{
+	return MapMemoryEntries(entries, count, 0);
+}
+
+//same as MapMemorySections, but replaces whatever the range was mapped as before.
+//used to change the domain & access rights of memory that is already mapped
+s32 RemapMemorySections(MemorySection *entries, u32 count)
+{
+	return MapMemoryEntries(entries, count, 1);
+}
+
 s32 MapHardwareRegisters()
 {
 	u32 **page = (u32 **)&MemoryTranslationTable[0xD0];
@@ -470,6 +590,8 @@ u32 VirtualToPhysical(u32 virtualAddress)
 		                    (pageEntry & 0xFFFFFC00));
 		if ((page & PAGE_TYPE_MASK) == COURSE_SECTION)
 			physicalAddress = (virtualAddress & 0xFFF) | (page & 0xFFFFF000);
+		else if ((page & PAGE_TYPE_MASK) == LARGE_COURSE_SECTION)
+			physicalAddress = (virtualAddress & 0xFFFF) | (page & 0xFFFF0000);
 	}
 
 	if (physicalAddress < 0xFFFE0000)
@@ -489,7 +611,9 @@ s32 CheckMemoryBlock(u8 *ptr, u32 type, u32 pid, u32 domainPid, u32 *blockSize)
 	{
 		*blockSize = 0x1000;
 		u32 page = *(u32 *)((COURSEPAGE_ENTRY_VALUE((u32)ptr) << 2) + (pageEntry & 0xFFFFFC00));
-		if ((page & PAGE_TYPE_MASK) != COURSE_SECTION)
+		if ((page & PAGE_TYPE_MASK) == LARGE_COURSE_SECTION)
+			*blockSize = LARGE_PAGE_SIZE;
+		else if ((page & PAGE_TYPE_MASK) != COURSE_SECTION)
 			goto return_error;
 
 		AccessPermissionsValue = page << 0x1A;
@@ -565,13 +689,9 @@ s32 InitializeMemory(void)
 		goto ret_init;
 	}
 
-	for (u32 i = 0; i < (sizeof(KernelMemoryMaps) / sizeof(KernelMemoryMaps[0])); i++)
-	{
-		MemorySection *section = &KernelMemoryMaps[i];
-		ret = MapMemory(section);
-		if (ret < 0)
-			goto ret_init;
-	}
+	ret = MapMemorySections(KernelMemoryMaps, sizeof(KernelMemoryMaps) / sizeof(KernelMemoryMaps[0]));
+	if (ret < 0)
+		goto ret_init;
 
 	//Ios also maps the registers/mirror with certain access for each process
 	ret = MapHardwareRegisters();
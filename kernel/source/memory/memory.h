@@ -98,6 +98,8 @@ typedef enum
 s32 InitializeMemory(void);
 void *KMalloc(u32 size);
 s32 MapMemory(MemorySection *entry);
+s32 MapMemorySections(MemorySection *entries, u32 count);
+s32 RemapMemorySections(MemorySection *entries, u32 count);
 u32 VirtualToPhysical(u32 virtualAddress);
 s32 CheckMemoryPointer(const void *ptr, u32 size, u32 type, u32 pid, u32 domainPid);
 #endif
@@ -107,6 +109,7 @@ void DCFlushRange(const void *start, u32 size);
 void DCFlushAll(void);
 void ICInvalidateAll(void);
 u32 TlbInvalidate(void);
+void TlbInvalidateEntry(u32 virtualAddress);
 void FlushMemory(void);
 
 u32 GetControlRegister(void);
@@ -0,0 +1,132 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	logRing - drains the log rings of all processes to the gecko
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/errno.h>
+#include <ios/gecko.h>
+
+#include "interrupt/irq.h"
+#include "memory/memory.h"
+#include "messaging/logRing.h"
+#include "messaging/messageQueue.h"
+#include "scheduler/threads.h"
+#include "scheduler/timer.h"
+#include "panic.h"
+
+#ifndef MIOS
+
+static LogRing *LogRings[MAX_PROCESSES] = { NULL };
+static u32 ReportedDroppedMessages[MAX_PROCESSES] = { 0 };
+static u32 DroppedBytes[MAX_PROCESSES] = { 0 };
+
+s32 RegisterLogRing(LogRing *ring)
+{
+	u32 irqState = DisableInterrupts();
+	const u32 processId = CurrentThread->ProcessId;
+	s32 ret = CheckMemoryPointer(ring, sizeof(LogRing), 4, processId, 0);
+	if (ret != IPC_SUCCESS)
+		goto restore_and_return;
+
+	LogRings[processId] = ring;
+	ReportedDroppedMessages[processId] = ring->DroppedMessages;
+	DroppedBytes[processId] = 0;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+//stops draining a process' ring. whatever was not drained yet is lost
+void ReleaseLogRing(const u32 processId)
+{
+	if (processId >= MAX_PROCESSES)
+		return;
+
+	u32 irqState = DisableInterrupts();
+	LogRings[processId] = NULL;
+	RestoreInterrupts(irqState);
+}
+
+s32 UnregisterLogRing(void)
+{
+	ReleaseLogRing(CurrentThread->ProcessId);
+	return IPC_SUCCESS;
+}
+
+static void DrainLogRing(const u32 processId, LogRing *ring)
+{
+	const u32 head = ring->Head;
+	u32 tail = ring->Tail;
+
+	//head is written by the process, so never read more than one ring's worth behind it
+	if (head - tail > LOG_RING_SIZE)
+	{
+		DroppedBytes[processId] += head - tail - LOG_RING_SIZE;
+		tail = head - LOG_RING_SIZE;
+	}
+
+	//send everything up to the end of the ring in one go, then the part that wrapped around
+	while (tail != head)
+	{
+		const u32 offset = tail & LOG_RING_MASK;
+		u32 size = head - tail;
+		if (size > LOG_RING_SIZE - offset)
+			size = LOG_RING_SIZE - offset;
+
+		gecko_write(&ring->Data[offset], size);
+		tail += size;
+	}
+	ring->Tail = tail;
+
+	const u32 droppedMessages = ring->DroppedMessages;
+	if (droppedMessages != ReportedDroppedMessages[processId])
+	{
+		gecko_printf("process %u dropped %u log messages\n", processId,
+		             droppedMessages - ReportedDroppedMessages[processId]);
+		ReportedDroppedMessages[processId] = droppedMessages;
+	}
+
+	if (DroppedBytes[processId] != 0)
+	{
+		gecko_printf("process %u skipped %u bytes of its log ring\n", processId,
+		             DroppedBytes[processId]);
+		DroppedBytes[processId] = 0;
+	}
+}
+
+void LogRingHandler(void)
+{
+	u32 messageQueue[1];
+	void *message;
+
+	s32 ret = CreateMessageQueue((void **)&messageQueue, 1);
+	if (ret < 0)
+		panic("Unable to create log ring queue: %d\n", ret);
+
+	const s32 queueId = ret;
+	ret = CreateTimer(0, LOG_RING_DRAIN_INTERVAL, queueId, NULL);
+	if (ret < 0)
+		panic("Unable to create log ring timer: %d\n", ret);
+
+	while (1)
+	{
+		ret = ReceiveMessage(queueId, &message, None);
+		if (ret != IPC_SUCCESS)
+			panic("iosReceiveMessage: %d\n", ret);
+
+		for (u32 processId = 0; processId < MAX_PROCESSES; processId++)
+		{
+			LogRing *ring = LogRings[processId];
+			if (ring != NULL)
+				DrainLogRing(processId, ring);
+		}
+	}
+}
+
+#endif
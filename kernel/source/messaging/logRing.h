@@ -0,0 +1,27 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	logRing - drains the log rings of all processes to the gecko
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __LOGRING_KERNEL_H__
+#define __LOGRING_KERNEL_H__
+
+#include <types.h>
+#include <ios/logring.h>
+
+#ifndef MIOS
+
+#define LOG_RING_DRAIN_INTERVAL 10000
+
+s32 RegisterLogRing(LogRing *ring);
+s32 UnregisterLogRing(void);
+void ReleaseLogRing(const u32 processId);
+void LogRingHandler(void);
+
+#endif
+#endif
@@ -20,6 +20,7 @@ Copyright (C) 2008, 2009	Sven Peter <svenpeter@gmail.com>
 #define ECC_BUFFER_ALLOC (PAGE_SPARE_SIZE + 32)
 #define BLOCK_SIZE       64
 #define NAND_MAX_PAGE    0x40000
+#define NAND_BLOCK_COUNT (NAND_MAX_PAGE / BLOCK_SIZE)
 
 void nand_irq(void);
 
@@ -30,7 +31,7 @@ void nand_get_status(u8 *);
 void nand_read_page(u32 pageno, void *data, void *ecc);
 void nand_write_page(u32 pageno, void *data, void *ecc);
 void nand_erase_block(u32 pageno);
-void nand_wait(void);
+int nand_wait(void);
 
 #define NAND_ECC_OK            0
 #define NAND_ECC_CORRECTED     1
@@ -39,4 +40,9 @@ void nand_wait(void);
 int nand_correct(u32 pageno, void *data, void *ecc);
 void nand_initialize(void);
 
+void nand_scan_blocks(void);
+int nand_block_is_bad(u32 block);
+void nand_mark_block_bad(u32 block);
+void nand_get_block_stats(u32 block, u16 *corrected, u16 *uncorrectable);
+
 #endif
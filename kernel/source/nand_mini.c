@@ -51,14 +51,24 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 #define NAND_FLAGS_RD	0x2000
 #define NAND_FLAGS_ECC	0x1000
 
+#define MEM2_BSS __attribute__ ((section (".bss.mem2")))
+
 static volatile int irq_flag;
+static volatile int nand_error;
 static u32 last_page_read = 0;
 static u32 nand_min_page = 0x200; // default to protecting boot1+boot2
 
+// block health, filled in by nand_scan_blocks, the fs' fat and the ecc checks of every read
+static u32 bad_blocks[NAND_BLOCK_COUNT / 32];
+static u16 ecc_corrected[NAND_BLOCK_COUNT] MEM2_BSS;
+static u16 ecc_uncorrectable[NAND_BLOCK_COUNT] MEM2_BSS;
+static u8 scan_buf[ECC_BUFFER_ALLOC] MEM2_BSS ALIGNED(128);
+
 void nand_irq(void)
 {
 	if(read32(NAND_CMD) & NAND_ERROR) {
 		gecko_printf("NAND: Error on IRQ\n");
+		nand_error = 1;
 	}
 	_ahb_flush_from(AHB_NAND);
 	AhbFlushTo(AHB_STARLET);
@@ -151,6 +161,7 @@ int nand_reset(void) {
 
 void nand_get_id(u8 *idbuf) {
 	irq_flag = 0;
+	nand_error = 0;
 	__nand_set_address(0,0);
 
 	DCInvalidateRange(idbuf, 0x40);
@@ -161,6 +172,7 @@ void nand_get_id(u8 *idbuf) {
 
 void nand_get_status(u8 *status_buf) {
 	irq_flag = 0;
+	nand_error = 0;
 	status_buf[0]=0;
 
 	DCInvalidateRange(status_buf, 0x40);
@@ -171,6 +183,7 @@ void nand_get_status(u8 *status_buf) {
 
 void nand_read_page(u32 pageno, void *data, void *ecc) {
 	irq_flag = 0;
+	nand_error = 0;
 	last_page_read = pageno;  // needed for error reporting
 	__nand_set_address(0, pageno);
 	nand_send_command(NAND_READ_PRE, 0x1f, 0, 0);
@@ -183,7 +196,7 @@ void nand_read_page(u32 pageno, void *data, void *ecc) {
 	nand_send_command(NAND_READ_POST, 0, NAND_FLAGS_IRQ | NAND_FLAGS_WAIT | NAND_FLAGS_RD | NAND_FLAGS_ECC, 0x840);
 }
 
-void nand_wait(void) {
+int nand_wait(void) {
 // power-saving IRQ wait
 	while(!irq_flag) {
 		u32 cookie = DisableInterrupts();
@@ -191,11 +204,31 @@ void nand_wait(void) {
 			irq_wait();
 		RestoreInterrupts(cookie);
 	}
+	return nand_error ? -1 : 0;
+}
+
+// reads only the spare area of a page by starting the transfer at its column
+static void nand_read_spare(u32 pageno, void *spare) {
+	irq_flag = 0;
+	nand_error = 0;
+	write32(NAND_ADDR0, PAGE_SIZE);
+	write32(NAND_ADDR1, pageno);
+	nand_send_command(NAND_READ_PRE, 0x1f, 0, 0);
+
+	DCInvalidateRange(spare, PAGE_SPARE_SIZE);
+
+	__nand_wait();
+	__nand_setup_dma(spare, (u8 *)-1);
+	nand_send_command(NAND_READ_POST, 0, NAND_FLAGS_IRQ | NAND_FLAGS_WAIT | NAND_FLAGS_RD, PAGE_SPARE_SIZE);
+	nand_wait();
+// every other command expects the transfer to start at the beginning of the page
+	write32(NAND_ADDR0, 0);
 }
 
 #ifdef NAND_SUPPORT_WRITE
 void nand_write_page(u32 pageno, void *data, void *ecc) {
 	irq_flag = 0;
+	nand_error = 0;
 	NAND_debug("nand_write_page(%u, %p, %p)\n", pageno, data, ecc);
 
 // this is a safety check to prevent you from accidentally wiping out boot1 or boot2.
@@ -217,6 +250,7 @@ void nand_write_page(u32 pageno, void *data, void *ecc) {
 #ifdef NAND_SUPPORT_ERASE
 void nand_erase_block(u32 pageno) {
 	irq_flag = 0;
+	nand_error = 0;
 	NAND_debug("nand_erase_block(%d)\n", pageno);
 
 // this is a safety check to prevent you from accidentally wiping out boot1 or boot2.
@@ -232,16 +266,63 @@ void nand_erase_block(u32 pageno) {
 }
 #endif
 
+int nand_block_is_bad(u32 block)
+{
+	if (block >= NAND_BLOCK_COUNT)
+		return 1;
+	return (bad_blocks[block / 32] >> (block % 32)) & 1;
+}
+
+void nand_mark_block_bad(u32 block)
+{
+	if (block >= NAND_BLOCK_COUNT || nand_block_is_bad(block))
+		return;
+	gecko_printf("NAND: marking block 0x%x as bad\n", block);
+	bad_blocks[block / 32] |= 1u << (block % 32);
+}
+
+void nand_get_block_stats(u32 block, u16 *corrected, u16 *uncorrectable)
+{
+	*corrected = block < NAND_BLOCK_COUNT ? ecc_corrected[block] : 0;
+	*uncorrectable = block < NAND_BLOCK_COUNT ? ecc_uncorrectable[block] : 0;
+}
+
+// factory bad blocks carry a marker in the first spare byte of their first or second page.
+// only boot1 & boot2's blocks are scanned on boot. the fs keeps the bad blocks of everything
+// after them in its fat, which lives on the nand, and hands them over once it mounted
+#define NAND_BOOT_BLOCKS (0x200 / BLOCK_SIZE)
+void nand_scan_blocks(void)
+{
+	u32 block, page;
+	u32 bad = 0;
+
+	memset(bad_blocks, 0, sizeof(bad_blocks));
+	memset(ecc_corrected, 0, sizeof(ecc_corrected));
+	memset(ecc_uncorrectable, 0, sizeof(ecc_uncorrectable));
+
+	for(block = 0; block < NAND_BOOT_BLOCKS; block++) {
+		for(page = 0; page < 2; page++) {
+			nand_read_spare(block * BLOCK_SIZE + page, scan_buf);
+			if(scan_buf[0] != 0xFF) {
+				nand_mark_block_bad(block);
+				bad++;
+				break;
+			}
+		}
+	}
+
+	gecko_printf("NAND: %d bad blocks\n", bad);
+}
+
 void nand_initialize(void)
 {
 	nand_reset();
 	irq_enable(IRQ_NAND);
+	nand_scan_blocks();
 }
 
 int nand_correct(u32 pageno, void *data, void *ecc)
 {
-	(void) pageno;
-
 	u8 *dp = (u8*)data;
 	u32 *ecc_read = (u32*)((u8*)ecc+0x30);
 	u32 *ecc_calc = (u32*)((u8*)ecc+0x40);
@@ -274,8 +355,14 @@ int nand_correct(u32 pageno, void *data, void *ecc)
 		ecc_read++;
 		ecc_calc++;
 	}
-	if(uncorrectable || corrected)
-		gecko_printf("ECC stats for NAND page 0x%x: %d uncorrectable, %d corrected\n", pageno, uncorrectable, corrected);
+	if((uncorrectable || corrected) && pageno < NAND_MAX_PAGE) {
+		u32 block = pageno / BLOCK_SIZE;
+		NAND_debug("ECC stats for NAND page 0x%x: %d uncorrectable, %d corrected\n", pageno, uncorrectable, corrected);
+		if(ecc_corrected[block] <= (u16)(0xFFFF - corrected))
+			ecc_corrected[block] += (u16)corrected;
+		if(ecc_uncorrectable[block] <= (u16)(0xFFFF - uncorrectable))
+			ecc_uncorrectable[block] += (u16)uncorrectable;
+	}
 	if(uncorrectable)
 		return NAND_ECC_UNCORRECTABLE;
 	if(corrected)
@@ -0,0 +1,302 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	emunand - nand page access backed by a nand image on the sd card
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/gecko.h>
+
+#include "core/defines.h"
+#include "peripherals/emunand.h"
+#include "nand.h"
+#include "sdmmc.h"
+#include "ff.h"
+
+#define MEM2_BSS __attribute__((section(".bss.mem2")))
+
+#define SECTOR_SIZE           512
+#define RAW_PAGE_SIZE         (PAGE_SIZE + PAGE_SPARE_SIZE)
+#define PAGES_PER_CLUSTER     8
+//8 raw pages are exactly 33 sectors, so every nand cluster starts on a sector
+#define SECTORS_PER_CLUSTER   (PAGES_PER_CLUSTER * RAW_PAGE_SIZE / SECTOR_SIZE)
+#define CLUSTERS_PER_BLOCK    (BLOCK_SIZE / PAGES_PER_CLUSTER)
+#define IMAGE_SIZE            ((u32)NAND_MAX_PAGE * RAW_PAGE_SIZE)
+#define IMAGE_CLUSTERS        (NAND_MAX_PAGE / PAGES_PER_CLUSTER)
+#define MAX_EXTENTS           128
+#define CACHE_CLUSTERS        4
+#define MAX_TRANSFER_SECTORS  512
+
+StaticAssert(SECTORS_PER_CLUSTER * SECTOR_SIZE == PAGES_PER_CLUSTER * RAW_PAGE_SIZE,
+             "nand clusters must end on a sector boundary");
+
+//a run of image sectors that is contiguous on the sd card
+typedef struct
+{
+	u32 ImageSector;
+	u32 SdSector;
+	u32 Count;
+} ImageExtent;
+
+static ImageExtent Extents[MAX_EXTENTS] MEM2_BSS;
+static u32 ExtentCount = 0;
+static bool EmuNandActive = false;
+
+//read ahead cache of whole nand clusters. writes go through it to the card
+static u8 Cache[CACHE_CLUSTERS * SECTORS_PER_CLUSTER * SECTOR_SIZE] MEM2_BSS ALIGNED(32);
+static u32 CacheCluster = 0;
+static u32 CacheCount = 0;
+
+static s32 AddExtent(u32 imageSector, u32 sdSector, u32 count)
+{
+	ImageExtent *last = ExtentCount > 0 ? &Extents[ExtentCount - 1] : NULL;
+	if (last != NULL && last->SdSector + last->Count == sdSector)
+	{
+		last->Count += count;
+		return IPC_SUCCESS;
+	}
+
+	if (ExtentCount >= MAX_EXTENTS)
+		return IPC_ENOMEM;
+
+	Extents[ExtentCount].ImageSector = imageSector;
+	Extents[ExtentCount].SdSector = sdSector;
+	Extents[ExtentCount].Count = count;
+	ExtentCount++;
+	return IPC_SUCCESS;
+}
+
+//walk the fat chain of the image once, so no access ever has to again
+static s32 BuildExtents(FIL *file)
+{
+	const FATFS *fs = file->fs;
+	const u32 fatClusterSize = (u32)fs->csize * SECTOR_SIZE;
+	const u32 fatClusters = (IMAGE_SIZE + fatClusterSize - 1) / fatClusterSize;
+
+	ExtentCount = 0;
+	for (u32 i = 0; i < fatClusters; i++)
+	{
+		//seeking into a cluster leaves curr_clust pointing at it
+		if (f_lseek(file, i * fatClusterSize + 1) != FR_OK)
+			return IPC_EINVAL;
+
+		const u32 sdSector = (file->curr_clust - 2) * fs->csize + fs->database;
+		s32 ret = AddExtent(i * fs->csize, sdSector, fs->csize);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static const ImageExtent *FindExtent(u32 imageSector)
+{
+	u32 low = 0;
+	u32 high = ExtentCount;
+
+	while (low < high)
+	{
+		const u32 middle = (low + high) / 2;
+		const ImageExtent *extent = &Extents[middle];
+		if (imageSector < extent->ImageSector)
+			high = middle;
+		else if (imageSector >= extent->ImageSector + extent->Count)
+			low = middle + 1;
+		else
+			return extent;
+	}
+
+	return NULL;
+}
+
+//split the transfer along the extents, so every contiguous piece is one sd command
+static s32 TransferSectors(u32 imageSector, u32 count, u8 *buffer, bool write)
+{
+	while (count > 0)
+	{
+		const ImageExtent *extent = FindExtent(imageSector);
+		if (extent == NULL)
+			return IPC_EINVAL;
+
+		const u32 offset = imageSector - extent->ImageSector;
+		u32 sectors = extent->Count - offset;
+		if (sectors > count)
+			sectors = count;
+		if (sectors > MAX_TRANSFER_SECTORS)
+			sectors = MAX_TRANSFER_SECTORS;
+
+		const int ret = write ? sdmmc_write(extent->SdSector + offset, sectors, buffer) :
+		                        sdmmc_read(extent->SdSector + offset, sectors, buffer);
+		if (ret < 0)
+			return write ? IPC_BADBLOCK : IPC_ECC_CRIT;
+
+		imageSector += sectors;
+		buffer += sectors * SECTOR_SIZE;
+		count -= sectors;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static s32 LoadCluster(u32 cluster)
+{
+	if (CacheCount > 0 && cluster >= CacheCluster && cluster < CacheCluster + CacheCount)
+		return IPC_SUCCESS;
+
+	u32 count = IMAGE_CLUSTERS - cluster;
+	if (count > CACHE_CLUSTERS)
+		count = CACHE_CLUSTERS;
+
+	CacheCount = 0;
+	s32 ret = TransferSectors(cluster * SECTORS_PER_CLUSTER, count * SECTORS_PER_CLUSTER, Cache, false);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	CacheCluster = cluster;
+	CacheCount = count;
+	return IPC_SUCCESS;
+}
+
+static inline u8 *GetCachedPage(u32 page)
+{
+	return &Cache[(page - CacheCluster * PAGES_PER_CLUSTER) * RAW_PAGE_SIZE];
+}
+
+//compare a few sectors read through the extent table with what fatfs itself reads for them
+static s32 VerifyExtents(FIL *file)
+{
+	const u32 imageSectors = IMAGE_SIZE / SECTOR_SIZE;
+	const u32 probes[] = { 0, imageSectors / 2, imageSectors - 1 };
+	u8 *extentSector = Cache;
+	u8 *fileSector = Cache + SECTOR_SIZE;
+
+	for (u32 i = 0; i < sizeof(probes) / sizeof(probes[0]); i++)
+	{
+		UINT read = 0;
+		if (f_lseek(file, probes[i] * SECTOR_SIZE) != FR_OK ||
+		    f_read(file, fileSector, SECTOR_SIZE, &read) != FR_OK || read != SECTOR_SIZE)
+			return IPC_EINVAL;
+
+		s32 ret = TransferSectors(probes[i], 1, extentSector, false);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		if (memcmp(extentSector, fileSector, SECTOR_SIZE) != 0)
+		{
+			gecko_printf("emunand: sector %u does not match the file\n", probes[i]);
+			return IPC_EINVAL;
+		}
+	}
+
+	return IPC_SUCCESS;
+}
+
+s32 InitializeEmuNand(const char *path)
+{
+	FIL file;
+
+	FRESULT fres = f_open(&file, path, FA_READ);
+	if (fres != FR_OK)
+	{
+		gecko_printf("emunand: failed to open %s (%d)\n", path, fres);
+		return IPC_ENOENT;
+	}
+
+	s32 ret = IPC_INVALIDSIZE;
+	if (file.fsize < IMAGE_SIZE)
+	{
+		gecko_printf("emunand: %s is too small for a nand image\n", path);
+		goto close;
+	}
+
+	ret = BuildExtents(&file);
+	if (ret != IPC_SUCCESS)
+	{
+		gecko_printf("emunand: failed to map %s (%d), is it too fragmented?\n", path, ret);
+		goto close;
+	}
+
+	ret = VerifyExtents(&file);
+	if (ret != IPC_SUCCESS)
+	{
+		gecko_printf("emunand: failed to verify %s (%d)\n", path, ret);
+		goto close;
+	}
+
+	CacheCount = 0;
+	EmuNandActive = true;
+	gecko_printf("emunand: using %s, %u extents\n", path, ExtentCount);
+
+close:
+	f_close(&file);
+	return ret;
+}
+
+bool IsEmuNandActive(void)
+{
+	return EmuNandActive;
+}
+
+s32 ReadEmuNandPage(u32 page, void *data, void *spare)
+{
+	s32 ret = LoadCluster(page / PAGES_PER_CLUSTER);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	const u8 *rawPage = GetCachedPage(page);
+	if (data != NULL)
+		memcpy(data, rawPage, PAGE_SIZE);
+	if (spare != NULL)
+		memcpy(spare, rawPage + PAGE_SIZE, PAGE_SPARE_SIZE);
+
+	return IPC_SUCCESS;
+}
+
+s32 WriteEmuNandPage(u32 page, const void *data, const void *spare)
+{
+	//the page shares its first & last sector with its neighbours, so update the whole cluster
+	const u32 cluster = page / PAGES_PER_CLUSTER;
+	s32 ret = LoadCluster(cluster);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	u8 *rawPage = GetCachedPage(page);
+	memcpy(rawPage, data, PAGE_SIZE);
+	memcpy(rawPage + PAGE_SIZE, spare, PAGE_SPARE_SIZE);
+
+	const u32 firstSector = page * RAW_PAGE_SIZE / SECTOR_SIZE;
+	const u32 lastSector = ((page + 1) * RAW_PAGE_SIZE - 1) / SECTOR_SIZE;
+	const u32 cacheSector = CacheCluster * SECTORS_PER_CLUSTER;
+	ret = TransferSectors(firstSector, lastSector - firstSector + 1,
+	                      &Cache[(firstSector - cacheSector) * SECTOR_SIZE], true);
+	if (ret != IPC_SUCCESS)
+		CacheCount = 0;
+
+	return ret;
+}
+
+s32 EraseEmuNandBlock(u32 block)
+{
+	const u32 firstCluster = block * CLUSTERS_PER_BLOCK;
+	s32 ret = IPC_SUCCESS;
+
+	//the cache doubles as the 0xFF source, so it holds nothing valid afterwards
+	CacheCount = 0;
+	memset(Cache, 0xFF, sizeof(Cache));
+	for (u32 i = 0; i < CLUSTERS_PER_BLOCK && ret == IPC_SUCCESS; i += CACHE_CLUSTERS)
+	{
+		u32 count = CLUSTERS_PER_BLOCK - i;
+		if (count > CACHE_CLUSTERS)
+			count = CACHE_CLUSTERS;
+
+		ret = TransferSectors((firstCluster + i) * SECTORS_PER_CLUSTER,
+		                      count * SECTORS_PER_CLUSTER, Cache, true);
+	}
+
+	return ret;
+}
@@ -0,0 +1,26 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	emunand - nand page access backed by a nand image on the sd card
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __EMUNAND_H__
+#define __EMUNAND_H__
+
+#include <types.h>
+
+#define EMUNAND_IMAGE_PATH "/nand.bin"
+
+//a nand dump with the spare data of every page right after the page itself
+s32 InitializeEmuNand(const char *path);
+bool IsEmuNandActive(void);
+
+s32 ReadEmuNandPage(u32 page, void *data, void *spare);
+s32 WriteEmuNandPage(u32 page, const void *data, const void *spare);
+s32 EraseEmuNandBlock(u32 block);
+
+#endif
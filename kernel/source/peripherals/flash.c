@@ -0,0 +1,170 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	flash - nand page access for the filesystem module
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+
+#include "core/defines.h"
+#include "memory/memory.h"
+#include "scheduler/threads.h"
+#include "peripherals/flash.h"
+#include "peripherals/emunand.h"
+#include "nand.h"
+
+#define MEM2_BSS __attribute__((section(".bss.mem2")))
+
+//the module's memory isn't identity mapped, so dma goes through these kernel buffers
+static u8 FlashPageBuffer[PAGE_SIZE] MEM2_BSS ALIGNED(64);
+static u8 FlashSpareBuffer[ECC_BUFFER_ALLOC] MEM2_BSS ALIGNED(128);
+
+static s32 CheckFlashAccess(u32 page, const void *data, const void *spare, u32 type)
+{
+	if (CurrentThread->ProcessId != FLASH_PROCESS_ID)
+		return IPC_EACCES;
+
+	if (page >= NAND_MAX_PAGE)
+		return IPC_EINVAL;
+
+	//bad blocks are never programmed or erased again. reads still go through, so whatever was
+	//committed to a block before a program or erase on it failed stays readable
+	if (type != 4 && !IsEmuNandActive() && nand_block_is_bad(page / BLOCK_SIZE))
+		return IPC_BADBLOCK;
+
+	if (data != NULL &&
+	    CheckMemoryPointer(data, PAGE_SIZE, type, CurrentThread->ProcessId, 0) != IPC_SUCCESS)
+		return IPC_EACCES;
+
+	if (spare != NULL && CheckMemoryPointer(spare, PAGE_SPARE_SIZE, type,
+	                                        CurrentThread->ProcessId, 0) != IPC_SUCCESS)
+		return IPC_EACCES;
+
+	return IPC_SUCCESS;
+}
+
+s32 ReadFlashPage(u32 page, void *data, void *spare)
+{
+	s32 ret = CheckFlashAccess(page, data, spare, 4);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (IsEmuNandActive())
+		return ReadEmuNandPage(page, data, spare);
+
+	nand_read_page(page, FlashPageBuffer, FlashSpareBuffer);
+	nand_wait();
+
+	switch (nand_correct(page, FlashPageBuffer, FlashSpareBuffer))
+	{
+		case NAND_ECC_UNCORRECTABLE:
+			ret = IPC_ECC_CRIT;
+			break;
+		case NAND_ECC_CORRECTED:
+			ret = IPC_ECC;
+			break;
+		default:
+			ret = IPC_SUCCESS;
+			break;
+	}
+
+	if (data != NULL)
+		memcpy(data, FlashPageBuffer, PAGE_SIZE);
+	if (spare != NULL)
+		memcpy(spare, FlashSpareBuffer, PAGE_SPARE_SIZE);
+
+	return ret;
+}
+
+s32 WriteFlashPage(u32 page, const void *data, const void *spare)
+{
+	s32 ret = CheckFlashAccess(page, data, spare, 3);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (data == NULL || spare == NULL)
+		return IPC_EINVAL;
+
+	if (page < FLASH_PROTECTED_PAGES)
+		return IPC_EACCES;
+
+	if (IsEmuNandActive())
+		return WriteEmuNandPage(page, data, spare);
+
+	memcpy(FlashPageBuffer, data, PAGE_SIZE);
+	memcpy(FlashSpareBuffer, spare, PAGE_SPARE_SIZE);
+	nand_write_page(page, FlashPageBuffer, FlashSpareBuffer);
+	if (nand_wait() < 0)
+	{
+		nand_mark_block_bad(page / BLOCK_SIZE);
+		return IPC_BADBLOCK;
+	}
+
+	return IPC_SUCCESS;
+}
+
+s32 EraseFlashBlock(u32 block)
+{
+	s32 ret = CheckFlashAccess(block * BLOCK_SIZE, NULL, NULL, 0);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (block * BLOCK_SIZE < FLASH_PROTECTED_PAGES)
+		return IPC_EACCES;
+
+	if (IsEmuNandActive())
+		return EraseEmuNandBlock(block);
+
+	nand_erase_block(block * BLOCK_SIZE);
+	if (nand_wait() < 0)
+	{
+		nand_mark_block_bad(block);
+		return IPC_BADBLOCK;
+	}
+
+	return IPC_SUCCESS;
+}
+
+//the fs keeps bad blocks in its fat, which survives a reboot. it hands them over after mounting,
+//so the kernel doesn't have to read every block's spare data on boot to find them
+s32 MarkFlashBlockBad(u32 block)
+{
+	if (CurrentThread->ProcessId != FLASH_PROCESS_ID)
+		return IPC_EACCES;
+
+	if (block >= NAND_BLOCK_COUNT)
+		return IPC_EINVAL;
+
+	if (!IsEmuNandActive())
+		nand_mark_block_bad(block);
+
+	return IPC_SUCCESS;
+}
+
+s32 GetFlashBlockStats(u32 block, FlashBlockStats *stats)
+{
+	if (CurrentThread->ProcessId != FLASH_PROCESS_ID)
+		return IPC_EACCES;
+
+	if (block >= NAND_BLOCK_COUNT)
+		return IPC_EINVAL;
+
+	if (CheckMemoryPointer(stats, sizeof(FlashBlockStats), 4, CurrentThread->ProcessId, 0) !=
+	    IPC_SUCCESS)
+		return IPC_EACCES;
+
+	if (IsEmuNandActive())
+	{
+		memset(stats, 0, sizeof(FlashBlockStats));
+		return IPC_SUCCESS;
+	}
+
+	stats->Bad = (u32)nand_block_is_bad(block);
+	nand_get_block_stats(block, &stats->CorrectedErrors, &stats->UncorrectableErrors);
+	return IPC_SUCCESS;
+}
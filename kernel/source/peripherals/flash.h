@@ -0,0 +1,29 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	flash - nand page access for the filesystem module
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <types.h>
+#include <ios/flash.h>
+
+//only the filesystem module is allowed to talk to the nand directly
+#define FLASH_PROCESS_ID 0x02
+//boot1 & boot2 live in the first blocks and are never written through here
+#define FLASH_PROTECTED_PAGES 0x200
+
+//Syscalls
+s32 ReadFlashPage(u32 page, void *data, void *spare);
+s32 WriteFlashPage(u32 page, const void *data, const void *spare);
+s32 EraseFlashBlock(u32 block);
+s32 GetFlashBlockStats(u32 block, FlashBlockStats *stats);
+s32 MarkFlashBlockBad(u32 block);
+
+#endif
@@ -20,6 +20,7 @@
 #include "interrupt/irq.h"
 #include "scheduler/threads.h"
 #include "messaging/ipc.h"
+#include "messaging/logRing.h"
 #include "filedesc/calls.h"
 #include "memory/memory.h"
 #include "memory/heaps.h"
@@ -133,17 +134,48 @@ ThreadInfo *ThreadQueue_PopThread(ThreadQueue *queue)
 	return ret;
 }
 
+#ifndef MIOS
+//install the domain access & hardware register mappings of a process.
+//threads of the same process share these, so we only touch what actually changed
+static inline void SwitchProcessContext(u32 processId)
+{
+	const u32 domainAccess = DomainAccessControlTable[processId];
+	if (GetDomainAccessControlRegister() != domainAccess)
+		SetDomainAccessControlRegister(domainAccess);
+
+	const u32 oldTable = MemoryTranslationTable[0xD0];
+	const u32 newTable = (u32)HardwareRegistersAccessTable[processId];
+	if (oldTable == newTable)
+		return;
+
+	MemoryTranslationTable[0xD0] = newTable;
+	FlushMemory();
+
+	//the section descriptor itself changed (type, domain, ...) so every page in it is stale
+	if ((oldTable & 0x3FF) != (newTable & 0x3FF) || (oldTable & 0x03) != 0x01)
+	{
+		TlbInvalidate();
+		return;
+	}
+
+	//only drop the tlb entries of the pages that are mapped differently between both processes
+	const u32 *oldPages = (const u32 *)(oldTable & 0xFFFFFC00);
+	const u32 *newPages = (const u32 *)(newTable & 0xFFFFFC00);
+	for (u32 page = 0; page < 0x100; page++)
+	{
+		if (oldPages[page] != newPages[page])
+			TlbInvalidateEntry(0x0D000000 | (page << 12));
+	}
+}
+#endif
+
 __attribute__((target("arm"))) __attribute__((noreturn)) void ScheduleYield(void)
 {
 	CurrentThread = ThreadQueue_PopThread(&SchedulerQueue);
 	CurrentThread->ThreadState = Running;
 
 #ifndef MIOS
-	SetDomainAccessControlRegister(DomainAccessControlTable[CurrentThread->ProcessId]);
-	MemoryTranslationTable[0xD0] =
-	    (u32)HardwareRegistersAccessTable[CurrentThread->ProcessId];
-	TlbInvalidate();
-	FlushMemory();
+	SwitchProcessContext(CurrentThread->ProcessId);
 #endif
 
 	__asm__ volatile(
@@ -316,6 +348,20 @@ restore_and_return:
 	return ret;
 }
 
+#ifndef MIOS
+static bool IsProcessAlive(const u32 processId)
+{
+	for (u32 i = 0; i < MAX_THREADS; i++)
+	{
+		if (Threads[i].ProcessId == processId && Threads[i].ThreadState != Unset &&
+		    Threads[i].ThreadState != Dead)
+			return true;
+	}
+
+	return false;
+}
+#endif
+
 s32 CancelThread(const s32 threadId, u32 return_value)
 {
 	u32 irqState = DisableInterrupts();
@@ -355,6 +401,12 @@ s32 CancelThread(const s32 threadId, u32 return_value)
 	else
 		threadToCancel->ThreadState = Unset;
 
+#ifndef MIOS
+	//once the last thread of a process is gone nobody looks after its log ring anymore
+	if (!IsProcessAlive(threadToCancel->ProcessId))
+		ReleaseLogRing(threadToCancel->ProcessId);
+#endif
+
 	CurrentThread->Context.Registers[0] = (u32)ret;
 	if (threadToCancel == CurrentThread)
 		ScheduleYield();
@@ -610,6 +662,41 @@ restore_and_return:
 	return ret;
 }
 #ifndef MIOS
+//big enough to get the elf header and all program headers of a module in a single read
+#define RM_HEADER_READ_SIZE 0x400
+
+static s32 ReadRMSegment(s32 fd, const u8 *headerBuffer, u32 headerLength, u32 *filePosition,
+                         const Elf32_Phdr *programHeader, void *destination)
+{
+	const u32 offset = programHeader->p_offset;
+	const u32 size = programHeader->p_filesz;
+	if (size == 0)
+		return IPC_SUCCESS;
+
+	//already got it with the headers
+	if (offset <= headerLength && size <= headerLength - offset)
+	{
+		memcpy(destination, headerBuffer + offset, size);
+		return IPC_SUCCESS;
+	}
+
+	//segments are read in file order, so we only seek when there is a gap between them
+	s32 ret;
+	if (offset != *filePosition)
+	{
+		ret = SeekFD(fd, (s32)offset, 0);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = ReadFD(fd, destination, size);
+	if (ret != (s32)size)
+		return ret < 0 ? ret : IPC_EINVAL;
+
+	*filePosition = offset + size;
+	return IPC_SUCCESS;
+}
+
 s32 LaunchRM(const char *path)
 {
 	if (GetUID() != 0)
@@ -617,36 +704,36 @@ s32 LaunchRM(const char *path)
 
 	//*technically* heapid 0 isn't correct here. the kernel heap id just happens to be always 0, but... :)
 	//but hey, this is what IOS did!
-	Elf32_Ehdr *elfHeader = (Elf32_Ehdr *)AllocateOnHeap(0, sizeof(Elf32_Ehdr));
-	if (elfHeader == NULL)
+	u8 *headerBuffer = (u8 *)AllocateOnHeap(0, RM_HEADER_READ_SIZE);
+	if (headerBuffer == NULL)
 		return IPC_EMAX;
 
 	const u32 elfMagic = ELFMAGIC;
+	const Elf32_Ehdr *elfHeader = (Elf32_Ehdr *)headerBuffer;
 	Elf32_Nhdr *noteHeader = NULL;
 	Elf32_Phdr *programHeaders = NULL;
+	u32 noteLength = 0;
+	u32 headerLength = 0;
+	u32 filePosition = 0;
 	s32 fd = OpenFD(path, IOS_OPEN);
 	s32 ret = fd;
 	if (ret < 0)
 		goto cleanup_launch;
 
-	if (ReadFD(fd, elfHeader, 4) != 4)
+	ret = ReadFD(fd, headerBuffer, RM_HEADER_READ_SIZE);
+	if (ret < 0)
 		goto cleanup_launch;
 
-	if (memcmp(elfHeader, &elfMagic, 4) != 0)
+	headerLength = (u32)ret;
+	filePosition = headerLength;
+	if (headerLength < 4 || memcmp(headerBuffer, &elfMagic, 4) != 0)
 	{
 		ret = 0;
 		goto cleanup_launch;
 	}
 
-	ret = SeekFD(fd, 0, 0);
-	if (ret != 0)
-		goto cleanup_launch;
-
-	ret = ReadFD(fd, elfHeader, sizeof(Elf32_Ehdr));
-	if (ret != sizeof(Elf32_Ehdr))
-		goto cleanup_launch;
-
-	if (ELFMAGIC != *((u32 *)&elfHeader->e_ident[EI_MAG0]) ||
+	if (headerLength < sizeof(Elf32_Ehdr) ||
+	    ELFMAGIC != *((u32 *)&elfHeader->e_ident[EI_MAG0]) ||
 	    IOSELFINFO != *((u32 *)&elfHeader->e_ident[EI_CLASS]))
 	{
 		ret = IPC_EINVAL;
@@ -660,93 +747,132 @@ s32 LaunchRM(const char *path)
 		goto cleanup_launch;
 	}
 
-	programHeaders =
-	    (Elf32_Phdr *)AllocateOnHeap(0, sizeof(Elf32_Phdr) * elfHeader->e_phnum);
+	const u32 headerCount = elfHeader->e_phnum;
+	const u32 programHeadersSize = sizeof(Elf32_Phdr) * headerCount;
+	programHeaders = (Elf32_Phdr *)AllocateOnHeap(0, programHeadersSize);
 	if (!programHeaders)
 	{
 		ret = IPC_EMAX;
 		goto cleanup_launch;
 	}
 
-	ret = ReadFD(fd, programHeaders, sizeof(Elf32_Phdr) * elfHeader->e_phnum);
-	if (ret != (s32)(sizeof(Elf32_Phdr) * elfHeader->e_phnum))
-		goto cleanup_launch;
+	if (elfHeader->e_phoff <= headerLength &&
+	    programHeadersSize <= headerLength - elfHeader->e_phoff)
+		memcpy(programHeaders, headerBuffer + elfHeader->e_phoff, programHeadersSize);
+	else
+	{
+		ret = SeekFD(fd, (s32)elfHeader->e_phoff, 0);
+		if (ret < 0)
+			goto cleanup_launch;
 
-	noteHeader = AllocateOnHeap(0, 0x4000);
-	if (!noteHeader)
+		ret = ReadFD(fd, programHeaders, programHeadersSize);
+		if (ret != (s32)programHeadersSize)
+			goto cleanup_launch;
+
+		filePosition = elfHeader->e_phoff + programHeadersSize;
+	}
+
+	//sort the segments by file offset so they can be streamed in with as few seeks as possible
+	for (u32 headerIndex = 1; headerIndex < headerCount; headerIndex++)
 	{
-		ret = IPC_EMAX;
-		goto cleanup_launch;
+		Elf32_Phdr programHeader = programHeaders[headerIndex];
+		u32 index = headerIndex;
+		for (; index > 0 && programHeaders[index - 1].p_offset > programHeader.p_offset; index--)
+			programHeaders[index] = programHeaders[index - 1];
+
+		programHeaders[index] = programHeader;
 	}
 
-	u32 headerCount = elfHeader->e_phnum;
-	u32 noteLength = 0;
-	u32 noteOffset = 0;
 	for (u32 headerIndex = 0; headerIndex < headerCount; headerIndex++)
 	{
 		Elf32_Phdr *programHeader = programHeaders + headerIndex;
-		if (programHeader->p_type == PT_LOAD)
+		if (programHeader->p_type == PT_NOTE)
 		{
+			if (noteHeader != NULL || programHeader->p_filesz < sizeof(Elf32_Nhdr))
+				continue;
+
+			noteHeader = AllocateOnHeap(0, programHeader->p_filesz);
+			if (!noteHeader)
+			{
+				ret = IPC_EMAX;
+				goto cleanup_launch;
+			}
+
 			noteLength = programHeader->p_filesz;
-			noteOffset = programHeader->p_offset;
+			ret = ReadRMSegment(fd, headerBuffer, headerLength, &filePosition,
+			                    programHeader, noteHeader);
+			if (ret != IPC_SUCCESS)
+				goto cleanup_launch;
+
 			continue;
 		}
 
 		if (programHeader->p_type != PT_LOAD || programHeader->p_vaddr == 0)
 			continue;
 
-		MemorySection section = { .PhysicalAddress = programHeader->p_paddr,
-			                      .VirtualAddress = programHeader->p_vaddr,
-			                      .Size = (programHeader->p_memsz + 0xFFF) & 0xFFFFF000,
-			                      .Domain = 0,
-			                      .AccessRights = AP_RWUSER,
-			                      .IsCached = 1 };
-
-		if (MapMemory(&section) != 0)
-			panic("Unable to map region %08x [%d bytes]\n",
-			      section.VirtualAddress, section.Size);
-
-		ret = SeekFD(fd, (s32)programHeader->p_offset, 0);
-		if (ret < 0)
-			goto cleanup_launch;
-
-		ret = ReadFD(fd, (void *)programHeader->p_vaddr, programHeader->p_filesz);
-		if (ret != (s32)programHeader->p_filesz)
+		if (programHeader->p_filesz > programHeader->p_memsz)
+		{
+			ret = IPC_EINVAL;
 			goto cleanup_launch;
-
-		//if the filecontent < the memory size we need to clear it
-		if (ret < (s32)programHeader->p_memsz)
-			memset((void *)programHeader->p_vaddr, 0, programHeader->p_memsz - (u32)ret);
+		}
 
 		//unknown flags
+		u32 accessRights;
 		switch (programHeader->p_flags)
 		{
 			case 2:
-				section.AccessRights = AP_RWUSER;
+				accessRights = AP_RWUSER;
 				break;
 			case 0:
-				section.AccessRights = AP_ROM;
+				accessRights = AP_ROM;
 				break;
 			case 1:
 			default:
-				section.AccessRights = AP_ROUSER;
+				accessRights = AP_ROUSER;
 				break;
 		}
 
-		section.Domain = FLAGSTODOMAIN(programHeader->p_flags << 6);
-		if (MapMemory(&section) != 0)
-			panic("Unable to map region %08x [%d bytes]\n",
-			      section.VirtualAddress, section.Size);
-
-		//map virtual address
-		section.VirtualAddress = MEM2_PHY2VIRT(section.VirtualAddress);
-		section.IsCached = 0;
-		if (MapMemory(&section) != 0)
-			panic("Unable to map region %08x [%d bytes]\n",
-			      section.VirtualAddress, section.Size);
+		//the fs writes the segment from user mode and its pointer check wants writable memory,
+		//so the cached view starts out writable in the domain everyone shares.
+		//the uncached view is not touched while loading and gets its final rights right away
+		MemorySection sections[2] = {
+			{ .PhysicalAddress = programHeader->p_paddr,
+			  .VirtualAddress = programHeader->p_vaddr,
+			  .Size = (programHeader->p_memsz + 0xFFF) & 0xFFFFF000,
+			  .Domain = 0x08,
+			  .AccessRights = AP_RWUSER,
+			  .IsCached = 1 },
+			{ .PhysicalAddress = programHeader->p_paddr,
+			  .VirtualAddress = MEM2_PHY2VIRT(programHeader->p_vaddr),
+			  .Size = (programHeader->p_memsz + 0xFFF) & 0xFFFFF000,
+			  .Domain = FLAGSTODOMAIN(programHeader->p_flags << 6),
+			  .AccessRights = accessRights,
+			  .IsCached = 0 },
+		};
+
+		if (MapMemorySections(sections, 2) != 0)
+			panic("Unable to map region %08x [%d bytes]\n", sections[0].VirtualAddress,
+			      sections[0].Size);
+
+		ret = ReadRMSegment(fd, headerBuffer, headerLength, &filePosition, programHeader,
+		                    (void *)programHeader->p_vaddr);
 
-		//no idea why but hey, you do you IOS
-		ret = elfHeader->e_phnum;
+		//if the filecontent < the memory size we need to clear it
+		if (ret == IPC_SUCCESS && programHeader->p_filesz < programHeader->p_memsz)
+			memset((void *)(programHeader->p_vaddr + programHeader->p_filesz), 0,
+			       programHeader->p_memsz - programHeader->p_filesz);
+
+		//write it all back before taking the write access away again.
+		//a failed read gets its final rights too, so nothing is left writable for everyone
+		DCFlushRange((void *)programHeader->p_vaddr, programHeader->p_memsz);
+		sections[0].Domain = FLAGSTODOMAIN(programHeader->p_flags << 6);
+		sections[0].AccessRights = accessRights;
+		if (RemapMemorySections(sections, 1) != 0)
+			panic("Unable to map region %08x [%d bytes]\n", sections[0].VirtualAddress,
+			      sections[0].Size);
+
+		if (ret != IPC_SUCCESS)
+			goto cleanup_launch;
 	}
 
 	ret = 0;
@@ -755,18 +881,9 @@ s32 LaunchRM(const char *path)
 	AhbFlushFrom(AHB_1);
 	AhbFlushTo(AHB_1);
 
-	if (noteLength == 0)
-		goto cleanup_launch;
-
-	ret = SeekFD(fd, (s32)noteOffset, 0);
-	if (ret < 0)
+	if (noteLength == 0 || noteHeader->n_descsz > noteLength - sizeof(Elf32_Nhdr))
 		goto cleanup_launch;
 
-	ret = ReadFD(fd, noteHeader, noteLength);
-	if (ret != (s32)noteLength)
-		goto cleanup_launch;
-
-	ret = 0;
 	const u32 noteSize = noteHeader->n_descsz / sizeof(ModuleInfo);
 	const ModuleInfo *module = (ModuleInfo *)(((u32)noteHeader) + sizeof(Elf32_Nhdr));
 	for (u32 index = 0; index < noteSize; index++)
@@ -791,8 +908,8 @@ cleanup_launch:
 	if (programHeaders)
 		FreeOnHeap(0, programHeaders);
 
-	if (elfHeader)
-		FreeOnHeap(0, elfHeader);
+	if (headerBuffer)
+		FreeOnHeap(0, headerBuffer);
 
 	if (noteHeader)
 		FreeOnHeap(0, noteHeader);
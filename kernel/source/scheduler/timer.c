@@ -270,7 +270,7 @@ return_create_timer:
 	RestoreInterrupts(interupts);
 	return ret;
 }
-s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
+static s32 RestartTimerChecked(s32 timerId, u32 timeUs, u32 repeatTimeUs, bool checkProcess)
 {
 	u32 interupts = DisableInterrupts();
 	s32 ret = 0;
@@ -281,7 +281,7 @@ s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
 		goto return_restart_timer;
 	}
 
-	if (timers[timerId].ProcessId != CurrentThread->ProcessId)
+	if (checkProcess && timers[timerId].ProcessId != CurrentThread->ProcessId)
 	{
 		ret = IPC_EACCES;
 		goto return_restart_timer;
@@ -304,7 +304,16 @@ return_restart_timer:
 	RestoreInterrupts(interupts);
 	return ret;
 }
-s32 StopOrDestroyTimer(s32 timerId, s32 destroyTimer)
+s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
+{
+	return RestartTimerChecked(timerId, timeUs, repeatTimeUs, true);
+}
+//kernel drivers that wait on behalf of whatever process called them use these
+s32 RestartTimerUnsafe(s32 timerId, u32 timeUs, u32 repeatTimeUs)
+{
+	return RestartTimerChecked(timerId, timeUs, repeatTimeUs, false);
+}
+s32 StopOrDestroyTimer(s32 timerId, s32 destroyTimer, bool checkProcess)
 {
 	s32 ret = 0;
 	u32 interupts = DisableInterrupts();
@@ -320,7 +329,7 @@ s32 StopOrDestroyTimer(s32 timerId, s32 destroyTimer)
 	}
 
 	timerInfo = &timers[timerId];
-	if (timerInfo->ProcessId != CurrentThread->ProcessId)
+	if (checkProcess && timerInfo->ProcessId != CurrentThread->ProcessId)
 	{
 		ret = IPC_EACCES;
 		goto return_stop_timer;
@@ -375,9 +384,13 @@ return_stop_timer:
 }
 s32 StopTimer(s32 timerId)
 {
-	return StopOrDestroyTimer(timerId, 0);
+	return StopOrDestroyTimer(timerId, 0, true);
+}
+s32 StopTimerUnsafe(s32 timerId)
+{
+	return StopOrDestroyTimer(timerId, 0, false);
 }
 s32 DestroyTimer(s32 timerId)
 {
-	return StopOrDestroyTimer(timerId, 1);
+	return StopOrDestroyTimer(timerId, 1, true);
 }
@@ -51,7 +51,9 @@ void QueueTimer(TimerInfo *timerInfo);
 u32 ConvertDelayToTicks(u32 delay);
 s32 CreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message);
 s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs);
+s32 RestartTimerUnsafe(s32 timerId, u32 timeUs, u32 repeatTimeUs);
 s32 StopTimer(s32 timerId);
+s32 StopTimerUnsafe(s32 timerId);
 s32 DestroyTimer(s32 timerId);
 u32 GetTimerValue(void);
 void SetTimerAlarm(u32 ticks);
@@ -23,10 +23,14 @@
 #include <string.h>
 #include <ios/processor.h>
 #include <ios/gecko.h>
+#include <ios/errno.h>
 
 #include "memory/memory.h"
 #include "messaging/ipc.h"
+#include "messaging/messageQueue.h"
 #include "interrupt/irq.h"
+#include "scheduler/timer.h"
+#include "scheduler/threads.h"
 
 #include "utils.h"
 #include "bsdtypes.h"
@@ -35,6 +39,18 @@
 
 struct sdhc_host sc_host;
 
+/*
+ * Waiting threads block on this queue. It is fed by sdhc_irq through the
+ * registered event handler and by a one-shot timer for the timeouts.
+ * The kernel waits on it for whichever process called in, like the fs
+ * module doing emunand i/o, so the queue & timer are used without the
+ * owner checks.
+ */
+static u32 sdhc_event_messages[4];
+static u32 sdhc_timeout_message;
+static s32 sdhc_event_queue = -1;
+static s32 sdhc_timeout_timer = -1;
+
 //#define SDHC_DEBUG
 
 #define SDHC_COMMAND_TIMEOUT	500
@@ -96,6 +112,7 @@ static inline void bus_space_write_1(bus_space_handle_t ioh, u32 r, u8 v)
 
 /* flag values */
 #define SHF_USE_DMA		0x0001
+#define SHF_HIGH_SPEED		0x0002
 
 #define HREAD1(hp, reg)							\
 	(bus_space_read_1((hp)->ioh, (reg)))
@@ -118,6 +135,10 @@ static inline void bus_space_write_1(bus_space_handle_t ioh, u32 r, u8 v)
 #define HSET2(hp, reg, bits)						\
 	HWRITE2((hp), (reg), HREAD2((hp), (reg)) | (bits))
 
+/* interrupts the waiting thread has to be woken up for */
+#define SDHC_WAKEUP_INTR	(SDHC_BUFFER_READ_READY | SDHC_BUFFER_WRITE_READY | \
+	SDHC_COMMAND_COMPLETE | SDHC_TRANSFER_COMPLETE | SDHC_ERROR_INTERRUPT)
+
 int	sdhc_start_command(struct sdhc_host *, struct sdmmc_command *);
 int	sdhc_wait_state(struct sdhc_host *, u_int32_t, u_int32_t);
 int	sdhc_soft_reset(struct sdhc_host *, int);
@@ -183,6 +204,9 @@ sdhc_host_found(bus_space_tag_t iot, bus_space_handle_t ioh, int usedma)
 	/*
 	 * Determine the base clock frequency. (2.2.24)
 	 */
+	if (ISSET(caps, SDHC_HIGH_SPEED_SUPP))
+		SET(sc_host.flags, SHF_HIGH_SPEED);
+
 	if (SDHC_BASE_FREQ_KHZ(caps) != 0)
 		sc_host.clkbase = SDHC_BASE_FREQ_KHZ(caps);
 	if (sc_host.clkbase == 0) {
@@ -376,6 +400,45 @@ sdhc_bus_clock(struct sdhc_host *hp, int freq)
 	return 0;
 }
 
+/*
+ * Switch the data bus between 1-bit and 4-bit mode. The card has to
+ * be told first (ACMD6), the host follows.
+ */
+int
+sdhc_bus_width(struct sdhc_host *hp, int width)
+{
+	switch (width) {
+	case 1:
+		HCLR1(hp, SDHC_HOST_CTL, SDHC_4BIT_MODE);
+		break;
+	case 4:
+		HSET1(hp, SDHC_HOST_CTL, SDHC_4BIT_MODE);
+		break;
+	default:
+		return EINVAL;
+	}
+	return 0;
+}
+
+/*
+ * Enable or disable high speed timing. Only once the card accepted the
+ * CMD6 switch; the clock itself is raised with sdhc_bus_clock().
+ */
+int
+sdhc_bus_highspeed(struct sdhc_host *hp, int enable)
+{
+	if (!enable) {
+		HCLR1(hp, SDHC_HOST_CTL, SDHC_HIGH_SPEED);
+		return 0;
+	}
+
+	if (!ISSET(hp->flags, SHF_HIGH_SPEED))
+		return EOPNOTSUPP;
+
+	HSET1(hp, SDHC_HOST_CTL, SDHC_HIGH_SPEED);
+	return 0;
+}
+
 void
 sdhc_card_intr_mask(struct sdhc_host *hp, int enable)
 {
@@ -412,9 +475,25 @@ sdhc_wait_state(struct sdhc_host *hp, u_int32_t mask, u_int32_t value)
 
 void
 sdhc_exec_command(struct sdhc_host *hp, struct sdmmc_command *cmd)
+{
+	sdhc_submit_command(hp, cmd);
+	sdhc_complete_command(hp, cmd);
+}
+
+/*
+ * Start a command and wait for its command phase only. A data transfer is
+ * left running and finished by sdhc_complete_command, so the caller can do
+ * other work while the controller moves the data.
+ */
+void
+sdhc_submit_command(struct sdhc_host *hp, struct sdmmc_command *cmd)
 {
 	int error;
 
+	/* Only one command can be on the bus at a time. */
+	if (hp->pending_command != NULL)
+		sdhc_complete_command(hp, hp->pending_command);
+
 	if (cmd->c_datalen > 0)
 		hp->data_command = 1;
 
@@ -473,10 +552,27 @@ sdhc_exec_command(struct sdhc_host *hp, struct sdmmc_command *cmd)
 
 	/*
 	 * If the command has data to transfer in any direction,
-	 * execute the transfer now.
+	 * the transfer is finished by sdhc_complete_command.
 	 */
-	if (cmd->c_error == 0 && cmd->c_datalen > 0)
-		sdhc_transfer_data(hp, cmd);
+	if (cmd->c_error == 0 && cmd->c_datalen > 0) {
+		hp->pending_command = cmd;
+		return;
+	}
+
+	DPRINTF(1,("sdhc: cmd %u done (flags=%#x error=%d prev state=%d)\n",
+	    cmd->c_opcode, cmd->c_flags, cmd->c_error, (cmd->c_resp[0] >> 9) & 15));
+	SET(cmd->c_flags, SCF_ITSDONE);
+	hp->data_command = 0;
+}
+
+void
+sdhc_complete_command(struct sdhc_host *hp, struct sdmmc_command *cmd)
+{
+	if (hp->pending_command != cmd)
+		return;
+
+	hp->pending_command = NULL;
+	sdhc_transfer_data(hp, cmd);
 
 	DPRINTF(1,("sdhc: cmd %u done (flags=%#x error=%d prev state=%d)\n",
 	    cmd->c_opcode, cmd->c_flags, cmd->c_error, (cmd->c_resp[0] >> 9) & 15));
@@ -524,11 +620,12 @@ sdhc_start_command(struct sdhc_host *hp, struct sdmmc_command *cmd)
 		mode |= SDHC_READ_MODE;
 	if (blkcount > 0) {
 		mode |= SDHC_BLOCK_COUNT_ENABLE;
-//		if (blkcount > 1) {
+		/* Only memory transfers are stopped with CMD12, not CMD6 & co. */
+		if (cmd->c_opcode == MMC_READ_BLOCK_MULTIPLE ||
+		    cmd->c_opcode == MMC_WRITE_BLOCK_MULTIPLE) {
 			mode |= SDHC_MULTI_BLOCK_MODE;
-			/* XXX only for memory commands? */
 			mode |= SDHC_AUTO_CMD12_ENABLE;
-//		}
+		}
 	}
 	if (ISSET(hp->flags, SHF_USE_DMA))
 		mode |= SDHC_DMA_ENABLE;
@@ -614,6 +711,7 @@ sdhc_transfer_data(struct sdhc_host *hp, struct sdmmc_command *cmd)
 //				gecko_printf("got a TRANSFER_COMPLETE: %08x\n", status);
 				break;
 			}
+			/* dma boundaries are handled in sdhc_intr, this is only reached when polling */
 			if (ISSET(status, SDHC_DMA_INTERRUPT)) {
 				DPRINTF(2,("sdhc: dma left:%#x\n", HREAD2(hp, SDHC_BLOCK_COUNT)));
 				// this works because our virtual memory
@@ -671,6 +769,33 @@ sdhc_soft_reset(struct sdhc_host *hp, int mask)
 	return (0);
 }
 
+/*
+ * Block the calling thread until one of the interrupts in `mask' arrived or
+ * `timo' milliseconds passed. Returns 0 on timeout.
+ */
+static int
+sdhc_wait_event(struct sdhc_host *hp, int mask, int timo)
+{
+	void *message;
+
+	/* drop wakeups & timeouts left over from earlier commands */
+	StopTimerUnsafe(sdhc_timeout_timer);
+	while (ReceiveMessageUnsafe(sdhc_event_queue, NULL, RegisteredEventHandler) == IPC_SUCCESS)
+		;
+
+	RestartTimerUnsafe(sdhc_timeout_timer, (u32)timo * 1000, 0);
+	while (!ISSET(hp->intr_status, mask)) {
+		if (ReceiveMessageUnsafe(sdhc_event_queue, &message, None) != IPC_SUCCESS ||
+		    message == &sdhc_timeout_message) {
+			timo = ISSET(hp->intr_status, mask);
+			break;
+		}
+	}
+	StopTimerUnsafe(sdhc_timeout_timer);
+
+	return timo;
+}
+
 int
 sdhc_wait_intr_debug(const char *funcname, int line, struct sdhc_host *hp, int mask, int timo)
 {
@@ -684,13 +809,17 @@ sdhc_wait_intr_debug(const char *funcname, int line, struct sdhc_host *hp, int m
 
 	status = hp->intr_status & mask;
 
-	for (; timo > 0; timo--) {
-		if (hp->intr_status != 0) {
-			status = hp->intr_status & mask;
-			break;
+	if (sdhc_event_queue >= 0)
+		timo = sdhc_wait_event(hp, mask, timo);
+	else {
+		for (; timo > 0; timo--) {
+			if (hp->intr_status != 0)
+				break;
+			udelay(1000);
 		}
-		udelay(1000);
 	}
+	if (timo > 0)
+		status = hp->intr_status & mask;
 
 	if (timo == 0) {
 		status |= SDHC_ERROR_TIMEOUT;
@@ -730,6 +859,7 @@ int
 sdhc_intr(void)
 {
 	u_int16_t status;
+	u_int16_t error;
 
 	DPRINTF(1,("shdc_intr():\n"));
 //	sdhc_dump_regs(&sc_host);
@@ -741,17 +871,30 @@ sdhc_intr(void)
 		return 0;
 	}
 	
-	/* Acknowledge the interrupts we are about to handle. */
+	/*
+	 * Acknowledge the interrupts we are about to handle. The 16 bit write
+	 * is a read-modify-write of the whole word, which acknowledges the
+	 * error status as well, so that has to be read first.
+	 */
+	error = HREAD2(&sc_host, SDHC_EINTR_STATUS);
 	HWRITE2(&sc_host, SDHC_NINTR_STATUS, status);
 	DPRINTF(2,("sdhc: interrupt status=%d\n", status));
 
+	/*
+	 * Restart the dma at its boundary right away, instead of waking up the
+	 * waiting thread for every 4KB.
+	 */
+	if (ISSET(status, SDHC_DMA_INTERRUPT) && sc_host.data_command &&
+	    !ISSET(status, SDHC_TRANSFER_COMPLETE)) {
+		HWRITE4(&sc_host, SDHC_DMA_ADDR, HREAD4(&sc_host, SDHC_DMA_ADDR));
+		status &= ~SDHC_DMA_INTERRUPT;
+	}
+
 	/* Service error interrupts. */
 	if (ISSET(status, SDHC_ERROR_INTERRUPT)) {
-		u_int16_t error;
 		u_int16_t signal;
 
 		/* Acknowledge error interrupts. */
-		error = HREAD2(&sc_host, SDHC_EINTR_STATUS);
 		signal = HREAD2(&sc_host, SDHC_EINTR_SIGNAL_EN);
 		HWRITE2(&sc_host, SDHC_EINTR_SIGNAL_EN, 0);
 		(void)sdhc_soft_reset(&sc_host, SDHC_RESET_DAT|SDHC_RESET_CMD);
@@ -828,13 +971,34 @@ sdhc_dump_regs(struct sdhc_host *hp)
 
 #include "core/hollywood.h"
 
-void sdhc_irq(void)
+int sdhc_irq(void)
 {
+	u16 status = sc_host.intr_status;
+
 	sdhc_intr();
+	return sdhc_event_queue >= 0 && (sc_host.intr_status & ~status & SDHC_WAKEUP_INTR) != 0;
 }
 
 void sdhc_init(void)
 {
+	s32 ret = CreateMessageQueue((void **)&sdhc_event_messages, 4);
+	if (ret >= 0) {
+		sdhc_event_queue = ret;
+		ret = RegisterEventHandler(IRQ_SDHC, sdhc_event_queue, NULL);
+	}
+	if (ret >= 0) {
+		ret = CreateTimer(0, 0, sdhc_event_queue, &sdhc_timeout_message);
+		sdhc_timeout_timer = ret;
+	}
+	if (ret < 0) {
+		gecko_printf("sdhc: falling back to polling (%d)\n", ret);
+		if (sdhc_event_queue >= 0) {
+			UnregisterEventHandler(IRQ_SDHC);
+			DestroyMessageQueue(sdhc_event_queue);
+		}
+		sdhc_event_queue = sdhc_timeout_timer = -1;
+	}
+
 	irq_enable(IRQ_SDHC);
 	sdhc_host_found(0, SDHC_REG_BASE, 1);
 }
@@ -843,4 +1007,11 @@ void sdhc_exit(void)
 {
        irq_disable(IRQ_SDHC);
        sdhc_shutdown();
+
+       if (sdhc_event_queue >= 0) {
+               DestroyTimer(sdhc_timeout_timer);
+               UnregisterEventHandler(IRQ_SDHC);
+               DestroyMessageQueue(sdhc_event_queue);
+               sdhc_event_queue = sdhc_timeout_timer = -1;
+       }
 }
@@ -35,6 +35,7 @@ struct sdhc_host
 	u_int16_t intr_status;  /* soft interrupt status */
 	u_int16_t intr_error_status; /* soft error status */
 	int data_command;
+	struct sdmmc_command *pending_command; /* data transfer still in flight */
 };
 
 extern struct sdhc_host sc_host;
@@ -46,7 +47,7 @@ void sdhc_shutdown(void);
 int sdhc_intr(void);
 void sdhc_init(void);
 void sdhc_exit(void);
-void sdhc_irq(void);
+int sdhc_irq(void);
 
 /* Host standard register set */
 #define SDHC_DMA_ADDR              0x00
@@ -199,8 +200,12 @@ int sdhc_host_reset(struct sdhc_host *hp);
 int sdhc_card_detect(struct sdhc_host *hp);
 int sdhc_bus_power(struct sdhc_host *hp, u_int32_t);
 int sdhc_bus_clock(struct sdhc_host *hp, int);
+int sdhc_bus_width(struct sdhc_host *hp, int);
+int sdhc_bus_highspeed(struct sdhc_host *hp, int);
 void sdhc_card_intr_mask(struct sdhc_host *hp, int);
 void sdhc_card_intr_ack(struct sdhc_host *hp);
 void sdhc_exec_command(struct sdhc_host *hp, struct sdmmc_command *);
+void sdhc_submit_command(struct sdhc_host *hp, struct sdmmc_command *);
+void sdhc_complete_command(struct sdhc_host *hp, struct sdmmc_command *);
 
 #endif
@@ -13,6 +13,7 @@ Copyright (C) 2008, 2009	Sven Peter <svenpeter@gmail.com>
 
 #include "core/defines.h"
 #include "memory/memory.h"
+#include "scheduler/timer.h"
 #include "bsdtypes.h"
 #include "utils.h"
 #include "sdhc.h"
@@ -36,7 +37,10 @@ static int sdmmcdebug = 0;
 	while (0)
 #endif
 
+#define MEM2_BSS __attribute__((section(".bss.mem2")))
+
 static struct sdmmc_card card SRAM_BSS;
+static u8 sdmmc_scratch[SDMMC_DEFAULT_BLOCKLEN * 8] MEM2_BSS ALIGNED(32);
 
 struct sdmmc_card
 {
@@ -45,6 +49,8 @@ struct sdmmc_card
 	int sdhc_blockmode;
 	int selected;
 	int new_card; // set to 1 everytime a new card is inserted
+	int bus_width;
+	int high_speed;
 
 	u32 timeout;
 	u32 num_sectors;
@@ -81,6 +87,99 @@ void sdmmc_abort(void)
 	sdhc_exec_command(card.handle, &cmd);
 }
 
+static int sdmmc_app_command(u16 opcode, u32 arg)
+{
+	struct sdmmc_command cmd;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.c_opcode = MMC_APP_CMD;
+	cmd.c_arg = MMC_ARG_RCA((u32)card.rca);
+	cmd.c_flags = SCF_RSP_R1;
+	sdhc_exec_command(card.handle, &cmd);
+	if (cmd.c_error)
+		return cmd.c_error;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.c_opcode = opcode;
+	cmd.c_arg = arg;
+	cmd.c_flags = SCF_RSP_R1;
+	sdhc_exec_command(card.handle, &cmd);
+	return cmd.c_error;
+}
+
+static int sdmmc_switch_func(u32 arg, u8 *status)
+{
+	struct sdmmc_command cmd;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.c_opcode = SD_SWITCH_FUNC;
+	cmd.c_arg = arg;
+	cmd.c_data = status;
+	cmd.c_datalen = SD_SWITCH_STATUS_LEN;
+	cmd.c_blklen = SD_SWITCH_STATUS_LEN;
+	cmd.c_flags = SCF_CMD_ADTC | SCF_CMD_READ | SCF_RSP_R1;
+	sdhc_exec_command(card.handle, &cmd);
+	return cmd.c_error;
+}
+
+/*
+ * Move the card from the 1-bit, 25MHz bus it was discovered on to the
+ * fastest mode both sides agree on. Anything that fails leaves the card
+ * in the last mode that worked.
+ */
+static void sdmmc_negotiate_bus(void)
+{
+	u8 *status = sdmmc_scratch;
+
+	card.bus_width = 1;
+	card.high_speed = 0;
+
+	if (sdmmc_app_command(SD_APP_SET_BUS_WIDTH, SD_ARG_BUS_WIDTH_4) == 0 &&
+	    sdhc_bus_width(card.handle, 4) == 0)
+		card.bus_width = 4;
+
+	//sd 1.0 cards don't know CMD6 and just fail the check
+	if (sdmmc_switch_func(SD_SWITCH_MODE_CHECK | SD_SWITCH_GROUP1_HS, status) != 0 ||
+	    !SD_SWITCH_HS_SUPPORTED(status))
+		return;
+
+	if (sdmmc_switch_func(SD_SWITCH_MODE_SET | SD_SWITCH_GROUP1_HS, status) != 0 ||
+	    SD_SWITCH_GROUP1_RESULT(status) != 1)
+		return;
+
+	//the card is in high speed now, so the host has to follow or drop back to 25MHz
+	if (sdhc_bus_highspeed(card.handle, 1) == 0 &&
+	    sdhc_bus_clock(card.handle, SDMMC_SDCLK_50MHZ) == 0)
+	{
+		card.high_speed = 1;
+		return;
+	}
+
+	gecko_printf("sdmmc: host can't do high speed, staying at 25MHz\n");
+	sdhc_bus_highspeed(card.handle, 0);
+	sdhc_bus_clock(card.handle, SDMMC_DEFAULT_CLOCK);
+}
+
+//time a short sequential read from the start of the card, in KB/s
+static u32 sdmmc_measure_read_rate(void)
+{
+	const u32 blocks = sizeof(sdmmc_scratch) / SDMMC_DEFAULT_BLOCKLEN;
+	const u32 passes = 16;
+	u32 start, ticks;
+
+	start = GetTimerValue();
+	for (u32 i = 0; i < passes; i++)
+	{
+		if (sdmmc_read(i * blocks, blocks, sdmmc_scratch) < 0)
+			return 0;
+	}
+	ticks = GetTimerValue() - start;
+	if (ticks == 0)
+		return 0;
+
+	return (u32)((u64)(passes * sizeof(sdmmc_scratch) / 1024) * ConvertDelayToTicks(1000000) / ticks);
+}
+
 void sdmmc_needs_discover(void)
 {
 	struct sdmmc_command cmd;
@@ -282,6 +381,10 @@ void sdmmc_needs_discover(void)
 		card.inserted = card.selected = 0;
 		goto out_clock;
 	}
+
+	sdmmc_negotiate_bus();
+	gecko_printf("sdmmc: %d-bit bus, %s speed\n", card.bus_width,
+	             card.high_speed ? "high" : "default");
 	return;
 
 out_clock:
@@ -332,21 +435,22 @@ int sdmmc_ack_card(void)
 {
 	if (card.new_card == 1)
 	{
+		//transfers are refused until the card is acknowledged, so only now one can be timed
 		card.new_card = 0;
+		if (card.inserted)
+			gecko_printf("sdmmc: reading at %uKB/s\n", sdmmc_measure_read_rate());
 		return 0;
 	}
 
 	return -1;
 }
 
-int sdmmc_read(u32 blk_start, u32 blk_count, void *data)
+static int sdmmc_submit_transfer(struct sdmmc_command *cmd, u16 opcode, u32 blk_start, u32 blk_count,
+                                 void *data)
 {
-	struct sdmmc_command cmd;
-
-	//	gecko_printf("%s(%u, %u, %p)\n", __FUNCTION__, blk_start, blk_count, data);
 	if (card.inserted == 0)
 	{
-		gecko_printf("sdmmc: READ: no card inserted.\n");
+		gecko_printf("sdmmc: no card inserted.\n");
 		return -1;
 	}
 
@@ -354,7 +458,7 @@ int sdmmc_read(u32 blk_start, u32 blk_count, void *data)
 	{
 		if (sdmmc_select() < 0)
 		{
-			gecko_printf("sdmmc: READ: cannot select card.\n");
+			gecko_printf("sdmmc: cannot select card.\n");
 			return -1;
 		}
 	}
@@ -365,75 +469,72 @@ int sdmmc_read(u32 blk_start, u32 blk_count, void *data)
 		return -1;
 	}
 
-	DPRINTF(2, ("sdmmc: MMC_READ_BLOCK_MULTIPLE\n"));
-	memset(&cmd, 0, sizeof(cmd));
-	cmd.c_opcode = MMC_READ_BLOCK_MULTIPLE;
+	DPRINTF(2, ("sdmmc: %s\n", opcode == MMC_READ_BLOCK_MULTIPLE ? "MMC_READ_BLOCK_MULTIPLE" : "MMC_WRITE_BLOCK_MULTIPLE"));
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->c_opcode = opcode;
 	if (card.sdhc_blockmode)
-		cmd.c_arg = blk_start;
+		cmd->c_arg = blk_start;
 	else
-		cmd.c_arg = blk_start * SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_data = data;
-	cmd.c_datalen = blk_count * SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_blklen = SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_flags = SCF_RSP_R1 | SCF_CMD_READ;
-	sdhc_exec_command(card.handle, &cmd);
+		cmd->c_arg = blk_start * SDMMC_DEFAULT_BLOCKLEN;
+	cmd->c_data = data;
+	cmd->c_datalen = blk_count * SDMMC_DEFAULT_BLOCKLEN;
+	cmd->c_blklen = SDMMC_DEFAULT_BLOCKLEN;
+	cmd->c_flags = SCF_RSP_R1;
+	if (opcode == MMC_READ_BLOCK_MULTIPLE)
+		cmd->c_flags |= SCF_CMD_READ;
+	sdhc_submit_command(card.handle, cmd);
 
-	if (cmd.c_error)
+	return 0;
+}
+
+/*
+ * The async calls return as soon as the card accepted the command. The data
+ * moves by dma while the caller does something else, until it calls
+ * sdmmc_wait with the same command. Starting another command waits for the
+ * previous transfer first.
+ */
+int sdmmc_read_async(u32 blk_start, u32 blk_count, void *data, struct sdmmc_command *cmd)
+{
+	return sdmmc_submit_transfer(cmd, MMC_READ_BLOCK_MULTIPLE, blk_start, blk_count, data);
+}
+
+int sdmmc_write_async(u32 blk_start, u32 blk_count, void *data, struct sdmmc_command *cmd)
+{
+	return sdmmc_submit_transfer(cmd, MMC_WRITE_BLOCK_MULTIPLE, blk_start, blk_count, data);
+}
+
+int sdmmc_wait(struct sdmmc_command *cmd)
+{
+	sdhc_complete_command(card.handle, cmd);
+
+	if (cmd->c_error)
 	{
-		gecko_printf("sdmmc: MMC_READ_BLOCK_MULTIPLE failed with %d\n", cmd.c_error);
+		gecko_printf("sdmmc: command %u failed with %d\n", cmd->c_opcode, cmd->c_error);
 		return -1;
 	}
-	DPRINTF(2, ("sdmmc: MMC_READ_BLOCK_MULTIPLE done\n"));
 
 	return 0;
 }
 
-int sdmmc_write(u32 blk_start, u32 blk_count, void *data)
+int sdmmc_read(u32 blk_start, u32 blk_count, void *data)
 {
 	struct sdmmc_command cmd;
 
-	if (card.inserted == 0)
-	{
-		gecko_printf("sdmmc: READ: no card inserted.\n");
+	//	gecko_printf("%s(%u, %u, %p)\n", __FUNCTION__, blk_start, blk_count, data);
+	if (sdmmc_read_async(blk_start, blk_count, data, &cmd) < 0)
 		return -1;
-	}
 
-	if (card.selected == 0)
-	{
-		if (sdmmc_select() < 0)
-		{
-			gecko_printf("sdmmc: READ: cannot select card.\n");
-			return -1;
-		}
-	}
-
-	if (card.new_card == 1)
-	{
-		gecko_printf("sdmmc: new card inserted but not acknowledged yet.\n");
-		return -1;
-	}
+	return sdmmc_wait(&cmd);
+}
 
-	DPRINTF(2, ("sdmmc: MMC_WRITE_BLOCK_MULTIPLE\n"));
-	memset(&cmd, 0, sizeof(cmd));
-	cmd.c_opcode = MMC_WRITE_BLOCK_MULTIPLE;
-	if (card.sdhc_blockmode)
-		cmd.c_arg = blk_start;
-	else
-		cmd.c_arg = blk_start * SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_data = data;
-	cmd.c_datalen = blk_count * SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_blklen = SDMMC_DEFAULT_BLOCKLEN;
-	cmd.c_flags = SCF_RSP_R1;
-	sdhc_exec_command(card.handle, &cmd);
+int sdmmc_write(u32 blk_start, u32 blk_count, void *data)
+{
+	struct sdmmc_command cmd;
 
-	if (cmd.c_error)
-	{
-		gecko_printf("sdmmc: MMC_READ_BLOCK_MULTIPLE failed with %d\n", cmd.c_error);
+	if (sdmmc_write_async(blk_start, blk_count, data, &cmd) < 0)
 		return -1;
-	}
-	DPRINTF(2, ("sdmmc: MMC_WRITE_BLOCK_MULTIPLE done\n"));
 
-	return 0;
+	return sdmmc_wait(&cmd);
 }
 
 int sdmmc_get_sectors(void)
@@ -21,6 +21,7 @@ typedef struct sdhc_host *sdmmc_chipset_handle_t;
 #define SDMMC_SDCLK_OFF    0
 #define SDMMC_SDCLK_400KHZ 400
 #define SDMMC_SDCLK_25MHZ  25000
+#define SDMMC_SDCLK_50MHZ  50000
 
 struct sdmmc_csd
 {
@@ -169,6 +170,11 @@ int sdmmc_select(void);
 int sdmmc_check_card(void);
 int sdmmc_ack_card(void);
 int sdmmc_read(u32 blk_start, u32 blk_count, void *data);
+int sdmmc_write(u32 blk_start, u32 blk_count, void *data);
+int sdmmc_read_async(u32 blk_start, u32 blk_count, void *data, struct sdmmc_command *cmd);
+int sdmmc_write_async(u32 blk_start, u32 blk_count, void *data, struct sdmmc_command *cmd);
+int sdmmc_wait(struct sdmmc_command *cmd);
+int sdmmc_get_sectors(void);
 
 /* MMC commands */    /* response type */
 #define MMC_GO_IDLE_STATE         0 /* R0 */
@@ -189,6 +195,7 @@ int sdmmc_read(u32 blk_start, u32 blk_count, void *data);
 
 /* SD commands */    /* response type */
 #define SD_SEND_RELATIVE_ADDR     3 /* R6 */
+#define SD_SWITCH_FUNC            6 /* R1 */
 #define SD_SEND_IF_COND           8 /* R7 */
 
 /* SD application commands */   /* response type */
@@ -238,6 +245,14 @@ int sdmmc_read(u32 blk_start, u32 blk_count, void *data);
 #define SD_ARG_BUS_WIDTH_1        0
 #define SD_ARG_BUS_WIDTH_4        2
 
+/* switch function argument & status (CMD6) */
+#define SD_SWITCH_MODE_CHECK      (0U << 31)
+#define SD_SWITCH_MODE_SET        (1U << 31)
+#define SD_SWITCH_GROUP1_HS       0x00fffff1
+#define SD_SWITCH_STATUS_LEN      64
+#define SD_SWITCH_HS_SUPPORTED(st) ((st)[13] & (1 << 1))
+#define SD_SWITCH_GROUP1_RESULT(st) ((st)[16] & 0xf)
+
 /* MMC R2 response (CSD) */
 #define MMC_CSD_CSDVER(resp)      MMC_RSP_BITS((resp), 126, 2)
 #define MMC_CSD_CSDVER_1_0        1
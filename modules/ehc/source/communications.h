@@ -0,0 +1,68 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+#include <ios/ipc.h>
+#include <usb/ehci.h>
+
+//same interface as oh1
+#define USBV0_IOCTL_CTRLMSG        0x0
+#define USBV0_IOCTL_BLKMSG         0x1
+#define USBV0_IOCTL_INTRMSG        0x2
+#define USBV0_IOCTL_SUSPENDDEV     0x5
+#define USBV0_IOCTL_RESUMEDEV      0x6
+#define USBV0_IOCTL_GETDEVLIST     0xc
+#define USBV0_IOCTL_GETHUBSTATUS   0xf
+#define USBV0_IOCTL_DEVREMOVALHOOK 0x1a
+#define USBV0_IOCTL_GETPORTSTATUS  0x14
+#define USBV0_IOCTL_SETPORTSTATUS  0x19
+
+#define swap_u16(value)            __builtin_bswap16(value)
+
+struct IORequestPacket_t;
+
+//the hardware qTD followed by our own bookkeeping. the controller only looks at the first 0x20 bytes
+typedef struct WiiTransferDescriptor_t
+{
+	EhciTransferDescriptor Hardware;
+	struct IORequestPacket_t *IORequestPacket;
+	struct WiiTransferDescriptor_t *NextInRequest;
+	u32 Length;
+} ALIGNED(32) WiiTransferDescriptor;
+CHECK_OFFSET(WiiTransferDescriptor, 0x00, Hardware);
+CHECK_OFFSET(WiiTransferDescriptor, 0x20, IORequestPacket);
+
+typedef struct
+{
+	EhciQueueHead Hardware;
+	//dummy qTD at the end of the queue. new transfers are written into it, see QueueTransfers
+	WiiTransferDescriptor *Tail;
+	u8 Period;
+	u8 IsPeriodic;
+} ALIGNED(32) WiiQueueHead;
+CHECK_OFFSET(WiiQueueHead, 0x00, Hardware);
+CHECK_OFFSET(WiiQueueHead, 0x30, Tail);
+
+typedef struct IORequestPacket_t
+{
+	IpcMessage *RequestMessage;
+	u32 Transferred;
+	char *MessageData;
+	u32 Size;
+	WiiTransferDescriptor *FirstTransfer;
+	WiiTransferDescriptor *LastTransfer;
+	WiiQueueHead *QueueHead;
+	s32 Queue;
+	s32 Result;
+	void *ControlMessage; /* Only set if queue == -1 */
+	struct IORequestPacket_t *Next;
+} IORequestPacket;
@@ -0,0 +1,106 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/errno.h>
+#include "deviceManagement.h"
+
+EHCDevice Devices[MAX_USB_DEVICES];
+
+s8 FindEndpointIndex(s8 deviceIndex, u8 endpointAddress)
+{
+	for (s8 i = 1; i < MAX_USB_ENDPOINTS; i++)
+	{
+		if (Devices[deviceIndex].Endpoints[i].EndpointAddress == endpointAddress)
+			return i;
+	}
+	return -1;
+}
+
+int SetDeviceIPCMessage(s8 deviceIndex, IpcMessage *message)
+{
+	if (Devices[deviceIndex].IpcMessage)
+		return IPC_EEXIST;
+
+	Devices[deviceIndex].IpcMessage = message;
+	return IPC_SUCCESS;
+}
+
+s8 GetDeviceIndex(u16 vid, u16 pid)
+{
+	for (s8 deviceIndex = 1; deviceIndex < MAX_USB_DEVICES; deviceIndex++)
+	{
+		if (Devices[deviceIndex].DeviceType == DEV_TYPE_DEVICE &&
+		    Devices[deviceIndex].VendorId == vid && Devices[deviceIndex].ProductId == pid)
+			return deviceIndex;
+	}
+	return -1;
+}
+
+int GetDeviceVendorAndProduct(s8 deviceIndex, u16 *vendor, u16 *product)
+{
+	if (deviceIndex < 0 || deviceIndex >= MAX_USB_DEVICES ||
+	    Devices[deviceIndex].DeviceType == DEV_TYPE_NONE)
+		return IPC_EINVAL;
+
+	if (vendor)
+		*vendor = Devices[deviceIndex].VendorId;
+	if (product)
+		*product = Devices[deviceIndex].ProductId;
+
+	return IPC_SUCCESS;
+}
+
+u8 GetPortIndex(s8 deviceIndex)
+{
+	return Devices[deviceIndex].PortIndex;
+}
+
+int PopulateDeviceList(DeviceListEntry *deviceList, u8 maxCount,
+                       u8 interfaceClass, u8 *countOutput)
+{
+	u8 addedCount = 0;
+
+	for (s8 deviceIndex = 1; deviceIndex < MAX_USB_DEVICES && addedCount < maxCount; deviceIndex++)
+	{
+		if (Devices[deviceIndex].DeviceType == DEV_TYPE_NONE)
+			continue;
+
+		bool matches = interfaceClass == 0 || Devices[deviceIndex].DeviceClass == interfaceClass;
+		for (u8 interfaceIndex = 0; !matches && interfaceIndex < Devices[deviceIndex].NumberOfInterfaces;
+		     interfaceIndex++)
+			matches = Devices[deviceIndex].Interfaces[interfaceIndex].InterfaceClass == interfaceClass;
+
+		if (!matches)
+			continue;
+
+		deviceList[addedCount].VendorId = Devices[deviceIndex].VendorId;
+		deviceList[addedCount].ProductId = Devices[deviceIndex].ProductId;
+		addedCount++;
+	}
+
+	*countOutput = addedCount;
+	return IPC_SUCCESS;
+}
+
+void AddInterface(s8 deviceIndex, u8 interfaceNumber, u8 alternateSetting,
+                  u8 class, u8 subClass, u8 protocol)
+{
+	u8 i = Devices[deviceIndex].NumberOfInterfaces;
+	if (i >= MAX_USB_INTERFACES)
+		return;
+
+	DeviceInterface *iface = &Devices[deviceIndex].Interfaces[i];
+	iface->InterfaceNumber = interfaceNumber;
+	iface->AlternateSetting = alternateSetting;
+	iface->InterfaceClass = class;
+	iface->InterfaceSubClass = subClass;
+	iface->InterfaceProtocol = protocol;
+	Devices[deviceIndex].NumberOfInterfaces++;
+}
@@ -0,0 +1,91 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+#include <ios/ipc.h>
+#include "communications.h"
+
+//device 0 is the root hub, the device index doubles as the usb address
+#define MAX_USB_DEVICES    8
+#define MAX_USB_ENDPOINTS  16
+#define MAX_USB_INTERFACES 8
+
+typedef struct
+{
+	u32 Unused;
+	u16 VendorId;
+	u16 ProductId;
+} DeviceListEntry;
+CHECK_SIZE(DeviceListEntry, 0x08);
+CHECK_OFFSET(DeviceListEntry, 0x00, Unused);
+CHECK_OFFSET(DeviceListEntry, 0x04, VendorId);
+CHECK_OFFSET(DeviceListEntry, 0x06, ProductId);
+
+typedef struct
+{
+	u8 InterfaceNumber;
+	u8 AlternateSetting;
+	u8 InterfaceClass;
+	u8 InterfaceSubClass;
+	u8 InterfaceProtocol;
+} ALIGNED(4) DeviceInterface;
+CHECK_SIZE(DeviceInterface, 0x08);
+
+typedef struct
+{
+	u8 EndpointAddress;
+	u8 Attributes;
+	u16 MaxPacketSize;
+	u8 Interval;
+	WiiQueueHead *QueueHead;
+} DeviceEndpoint;
+CHECK_SIZE(DeviceEndpoint, 0x0C);
+CHECK_OFFSET(DeviceEndpoint, 0x00, EndpointAddress);
+CHECK_OFFSET(DeviceEndpoint, 0x01, Attributes);
+CHECK_OFFSET(DeviceEndpoint, 0x02, MaxPacketSize);
+CHECK_OFFSET(DeviceEndpoint, 0x04, Interval);
+CHECK_OFFSET(DeviceEndpoint, 0x08, QueueHead);
+
+typedef enum
+{
+	DEV_TYPE_NONE = 0,
+	DEV_TYPE_HUB,
+	DEV_TYPE_DEVICE,
+} DeviceType;
+
+typedef struct
+{
+	DeviceType DeviceType;
+	u8 PortIndex;
+	u8 MaxPower;
+	u16 VendorId;
+	u16 ProductId;
+	u8 DeviceClass;
+	u8 DeviceSubClass;
+	u8 DeviceProtocol;
+	u8 NumberOfInterfaces;
+	IpcMessage *IpcMessage;
+	DeviceInterface Interfaces[MAX_USB_INTERFACES];
+	DeviceEndpoint Endpoints[MAX_USB_ENDPOINTS];
+} EHCDevice;
+
+extern EHCDevice Devices[MAX_USB_DEVICES];
+
+s8 FindEndpointIndex(s8 deviceIndex, u8 endpointAddress);
+s8 GetDeviceIndex(u16 vid, u16 pid);
+int GetDeviceVendorAndProduct(s8 deviceIndex, u16 *vendor, u16 *product);
+u8 GetPortIndex(s8 deviceIndex);
+int SetDeviceIPCMessage(s8 deviceIndex, IpcMessage *message);
+int PopulateDeviceList(DeviceListEntry *deviceList, u8 maxCount,
+                       u8 interfaceClass, u8 *countOutput);
+void AddInterface(s8 deviceIndex, u8 interfaceNumber, u8 alternateSetting,
+                  u8 class, u8 subClass, u8 protocol);
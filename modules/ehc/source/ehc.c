@@ -0,0 +1,433 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/irq.h>
+#include <ios/errno.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+#include <string.h>
+#include <usb/ehci.h>
+
+#include "memory.h"
+#include "deviceManagement.h"
+#include "communications.h"
+#include "module.h"
+
+#define EHC_DEVICE_NAME "/dev/usb/ehc"
+
+static s16 _rootHubFileDescriptor = 0x7fff;
+static s32 _deviceQueueId;
+static u32 _deviceQueueBuffers[MAX_USB_DEVICES];
+static void *_statusChangeMessage = (void *)0xcafef00d;
+
+static u32 _workerThreadStack[0x100];
+
+static int HexToInteger(const char *hexstring)
+{
+	int result = 0, val;
+
+	if (hexstring[0] == '0' && (hexstring[1] == 'x' || hexstring[1] == 'X'))
+		hexstring += 2;
+
+	while (true)
+	{
+		const char ch = *hexstring;
+		if (ch >= '0' && ch <= '9')
+			val = ch - '0';
+		else if (ch >= 'a' && ch <= 'f')
+			val = ch - 'a' + 10;
+		else if (ch >= 'A' && ch <= 'F')
+			val = ch - 'A' + 10;
+		else
+			break;
+		result = result * 16 + val;
+		hexstring++;
+	}
+
+	return result;
+}
+
+static int CreateUSBDeviceQueue(EHCModuleControl *module)
+{
+	int ret = OSCreateMessageQueue(_deviceQueueBuffers,
+	                               sizeof(_deviceQueueBuffers) / sizeof(u32));
+	if (ret < 0)
+		return ret;
+
+	_deviceQueueId = ret;
+	module->QueueId = _deviceQueueId;
+	return OSRegisterResourceManager(EHC_DEVICE_NAME, _deviceQueueId);
+}
+
+static int HandleClose(EHCModuleControl *module, const IpcRequest *request)
+{
+	int result = IPC_SUCCESS;
+
+	u16 fd = *(u16 *)((int)&request->FileDescriptor + 2);
+	if (fd != _rootHubFileDescriptor)
+	{
+		s8 deviceIndex = (s8)fd;
+		result = GetDeviceVendorAndProduct(deviceIndex, NULL, NULL);
+		if (result == IPC_SUCCESS)
+			CloseDevice(module, deviceIndex);
+	}
+	return result;
+}
+
+static int HandleOpen(EHCModuleControl *, const IpcRequest *request)
+{
+	const char *device = request->Message.Open.Filepath;
+	const size_t nameLength = strlen(EHC_DEVICE_NAME);
+	char vendor[16] = { 0 };
+	char product[16] = { 0 };
+	size_t len;
+
+	if (strncmp(device, EHC_DEVICE_NAME, nameLength) != 0)
+		return IPC_ENOENT;
+
+	if (device[nameLength] == '\0')
+		return _rootHubFileDescriptor;
+
+	//the rest of the path is /vid/pid
+	const char *nextToken = device + nameLength + 1;
+	for (len = 0; nextToken[len] != '\0' && nextToken[len] != '/'; len++);
+	if (len >= sizeof(vendor) || nextToken[len] == '\0')
+		return IPC_EINVAL;
+	memcpy(vendor, nextToken, len);
+
+	nextToken += len + 1;
+	for (len = 0; nextToken[len] != '\0' && nextToken[len] != '/'; len++);
+	if (len >= sizeof(product))
+		return IPC_EINVAL;
+	memcpy(product, nextToken, len);
+
+	s8 deviceIndex = GetDeviceIndex((u16)HexToInteger(vendor), (u16)HexToInteger(product));
+	return deviceIndex >= 0 ? deviceIndex : IPC_EINVAL;
+}
+
+static int HandleIoctl(EHCModuleControl *module, IpcMessage *message, bool *isAsync)
+{
+	const IpcRequest *request = &message->Request;
+	const IoctlMessage *ioctl = &request->Message.Ioctl;
+	int result = IPC_EINVAL;
+
+	*isAsync = false;
+
+	u16 fd = *(u16 *)((int)&request->FileDescriptor + 2);
+	if (fd == _rootHubFileDescriptor)
+	{
+		if (ioctl->Ioctl == USBV0_IOCTL_GETHUBSTATUS)
+		{
+			u32 *status = ioctl->IoBuffer;
+			if (status == NULL || ioctl->IoLength != 4)
+				return IPC_EINVAL;
+
+			*status = module->NumberOfPorts;
+			return IPC_SUCCESS;
+		}
+		return IPC_EINVAL;
+	}
+
+	s8 deviceIndex = *(s8 *)((int)&request->FileDescriptor + 3);
+	result = GetDeviceVendorAndProduct(deviceIndex, NULL, NULL);
+	if (result != IPC_SUCCESS)
+		return result;
+
+	if (ioctl->Ioctl == USBV0_IOCTL_SUSPENDDEV || ioctl->Ioctl == USBV0_IOCTL_RESUMEDEV)
+	{
+		if (ioctl->InputBuffer || ioctl->InputLength != 0 || ioctl->IoBuffer ||
+		    ioctl->IoLength != 0)
+			return IPC_EINVAL;
+
+		u8 port = GetPortIndex(deviceIndex);
+		if (ioctl->Ioctl == USBV0_IOCTL_SUSPENDDEV)
+			result = SuspendDevice(module, port);
+		else
+			result = ResumeDevice(module, port);
+	}
+	else if (ioctl->Ioctl == USBV0_IOCTL_DEVREMOVALHOOK)
+	{
+		result = SetDeviceIPCMessage(deviceIndex, message);
+		*isAsync = true;
+	}
+	else
+		result = IPC_EINVAL;
+
+	return result;
+}
+
+static int HandleIoctlv(EHCModuleControl *module, IpcMessage *message, bool *isAsync)
+{
+	const IpcRequest *request = &message->Request;
+	const IoctlvMessage *ioctlv = &request->Message.Ioctlv;
+	const IoctlvMessageData *vector;
+	int result = IPC_EINVAL;
+
+	u16 fd = *(u16 *)((int)&request->FileDescriptor + 2);
+	if (fd != _rootHubFileDescriptor)
+	{
+		s8 deviceIndex = *(s8 *)((int)&request->FileDescriptor + 3);
+		if (GetDeviceVendorAndProduct(deviceIndex, NULL, NULL) != IPC_SUCCESS)
+			return IPC_EINVAL;
+
+		if (ioctlv->Ioctl == USBV0_IOCTL_CTRLMSG)
+			result = ProcessControlMessage(module, message);
+		else if (ioctlv->Ioctl == USBV0_IOCTL_INTRMSG || ioctlv->Ioctl == USBV0_IOCTL_BLKMSG)
+			result = ProcessInterruptBlockMessage(module, message);
+		else
+			return IPC_EINVAL;
+
+		*isAsync = true;
+		return result;
+	}
+
+	//all other ioctls are synchronous
+	*isAsync = false;
+	vector = ioctlv->MessageData;
+
+	if (ioctlv->Ioctl == USBV0_IOCTL_GETPORTSTATUS)
+	{
+		if (ioctlv->InputArgc != 1 || ioctlv->IoArgc != 1 || !vector[0].Data ||
+		    !vector[1].Data || vector[0].Length != 1 || vector[1].Length != 4)
+			return IPC_EINVAL;
+
+		u8 queryPort = *(u8 *)vector[0].Data;
+		u32 *outptr = (u32 *)vector[1].Data;
+		if (queryPort < module->NumberOfPorts)
+		{
+			*outptr = module->HardwareRegisters->PortControl[queryPort];
+			OSDCFlushRange(outptr, sizeof(*outptr));
+			result = IPC_SUCCESS;
+		}
+	}
+	else if (ioctlv->Ioctl == USBV0_IOCTL_SETPORTSTATUS)
+	{
+		if (ioctlv->InputArgc != 2 || vector[0].Length != 1 || !vector[0].Data ||
+		    vector[1].Length != 4 || !vector[1].Data)
+			return IPC_EINVAL;
+
+		u8 port = *(u8 *)vector[0].Data;
+		if (port < module->NumberOfPorts)
+		{
+			module->HardwareRegisters->PortControl[port] = *(u32 *)vector[1].Data;
+			result = IPC_SUCCESS;
+		}
+	}
+	else if (ioctlv->Ioctl == USBV0_IOCTL_GETDEVLIST)
+	{
+		if (ioctlv->InputArgc != 2 || ioctlv->IoArgc != 2)
+		{
+			printk("readcount[%u], writecount[%u] bad\n", ioctlv->InputArgc, ioctlv->IoArgc);
+			return IPC_EINVAL;
+		}
+
+		if (vector[0].Length != 1 || !vector[0].Data || vector[1].Length != 1 ||
+		    !vector[1].Data || vector[2].Length != 1 || !vector[2].Data)
+			return IPC_EINVAL;
+
+		u8 numberOfElements = *(u8 *)vector[0].Data;
+		if (vector[3].Length != numberOfElements * sizeof(DeviceListEntry) ||
+		    (numberOfElements != 0 && !vector[3].Data))
+			return IPC_EINVAL;
+
+		u8 *count = (u8 *)vector[2].Data;
+		result = PopulateDeviceList((DeviceListEntry *)vector[3].Data, numberOfElements,
+		                            *(u8 *)vector[1].Data, count);
+		OSDCFlushRange(vector[3].Data, vector[3].Length);
+		OSDCFlushRange(count, sizeof(*count));
+	}
+
+	return result;
+}
+
+static int ProcessEvents(EHCModuleControl *module)
+{
+	IpcMessage *message;
+	int result;
+
+	module->State |= EHC_STATE_PROCESSING_EVENTS;
+	while (true)
+	{
+		result = OSReceiveMessage(_deviceQueueId, &message, 0);
+		if (result != 0)
+			return result;
+
+		const IpcRequest *request = &message->Request;
+		if (request == _statusChangeMessage)
+		{
+			HandleStatusChange(module);
+			continue;
+		}
+
+		bool isAsync = false;
+		switch (request->Command)
+		{
+			case IOS_CLOSE:
+				result = HandleClose(module, request);
+				break;
+			case IOS_OPEN:
+				result = HandleOpen(module, request);
+				break;
+			case IOS_IOCTL:
+				result = HandleIoctl(module, message, &isAsync);
+				break;
+			case IOS_IOCTLV:
+				result = HandleIoctlv(module, message, &isAsync);
+				break;
+			default:
+				result = IPC_EINVAL;
+		}
+
+		if (result < 0 || !isAsync)
+			OSResourceReply(message, result);
+	}
+}
+
+static int WorkerThread(EHCModuleControl *module)
+{
+	void *queueBuffer[4] ALIGNED(16);
+	volatile EhciRegisters *registers = module->HardwareRegisters;
+	u8 device = module->DeviceEvent;
+
+	int queueId = OSCreateMessageQueue(queueBuffer, sizeof(queueBuffer) / sizeof(u32));
+	int ret = OSRegisterEventHandler(device, queueId, NULL);
+	if (ret != 0)
+		return -1;
+
+	registers->UsbStatus = EHCI_STS_INTR_MASK;
+	OSClearAndEnableEvent(device);
+	while (true)
+	{
+		do
+		{
+			ret = OSReceiveMessage(queueId, NULL, 0);
+		}
+		while (ret != 0);
+
+		//only acknowledge what we handle here, the async advance bit is polled by UnlinkQueueHead
+		const u32 interruptStatus = registers->UsbStatus & EHC_INTERRUPTS;
+		registers->UsbStatus = interruptStatus;
+
+		if (interruptStatus & (EHCI_STS_INT | EHCI_STS_ERR))
+			ProcessCompletedTransfers(module);
+
+		if (interruptStatus & EHCI_STS_HSE)
+			printk("EHC: host system error, status 0x%08x\n", registers->UsbStatus);
+
+		if ((interruptStatus & EHCI_STS_PCD) && (module->State & EHC_STATE_DEVICE_QUERIED) != 0 &&
+		    (module->State & EHC_STATE_PROCESSING_EVENTS) != 0)
+			OSSendMessage(module->QueueId, _statusChangeMessage, 0);
+
+		OSClearAndEnableEvent(device);
+	}
+}
+
+static int ResetController(EHCModuleControl *module)
+{
+	volatile EhciRegisters *registers = module->HardwareRegisters;
+
+	//the controller has to be halted before it can be reset
+	registers->UsbCommand &= ~EHCI_CMD_RUN;
+	for (int tries = 20; tries > 0 && !(registers->UsbStatus & EHCI_STS_HALT); tries--)
+		SleepModule(module, 125);
+
+	registers->UsbCommand |= EHCI_CMD_RESET;
+	for (int tries = 100; tries > 0 && (registers->UsbCommand & EHCI_CMD_RESET); tries--)
+		SleepModule(module, 1000);
+
+	return (registers->UsbCommand & EHCI_CMD_RESET) ? IPC_NOTREADY : IPC_SUCCESS;
+}
+
+int main(void)
+{
+	int rc;
+	EHCModuleControl *module = NULL;
+
+	OSSetThreadPriority(0, 0x60);
+	printk("%s\n", "$IOSVersion: EHC: " __DATE__ " " __TIME__ " 64M $");
+	rc = CreateHeap();
+	if (rc < 0)
+		goto error;
+
+	module = OSAllocateMemory(_moduleHeap, sizeof(*module));
+	if (!module)
+	{
+		rc = IPC_ENOMEM;
+		goto error;
+	}
+
+	memset(module, 0, sizeof(*module));
+	rc = CreateUSBDeviceQueue(module);
+	if (rc < 0)
+		goto error;
+
+	module->HardwareRegisters = (volatile EhciRegisters *)EHCI_REG_BASE;
+	module->DeviceEvent = IRQ_EHCI;
+	rc = OSCreateMessageQueue(&module->TimerQueueBuffer, 1);
+	if (rc < 0)
+		goto error;
+
+	module->TimerQueue = rc;
+	rc = OSCreateTimer(0, 0, module->TimerQueue, _statusChangeMessage);
+	if (rc < 0)
+		goto error_destroy_timer_queue;
+
+	module->Timer = rc;
+	rc = ResetController(module);
+	if (rc < 0)
+		goto error_destroy_timer_queue;
+
+	rc = InitialiseModule(module);
+	if (rc < 0)
+		goto error_destroy_timer_queue;
+
+	volatile EhciRegisters *regs = module->HardwareRegisters;
+	regs->ChickenBits |= EHCI_CHICKENBITS_INIT;
+	regs->CtrlDsSegment = 0;
+	regs->PeriodicListBase = GetPhysicalAddress(module->PeriodicList);
+	regs->AsyncListAddr = GetPhysicalAddress(module->AsyncHead);
+	regs->UsbStatus = EHCI_STS_INTR_MASK;
+	regs->UsbInterrupt = EHC_INTERRUPTS;
+	//interrupt at most once per micro frame, 1024 entry frame list
+	regs->UsbCommand = (1U << EHCI_CMD_ITC_SHIFT) | EHCI_CMD_PSE | EHCI_CMD_ASE | EHCI_CMD_RUN;
+	SleepModule(module, 1000);
+	if (regs->UsbStatus & EHCI_STS_HALT)
+	{
+		rc = IPC_NOTREADY;
+		goto error_destroy_timer_queue;
+	}
+
+	s32 priority = OSGetThreadPriority(0);
+	rc = OSCreateThread((ThreadFunc)WorkerThread, module, _workerThreadStack,
+	                    sizeof(_workerThreadStack), priority, 1);
+	if (rc < 0)
+		goto error_destroy_timer_queue;
+
+	OSStartThread(rc);
+	priority = OSGetThreadPriority(0);
+	OSSetThreadPriority(0, priority - 1);
+	rc = QueryModuleDevices(module);
+	if (rc < 0)
+		goto error_destroy_timer_queue;
+
+	ProcessEvents(module);
+
+error_destroy_timer_queue:
+	if (module->TimerQueue > 0)
+		OSDestroyMessageQueue(module->TimerQueue);
+
+error:
+	printk("ehci_core: EHCI initialization failed: %d\n", rc);
+	printk("ehci_core exits...\n");
+	if (module)
+		OSFreeMemory(_moduleHeap, module);
+	OSStopThread(0, 0);
+	return rc;
+}
@@ -0,0 +1,105 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/errno.h>
+#include <ios/syscalls.h>
+#include <string.h>
+
+#include "memory.h"
+#include "module.h"
+
+//right after the frame list
+#define EHC_HEAP_BASE ((void *)0x13891000)
+#define EHC_HEAP_SIZE 0x8000
+
+s32 _moduleHeap;
+
+s32 CreateHeap(void)
+{
+	memset(EHC_HEAP_BASE, 0, EHC_HEAP_SIZE);
+	_moduleHeap = OSCreateHeap(EHC_HEAP_BASE, EHC_HEAP_SIZE);
+	return _moduleHeap < 0 ? IPC_EINVAL : IPC_SUCCESS;
+}
+
+void FreeMemory(void *ptr)
+{
+	OSFreeMemory(_moduleHeap, ptr);
+}
+
+void *ValidateMemoryAddress(void *ptr)
+{
+	//redirect SRAM to the dma address space
+	if ((ptr >= (void *)0xffff0000) && (ptr != (void *)0xffffffff))
+		ptr = (void *)((int)ptr + 0x0d410000);
+
+	return ptr;
+}
+
+u32 GetPhysicalAddress(const void *ptr)
+{
+	return (u32)ValidateMemoryAddress((void *)ptr);
+}
+
+WiiQueueHead *AllocateQueueHead(void)
+{
+	WiiQueueHead *queueHead = OSAlignedAllocateMemory(_moduleHeap, sizeof(WiiQueueHead), 32);
+	if (queueHead)
+		memset(queueHead, 0, sizeof(WiiQueueHead));
+
+	return queueHead;
+}
+
+WiiTransferDescriptor *AllocateTransferDescriptor(void)
+{
+	WiiTransferDescriptor *transfer =
+	    OSAlignedAllocateMemory(_moduleHeap, sizeof(WiiTransferDescriptor), 32);
+	if (!transfer)
+		return NULL;
+
+	memset(transfer, 0, sizeof(WiiTransferDescriptor));
+	transfer->Hardware.Next = EHCI_LINK_TERMINATE;
+	transfer->Hardware.AlternateNext = EHCI_LINK_TERMINATE;
+	return transfer;
+}
+
+//buffers that are iobufs (like msc's) are handed over through the kernel, which skips the
+//cache maintenance when it isn't needed. anything else gets flushed/invalidated by range
+void BufferToDevice(void *data, u32 length)
+{
+	if (length != 0 && OSIOBufToDevice(data, EHC_AHB_DEVICE) != IPC_SUCCESS)
+		OSDCFlushRange(data, length);
+}
+
+void BufferFromDevice(void *data, u32 length)
+{
+	if (length != 0 && OSIOBufFromDevice(data, EHC_AHB_DEVICE) != IPC_SUCCESS)
+		OSDCInvalidateRange(data, length);
+}
+
+void CleanupIORequest(IORequestPacket *ioRequest)
+{
+	if (!ioRequest)
+		return;
+
+	const s32 result = ioRequest->Result < 0 ? ioRequest->Result : (s32)ioRequest->Transferred;
+	BufferFromDevice(ioRequest->MessageData, ioRequest->Size);
+
+	if (ioRequest->Queue <= 0)
+		OSResourceReply(ioRequest->RequestMessage, result);
+	else
+	{
+		OSSendMessage(ioRequest->Queue, (void *)result, 0);
+	}
+
+	if (ioRequest->ControlMessage)
+		OSFreeMemory(_moduleHeap, ioRequest->ControlMessage);
+
+	OSFreeMemory(_moduleHeap, ioRequest);
+}
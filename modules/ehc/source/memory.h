@@ -0,0 +1,30 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+#include "communications.h"
+
+//uncached memory shared with the controller. the periodic frame list has to be 4KB aligned
+#define EHC_FRAME_LIST_BASE ((u32 *)0x13890000)
+#define EHC_FRAME_LIST_SIZE 1024
+
+extern s32 _moduleHeap;
+
+s32 CreateHeap(void);
+void FreeMemory(void *ptr);
+void *ValidateMemoryAddress(void *ptr);
+u32 GetPhysicalAddress(const void *ptr);
+WiiQueueHead *AllocateQueueHead(void);
+WiiTransferDescriptor *AllocateTransferDescriptor(void);
+void BufferToDevice(void *data, u32 length);
+void BufferFromDevice(void *data, u32 length);
+void CleanupIORequest(IORequestPacket *ioRequest);
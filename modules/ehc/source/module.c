@@ -0,0 +1,1101 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/syscalls.h>
+#include <ios/printk.h>
+#include <ios/errno.h>
+#include <string.h>
+#include <usb/usb.h>
+
+#include "module.h"
+#include "memory.h"
+#include "communications.h"
+#include "deviceManagement.h"
+
+#define PADDED4_SIZEOF(type)      (((sizeof(type) + 3) / 4) * 4)
+#define EHC_CONTROL_PACKET_SIZE   64
+#define EHC_NAK_RELOAD            4
+#define EHC_MAX_CONFIGURATION     0x400
+#define EHC_PORT_RESET_TRIES      20
+
+static USBControlMessage *_controlRequest = NULL;
+
+static void EnableModuleInterrupts(EHCModuleControl *module)
+{
+	module->HardwareRegisters->UsbInterrupt = EHC_INTERRUPTS;
+}
+
+static void DisableModuleInterrupts(EHCModuleControl *module)
+{
+	module->HardwareRegisters->UsbInterrupt = 0;
+}
+
+static inline u32 QueueHeadLink(const WiiQueueHead *queueHead)
+{
+	return GetPhysicalAddress(queueHead) | EHCI_LINK_QH;
+}
+
+static inline u32 TransferLink(const WiiTransferDescriptor *transfer)
+{
+	return GetPhysicalAddress(transfer);
+}
+
+//the descriptors are little endian and not aligned in the configuration blob
+static inline u16 ReadLittleEndian16(const void *ptr)
+{
+	const u8 *data = (const u8 *)ptr;
+	return (u16)(data[0] | data[1] << 8);
+}
+
+static u8 GetPeriodicLevel(u8 interval)
+{
+	//high speed intervals are 2^(interval - 1) micro frames, there are 8 in a frame
+	u8 level = interval > 4 ? (u8)(interval - 4) : 0;
+	return level >= EHC_PERIODIC_LEVELS ? EHC_PERIODIC_LEVELS - 1 : level;
+}
+
+//points the overlay at the next qTD to run, this also clears the halt and the data toggle
+static void ResetQueueHead(WiiQueueHead *queueHead, u32 next)
+{
+	queueHead->Hardware.CurrentTransfer = 0;
+	queueHead->Hardware.Overlay.Next = next;
+	queueHead->Hardware.Overlay.AlternateNext = EHCI_LINK_TERMINATE;
+	queueHead->Hardware.Overlay.Token = 0;
+}
+
+static WiiQueueHead *CreateQueueHead(s8 deviceIndex, const DeviceEndpoint *endpoint)
+{
+	WiiQueueHead *queueHead = AllocateQueueHead();
+	WiiTransferDescriptor *tail = AllocateTransferDescriptor();
+	if (!queueHead || !tail)
+	{
+		if (queueHead)
+			FreeMemory(queueHead);
+		if (tail)
+			FreeMemory(tail);
+		return NULL;
+	}
+
+	const u8 transferType = endpoint->Attributes & USB_ENDPOINT_XFERTYPE_MASK;
+	u32 characteristics = QH_SET(ADDRESS, deviceIndex) |
+	                      QH_SET(ENDPOINT, endpoint->EndpointAddress & USB_ENDPOINT_NUMBER_MASK) |
+	                      QH_SET(SPEED, QH_SPEED_HIGH) |
+	                      QH_SET(MPS, endpoint->MaxPacketSize & USB_ENDPOINT_MAXP_MASK);
+	u32 capabilities = QH_SET(MULT, 1);
+	if (transferType == USB_ENDPOINT_XFER_CONTROL)
+		characteristics |= QH_DTC;
+
+	if (transferType == USB_ENDPOINT_XFER_INT)
+	{
+		//poll in the first micro frame of every frame the queue head is visited in
+		capabilities |= QH_SET(SMASK, 0x01);
+		queueHead->IsPeriodic = 1;
+		queueHead->Period = (u8)(1 << GetPeriodicLevel(endpoint->Interval));
+	}
+	else
+		characteristics |= QH_SET(NAK_RELOAD, EHC_NAK_RELOAD);
+
+	queueHead->Hardware.HorizontalLink = EHCI_LINK_TERMINATE;
+	queueHead->Hardware.Characteristics = characteristics;
+	queueHead->Hardware.Capabilities = capabilities;
+	queueHead->Tail = tail;
+	ResetQueueHead(queueHead, TransferLink(tail));
+	return queueHead;
+}
+
+static WiiQueueHead *GetScheduleHead(EHCModuleControl *module, const WiiQueueHead *queueHead)
+{
+	if (!queueHead->IsPeriodic)
+		return module->AsyncHead;
+
+	return module->PeriodicHeads[__builtin_ctz(queueHead->Period)];
+}
+
+static void LinkQueueHead(EHCModuleControl *module, WiiQueueHead *queueHead)
+{
+	//the controller may be reading the schedule, so the new entry has to be complete before it becomes reachable
+	WiiQueueHead *previous = GetScheduleHead(module, queueHead);
+	queueHead->Hardware.HorizontalLink = previous->Hardware.HorizontalLink;
+	previous->Hardware.HorizontalLink = QueueHeadLink(queueHead);
+}
+
+static void UnlinkQueueHead(EHCModuleControl *module, WiiQueueHead *queueHead)
+{
+	volatile EhciRegisters *registers = module->HardwareRegisters;
+	WiiQueueHead *previous = GetScheduleHead(module, queueHead);
+	const u32 link = QueueHeadLink(queueHead);
+
+	while (previous->Hardware.HorizontalLink != link)
+	{
+		const u32 next = previous->Hardware.HorizontalLink;
+		if (next & EHCI_LINK_TERMINATE || (next & EHCI_LINK_MASK) == GetPhysicalAddress(module->AsyncHead))
+			return;
+
+		previous = (WiiQueueHead *)(next & EHCI_LINK_MASK);
+	}
+
+	previous->Hardware.HorizontalLink = queueHead->Hardware.HorizontalLink;
+	if (queueHead->IsPeriodic)
+	{
+		//the controller caches nothing of the periodic schedule beyond the current frame
+		SleepModule(module, 2000);
+		return;
+	}
+
+	//wait until the controller let go of any cached copy of the queue head
+	if (!(registers->UsbStatus & EHCI_STS_ASS))
+		return;
+
+	registers->UsbStatus = EHCI_STS_IAA;
+	registers->UsbCommand |= EHCI_CMD_IAAD;
+	for (int tries = 100; tries > 0 && !(registers->UsbStatus & EHCI_STS_IAA); tries--)
+		SleepModule(module, 125);
+
+	registers->UsbStatus = EHCI_STS_IAA;
+}
+
+static void FreeRequestTransfers(IORequestPacket *ioRequest)
+{
+	WiiTransferDescriptor *transfer = ioRequest->FirstTransfer;
+	while (transfer)
+	{
+		WiiTransferDescriptor *next = transfer->NextInRequest;
+		FreeMemory(transfer);
+		transfer = next;
+	}
+
+	ioRequest->FirstTransfer = NULL;
+	ioRequest->LastTransfer = NULL;
+}
+
+static void RetireRequest(EHCModuleControl *module, IORequestPacket *ioRequest)
+{
+	IORequestPacket **link = &module->ActiveRequests;
+	while (*link && *link != ioRequest)
+		link = &(*link)->Next;
+
+	if (*link)
+		*link = ioRequest->Next;
+
+	FreeRequestTransfers(ioRequest);
+	OSAhbFlushFrom(EHC_AHB_DEVICE);
+	OSAhbFlushTo(AHB_STARLET);
+	CleanupIORequest(ioRequest);
+}
+
+static IORequestPacket *FindActiveRequest(EHCModuleControl *module, const WiiQueueHead *queueHead)
+{
+	IORequestPacket *ioRequest = module->ActiveRequests;
+	while (ioRequest && ioRequest->QueueHead != queueHead)
+		ioRequest = ioRequest->Next;
+
+	return ioRequest;
+}
+
+static void CancelRequests(EHCModuleControl *module, WiiQueueHead *queueHead, s32 result)
+{
+	IORequestPacket *ioRequest = FindActiveRequest(module, queueHead);
+	if (!ioRequest)
+		return;
+
+	UnlinkQueueHead(module, queueHead);
+	ioRequest = module->ActiveRequests;
+	while (ioRequest)
+	{
+		IORequestPacket *next = ioRequest->Next;
+		if (ioRequest->QueueHead == queueHead)
+		{
+			ioRequest->Result = result;
+			RetireRequest(module, ioRequest);
+		}
+		ioRequest = next;
+	}
+
+	ResetQueueHead(queueHead, TransferLink(queueHead->Tail));
+	LinkQueueHead(module, queueHead);
+}
+
+//clearing a halt puts the device's data toggle back to DATA0, so the queue head has to follow.
+//the toggle lives in the overlay, which is only ours while nothing is queued on the endpoint
+static void ResetEndpointToggle(EHCModuleControl *module, s8 deviceIndex, u8 endpointAddress)
+{
+	const s8 endpointIndex = FindEndpointIndex(deviceIndex, endpointAddress);
+	if (endpointIndex < 1)
+		return;
+
+	WiiQueueHead *queueHead = Devices[deviceIndex].Endpoints[endpointIndex].QueueHead;
+	if (!queueHead)
+		return;
+
+	DisableModuleInterrupts(module);
+	if (!FindActiveRequest(module, queueHead))
+	{
+		UnlinkQueueHead(module, queueHead);
+		ResetQueueHead(queueHead, TransferLink(queueHead->Tail));
+		LinkQueueHead(module, queueHead);
+	}
+	EnableModuleInterrupts(module);
+}
+
+//fills in a qTD for as much of the buffer as its 5 pages can hold. transfers that do not end the
+//request are cut at a packet boundary, so the device never sees a short packet in the middle
+static u32 FillTransfer(WiiTransferDescriptor *transfer, IORequestPacket *ioRequest, u32 address,
+                        u32 length, u16 maxPacketSize, u32 token)
+{
+	u32 size = 0;
+	if (length != 0)
+	{
+		const u32 firstPage = address & ~(u32)(QTD_PAGE_SIZE - 1);
+		size = QTD_PAGE_SIZE - (address - firstPage);
+		transfer->Hardware.Buffer[0] = address;
+		for (u32 page = 1; page < QTD_MAX_PAGES && size < length; page++)
+		{
+			transfer->Hardware.Buffer[page] = firstPage + page * QTD_PAGE_SIZE;
+			size += QTD_PAGE_SIZE;
+		}
+
+		if (size >= length)
+			size = length;
+		else
+			size -= size % maxPacketSize;
+	}
+
+	transfer->IORequestPacket = ioRequest;
+	transfer->Length = size;
+	transfer->Hardware.Token = token | QTD_SET(BYTES, size) | QTD_SET(CERR, 3) | QTD_STS_ACTIVE;
+	return size;
+}
+
+//appends a chain of qTDs to the queue head. the current dummy tail becomes the first qTD of the chain
+//and its token is written last, so the controller never sees a half built chain
+static int QueueTransfers(EHCModuleControl *module, IORequestPacket *ioRequest, WiiQueueHead *queueHead,
+                          WiiTransferDescriptor **chain, u32 count, u32 firstToken)
+{
+	WiiTransferDescriptor *newTail = AllocateTransferDescriptor();
+	if (!newTail)
+		return IPC_ENOMEM;
+
+	WiiTransferDescriptor *first = queueHead->Tail;
+	chain[0] = first;
+	for (u32 i = 0; i < count; i++)
+	{
+		WiiTransferDescriptor *next = i + 1 < count ? chain[i + 1] : newTail;
+		chain[i]->NextInRequest = i + 1 < count ? next : NULL;
+		chain[i]->Hardware.Next = TransferLink(next);
+		//a short packet ends the request, unless the chain asked to go somewhere else already
+		if (chain[i]->Hardware.AlternateNext == EHCI_LINK_TERMINATE)
+			chain[i]->Hardware.AlternateNext = TransferLink(newTail);
+	}
+
+	ioRequest->QueueHead = queueHead;
+	ioRequest->FirstTransfer = first;
+	ioRequest->LastTransfer = chain[count - 1];
+	queueHead->Tail = newTail;
+
+	first->Hardware.Token = firstToken;
+	ioRequest->Next = module->ActiveRequests;
+	module->ActiveRequests = ioRequest;
+	return IPC_SUCCESS;
+}
+
+static int SendControlMessageAsync(EHCModuleControl *module, USBControlMessage *controlMessage,
+                                   IpcMessage *ipcMessage, s32 queueId, s8 deviceIndex)
+{
+	WiiTransferDescriptor *chain[2 + (0x10000 / (QTD_PAGE_SIZE * (QTD_MAX_PAGES - 1))) + 1];
+	u32 count = 0;
+	int rc = IPC_SUCCESS;
+	s8 endpointIndex = 0;
+
+	if (controlMessage->Oh1.Endpoint != 0)
+	{
+		endpointIndex = FindEndpointIndex(deviceIndex, controlMessage->Oh1.Endpoint);
+		if (endpointIndex < 1)
+			return IPC_EINVAL;
+	}
+
+	WiiQueueHead *queueHead = Devices[deviceIndex].Endpoints[endpointIndex].QueueHead;
+	const u16 maxPacketSize = Devices[deviceIndex].Endpoints[endpointIndex].MaxPacketSize;
+	const u16 length = swap_u16(controlMessage->Length);
+	const bool isInput = (controlMessage->RequestType & USB_ENDPOINT_DIR_MASK) == USB_DIR_IN;
+	if (!queueHead)
+		return IPC_EINVAL;
+
+	IORequestPacket *ioRequest = OSAllocateMemory(_moduleHeap, sizeof(IORequestPacket));
+	if (!ioRequest)
+		return IPC_EMAX;
+
+	memset(ioRequest, 0, sizeof(*ioRequest));
+	ioRequest->RequestMessage = ipcMessage;
+	ioRequest->Queue = queueId;
+	ioRequest->MessageData = controlMessage->Oh1.Data;
+	ioRequest->Size = length;
+	ioRequest->ControlMessage = (queueId == -1) ? controlMessage : NULL;
+
+	DisableModuleInterrupts(module);
+	OSDCFlushRange(controlMessage, sizeof(*controlMessage));
+	BufferToDevice(controlMessage->Oh1.Data, length);
+
+	//setup stage. chain[0] will be the queue head's dummy tail, filled in by QueueTransfers
+	WiiTransferDescriptor setup = { 0 };
+	FillTransfer(&setup, ioRequest, GetPhysicalAddress(controlMessage), 8, maxPacketSize,
+	             QTD_SET(PID, QTD_PID_SETUP));
+	setup.Length = 0;
+	chain[count++] = NULL;
+
+	//data stage, the toggle starts at 1 and flips with every packet sent
+	const u32 dataAddress = GetPhysicalAddress(ValidateMemoryAddress(controlMessage->Oh1.Data));
+	u32 toggle = QTD_TOGGLE;
+	for (u32 offset = 0; offset < length;)
+	{
+		WiiTransferDescriptor *transfer = AllocateTransferDescriptor();
+		if (!transfer)
+		{
+			rc = IPC_EMAX;
+			goto error;
+		}
+
+		chain[count++] = transfer;
+		const u32 size = FillTransfer(transfer, ioRequest, dataAddress + offset, length - offset,
+		                              maxPacketSize,
+		                              toggle | QTD_SET(PID, isInput ? QTD_PID_IN : QTD_PID_OUT));
+		if ((size + maxPacketSize - 1) / maxPacketSize & 1)
+			toggle ^= QTD_TOGGLE;
+		offset += size;
+	}
+
+	//status stage goes the other way and always uses toggle 1
+	WiiTransferDescriptor *status = AllocateTransferDescriptor();
+	if (!status)
+	{
+		rc = IPC_EMAX;
+		goto error;
+	}
+
+	chain[count++] = status;
+	FillTransfer(status, ioRequest, 0, 0, maxPacketSize,
+	             QTD_TOGGLE | QTD_SET(PID, (length != 0 && isInput) ? QTD_PID_OUT : QTD_PID_IN) | QTD_IOC);
+
+	//a short read still has to go through the status stage
+	for (u32 i = 1; i < count - 1; i++)
+		chain[i]->Hardware.AlternateNext = TransferLink(status);
+
+	WiiTransferDescriptor *first = queueHead->Tail;
+	memcpy(first->Hardware.Buffer, setup.Hardware.Buffer, sizeof(setup.Hardware.Buffer));
+	first->Hardware.AlternateNext = EHCI_LINK_TERMINATE;
+	first->IORequestPacket = ioRequest;
+	first->Length = 0;
+	rc = QueueTransfers(module, ioRequest, queueHead, chain, count, setup.Hardware.Token);
+	if (rc < 0)
+		goto error;
+
+	EnableModuleInterrupts(module);
+	return IPC_SUCCESS;
+
+error:
+	for (u32 i = 1; i < count; i++)
+		FreeMemory(chain[i]);
+
+	OSFreeMemory(_moduleHeap, ioRequest);
+	EnableModuleInterrupts(module);
+	return rc;
+}
+
+static int SendControlMessage(EHCModuleControl *module, s8 deviceIndex, USBControlMessage *message)
+{
+	void *receivedMessage = NULL;
+
+	int rc = SendControlMessageAsync(module, message, NULL, module->TimerQueue, deviceIndex);
+	if (rc >= 0)
+		rc = OSReceiveMessage(module->TimerQueue, &receivedMessage, 0);
+	if (rc >= 0 && (s32)receivedMessage < 0)
+		rc = (s32)receivedMessage;
+
+	return rc;
+}
+
+static int SendDeviceRequest(EHCModuleControl *module, s8 deviceIndex, u8 requestType, u8 request,
+                             u16 value, u16 index, void *data, u16 length)
+{
+	USBControlMessage *message = _controlRequest;
+
+	memset(message, 0, sizeof(*message));
+	message->RequestType = requestType;
+	message->Request = request;
+	message->Value = swap_u16(value);
+	message->Index = swap_u16(index);
+	message->Length = swap_u16(length);
+	message->Oh1.Data = data;
+	message->Oh1.Endpoint = 0;
+	message->Oh1.DeviceIndex = deviceIndex;
+	return SendControlMessage(module, deviceIndex, message);
+}
+
+static int ResetPort(EHCModuleControl *module, u8 port)
+{
+	volatile u32 *portControl = &module->HardwareRegisters->PortControl[port];
+
+	if (!(*portControl & EHCI_PORT_CONNECT))
+		return IPC_NOTREADY;
+
+	//a low speed device can be recognised from the line state, it goes straight to the companion controller
+	if ((*portControl & EHCI_PORT_LS_MASK) == EHCI_PORT_LS_K)
+	{
+		*portControl = (*portControl & ~EHCI_PORT_RWC) | EHCI_PORT_OWNER;
+		return IPC_NOTREADY;
+	}
+
+	*portControl = (*portControl & ~(EHCI_PORT_RWC | EHCI_PORT_PE)) | EHCI_PORT_RESET;
+	SleepModule(module, 50000);
+	*portControl = *portControl & ~(EHCI_PORT_RWC | EHCI_PORT_RESET);
+	for (int tries = EHC_PORT_RESET_TRIES; tries > 0 && (*portControl & EHCI_PORT_RESET); tries--)
+		SleepModule(module, 100);
+
+	//full speed devices do not finish the high speed handshake, so the port stays disabled
+	if (!(*portControl & EHCI_PORT_PE))
+	{
+		printk("EHC: handing port %u to the companion controller\n", port);
+		*portControl = (*portControl & ~EHCI_PORT_RWC) | EHCI_PORT_OWNER;
+		return IPC_NOTREADY;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static void RemoveDevice(EHCModuleControl *module, s8 deviceIndex)
+{
+	DisableModuleInterrupts(module);
+	for (u8 endpointIndex = 0; endpointIndex < MAX_USB_ENDPOINTS; endpointIndex++)
+	{
+		WiiQueueHead *queueHead = Devices[deviceIndex].Endpoints[endpointIndex].QueueHead;
+		if (!queueHead)
+			continue;
+
+		CancelRequests(module, queueHead, IPC_ENOENT);
+		UnlinkQueueHead(module, queueHead);
+		FreeMemory(queueHead->Tail);
+		FreeMemory(queueHead);
+	}
+
+	memset(&Devices[deviceIndex], 0, sizeof(Devices[deviceIndex]));
+	EnableModuleInterrupts(module);
+}
+
+static s8 GetAvailableDeviceIndex(EHCModuleControl *module, u8 port)
+{
+	for (s8 deviceIndex = 1; deviceIndex < MAX_USB_DEVICES; deviceIndex++)
+	{
+		if (Devices[deviceIndex].DeviceType != DEV_TYPE_NONE)
+			continue;
+
+		memset(&Devices[deviceIndex], 0, sizeof(Devices[deviceIndex]));
+		DeviceEndpoint *endpoint = &Devices[deviceIndex].Endpoints[0];
+		endpoint->EndpointAddress = 0;
+		endpoint->Attributes = USB_ENDPOINT_XFER_CONTROL;
+		endpoint->MaxPacketSize = EHC_CONTROL_PACKET_SIZE;
+
+		//the device still listens on address 0 until it is configured
+		endpoint->QueueHead = CreateQueueHead(0, endpoint);
+		if (!endpoint->QueueHead)
+			return 0;
+
+		Devices[deviceIndex].DeviceType = DEV_TYPE_DEVICE;
+		Devices[deviceIndex].PortIndex = port;
+		LinkQueueHead(module, endpoint->QueueHead);
+		return deviceIndex;
+	}
+	return 0;
+}
+
+static void ParseDescriptors(EHCModuleControl *module, s8 deviceIndex,
+                             const UsbConfigurationDescriptor *configuration, size_t totalLength)
+{
+	const u8 *descriptor = (const u8 *)configuration + configuration->Length;
+	const u8 *lastDescriptor = (const u8 *)configuration + totalLength;
+	u8 endpointIndex = 1;
+	u32 usedSlotsMask = 0;
+	u8 interfaceNumber = 0;
+	u8 numberOfEndpoints = 0;
+
+	for (; descriptor + 2 <= lastDescriptor && descriptor[0] != 0; descriptor += descriptor[0])
+	{
+		const UsbDescriptor *parsed = (const UsbDescriptor *)descriptor;
+		if (numberOfEndpoints == 0)
+		{
+			if (parsed->Header.DescriptorType != USB_DT_INTERFACE)
+				continue;
+
+			interfaceNumber = parsed->Interface.InterfaceNumber;
+			if (interfaceNumber >= MAX_USB_INTERFACES)
+				break;
+
+			numberOfEndpoints = parsed->Interface.NumberOfEndpoints;
+			if ((1 << interfaceNumber & usedSlotsMask) == 0)
+			{
+				AddInterface(deviceIndex, interfaceNumber, parsed->Interface.AlternateSetting,
+				             parsed->Interface.InterfaceClass, parsed->Interface.InterfaceSubClass,
+				             parsed->Interface.InterfaceProtocol);
+			}
+			if (numberOfEndpoints == 0)
+				usedSlotsMask |= 1 << interfaceNumber;
+			continue;
+		}
+
+		if (parsed->Header.DescriptorType != USB_DT_ENDPOINT)
+			continue;
+
+		numberOfEndpoints--;
+		if (numberOfEndpoints == 0)
+			usedSlotsMask |= 1 << interfaceNumber;
+
+		//only the first alternate setting of an interface gets its endpoints set up
+		if (Devices[deviceIndex].Interfaces[Devices[deviceIndex].NumberOfInterfaces - 1].InterfaceNumber != interfaceNumber)
+			continue;
+
+		DeviceEndpoint *deviceEndpoint = &Devices[deviceIndex].Endpoints[endpointIndex];
+		deviceEndpoint->EndpointAddress = parsed->Endpoint.EndpointAddress;
+		deviceEndpoint->Attributes = parsed->Endpoint.Attributes;
+		deviceEndpoint->MaxPacketSize = ReadLittleEndian16(&descriptor[4]);
+		deviceEndpoint->Interval = parsed->Endpoint.Interval;
+
+		if ((deviceEndpoint->Attributes & USB_ENDPOINT_XFERTYPE_MASK) == USB_ENDPOINT_XFER_ISOC)
+		{
+			printk("EHC: isochronous endpoint 0x%02x is not supported\n",
+			       deviceEndpoint->EndpointAddress);
+			continue;
+		}
+
+		deviceEndpoint->QueueHead = CreateQueueHead(deviceIndex, deviceEndpoint);
+		if (!deviceEndpoint->QueueHead)
+			return;
+
+		LinkQueueHead(module, deviceEndpoint->QueueHead);
+		endpointIndex++;
+		if (endpointIndex >= MAX_USB_ENDPOINTS)
+			return;
+	}
+}
+
+static int ConfigureDevice(EHCModuleControl *module, s8 deviceIndex, UsbDeviceDescriptor *device,
+                           UsbConfigurationDescriptor *configuration)
+{
+	WiiQueueHead *controlQueueHead = Devices[deviceIndex].Endpoints[0].QueueHead;
+	int rc = SendDeviceRequest(module, deviceIndex, USB_DIR_OUT | USB_TYPE_STANDARD,
+	                           USB_REQ_SET_ADDRESS, (u16)deviceIndex, 0, NULL, 0);
+	if (rc < 0)
+		return rc;
+
+	//give the device its set address recovery time before talking to it on the new address
+	SleepModule(module, 2000);
+	controlQueueHead->Hardware.Characteristics =
+	    (controlQueueHead->Hardware.Characteristics & ~QH_SET(ADDRESS, QH_ADDRESS_MASK)) |
+	    QH_SET(ADDRESS, deviceIndex);
+
+	rc = SendDeviceRequest(module, deviceIndex, USB_DIR_IN, USB_REQ_GET_DESCRIPTOR,
+	                       USB_DT_DEVICE << 8, 0, device, sizeof(*device));
+	if (rc < 0)
+		return rc;
+
+	Devices[deviceIndex].Endpoints[0].MaxPacketSize = device->MaxPacketSize0;
+	controlQueueHead->Hardware.Characteristics =
+	    (controlQueueHead->Hardware.Characteristics & ~QH_SET(MPS, QH_MPS_MASK)) |
+	    QH_SET(MPS, device->MaxPacketSize0);
+	Devices[deviceIndex].VendorId = swap_u16(device->VendorId);
+	Devices[deviceIndex].ProductId = swap_u16(device->ProductId);
+	Devices[deviceIndex].DeviceClass = device->DeviceClass;
+	Devices[deviceIndex].DeviceSubClass = device->DeviceSubClass;
+	Devices[deviceIndex].DeviceProtocol = device->DeviceProtocol;
+
+	rc = SendDeviceRequest(module, deviceIndex, USB_DIR_IN, USB_REQ_GET_DESCRIPTOR,
+	                       USB_DT_CONFIG << 8, 0, configuration, sizeof(*configuration));
+	if (rc < 0)
+		return rc;
+
+	Devices[deviceIndex].MaxPower = configuration->MaxPower;
+	u16 totalLength = swap_u16(configuration->TotalLength);
+	if (totalLength > EHC_MAX_CONFIGURATION)
+		totalLength = EHC_MAX_CONFIGURATION;
+
+	UsbConfigurationDescriptor *configurationReply =
+	    OSAlignedAllocateMemory(_moduleHeap, totalLength, 32);
+	if (configurationReply)
+	{
+		memset(configurationReply, 0, totalLength);
+		rc = SendDeviceRequest(module, deviceIndex, USB_DIR_IN, USB_REQ_GET_DESCRIPTOR,
+		                       USB_DT_CONFIG << 8, 0, configurationReply, totalLength);
+		if (rc >= 0)
+			ParseDescriptors(module, deviceIndex, configurationReply, totalLength);
+
+		OSFreeMemory(_moduleHeap, configurationReply);
+	}
+
+	rc = SendDeviceRequest(module, deviceIndex, USB_DIR_OUT, USB_REQ_SET_CONFIGURATION,
+	                       configuration->ConfigurationValue, 0, NULL, 0);
+	if (rc < 0)
+		return rc;
+
+	for (u8 i = 0; i < Devices[deviceIndex].NumberOfInterfaces; i++)
+	{
+		const DeviceInterface *iface = &Devices[deviceIndex].Interfaces[i];
+		if (iface->AlternateSetting == 0)
+			continue;
+
+		rc = SendDeviceRequest(module, deviceIndex, USB_RECIP_INTERFACE, USB_REQ_SET_INTERFACE,
+		                       iface->AlternateSetting, iface->InterfaceNumber, NULL, 0);
+		if (rc < 0)
+			return rc;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static void EnumeratePort(EHCModuleControl *module, u8 port)
+{
+	if (ResetPort(module, port) != IPC_SUCCESS)
+		return;
+
+	s8 deviceIndex = GetAvailableDeviceIndex(module, port);
+	if (deviceIndex == 0)
+	{
+		printk("No device slots available!\n");
+		return;
+	}
+
+	size_t descriptorSize = PADDED4_SIZEOF(UsbDeviceDescriptor);
+	size_t configurationSize = PADDED4_SIZEOF(UsbConfigurationDescriptor);
+	UsbDeviceDescriptor *device = OSAlignedAllocateMemory(_moduleHeap, descriptorSize, 32);
+	UsbConfigurationDescriptor *configuration =
+	    OSAlignedAllocateMemory(_moduleHeap, configurationSize, 32);
+
+	int ret = IPC_ENOMEM;
+	if (device && configuration)
+	{
+		memset(device, 0, descriptorSize);
+		memset(configuration, 0, configurationSize);
+		ret = ConfigureDevice(module, deviceIndex, device, configuration);
+	}
+
+	if (ret == IPC_SUCCESS)
+	{
+		printk("EHC: configured USB device at port %u, vid: 0x%04x pid: 0x%04x\n", port,
+		       Devices[deviceIndex].VendorId, Devices[deviceIndex].ProductId);
+	}
+	else
+	{
+		printk("EHC: failed to configure the device at port %u: %d\n", port, ret);
+		RemoveDevice(module, deviceIndex);
+	}
+
+	if (device)
+		OSFreeMemory(_moduleHeap, device);
+	if (configuration)
+		OSFreeMemory(_moduleHeap, configuration);
+}
+
+int InitialiseModule(EHCModuleControl *module)
+{
+	module->ActiveRequests = NULL;
+	module->PeriodicList = EHC_FRAME_LIST_BASE;
+	module->AsyncHead = AllocateQueueHead();
+	if (!module->AsyncHead)
+		return IPC_ENOMEM;
+
+	//the async schedule is a ring around a dummy head that never has any work queued on it
+	WiiQueueHead *asyncHead = module->AsyncHead;
+	asyncHead->Hardware.HorizontalLink = QueueHeadLink(asyncHead);
+	asyncHead->Hardware.Characteristics = QH_HEAD | QH_SET(SPEED, QH_SPEED_HIGH) |
+	                                      QH_SET(MPS, EHC_CONTROL_PACKET_SIZE);
+	asyncHead->Hardware.Overlay.Next = EHCI_LINK_TERMINATE;
+	asyncHead->Hardware.Overlay.AlternateNext = EHCI_LINK_TERMINATE;
+	asyncHead->Hardware.Overlay.Token = QTD_STS_HALTED;
+
+	//the periodic schedule is a tree of inactive queue heads, one per polling interval. every frame
+	//enters it at the longest interval it is due for, and falls through to the shorter ones
+	for (int level = 0; level < EHC_PERIODIC_LEVELS; level++)
+	{
+		WiiQueueHead *skeleton = AllocateQueueHead();
+		if (!skeleton)
+			return IPC_ENOMEM;
+
+		skeleton->IsPeriodic = 1;
+		skeleton->Period = (u8)(1 << level);
+		skeleton->Hardware.Characteristics = QH_SET(SPEED, QH_SPEED_HIGH);
+		skeleton->Hardware.Capabilities = QH_SET(SMASK, 0x01) | QH_SET(MULT, 1);
+		skeleton->Hardware.Overlay.Next = EHCI_LINK_TERMINATE;
+		skeleton->Hardware.Overlay.AlternateNext = EHCI_LINK_TERMINATE;
+		skeleton->Hardware.Overlay.Token = QTD_STS_HALTED;
+		skeleton->Hardware.HorizontalLink =
+		    level == 0 ? EHCI_LINK_TERMINATE : QueueHeadLink(module->PeriodicHeads[level - 1]);
+		module->PeriodicHeads[level] = skeleton;
+	}
+
+	for (u32 frame = 0; frame < EHC_FRAME_LIST_SIZE; frame++)
+	{
+		u32 level = frame == 0 ? EHC_PERIODIC_LEVELS - 1 : (u32)__builtin_ctz(frame);
+		if (level >= EHC_PERIODIC_LEVELS)
+			level = EHC_PERIODIC_LEVELS - 1;
+
+		module->PeriodicList[frame] = QueueHeadLink(module->PeriodicHeads[level]);
+	}
+
+	return IPC_SUCCESS;
+}
+
+int QueryModuleDevices(EHCModuleControl *module)
+{
+	volatile EhciRegisters *registers = module->HardwareRegisters;
+
+	_controlRequest = OSAlignedAllocateMemory(_moduleHeap, sizeof(USBControlMessage), 32);
+	if (_controlRequest == NULL)
+		return IPC_EMAX;
+
+	module->NumberOfPorts = (u8)EHCI_HCS_N_PORTS(registers->HcsParameters);
+	if (module->NumberOfPorts > EHCI_MAX_PORTS)
+		module->NumberOfPorts = EHCI_MAX_PORTS;
+
+	Devices[0].DeviceType = DEV_TYPE_HUB;
+	Devices[0].Interfaces[0].InterfaceNumber = module->NumberOfPorts;
+
+	//route every port to us. whatever is not high speed gets handed back to the ohci port by port
+	registers->PortConfigFlag = EHCI_CF_ROUTE_EHCI;
+	for (u8 port = 0; port < module->NumberOfPorts; port++)
+		registers->PortControl[port] = (registers->PortControl[port] & ~EHCI_PORT_RWC) | EHCI_PORT_POWER;
+
+	SleepModule(module, 20000);
+	for (u8 port = 0; port < module->NumberOfPorts; port++)
+	{
+		EnumeratePort(module, port);
+		registers->PortControl[port] |= EHCI_PORT_RWC;
+	}
+
+	module->State |= EHC_STATE_DEVICE_QUERIED;
+	return IPC_SUCCESS;
+}
+
+int ProcessControlMessage(EHCModuleControl *module, IpcMessage *ipcMessage)
+{
+	const IpcRequest *request = &ipcMessage->Request;
+	const IoctlvMessage *ioctlv = &request->Message.Ioctlv;
+	u32 inputCount = ioctlv->InputArgc;
+	u32 ioCount = ioctlv->IoArgc;
+	if (inputCount != 6 || ioCount != 1)
+	{
+		printk("readcount[%u], writecount[%u] bad\n", inputCount, ioCount);
+		return IPC_EINVAL;
+	}
+
+	const IoctlvMessageData *vector = ioctlv->MessageData;
+	if (vector[0].Length != 1 || !vector[0].Data || vector[1].Length != 1 ||
+	    !vector[1].Data || vector[2].Length != 2 || !vector[2].Data ||
+	    vector[3].Length != 2 || !vector[3].Data || vector[4].Length != 2 ||
+	    !vector[4].Data || vector[5].Length != 1 || !vector[5].Data ||
+	    vector[6].Length != swap_u16(*(u16 *)vector[4].Data) ||
+	    (vector[6].Length != 0 && !vector[6].Data))
+	{
+		printk("parameter validity check failed\n");
+		return IPC_EINVAL;
+	}
+
+	USBControlMessage *controlMessage =
+	    OSAlignedAllocateMemory(_moduleHeap, sizeof(*controlMessage), 32);
+	if (!controlMessage)
+	{
+		printk("failed to allocate ehcctrlreq\n");
+		return IPC_EMAX;
+	}
+
+	s8 deviceIndex = *(s8 *)((int)&request->FileDescriptor + 3);
+	controlMessage->RequestType = *(u8 *)vector[0].Data;
+	controlMessage->Request = *(u8 *)vector[1].Data;
+	controlMessage->Value = *(u16 *)vector[2].Data;
+	controlMessage->Index = *(u16 *)vector[3].Data;
+	controlMessage->Length = *(u16 *)vector[4].Data;
+	controlMessage->Oh1.Data = vector[6].Data;
+	controlMessage->Oh1.Endpoint = *(u8 *)vector[5].Data;
+	controlMessage->Oh1.DeviceIndex = deviceIndex;
+	if (controlMessage->RequestType == (USB_DIR_OUT | USB_RECIP_ENDPOINT) &&
+	    controlMessage->Request == USB_REQ_CLEAR_FEATURE &&
+	    swap_u16(controlMessage->Value) == USB_ENDPOINT_HALT)
+		ResetEndpointToggle(module, deviceIndex, (u8)swap_u16(controlMessage->Index));
+
+	int rc = SendControlMessageAsync(module, controlMessage, ipcMessage, -1, deviceIndex);
+	if (rc < 0)
+		OSFreeMemory(_moduleHeap, controlMessage);
+
+	return rc;
+}
+
+int ProcessInterruptBlockMessage(EHCModuleControl *module, IpcMessage *ipcMessage)
+{
+	const IpcRequest *request = &ipcMessage->Request;
+	const IoctlvMessage *ioctlv = &request->Message.Ioctlv;
+	u32 inputCount = ioctlv->InputArgc;
+	u32 ioCount = ioctlv->IoArgc;
+	u32 length;
+	int rc;
+
+	if (inputCount != 2 || ioCount != 1)
+	{
+		printk("readcount[%u], writecount[%u] bad\n", inputCount, ioCount);
+		return IPC_EINVAL;
+	}
+
+	//bulk transfers may pass a 32 bit length, so a single request can move more than 64KB
+	const IoctlvMessageData *vector = ioctlv->MessageData;
+	if (vector[0].Length != 1 || !vector[0].Data || !vector[1].Data)
+		return IPC_EINVAL;
+
+	if (vector[1].Length == sizeof(u16))
+		length = *(u16 *)vector[1].Data;
+	else if (vector[1].Length == sizeof(u32) && ioctlv->Ioctl == USBV0_IOCTL_BLKMSG)
+		length = *(u32 *)vector[1].Data;
+	else
+		return IPC_EINVAL;
+
+	if (length == 0 || length != vector[2].Length || !vector[2].Data)
+		return IPC_EINVAL;
+
+	const u8 endpointAddress = *(u8 *)vector[0].Data;
+	const s8 deviceIndex = *(s8 *)((int)&request->FileDescriptor + 3);
+	const s8 endpointIndex = endpointAddress == 0 ? -1 : FindEndpointIndex(deviceIndex, endpointAddress);
+	if (endpointIndex < 1)
+		return IPC_EINVAL;
+
+	DeviceEndpoint *endpoint = &Devices[deviceIndex].Endpoints[endpointIndex];
+	if (!endpoint->QueueHead)
+		return IPC_EINVAL;
+
+	IORequestPacket *irp = OSAllocateMemory(_moduleHeap, sizeof(*irp));
+	if (!irp)
+		return IPC_EMAX;
+
+	memset(irp, 0, sizeof(*irp));
+	irp->Queue = -1;
+	irp->RequestMessage = ipcMessage;
+	irp->MessageData = vector[2].Data;
+	irp->Size = length;
+
+	//every qTD holds at least 4 full pages
+	const u32 transferCount = length / (QTD_PAGE_SIZE * (QTD_MAX_PAGES - 1)) + 1;
+	WiiTransferDescriptor **chain = OSAllocateMemory(_moduleHeap, transferCount * sizeof(*chain));
+	if (!chain)
+	{
+		OSFreeMemory(_moduleHeap, irp);
+		return IPC_EMAX;
+	}
+
+	DisableModuleInterrupts(module);
+	BufferToDevice(irp->MessageData, length);
+
+	//chain[0] is the queue head's dummy tail, it gets filled in place
+	const u32 address = GetPhysicalAddress(ValidateMemoryAddress(irp->MessageData));
+	const u32 pid = QTD_SET(PID, (endpointAddress & USB_DIR_IN) ? QTD_PID_IN : QTD_PID_OUT);
+	WiiTransferDescriptor first = { 0 };
+	u32 count = 0;
+	rc = IPC_SUCCESS;
+	for (u32 offset = 0; offset < length; count++)
+	{
+		WiiTransferDescriptor *transfer = &first;
+		if (count != 0)
+		{
+			transfer = AllocateTransferDescriptor();
+			if (!transfer)
+			{
+				rc = IPC_EMAX;
+				break;
+			}
+		}
+
+		chain[count] = transfer;
+		offset += FillTransfer(transfer, irp, address + offset, length - offset,
+		                       endpoint->MaxPacketSize, pid);
+		if (offset == length)
+			transfer->Hardware.Token |= QTD_IOC;
+	}
+
+	if (rc == IPC_SUCCESS)
+	{
+		WiiTransferDescriptor *tail = endpoint->QueueHead->Tail;
+		memcpy(tail->Hardware.Buffer, first.Hardware.Buffer, sizeof(first.Hardware.Buffer));
+		tail->Hardware.AlternateNext = EHCI_LINK_TERMINATE;
+		tail->IORequestPacket = irp;
+		tail->Length = first.Length;
+		rc = QueueTransfers(module, irp, endpoint->QueueHead, chain, count, first.Hardware.Token);
+	}
+
+	if (rc < 0)
+	{
+		for (u32 i = 1; i < count; i++)
+			FreeMemory(chain[i]);
+		OSFreeMemory(_moduleHeap, irp);
+	}
+
+	OSFreeMemory(_moduleHeap, chain);
+	EnableModuleInterrupts(module);
+	return rc;
+}
+
+void ProcessCompletedTransfers(EHCModuleControl *module)
+{
+	IORequestPacket *ioRequest = module->ActiveRequests;
+	while (ioRequest)
+	{
+		IORequestPacket *next = ioRequest->Next;
+		WiiTransferDescriptor *transfer = ioRequest->FirstTransfer;
+		bool completed = false;
+		u32 transferred = 0;
+
+		while (transfer)
+		{
+			const u32 token = transfer->Hardware.Token;
+			if (token & QTD_STS_ACTIVE)
+				break;
+
+			const u32 remaining = QTD_GET(BYTES, token);
+			if (transfer->Length != 0)
+				transferred += transfer->Length - remaining;
+
+			if (token & QTD_STS_HALTED)
+			{
+				//a stall without any other error is the device refusing the request
+				printk("EHC: transfer %p halted, token 0x%08x\n", transfer, token);
+				ioRequest->Result = (token & (QTD_STS_XACT | QTD_STS_BABBLE | QTD_STS_DBE)) ?
+				                        IPC_UNKNOWN :
+				                        IPC_EINVAL;
+				ResetQueueHead(ioRequest->QueueHead, ioRequest->LastTransfer->Hardware.Next);
+				completed = true;
+				break;
+			}
+
+			if (transfer == ioRequest->LastTransfer)
+			{
+				completed = true;
+				break;
+			}
+
+			//on a short packet the controller took the alternate link, follow it
+			if (remaining != 0 && transfer->Length != 0)
+			{
+				if (transfer->Hardware.AlternateNext != TransferLink(ioRequest->LastTransfer))
+				{
+					completed = true;
+					break;
+				}
+
+				transfer = ioRequest->LastTransfer;
+				continue;
+			}
+
+			transfer = transfer->NextInRequest;
+		}
+
+		if (completed)
+		{
+			ioRequest->Transferred = transferred;
+			RetireRequest(module, ioRequest);
+		}
+
+		ioRequest = next;
+	}
+}
+
+int SleepModule(EHCModuleControl *module, u32 timeout)
+{
+	int rc;
+	void *message;
+
+	rc = OSRestartTimer(module->Timer, timeout, 0);
+	if (rc < 0)
+	{
+		printk("usleept: RestartTimer (tmr = %d usec = %u) failed: %d\n",
+		       module->Timer, timeout, rc);
+	}
+	else
+	{
+		rc = OSReceiveMessage(module->TimerQueue, &message, 0);
+		OSStopTimer(module->Timer);
+	}
+	return rc;
+}
+
+void HandleStatusChange(EHCModuleControl *module)
+{
+	volatile EhciRegisters *registers = module->HardwareRegisters;
+
+	for (u8 port = 0; port < module->NumberOfPorts; port++)
+	{
+		const u32 portControl = registers->PortControl[port];
+		if (!(portControl & EHCI_PORT_CSC) || (portControl & EHCI_PORT_OWNER))
+			continue;
+
+		registers->PortControl[port] = portControl;
+		for (s8 deviceIndex = 1; deviceIndex < MAX_USB_DEVICES; deviceIndex++)
+		{
+			if (Devices[deviceIndex].DeviceType != DEV_TYPE_DEVICE ||
+			    Devices[deviceIndex].PortIndex != port)
+				continue;
+
+			if (Devices[deviceIndex].IpcMessage != NULL)
+				OSResourceReply(Devices[deviceIndex].IpcMessage, 0);
+
+			RemoveDevice(module, deviceIndex);
+		}
+
+		if (portControl & EHCI_PORT_CONNECT)
+			EnumeratePort(module, port);
+	}
+}
+
+int SuspendDevice(EHCModuleControl *module, u8 port)
+{
+	if (port >= module->NumberOfPorts)
+		return IPC_EINVAL;
+
+	volatile u32 *portControl = &module->HardwareRegisters->PortControl[port];
+	if (!(*portControl & EHCI_PORT_PE))
+		return IPC_NOTREADY;
+
+	*portControl = (*portControl & ~EHCI_PORT_RWC) | EHCI_PORT_SUSPEND;
+	if (!(*portControl & EHCI_PORT_SUSPEND))
+		return IPC_UNKNOWN;
+
+	return IPC_SUCCESS;
+}
+
+int ResumeDevice(EHCModuleControl *module, u8 port)
+{
+	if (port >= module->NumberOfPorts)
+		return IPC_EINVAL;
+
+	volatile u32 *portControl = &module->HardwareRegisters->PortControl[port];
+	if (!(*portControl & EHCI_PORT_SUSPEND))
+		return IPC_SUCCESS;
+
+	//drive resume for at least 20ms, then the controller finishes it by itself
+	*portControl = (*portControl & ~EHCI_PORT_RWC) | EHCI_PORT_RESUME;
+	SleepModule(module, 20000);
+	*portControl = *portControl & ~(EHCI_PORT_RWC | EHCI_PORT_RESUME);
+	SleepModule(module, 2000);
+	if (*portControl & EHCI_PORT_SUSPEND)
+		return IPC_UNKNOWN;
+
+	return IPC_SUCCESS;
+}
+
+void CloseDevice(EHCModuleControl *module, s8 deviceIndex)
+{
+	DisableModuleInterrupts(module);
+	for (u8 endpointIndex = 0; endpointIndex < MAX_USB_ENDPOINTS; endpointIndex++)
+	{
+		WiiQueueHead *queueHead = Devices[deviceIndex].Endpoints[endpointIndex].QueueHead;
+		if (queueHead)
+			CancelRequests(module, queueHead, IPC_EINTR);
+	}
+	EnableModuleInterrupts(module);
+}
@@ -0,0 +1,53 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ehc - usb 2.0 ehci implementation in ios
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+#include <ios/ahb.h>
+#include <ios/ipc.h>
+#include <usb/ehci.h>
+
+#include "communications.h"
+
+//the usb host controllers share their ahb port
+#define EHC_AHB_DEVICE              AHB_OHCI
+#define EHC_INTERRUPTS              (EHCI_STS_INT | EHCI_STS_ERR | EHCI_STS_PCD | EHCI_STS_HSE)
+//interrupt endpoints are polled every 1, 2, 4, 8, 16 or 32 frames
+#define EHC_PERIODIC_LEVELS         6
+
+#define EHC_STATE_DEVICE_QUERIED    (1 << 0)
+#define EHC_STATE_PROCESSING_EVENTS (1 << 1)
+typedef struct
+{
+	volatile EhciRegisters *HardwareRegisters;
+	u32 *PeriodicList;
+	WiiQueueHead *AsyncHead;
+	WiiQueueHead *PeriodicHeads[EHC_PERIODIC_LEVELS];
+	IORequestPacket *ActiveRequests;
+	s32 Timer;
+	s32 TimerQueue;
+	s32 QueueId;
+	u32 TimerQueueBuffer;
+	u8 DeviceEvent;
+	u8 NumberOfPorts;
+	u32 State;
+} EHCModuleControl;
+
+int InitialiseModule(EHCModuleControl *module);
+int QueryModuleDevices(EHCModuleControl *module);
+int SleepModule(EHCModuleControl *module, u32 timeout);
+int ProcessControlMessage(EHCModuleControl *module, IpcMessage *ipcMessage);
+int ProcessInterruptBlockMessage(EHCModuleControl *module, IpcMessage *ipcMessage);
+void ProcessCompletedTransfers(EHCModuleControl *module);
+int SuspendDevice(EHCModuleControl *module, u8 port);
+int ResumeDevice(EHCModuleControl *module, u8 port);
+void HandleStatusChange(EHCModuleControl *module);
+void CloseDevice(EHCModuleControl *module, s8 deviceIndex);
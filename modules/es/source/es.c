@@ -6,33 +6,231 @@
 # see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/ipc.h>
 #include <ios/syscalls.h>
 #include "ios/printk.h"
 #include <ios/module.h>
 
 #include "es.h"
+#include "titles.h"
 
-MODULE_DATA const unsigned char esDummyData[] = { 0x42 };
+static inline bool HasVectors(const IoctlvMessage *ioctlv, u32 inputCount, u32 ioCount)
+{
+	return ioctlv->InputArgc == inputCount && ioctlv->IoArgc == ioCount;
+}
+
+static inline bool IsValidVector(const IoctlvMessageData *vector, u32 length)
+{
+	return vector->Data != NULL && vector->Length >= length;
+}
+
+static s32 GetTitleCount(IoctlvMessage *ioctlv, bool owned)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	if (!HasVectors(ioctlv, 0, 1) || !IsValidVector(&vector[0], sizeof(u32)))
+		return ES_EINVAL;
+
+	*(u32 *)vector[0].Data = GetTitleIds(NULL, 0, owned);
+	return IPC_SUCCESS;
+}
+
+static s32 ListTitles(IoctlvMessage *ioctlv, bool owned)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	if (!HasVectors(ioctlv, 1, 1) || !IsValidVector(&vector[0], sizeof(u32)))
+		return ES_EINVAL;
+
+	const u32 count = *(u32 *)vector[0].Data;
+	if (!IsValidVector(&vector[1], count * sizeof(u64)))
+		return ES_EINVAL;
+
+	GetTitleIds((u64 *)vector[1].Data, count, owned);
+	return IPC_SUCCESS;
+}
+
+//every title query starts with the title id as its first input vector
+static const TitleInfo *GetRequestedTitle(IoctlvMessage *ioctlv, u32 inputCount, u32 ioCount)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	if (!HasVectors(ioctlv, inputCount, ioCount) || !IsValidVector(&vector[0], sizeof(u64)))
+		return NULL;
+
+	return GetTitleInfo(*(u64 *)vector[0].Data);
+}
+
+static s32 HandleTitleQuery(IoctlvMessage *ioctlv)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	const TitleInfo *title;
+	u32 count;
+
+	switch (ioctlv->Ioctl)
+	{
+		case ES_IOCTLV_GETTITLECONTENTSCNT:
+			title = GetRequestedTitle(ioctlv, 1, 1);
+			if (title == NULL || !title->HasMetadata)
+				return ES_EINVAL;
+			if (!IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			*(u32 *)vector[1].Data = title->View.NumberOfContents;
+			return IPC_SUCCESS;
+		case ES_IOCTLV_GETTITLECONTENTS:
+		{
+			title = GetRequestedTitle(ioctlv, 2, 1);
+			if (title == NULL || !title->HasMetadata || !IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			count = *(u32 *)vector[1].Data;
+			if (count > title->View.NumberOfContents || !IsValidVector(&vector[2], count * sizeof(u32)))
+				return ES_EINVAL;
+
+			//only the ids are wanted, so go through the views in small batches
+			u32 *contentIds = (u32 *)vector[2].Data;
+			TmdViewContent contents[0x10];
+			for (u32 i = 0; i < count; i += 0x10)
+			{
+				const u32 batch = count - i < 0x10 ? count - i : 0x10;
+				s32 ret = GetTitleContents(title, i, contents, batch);
+				if (ret != IPC_SUCCESS)
+					return ret;
+				for (u32 j = 0; j < batch; j++)
+					contentIds[i + j] = contents[j].ContentId;
+			}
+			return IPC_SUCCESS;
+		}
+		case ES_IOCTLV_GETVIEWCNT:
+			title = GetRequestedTitle(ioctlv, 1, 1);
+			if (!IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			*(u32 *)vector[1].Data = title == NULL ? 0 : title->TicketCount;
+			return IPC_SUCCESS;
+		case ES_IOCTLV_GETVIEWS:
+			title = GetRequestedTitle(ioctlv, 2, 1);
+			if (title == NULL || title->TicketCount == 0)
+				return ES_NO_TICKET;
+			if (!IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			count = *(u32 *)vector[1].Data;
+			if (!IsValidVector(&vector[2], count * sizeof(TicketView)))
+				return ES_EINVAL;
+			return GetTicketViews(title, (TicketView *)vector[2].Data, count);
+		case ES_IOCTLV_GETTMDVIEWCNT:
+			title = GetRequestedTitle(ioctlv, 1, 1);
+			if (title == NULL || !title->HasMetadata || !IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			*(u32 *)vector[1].Data =
+			    sizeof(TmdViewHeader) + title->View.NumberOfContents * sizeof(TmdViewContent);
+			return IPC_SUCCESS;
+		case ES_IOCTLV_GETTMDVIEWS:
+		{
+			title = GetRequestedTitle(ioctlv, 2, 1);
+			if (title == NULL || !title->HasMetadata || !IsValidVector(&vector[1], sizeof(u32)))
+				return ES_EINVAL;
+
+			const u32 size = *(u32 *)vector[1].Data;
+			count = title->View.NumberOfContents;
+			if (size < sizeof(TmdViewHeader) + count * sizeof(TmdViewContent) ||
+			    !IsValidVector(&vector[2], size))
+				return ES_EINVAL;
+
+			u8 *view = (u8 *)vector[2].Data;
+			memcpy(view, &title->View, sizeof(TmdViewHeader));
+			return GetTitleContents(title, 0, (TmdViewContent *)(view + sizeof(TmdViewHeader)),
+			                        count);
+		}
+		default:
+			return ES_EINVAL;
+	}
+}
+
+static s32 HandleIoctlv(IoctlvMessage *ioctlv)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+
+	switch (ioctlv->Ioctl)
+	{
+		case ES_IOCTLV_GETOWNEDTITLECNT:
+			return GetTitleCount(ioctlv, true);
+		case ES_IOCTLV_GETOWNEDTITLES:
+			return ListTitles(ioctlv, true);
+		case ES_IOCTLV_GETTITLECNT:
+			return GetTitleCount(ioctlv, false);
+		case ES_IOCTLV_GETTITLES:
+			return ListTitles(ioctlv, false);
+		case ES_IOCTLV_DELETETITLE:
+			if (!HasVectors(ioctlv, 1, 0) || !IsValidVector(&vector[0], sizeof(u64)))
+				return ES_EINVAL;
+			return DeleteTitle(*(u64 *)vector[0].Data);
+		case ES_IOCTLV_DELETETICKET:
+			if (!HasVectors(ioctlv, 1, 0) || !IsValidVector(&vector[0], sizeof(TicketView)))
+				return ES_EINVAL;
+			return DeleteTicket((const TicketView *)vector[0].Data);
+		default:
+			return HandleTitleQuery(ioctlv);
+	}
+}
+
+static s32 HandleRequest(IpcRequest *request)
+{
+	switch (request->Command)
+	{
+		case IOS_OPEN:
+			if (strncmp(request->Message.Open.Filepath, ES_DEVICE_NAME, ES_DEVICE_NAME_SIZE) != 0)
+				return IPC_ENOENT;
+			return 0;
+		case IOS_CLOSE:
+			return IPC_SUCCESS;
+		case IOS_IOCTLV:
+			return HandleIoctlv(&request->Message.Ioctlv);
+		default:
+			return IPC_EINVAL;
+	}
+}
 
 int main(void)
 {
 	u32 messageQueueMessages[8] ALIGNED(0x20) = { 0 };
+	IpcMessage *message;
 
 	OSSetThreadPriority(0, 0x50);
 	OSSetThreadPriority(0, 0x79);
 	printk("$IOSVersion:  ES: %s %s 64M $", __DATE__, __TIME__);
 
-	s32 ret = OSCreateMessageQueue((void **)&messageQueueMessages, 1);
-	const u32 EsMessageQueueId = (u32)ret;
+	s32 ret = OSCreateMessageQueue((void **)&messageQueueMessages, 8);
+	const s32 EsMessageQueueId = ret;
 	if (ret < 0)
 	{
 		printk("failed to create messagequeue! %d\n", ret);
 		return -408;
 	}
 
+	ret = InitializeTitleIndex();
+	if (ret < 0)
+	{
+		printk("failed to build the title index! %d\n", ret);
+		return ret;
+	}
+
+	ret = OSRegisterResourceManager(ES_DEVICE_NAME, EsMessageQueueId);
+	if (ret < 0)
+	{
+		printk("failed to register resource manager! %d\n", ret);
+		return ret;
+	}
+
 	while (1)
 	{
-		OSReceiveMessage(EsMessageQueueId, &esDummyData, 0);
+		ret = OSReceiveMessage(EsMessageQueueId, &message, 0);
+		if (ret < 0)
+			break;
+
+		OSResourceReply(message, HandleRequest(&message->Request));
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -11,7 +11,141 @@
 #ifndef __ES_H__
 #define __ES_H__
 
+#include <types.h>
+
 #define ES_DEVICE_NAME      "/dev/es"
 #define ES_DEVICE_NAME_SIZE sizeof(ES_DEVICE_NAME)
 
-#endif
\ No newline at end of file
+#define ES_IOCTLV_GETOWNEDTITLECNT     0x0C
+#define ES_IOCTLV_GETOWNEDTITLES       0x0D
+#define ES_IOCTLV_GETTITLECNT          0x0E
+#define ES_IOCTLV_GETTITLES            0x0F
+#define ES_IOCTLV_GETTITLECONTENTSCNT  0x10
+#define ES_IOCTLV_GETTITLECONTENTS     0x11
+#define ES_IOCTLV_GETVIEWCNT           0x12
+#define ES_IOCTLV_GETVIEWS             0x13
+#define ES_IOCTLV_GETTMDVIEWCNT        0x14
+#define ES_IOCTLV_GETTMDVIEWS          0x15
+#define ES_IOCTLV_DELETETITLE          0x17
+#define ES_IOCTLV_DELETETICKET         0x18
+
+#define SIGNATURE_RSA4096 0x00010000
+#define SIGNATURE_RSA2048 0x00010001
+#define SIGNATURE_ECC     0x00010002
+
+#pragma pack(push, 1)
+typedef struct
+{
+	char Issuer[0x40];
+	u8 Version;
+	u8 CaCrlVersion;
+	u8 SignerCrlVersion;
+	u8 Padding;
+	u64 SystemVersion;
+	u64 TitleId;
+	u32 TitleType;
+	u16 GroupId;
+	u8 Reserved[0x3E];
+	u32 AccessRights;
+	u16 TitleVersion;
+	u16 NumberOfContents;
+	u16 BootIndex;
+	u16 Padding2;
+} TmdHeader;
+
+typedef struct
+{
+	u32 ContentId;
+	u16 Index;
+	u16 Type;
+	u64 Size;
+	u8 Hash[0x14];
+} TmdContent;
+
+typedef struct
+{
+	u8 Version;
+	u8 Padding[3];
+	u64 SystemVersion;
+	u64 TitleId;
+	u32 TitleType;
+	u16 GroupId;
+	u8 Reserved[0x3E];
+	u16 TitleVersion;
+	u16 NumberOfContents;
+} TmdViewHeader;
+
+typedef struct
+{
+	u32 ContentId;
+	u16 Index;
+	u16 Type;
+	u64 Size;
+} TmdViewContent;
+
+typedef struct
+{
+	u32 Tag;
+	u32 Value;
+} TicketLimit;
+
+typedef struct
+{
+	char Issuer[0x40];
+	u8 EccPublicKey[0x3C];
+	u8 Version;
+	u8 Reserved[2];
+	u8 TitleKey[0x10];
+	u8 Unknown;
+	u64 TicketId;
+	u32 DeviceType;
+	u64 TitleId;
+	u16 AccessMask;
+	u8 Reserved2[0x3C];
+	u8 ContentAccessMask[0x40];
+	u16 Padding;
+	TicketLimit Limits[8];
+} Ticket;
+
+typedef struct
+{
+	u32 View;
+	u64 TicketId;
+	u32 DeviceType;
+	u64 TitleId;
+	u16 AccessMask;
+	u8 Reserved[0x3C];
+	u8 ContentAccessMask[0x40];
+	u16 Padding;
+	TicketLimit Limits[8];
+} TicketView;
+#pragma pack(pop)
+
+CHECK_SIZE(TmdHeader, 0xA4);
+CHECK_OFFSET(TmdHeader, 0x44, SystemVersion);
+CHECK_OFFSET(TmdHeader, 0x4C, TitleId);
+CHECK_OFFSET(TmdHeader, 0x54, TitleType);
+CHECK_OFFSET(TmdHeader, 0x58, GroupId);
+CHECK_OFFSET(TmdHeader, 0x5A, Reserved);
+CHECK_OFFSET(TmdHeader, 0x98, AccessRights);
+CHECK_OFFSET(TmdHeader, 0x9C, TitleVersion);
+CHECK_OFFSET(TmdHeader, 0x9E, NumberOfContents);
+CHECK_OFFSET(TmdHeader, 0xA0, BootIndex);
+CHECK_SIZE(TmdContent, 0x24);
+CHECK_SIZE(TmdViewHeader, 0x5C);
+CHECK_OFFSET(TmdViewHeader, 0x04, SystemVersion);
+CHECK_OFFSET(TmdViewHeader, 0x0C, TitleId);
+CHECK_OFFSET(TmdViewHeader, 0x1A, Reserved);
+CHECK_OFFSET(TmdViewHeader, 0x58, TitleVersion);
+CHECK_OFFSET(TmdViewHeader, 0x5A, NumberOfContents);
+CHECK_SIZE(TmdViewContent, 0x10);
+CHECK_SIZE(Ticket, 0x164);
+CHECK_OFFSET(Ticket, 0x90, TicketId);
+CHECK_OFFSET(Ticket, 0x9C, TitleId);
+CHECK_OFFSET(Ticket, 0x124, Limits);
+CHECK_SIZE(TicketView, 0xD8);
+CHECK_OFFSET(TicketView, 0x04, TicketId);
+CHECK_OFFSET(TicketView, 0x10, TitleId);
+CHECK_OFFSET(TicketView, 0x98, Limits);
+
+#endif
@@ -0,0 +1,496 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	titles - index of the titles & tickets installed on the nand
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/ipc.h>
+#include <ios/printk.h>
+#include <ios/processor.h>
+#include <ios/syscalls.h>
+
+#include "titles.h"
+
+#define FS_DEVICE_NAME      "/dev/fs"
+#define FS_IOCTLV_READDIR   0x04
+#define FS_IOCTL_DELETE     0x07
+#define FS_MAX_PATH         0x40
+#define FS_MAX_NAME         0x0C
+#define FS_RETRY_DELAY      1000
+#define ES_MAX_TITLE_TYPES  0x10
+#define ES_SIGNATURE_SIZE   (4 + 0x100 + 0x3C)
+#define ES_TICKET_SIZE      (ES_SIGNATURE_SIZE + sizeof(Ticket))
+
+static TitleInfo Titles[ES_MAX_TITLES];
+static u32 TitleCount = 0;
+static TmdViewContent ContentPool[ES_MAX_CONTENTS];
+static u32 ContentPoolUsed = 0;
+static TicketView TicketPool[ES_MAX_TICKETS];
+static u32 TicketPoolUsed = 0;
+static bool TitleIndexValid = false;
+static s32 FileSystemFd = -1;
+
+static char PathBuffer[FS_MAX_PATH] ALIGNED(0x20);
+static char TypeNames[ES_MAX_TITLE_TYPES * (FS_MAX_NAME + 1)] ALIGNED(0x20);
+static char TitleNames[ES_MAX_TITLES * (FS_MAX_NAME + 1)] ALIGNED(0x20);
+static TmdContent ContentBuffer[0x10] ALIGNED(0x20);
+static Ticket TicketBuffer ALIGNED(0x20);
+
+static u32 GetSignatureSize(u32 signatureType)
+{
+	switch (signatureType)
+	{
+		case SIGNATURE_RSA4096:
+			return 4 + 0x200 + 0x3C;
+		case SIGNATURE_RSA2048:
+			return 4 + 0x100 + 0x3C;
+		case SIGNATURE_ECC:
+			return 4 + 0x3C + 0x40;
+		default:
+			return 0;
+	}
+}
+
+static bool ParseTitleIdHalf(const char *name, u32 *value)
+{
+	*value = 0;
+	for (u32 i = 0; i < 8; i++)
+	{
+		const char character = name[i];
+		u32 digit;
+		if (character >= '0' && character <= '9')
+			digit = (u32)(character - '0');
+		else if (character >= 'a' && character <= 'f')
+			digit = (u32)(character - 'a' + 10);
+		else if (character >= 'A' && character <= 'F')
+			digit = (u32)(character - 'A' + 10);
+		else
+			return false;
+
+		*value = (*value << 4) | digit;
+	}
+
+	return true;
+}
+
+static s32 ReadExact(s32 fd, void *data, u32 length)
+{
+	s32 ret = OSReadFD(fd, data, length);
+	if (ret < 0)
+		return ret;
+
+	return (u32)ret == length ? IPC_SUCCESS : ES_SHORT_READ;
+}
+
+static s32 ReadDirectory(char *names, u32 maxEntries)
+{
+	u32 maxCount = maxEntries;
+	u32 count = 0;
+	IoctlvMessageData vectors[4] = {
+		{ PathBuffer, FS_MAX_PATH },
+		{ &maxCount, sizeof(u32) },
+		{ names, maxEntries * (FS_MAX_NAME + 1) },
+		{ &count, sizeof(u32) },
+	};
+
+	s32 ret = OSIoctlvFD(FileSystemFd, FS_IOCTLV_READDIR, 2, 2, vectors);
+	return ret < 0 ? ret : (s32)count;
+}
+
+static s32 OpenFileSystem(void)
+{
+	u32 queueMessages[1] ALIGNED(0x10);
+
+	s32 fd = OSOpenFD(FS_DEVICE_NAME, 0);
+	if (fd != IPC_ENOENT)
+		return fd;
+
+	//the fs module runs at a lower priority than us, so give it the time to register
+	s32 queueId = OSCreateMessageQueue(queueMessages, 1);
+	if (queueId < 0)
+		return queueId;
+
+	s32 timerId = OSCreateTimer(FS_RETRY_DELAY, FS_RETRY_DELAY, queueId, NULL);
+	while (timerId >= 0 && fd == IPC_ENOENT)
+	{
+		OSReceiveMessage(queueId, NULL, 0);
+		fd = OSOpenFD(FS_DEVICE_NAME, 0);
+	}
+
+	if (timerId >= 0)
+		OSDestroyTimer(timerId);
+	OSDestroyMessageQueue(queueId);
+	return timerId < 0 ? timerId : fd;
+}
+
+//reads count content records from the tmd fd is positioned at & converts them to their view
+static s32 ReadContents(s32 fd, TmdViewContent *contents, u32 count)
+{
+	const u32 chunkEntries = sizeof(ContentBuffer) / sizeof(TmdContent);
+	for (u32 i = 0; i < count; i += chunkEntries)
+	{
+		const u32 entries = count - i < chunkEntries ? count - i : chunkEntries;
+		s32 ret = ReadExact(fd, ContentBuffer, entries * sizeof(TmdContent));
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		for (u32 j = 0; j < entries; j++)
+		{
+			contents[i + j].ContentId = ContentBuffer[j].ContentId;
+			contents[i + j].Index = ContentBuffer[j].Index;
+			contents[i + j].Type = ContentBuffer[j].Type;
+			contents[i + j].Size = ContentBuffer[j].Size;
+		}
+	}
+
+	return IPC_SUCCESS;
+}
+
+//opens the title's tmd and leaves it positioned at its first content record
+static s32 OpenMetadata(u64 titleId, TmdHeader *header)
+{
+	u32 signatureType;
+
+	snprintf(PathBuffer, sizeof(PathBuffer), "/title/%08x/%08x/content/title.tmd",
+	         (u32)(titleId >> 32), (u32)titleId);
+	s32 fd = OSOpenFD(PathBuffer, Read);
+	if (fd < 0)
+		return fd;
+
+	s32 ret = ReadExact(fd, &signatureType, sizeof(u32));
+	if (ret != IPC_SUCCESS)
+		goto close_and_return;
+
+	const u32 signatureSize = GetSignatureSize(signatureType);
+	if (signatureSize == 0)
+	{
+		ret = ES_INVALID_SIGNATURE_TYPE;
+		goto close_and_return;
+	}
+
+	ret = OSSeekFD(fd, (s32)signatureSize, SeekSet);
+	if (ret < 0)
+		goto close_and_return;
+
+	ret = ReadExact(fd, header, sizeof(TmdHeader));
+	if (ret == IPC_SUCCESS && header->TitleId != titleId)
+		ret = ES_EINVAL;
+
+close_and_return:
+	if (ret != IPC_SUCCESS)
+	{
+		OSCloseFD(fd);
+		return ret;
+	}
+
+	return fd;
+}
+
+static s32 LoadMetadata(TitleInfo *title)
+{
+	TmdHeader header;
+	s32 fd = OpenMetadata(title->TitleId, &header);
+	if (fd < 0)
+		return fd;
+
+	TmdViewHeader *view = &title->View;
+	memset(view, 0, sizeof(TmdViewHeader));
+	view->Version = header.Version;
+	view->SystemVersion = header.SystemVersion;
+	view->TitleId = header.TitleId;
+	view->TitleType = header.TitleType;
+	view->GroupId = header.GroupId;
+	memcpy(view->Reserved, header.Reserved, sizeof(view->Reserved));
+	view->TitleVersion = header.TitleVersion;
+	view->NumberOfContents = header.NumberOfContents;
+	title->BootIndex = header.BootIndex;
+	title->HasMetadata = true;
+
+	const u32 contents = header.NumberOfContents;
+	title->ContentsCached = ContentPoolUsed + contents <= ES_MAX_CONTENTS &&
+	                        ReadContents(fd, &ContentPool[ContentPoolUsed], contents) == IPC_SUCCESS;
+	if (title->ContentsCached)
+	{
+		title->FirstContent = (u16)ContentPoolUsed;
+		ContentPoolUsed += contents;
+	}
+
+	OSCloseFD(fd);
+	return IPC_SUCCESS;
+}
+
+static void BuildTicketView(const Ticket *ticket, u32 index, TicketView *view)
+{
+	view->View = index;
+	memcpy(&view->TicketId, &ticket->TicketId, sizeof(TicketView) - sizeof(view->View));
+}
+
+static s32 ReadTickets(u64 titleId, TicketView *views, u32 count, u32 *ticketCount)
+{
+	snprintf(PathBuffer, sizeof(PathBuffer), "/ticket/%08x/%08x.tik", (u32)(titleId >> 32),
+	         (u32)titleId);
+	s32 fd = OSOpenFD(PathBuffer, Read);
+	if (fd < 0)
+		return fd;
+
+	s32 ret = OSSeekFD(fd, 0, SeekEnd);
+	if (ret < 0)
+		goto close_and_return;
+
+	const u32 tickets = (u32)ret / ES_TICKET_SIZE;
+	if (ticketCount != NULL)
+		*ticketCount = tickets;
+
+	if (count > tickets)
+		count = tickets;
+
+	ret = IPC_SUCCESS;
+	for (u32 i = 0; i < count && ret == IPC_SUCCESS; i++)
+	{
+		ret = OSSeekFD(fd, (s32)((i * ES_TICKET_SIZE) + ES_SIGNATURE_SIZE), SeekSet);
+		if (ret < 0)
+			break;
+
+		ret = ReadExact(fd, &TicketBuffer, sizeof(Ticket));
+		if (ret == IPC_SUCCESS)
+			BuildTicketView(&TicketBuffer, i, &views[i]);
+	}
+
+close_and_return:
+	OSCloseFD(fd);
+	return ret < 0 ? ret : IPC_SUCCESS;
+}
+
+static s32 LoadTickets(TitleInfo *title)
+{
+	u32 tickets = 0;
+	s32 ret = ReadTickets(title->TitleId, NULL, 0, &tickets);
+	if (ret != IPC_SUCCESS || tickets == 0)
+		return ret != IPC_SUCCESS ? ret : ES_NO_TICKET;
+
+	title->TicketCount = (u16)tickets;
+	title->TicketsCached =
+	    TicketPoolUsed + tickets <= ES_MAX_TICKETS &&
+	    ReadTickets(title->TitleId, &TicketPool[TicketPoolUsed], tickets, NULL) == IPC_SUCCESS;
+	if (title->TicketsCached)
+	{
+		title->FirstTicket = (u16)TicketPoolUsed;
+		TicketPoolUsed += tickets;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static TitleInfo *FindTitle(u64 titleId)
+{
+	for (u32 i = 0; i < TitleCount; i++)
+	{
+		if (Titles[i].TitleId == titleId)
+			return &Titles[i];
+	}
+
+	return NULL;
+}
+
+static void IndexTitle(u64 titleId, bool ticket)
+{
+	TitleInfo *title = FindTitle(titleId);
+	const bool isNew = title == NULL;
+
+	if (isNew)
+	{
+		if (TitleCount >= ES_MAX_TITLES)
+		{
+			printk("ES: too many titles, %08x-%08x is not indexed\n", (u32)(titleId >> 32),
+			       (u32)titleId);
+			return;
+		}
+
+		title = &Titles[TitleCount];
+		memset(title, 0, sizeof(TitleInfo));
+		title->TitleId = titleId;
+	}
+
+	s32 ret = ticket ? LoadTickets(title) : LoadMetadata(title);
+	if (ret == IPC_SUCCESS && isNew)
+		TitleCount++;
+}
+
+//titles are stored as <root>/<upper 32 bits>/<lower 32 bits>[suffix]
+static void IndexDirectory(const char *root, const char *suffix)
+{
+	const u32 suffixLength = strlen(suffix);
+	u32 upper, lower;
+
+	snprintf(PathBuffer, sizeof(PathBuffer), "%s", root);
+	s32 types = ReadDirectory(TypeNames, ES_MAX_TITLE_TYPES);
+	const char *typeName = TypeNames;
+	for (s32 i = 0; i < types; i++, typeName += strlen(typeName) + 1)
+	{
+		if (strlen(typeName) != 8 || !ParseTitleIdHalf(typeName, &upper))
+			continue;
+
+		snprintf(PathBuffer, sizeof(PathBuffer), "%s/%s", root, typeName);
+		s32 titles = ReadDirectory(TitleNames, ES_MAX_TITLES);
+		const char *titleName = TitleNames;
+		for (s32 j = 0; j < titles; j++, titleName += strlen(titleName) + 1)
+		{
+			if (strlen(titleName) != 8 + suffixLength ||
+			    strncmp(&titleName[8], suffix, suffixLength) != 0 ||
+			    !ParseTitleIdHalf(titleName, &lower))
+				continue;
+
+			IndexTitle(((u64)upper << 32) | lower, suffixLength != 0);
+		}
+	}
+}
+
+//parsing every tmd & ticket is slow, so we do it once and answer all queries from memory
+static void BuildTitleIndex(void)
+{
+	const u32 start = OSGetTimerValue();
+
+	TitleCount = 0;
+	ContentPoolUsed = 0;
+	TicketPoolUsed = 0;
+	IndexDirectory("/title", "");
+	IndexDirectory("/ticket", ".tik");
+	TitleIndexValid = true;
+
+	printk("ES: indexed %u titles in %u ticks\n", TitleCount, OSGetTimerValue() - start);
+}
+
+s32 InitializeTitleIndex(void)
+{
+	FileSystemFd = OpenFileSystem();
+	if (FileSystemFd < 0)
+		return FileSystemFd;
+
+	BuildTitleIndex();
+	return IPC_SUCCESS;
+}
+
+void InvalidateTitleIndex(void)
+{
+	TitleIndexValid = false;
+}
+
+static inline void EnsureTitleIndex(void)
+{
+	if (!TitleIndexValid)
+		BuildTitleIndex();
+}
+
+u32 GetTitleIds(u64 *titleIds, u32 maxTitles, bool owned)
+{
+	u32 count = 0;
+
+	EnsureTitleIndex();
+	for (u32 i = 0; i < TitleCount; i++)
+	{
+		if (owned ? Titles[i].TicketCount == 0 : !Titles[i].HasMetadata)
+			continue;
+
+		if (titleIds != NULL)
+		{
+			if (count >= maxTitles)
+				break;
+			titleIds[count] = Titles[i].TitleId;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+const TitleInfo *GetTitleInfo(u64 titleId)
+{
+	EnsureTitleIndex();
+	return FindTitle(titleId);
+}
+
+s32 GetTitleContents(const TitleInfo *title, u32 first, TmdViewContent *contents, u32 count)
+{
+	TmdHeader header;
+
+	if (!title->HasMetadata || first + count > title->View.NumberOfContents)
+		return ES_EINVAL;
+
+	if (title->ContentsCached)
+	{
+		memcpy(contents, &ContentPool[title->FirstContent + first], count * sizeof(TmdViewContent));
+		return IPC_SUCCESS;
+	}
+
+	s32 fd = OpenMetadata(title->TitleId, &header);
+	if (fd < 0)
+		return fd;
+
+	s32 ret = OSSeekFD(fd, (s32)(first * sizeof(TmdContent)), SeekCur);
+	if (ret >= 0)
+		ret = ReadContents(fd, contents, count);
+	OSCloseFD(fd);
+	return ret;
+}
+
+s32 GetTicketViews(const TitleInfo *title, TicketView *views, u32 count)
+{
+	if (count > title->TicketCount)
+		return ES_EINVAL;
+
+	if (title->TicketsCached)
+	{
+		memcpy(views, &TicketPool[title->FirstTicket], count * sizeof(TicketView));
+		return IPC_SUCCESS;
+	}
+
+	return ReadTickets(title->TitleId, views, count, NULL);
+}
+
+static s32 DeletePath(void)
+{
+	s32 ret = OSIoctlFD(FileSystemFd, FS_IOCTL_DELETE, PathBuffer, FS_MAX_PATH, NULL, 0);
+	InvalidateTitleIndex();
+	return ret;
+}
+
+s32 DeleteTitle(u64 titleId)
+{
+	const TitleInfo *title = GetTitleInfo(titleId);
+	if (title == NULL || !title->HasMetadata)
+		return ES_EINVAL;
+
+	snprintf(PathBuffer, sizeof(PathBuffer), "/title/%08x/%08x", (u32)(titleId >> 32),
+	         (u32)titleId);
+	return DeletePath();
+}
+
+s32 DeleteTicket(const TicketView *view)
+{
+	TicketView storedView;
+
+	const TitleInfo *title = GetTitleInfo(view->TitleId);
+	if (title == NULL || title->TicketCount == 0)
+		return ES_NO_TICKET;
+
+	//tickets are only removed by dropping the whole file, which we can't do if it holds others
+	if (title->TicketCount != 1)
+		return ES_EINVAL;
+
+	s32 ret = GetTicketViews(title, &storedView, 1);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (storedView.TicketId != view->TicketId)
+		return ES_NO_TICKET;
+
+	snprintf(PathBuffer, sizeof(PathBuffer), "/ticket/%08x/%08x.tik", (u32)(view->TitleId >> 32),
+	         (u32)view->TitleId);
+	return DeletePath();
+}
@@ -0,0 +1,48 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	titles - index of the titles & tickets installed on the nand
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __TITLES_H__
+#define __TITLES_H__
+
+#include <types.h>
+
+#include "es.h"
+
+#define ES_MAX_TITLES   0x60
+#define ES_MAX_CONTENTS 0x400
+#define ES_MAX_TICKETS  0x60
+
+typedef struct
+{
+	u64 TitleId;
+	bool HasMetadata;
+	u16 BootIndex;
+	TmdViewHeader View;
+	//contents & ticket views live in shared pools. Cached is false if the pool ran out
+	bool ContentsCached;
+	u16 FirstContent;
+	u16 TicketCount;
+	bool TicketsCached;
+	u16 FirstTicket;
+} TitleInfo;
+
+s32 InitializeTitleIndex(void);
+//drops the index after the nand changed underneath it. it is rebuilt on the next query
+void InvalidateTitleIndex(void);
+
+u32 GetTitleIds(u64 *titleIds, u32 maxTitles, bool owned);
+const TitleInfo *GetTitleInfo(u64 titleId);
+s32 GetTitleContents(const TitleInfo *title, u32 first, TmdViewContent *contents, u32 count);
+s32 GetTicketViews(const TitleInfo *title, TicketView *views, u32 count);
+
+s32 DeleteTitle(u64 titleId);
+s32 DeleteTicket(const TicketView *view);
+
+#endif
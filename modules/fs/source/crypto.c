@@ -0,0 +1,117 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	crypto - encryption & hmac of the nand filesystem clusters
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/keyring.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+
+#include "crypto.h"
+
+//the sha engine can't do more than 0x400 blocks in one go
+#define HMAC_MAX_CHUNK 0x10000
+
+static u8 HmacContext[0x60] ALIGNED(0x40);
+static u8 HmacSalt[HMAC_SALT_SIZE] ALIGNED(0x40);
+static u8 HmacOutput[FLASH_HMAC_SIZE] ALIGNED(0x20);
+static u8 AesIv[0x10] ALIGNED(0x20);
+static u8 CryptBuffer[FLASH_CLUSTER_SIZE] ALIGNED(0x40);
+
+s32 GenerateHmac(const void *data, u32 size, const void *salt, u8 *hmac)
+{
+	ShaContext *context = (ShaContext *)HmacContext;
+	const u8 *input = (const u8 *)data;
+
+	memcpy(HmacSalt, salt, HMAC_SALT_SIZE);
+	s32 ret = OSIOSCGenerateBlockMAC(context, input, 0, HmacSalt, HMAC_SALT_SIZE,
+	                                 KEYRING_CONST_NAND_HMAC, InitHMacState, HmacOutput);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	while (size > HMAC_MAX_CHUNK)
+	{
+		ret = OSIOSCGenerateBlockMAC(context, input, HMAC_MAX_CHUNK, NULL, 0,
+		                             KEYRING_CONST_NAND_HMAC, ContributeHMacState, HmacOutput);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		input += HMAC_MAX_CHUNK;
+		size -= HMAC_MAX_CHUNK;
+	}
+
+	ret = OSIOSCGenerateBlockMAC(context, input, size, NULL, 0, KEYRING_CONST_NAND_HMAC,
+	                             FinalizeHmacState, HmacOutput);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	memcpy(hmac, HmacOutput, FLASH_HMAC_SIZE);
+	return IPC_SUCCESS;
+}
+
+static void BuildClusterSalt(ClusterSalt *salt, const FstEntry *entry, u16 entryIndex,
+                             u16 chainIndex)
+{
+	memset(salt, 0, sizeof(ClusterSalt));
+	salt->UserId = entry->UserId;
+	memcpy(salt->Name, entry->Name, FS_MAX_NAME);
+	salt->ChainIndex = chainIndex;
+	salt->EntryIndex = entryIndex;
+	salt->Unknown = entry->Unknown;
+}
+
+s32 ReadDataCluster(const FstEntry *entry, u16 entryIndex, u16 chainIndex, u16 cluster,
+                    void *data)
+{
+	ClusterSalt salt;
+	u8 storedHmac[FLASH_HMAC_SIZE];
+	u8 hmac[FLASH_HMAC_SIZE];
+
+	s32 ret = ReadFlashClusters(cluster, 1, CryptBuffer, storedHmac);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	memset(AesIv, 0, sizeof(AesIv));
+	ret = OSIOSCDecrypt(KEYRING_CONST_NAND_KEY, AesIv, CryptBuffer, FLASH_CLUSTER_SIZE, data);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	BuildClusterSalt(&salt, entry, entryIndex, chainIndex);
+	ret = GenerateHmac(data, FLASH_CLUSTER_SIZE, &salt, hmac);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (memcmp(hmac, storedHmac, FLASH_HMAC_SIZE) != 0)
+	{
+		printk("FS: hmac mismatch in cluster 0x%04X\n", cluster);
+		return FS_ECORRUPT;
+	}
+
+	return IPC_SUCCESS;
+}
+
+s32 WriteDataCluster(const FstEntry *entry, u16 entryIndex, u16 chainIndex, u16 cluster,
+                     const void *data)
+{
+	ClusterSalt salt;
+	u8 hmac[FLASH_HMAC_SIZE];
+
+	BuildClusterSalt(&salt, entry, entryIndex, chainIndex);
+	s32 ret = GenerateHmac(data, FLASH_CLUSTER_SIZE, &salt, hmac);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	memset(AesIv, 0, sizeof(AesIv));
+	ret = OSIOSCEncrypt(KEYRING_CONST_NAND_KEY, AesIv, data, FLASH_CLUSTER_SIZE, CryptBuffer);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	return WriteFlashClusters(cluster, 1, CryptBuffer, hmac);
+}
@@ -0,0 +1,45 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	crypto - encryption & hmac of the nand filesystem clusters
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __CRYPTO_H__
+#define __CRYPTO_H__
+
+#include <types.h>
+
+#include "superblock.h"
+
+#define HMAC_SALT_SIZE 0x40
+
+typedef struct
+{
+	u32 UserId;
+	char Name[FS_MAX_NAME];
+	u32 ChainIndex;
+	u32 EntryIndex;
+	u32 Unknown;
+	u8 Padding[0x24];
+} ClusterSalt;
+CHECK_SIZE(ClusterSalt, HMAC_SALT_SIZE);
+CHECK_OFFSET(ClusterSalt, 0x00, UserId);
+CHECK_OFFSET(ClusterSalt, 0x04, Name);
+CHECK_OFFSET(ClusterSalt, 0x10, ChainIndex);
+CHECK_OFFSET(ClusterSalt, 0x14, EntryIndex);
+CHECK_OFFSET(ClusterSalt, 0x18, Unknown);
+
+s32 GenerateHmac(const void *data, u32 size, const void *salt, u8 *hmac);
+
+//data clusters are salted with the owner, name & position of the file they belong to.
+//entry is passed separately from entryIndex so callers can verify against an entry's old state
+s32 ReadDataCluster(const FstEntry *entry, u16 entryIndex, u16 chainIndex, u16 cluster,
+                    void *data);
+s32 WriteDataCluster(const FstEntry *entry, u16 entryIndex, u16 chainIndex, u16 cluster,
+                     const void *data);
+
+#endif
@@ -0,0 +1,291 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	file - file data access of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+
+#include "file.h"
+#include "crypto.h"
+
+#define CLUSTER_WRITE_TRIES 4
+
+typedef struct
+{
+	u16 Entry;
+	u16 ChainIndex;
+	u16 Cluster;
+	u16 PreviousCluster;
+	bool Dirty;
+} ClusterCacheInfo;
+
+static u8 ClusterData[FLASH_CLUSTER_SIZE] ALIGNED(0x40);
+static ClusterCacheInfo ClusterCache = {
+	.Entry = FST_NONE,
+	.ChainIndex = 0,
+	.Cluster = FST_NONE,
+	.PreviousCluster = FST_NONE,
+	.Dirty = false,
+};
+
+//a cluster that fails to program retires its block, and the data goes to a new cluster instead
+static s32 WriteNewCluster(const FstEntry *entry, u16 entryIndex, u16 chainIndex, u16 *newCluster)
+{
+	for (u32 tries = 0; tries < CLUSTER_WRITE_TRIES; tries++)
+	{
+		s32 ret = AllocateCluster(newCluster);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		ret = WriteDataCluster(entry, entryIndex, chainIndex, *newCluster, ClusterData);
+		if (ret != IPC_BADBLOCK)
+			return ret;
+
+		RetireClusterBlock(*newCluster);
+	}
+
+	return FS_EIO;
+}
+
+//clusters are never overwritten in place. a modified cluster is written to a freshly erased
+//one and swapped into the chain, so the superblock on the nand always points to intact data
+s32 FlushFileCache(void)
+{
+	u16 newCluster;
+	u16 *fat = FsSuperblock.Fat;
+
+	if (ClusterCache.Entry == FST_NONE || !ClusterCache.Dirty)
+		return IPC_SUCCESS;
+
+	FstEntry *entry = &FsSuperblock.Fst[ClusterCache.Entry];
+	s32 ret = WriteNewCluster(entry, ClusterCache.Entry, ClusterCache.ChainIndex, &newCluster);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	fat[newCluster] = FAT_IS_CLUSTER(ClusterCache.Cluster) ? fat[ClusterCache.Cluster] :
+	                                                         FAT_CHAIN_END;
+	if (FAT_IS_CLUSTER(ClusterCache.PreviousCluster))
+		fat[ClusterCache.PreviousCluster] = newCluster;
+	else
+		entry->Sub = newCluster;
+
+	if (FAT_IS_CLUSTER(ClusterCache.Cluster))
+		ReleaseCluster(ClusterCache.Cluster);
+
+	ClusterCache.Cluster = newCluster;
+	ClusterCache.Dirty = false;
+	return IPC_SUCCESS;
+}
+
+void InvalidateFileCache(u16 entry)
+{
+	if (ClusterCache.Entry != entry)
+		return;
+
+	ClusterCache.Entry = FST_NONE;
+	ClusterCache.Dirty = false;
+}
+
+//overwrite skips reading the cluster when the caller replaces everything in it that matters
+static s32 LoadCluster(u16 entryIndex, u16 chainIndex, bool overwrite)
+{
+	const FstEntry *entry = &FsSuperblock.Fst[entryIndex];
+	const u16 *fat = FsSuperblock.Fat;
+
+	if (ClusterCache.Entry == entryIndex && ClusterCache.ChainIndex == chainIndex)
+		return IPC_SUCCESS;
+
+	s32 ret = FlushFileCache();
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	//when moving forward through the same file, continue the walk from the cached cluster
+	u16 index = 0;
+	u16 previous = FST_NONE;
+	u16 cluster = entry->Sub;
+	if (ClusterCache.Entry == entryIndex && ClusterCache.ChainIndex < chainIndex &&
+	    FAT_IS_CLUSTER(ClusterCache.Cluster))
+	{
+		index = ClusterCache.ChainIndex;
+		previous = ClusterCache.PreviousCluster;
+		cluster = ClusterCache.Cluster;
+	}
+
+	for (; index < chainIndex; index++)
+	{
+		if (!FAT_IS_CLUSTER(cluster))
+			return FS_ECORRUPT;
+
+		previous = cluster;
+		cluster = fat[cluster];
+	}
+
+	ClusterCache.Entry = FST_NONE;
+	if (!FAT_IS_CLUSTER(cluster))
+		cluster = FST_NONE;
+
+	if (cluster != FST_NONE && !overwrite)
+	{
+		ret = ReadDataCluster(entry, entryIndex, chainIndex, cluster, ClusterData);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+	else
+		memset(ClusterData, 0, sizeof(ClusterData));
+
+	ClusterCache.Entry = entryIndex;
+	ClusterCache.ChainIndex = chainIndex;
+	ClusterCache.Cluster = cluster;
+	ClusterCache.PreviousCluster = previous;
+	ClusterCache.Dirty = false;
+	return IPC_SUCCESS;
+}
+
+s32 ReadFile(FsHandle *handle, void *data, u32 length)
+{
+	const FstEntry *entry = &FsSuperblock.Fst[handle->Entry];
+	u8 *output = (u8 *)data;
+	u32 read = 0;
+
+	if (handle->Position >= entry->Size)
+		return 0;
+
+	if (length > entry->Size - handle->Position)
+		length = entry->Size - handle->Position;
+
+	while (read < length)
+	{
+		const u32 offset = handle->Position % FLASH_CLUSTER_SIZE;
+		u32 chunk = FLASH_CLUSTER_SIZE - offset;
+		if (chunk > length - read)
+			chunk = length - read;
+
+		s32 ret = LoadCluster(handle->Entry, (u16)(handle->Position / FLASH_CLUSTER_SIZE), false);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		memcpy(&output[read], &ClusterData[offset], chunk);
+		read += chunk;
+		handle->Position += chunk;
+	}
+
+	return (s32)read;
+}
+
+s32 WriteFile(FsHandle *handle, const void *data, u32 length)
+{
+	FstEntry *entry = &FsSuperblock.Fst[handle->Entry];
+	const u8 *input = (const u8 *)data;
+	u32 written = 0;
+
+	while (written < length)
+	{
+		const u32 offset = handle->Position % FLASH_CLUSTER_SIZE;
+		u32 chunk = FLASH_CLUSTER_SIZE - offset;
+		if (chunk > length - written)
+			chunk = length - written;
+
+		//no need to read the old data if all of it is replaced or past the end of the file
+		const bool overwrite =
+		    offset == 0 && (chunk == FLASH_CLUSTER_SIZE || handle->Position + chunk >= entry->Size);
+		s32 ret = LoadCluster(handle->Entry, (u16)(handle->Position / FLASH_CLUSTER_SIZE),
+		                      overwrite);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		memcpy(&ClusterData[offset], &input[written], chunk);
+		ClusterCache.Dirty = true;
+		handle->Modified = true;
+
+		written += chunk;
+		handle->Position += chunk;
+		if (handle->Position > entry->Size)
+			entry->Size = handle->Position;
+	}
+
+	return (s32)written;
+}
+
+s32 SeekFile(FsHandle *handle, s32 where, s32 whence)
+{
+	const FstEntry *entry = &FsSuperblock.Fst[handle->Entry];
+	s32 position;
+
+	switch (whence)
+	{
+		case SeekSet:
+			position = where;
+			break;
+		case SeekCur:
+			position = (s32)handle->Position + where;
+			break;
+		case SeekEnd:
+			position = (s32)entry->Size + where;
+			break;
+		default:
+			return FS_EINVAL;
+	}
+
+	if (position < 0 || (u32)position > entry->Size)
+		return FS_EINVAL;
+
+	handle->Position = (u32)position;
+	return position;
+}
+
+void ReleaseFileClusters(u16 entryIndex)
+{
+	FstEntry *entry = &FsSuperblock.Fst[entryIndex];
+	u16 cluster = entry->Sub;
+
+	InvalidateFileCache(entryIndex);
+	for (u32 i = 0; i < FLASH_CLUSTER_COUNT && FAT_IS_CLUSTER(cluster); i++)
+	{
+		const u16 next = FsSuperblock.Fat[cluster];
+		ReleaseCluster(cluster);
+		cluster = next;
+	}
+
+	entry->Sub = FST_NONE;
+	entry->Size = 0;
+}
+
+s32 RekeyFileClusters(u16 entryIndex, const FstEntry *oldEntry)
+{
+	FstEntry *entry = &FsSuperblock.Fst[entryIndex];
+	u16 *fat = FsSuperblock.Fat;
+	u16 previous = FST_NONE;
+	u16 cluster = entry->Sub;
+	u16 newCluster;
+	s32 ret = IPC_SUCCESS;
+
+	InvalidateFileCache(entryIndex);
+	for (u16 chainIndex = 0; FAT_IS_CLUSTER(cluster); chainIndex++)
+	{
+		ret = ReadDataCluster(oldEntry, entryIndex, chainIndex, cluster, ClusterData);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		ret = WriteNewCluster(entry, entryIndex, chainIndex, &newCluster);
+		if (ret != IPC_SUCCESS)
+			return ret;
+
+		fat[newCluster] = fat[cluster];
+		if (previous == FST_NONE)
+			entry->Sub = newCluster;
+		else
+			fat[previous] = newCluster;
+
+		ReleaseCluster(cluster);
+		previous = newCluster;
+		cluster = fat[newCluster];
+	}
+
+	return IPC_SUCCESS;
+}
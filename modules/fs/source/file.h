@@ -0,0 +1,50 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	file - file data access of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __FILE_H__
+#define __FILE_H__
+
+#include <types.h>
+#include <ios/ipc.h>
+
+#include "superblock.h"
+
+typedef enum
+{
+	HandleUnused = 0,
+	HandleManager = 1,
+	HandleFile = 2,
+} FsHandleType;
+
+typedef struct
+{
+	FsHandleType Type;
+	u32 UserId;
+	u16 GroupId;
+	u16 Entry;
+	AccessMode Mode;
+	u32 Position;
+	bool Modified;
+} FsHandle;
+
+s32 ReadFile(FsHandle *handle, void *data, u32 length);
+s32 WriteFile(FsHandle *handle, const void *data, u32 length);
+s32 SeekFile(FsHandle *handle, s32 where, s32 whence);
+
+//the last used cluster is kept decrypted in memory & written back when another cluster is needed
+s32 FlushFileCache(void);
+void InvalidateFileCache(u16 entry);
+
+void ReleaseFileClusters(u16 entry);
+//rewrites a file's clusters after a change to the fields their hmac is salted with.
+//the cache has to be flushed before the entry is changed, as it is written with the current salt
+s32 RekeyFileClusters(u16 entry, const FstEntry *oldEntry);
+
+#endif
@@ -0,0 +1,150 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	flash - cluster level nand access of the filesystem
+
+	Copyright (C) 2026	DacoTaco
+	Copyright (C) 2008, 2009	Segher Boessenkool <segher@kernel.crashing.org>
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/syscalls.h>
+
+#include "flash.h"
+
+#define ECC_OFFSET      0x30
+#define ECC_SUBPAGE     0x200
+#define HMAC_PAGE       0x06
+#define HMAC_COPY_SPLIT 0x0C
+
+static u8 SpareBuffer[FLASH_SPARE_SIZE] ALIGNED(0x20);
+static u8 PageBuffer[FLASH_PAGE_SIZE] ALIGNED(0x40);
+
+static u8 Parity(u8 x)
+{
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+	return x & 1;
+}
+
+//the nand controller only checks the ecc on reads, so we have to calculate it when writing
+static void CalculateEcc(const u8 *data, u8 *ecc)
+{
+	u8 a[12][2];
+	u32 a0 = 0, a1 = 0;
+
+	memset(a, 0, sizeof(a));
+	for (u32 i = 0; i < ECC_SUBPAGE; i++)
+	{
+		for (u32 j = 0; j < 9; j++)
+			a[3 + j][(i >> j) & 1] ^= data[i];
+	}
+
+	u8 x = a[3][0] ^ a[3][1];
+	a[0][0] = x & 0x55;
+	a[0][1] = x & 0xAA;
+	a[1][0] = x & 0x33;
+	a[1][1] = x & 0xCC;
+	a[2][0] = x & 0x0F;
+	a[2][1] = x & 0xF0;
+
+	for (u32 j = 0; j < 12; j++)
+	{
+		a0 |= (u32)Parity(a[j][0]) << j;
+		a1 |= (u32)Parity(a[j][1]) << j;
+	}
+
+	ecc[0] = (u8)a0;
+	ecc[1] = (u8)(a0 >> 8);
+	ecc[2] = (u8)a1;
+	ecc[3] = (u8)(a1 >> 8);
+}
+
+s32 ReadFlashClusters(u16 cluster, u32 count, void *data, u8 *hmac)
+{
+	u32 page = cluster * FLASH_PAGES_PER_CLUSTER;
+	u32 pages = count * FLASH_PAGES_PER_CLUSTER;
+	u8 *pageData = (u8 *)data;
+	s32 ret = IPC_SUCCESS;
+
+	for (u32 i = 0; i < pages; i++, pageData += FLASH_PAGE_SIZE)
+	{
+		//the hmac sits in the spare data of the last 2 pages of the cluster
+		const u32 clusterPage = i % FLASH_PAGES_PER_CLUSTER;
+		const bool hmacPage = hmac != NULL && i >= pages - FLASH_PAGES_PER_CLUSTER &&
+		                      clusterPage >= HMAC_PAGE;
+
+		ret = OSReadFlashPage(page + i, pageData, hmacPage ? SpareBuffer : NULL);
+		if (ret == IPC_ECC_CRIT || ret == IPC_BADBLOCK)
+			return FS_EIO;
+		if (ret != IPC_SUCCESS && ret != IPC_ECC)
+			return ret;
+
+		if (hmacPage && clusterPage == HMAC_PAGE)
+			memcpy(hmac, &SpareBuffer[1], FLASH_HMAC_SIZE);
+	}
+
+	return IPC_SUCCESS;
+}
+
+s32 WriteFlashClusters(u16 cluster, u32 count, const void *data, const u8 *hmac)
+{
+	u32 page = cluster * FLASH_PAGES_PER_CLUSTER;
+	u32 pages = count * FLASH_PAGES_PER_CLUSTER;
+	const u8 *pageData = (const u8 *)data;
+
+	for (u32 i = 0; i < pages; i++, pageData += FLASH_PAGE_SIZE)
+	{
+		const u32 clusterPage = i % FLASH_PAGES_PER_CLUSTER;
+		memset(SpareBuffer, 0xFF, sizeof(SpareBuffer));
+
+		//page 6 holds the hmac and the first part of its copy, page 7 the rest of the copy
+		if (hmac != NULL && i >= pages - FLASH_PAGES_PER_CLUSTER)
+		{
+			if (clusterPage == HMAC_PAGE)
+			{
+				memcpy(&SpareBuffer[1], hmac, FLASH_HMAC_SIZE);
+				memcpy(&SpareBuffer[1 + FLASH_HMAC_SIZE], hmac, HMAC_COPY_SPLIT);
+			}
+			else if (clusterPage == HMAC_PAGE + 1)
+				memcpy(&SpareBuffer[1], &hmac[HMAC_COPY_SPLIT], FLASH_HMAC_SIZE - HMAC_COPY_SPLIT);
+		}
+
+		for (u32 j = 0; j < FLASH_PAGE_SIZE / ECC_SUBPAGE; j++)
+			CalculateEcc(&pageData[j * ECC_SUBPAGE], &SpareBuffer[ECC_OFFSET + (j * 4)]);
+
+		s32 ret = OSWriteFlashPage(page + i, pageData, SpareBuffer);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	return IPC_SUCCESS;
+}
+
+//the spare data is copied along as is, so the ecc & hmac of the cluster stay valid
+s32 CopyFlashCluster(u16 from, u16 to)
+{
+	for (u32 i = 0; i < FLASH_PAGES_PER_CLUSTER; i++)
+	{
+		s32 ret = OSReadFlashPage((from * FLASH_PAGES_PER_CLUSTER) + i, PageBuffer, SpareBuffer);
+		if (ret == IPC_ECC_CRIT || ret == IPC_BADBLOCK)
+			return FS_EIO;
+		if (ret != IPC_SUCCESS && ret != IPC_ECC)
+			return ret;
+
+		ret = OSWriteFlashPage((to * FLASH_PAGES_PER_CLUSTER) + i, PageBuffer, SpareBuffer);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	return IPC_SUCCESS;
+}
+
+s32 EraseFlashCluster(u16 cluster)
+{
+	return OSEraseFlashBlock(cluster / FLASH_CLUSTERS_PER_BLOCK);
+}
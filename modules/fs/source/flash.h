@@ -0,0 +1,31 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	flash - cluster level nand access of the filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include <types.h>
+
+#define FLASH_PAGE_SIZE          0x800
+#define FLASH_SPARE_SIZE         0x40
+#define FLASH_PAGES_PER_BLOCK    0x40
+#define FLASH_PAGES_PER_CLUSTER  0x08
+#define FLASH_CLUSTER_SIZE       (FLASH_PAGE_SIZE * FLASH_PAGES_PER_CLUSTER)
+#define FLASH_CLUSTERS_PER_BLOCK (FLASH_PAGES_PER_BLOCK / FLASH_PAGES_PER_CLUSTER)
+#define FLASH_CLUSTER_COUNT      0x8000
+#define FLASH_HMAC_SIZE          0x14
+
+//reads/writes a run of clusters. the hmac lives in the spare data of the last cluster of the run
+s32 ReadFlashClusters(u16 cluster, u32 count, void *data, u8 *hmac);
+s32 WriteFlashClusters(u16 cluster, u32 count, const void *data, const u8 *hmac);
+s32 CopyFlashCluster(u16 from, u16 to);
+s32 EraseFlashCluster(u16 cluster);
+
+#endif
@@ -6,15 +6,610 @@
 # see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/ipc.h>
 #include <ios/syscalls.h>
 #include "ios/printk.h"
 
 #include "fs.h"
+#include "fst.h"
+#include "file.h"
+#include "superblock.h"
+
+static FsHandle FsHandles[FS_MAX_HANDLES];
+static s32 CommitTimerId = -1;
+static bool CommitTimerArmed = false;
+static u32 CommitTimerMessage;
+
+//writing a superblock means erasing 2 blocks & writing 256KB, so rather than doing it for every
+//change we arm a timer on the first change and commit everything that happened until it fires.
+//the kernel drops the timer's message when our queue is full, so the timer keeps repeating
+//until we get to see one and stop it
+static void ScheduleCommit(void)
+{
+	MarkSuperblockDirty();
+	if (CommitTimerArmed)
+		return;
+
+	if (OSRestartTimer(CommitTimerId, FS_COMMIT_DELAY, FS_COMMIT_DELAY) == IPC_SUCCESS)
+		CommitTimerArmed = true;
+}
+
+static s32 SyncFileSystem(void)
+{
+	if (CommitTimerArmed)
+	{
+		OSStopTimer(CommitTimerId);
+		CommitTimerArmed = false;
+	}
+
+	s32 ret = FlushFileCache();
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (!IsSuperblockDirty())
+		return IPC_SUCCESS;
+
+	return CommitSuperblock();
+}
+
+static bool HasOpenWriters(void)
+{
+	for (u32 i = 0; i < FS_MAX_HANDLES; i++)
+	{
+		if (FsHandles[i].Type == HandleFile && (FsHandles[i].Mode & Write) != 0)
+			return true;
+	}
+
+	return false;
+}
+
+static bool HasPermission(const FstEntry *entry, u32 userId, u16 groupId, u32 mode)
+{
+	u8 permissions;
+
+	if (userId == 0)
+		return true;
+
+	if (entry->UserId == userId)
+		permissions = FST_PERMISSIONS_OWNER(entry->Mode);
+	else if (entry->GroupId == groupId)
+		permissions = FST_PERMISSIONS_GROUP(entry->Mode);
+	else
+		permissions = FST_PERMISSIONS_OTHER(entry->Mode);
+
+	return (permissions & mode) == mode;
+}
+
+static inline u8 BuildMode(u8 type, const FsAttributes *attributes)
+{
+	return (u8)(type | ((attributes->OwnerPermissions & 0x03) << 6) |
+	            ((attributes->GroupPermissions & 0x03) << 4) |
+	            ((attributes->OtherPermissions & 0x03) << 2));
+}
+
+static bool IsInTree(u16 index, u16 root)
+{
+	for (u32 depth = 0; index != FST_NONE && depth <= FS_MAX_DEPTH; depth++)
+	{
+		if (index == root)
+			return true;
+
+		index = GetFstParent(index);
+	}
+
+	return false;
+}
+
+static bool IsTreeOpen(u16 root)
+{
+	for (u32 i = 0; i < FS_MAX_HANDLES; i++)
+	{
+		if (FsHandles[i].Type == HandleFile && IsInTree(FsHandles[i].Entry, root))
+			return true;
+	}
+
+	return false;
+}
+
+static s32 GetStats(FsStats *stats)
+{
+	memset(stats, 0, sizeof(FsStats));
+	stats->ClusterSize = FLASH_CLUSTER_SIZE;
+
+	for (u32 i = 0; i < FLASH_CLUSTER_COUNT; i++)
+	{
+		switch (FsSuperblock.Fat[i])
+		{
+			case FAT_FREE:
+				stats->FreeClusters++;
+				break;
+			case FAT_BAD:
+				stats->BadClusters++;
+				break;
+			case FAT_RESERVED:
+				stats->ReservedClusters++;
+				break;
+			default:
+				stats->UsedClusters++;
+				break;
+		}
+	}
+
+	for (u16 i = 0; i < FST_ENTRY_COUNT; i++)
+	{
+		if (FST_ENTRY_TYPE(i) == 0)
+			stats->FreeInodes++;
+		else
+			stats->UsedInodes++;
+	}
+
+	return IPC_SUCCESS;
+}
+
+static s32 CreateEntry(const FsHandle *handle, const FsAttributes *attributes, u8 type)
+{
+	char name[FS_MAX_NAME];
+	u16 parent;
+
+	s32 ret = ResolvePath(attributes->Path, &parent, name);
+	if (ret >= 0)
+		return FS_EEXIST;
+
+	if (ret != FS_ENOENT || parent == FST_NONE)
+		return ret;
+
+	if (!HasPermission(&FsSuperblock.Fst[parent], handle->UserId, handle->GroupId, Write))
+		return FS_EACCESS;
+
+	ret = CreateFstEntry(parent, name, BuildMode(type, attributes), attributes->Attributes,
+	                     handle->UserId, handle->GroupId);
+	if (ret < 0)
+		return ret;
+
+	ScheduleCommit();
+	return IPC_SUCCESS;
+}
+
+static s32 SetAttributes(const FsHandle *handle, const FsAttributes *attributes)
+{
+	s32 ret = ResolvePath(attributes->Path, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	const u16 index = (u16)ret;
+	FstEntry *entry = &FsSuperblock.Fst[index];
+
+	//only root can hand an entry over to someone else, the owner can only change the rest
+	if (handle->UserId != 0 &&
+	    (handle->UserId != entry->UserId || attributes->OwnerId != entry->UserId))
+		return FS_EACCESS;
+
+	ret = FlushFileCache();
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	const FstEntry oldEntry = *entry;
+	entry->UserId = attributes->OwnerId;
+	entry->GroupId = attributes->GroupId;
+	entry->Mode = BuildMode(entry->Mode & FST_TYPE_MASK, attributes);
+	entry->Attributes = attributes->Attributes;
+
+	if ((entry->Mode & FST_TYPE_MASK) == FST_TYPE_FILE && oldEntry.UserId != entry->UserId)
+	{
+		ret = RekeyFileClusters(index, &oldEntry);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	ScheduleCommit();
+	return IPC_SUCCESS;
+}
+
+static s32 GetAttributes(const char *path, FsAttributes *attributes)
+{
+	s32 ret = ResolvePath(path, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	const FstEntry *entry = &FsSuperblock.Fst[ret];
+	memset(attributes, 0, sizeof(FsAttributes));
+	attributes->OwnerId = entry->UserId;
+	attributes->GroupId = entry->GroupId;
+	strncpy(attributes->Path, path, FS_MAX_PATH - 1);
+	attributes->OwnerPermissions = FST_PERMISSIONS_OWNER(entry->Mode);
+	attributes->GroupPermissions = FST_PERMISSIONS_GROUP(entry->Mode);
+	attributes->OtherPermissions = FST_PERMISSIONS_OTHER(entry->Mode);
+	attributes->Attributes = entry->Attributes;
+	return IPC_SUCCESS;
+}
+
+static void DeleteTree(u16 root)
+{
+	//delete the deepest first child until the root itself is a leaf
+	while (1)
+	{
+		u16 current = root;
+		while (FST_ENTRY_TYPE(current) == FST_TYPE_DIRECTORY &&
+		       FsSuperblock.Fst[current].Sub < FST_ENTRY_COUNT)
+			current = FsSuperblock.Fst[current].Sub;
+
+		if (FST_ENTRY_TYPE(current) == FST_TYPE_FILE)
+			ReleaseFileClusters(current);
+
+		DeleteFstEntry(current);
+		if (current == root)
+			break;
+	}
+}
+
+static s32 DeleteEntry(const FsHandle *handle, const char *path)
+{
+	u16 parent;
+	s32 ret = ResolvePath(path, &parent, NULL);
+	if (ret < 0)
+		return ret;
+
+	if (ret == FST_ROOT_ENTRY ||
+	    !HasPermission(&FsSuperblock.Fst[parent], handle->UserId, handle->GroupId, Write))
+		return FS_EACCESS;
+
+	if (IsTreeOpen((u16)ret))
+		return FS_EBUSY;
+
+	DeleteTree((u16)ret);
+	ScheduleCommit();
+	return IPC_SUCCESS;
+}
+
+//wipes everything below the root. blocks that went bad stay retired in the fat
+static s32 FormatFileSystem(const FsHandle *handle)
+{
+	if (handle->UserId != 0)
+		return FS_EACCESS;
+
+	if (IsTreeOpen(FST_ROOT_ENTRY))
+		return FS_EBUSY;
+
+	while (FsSuperblock.Fst[FST_ROOT_ENTRY].Sub < FST_ENTRY_COUNT)
+		DeleteTree(FsSuperblock.Fst[FST_ROOT_ENTRY].Sub);
+
+	MarkSuperblockDirty();
+	return SyncFileSystem();
+}
+
+static s32 RenameEntry(const FsHandle *handle, const FsRename *rename)
+{
+	char name[FS_MAX_NAME];
+	u16 oldParent, newParent;
+
+	s32 ret = ResolvePath(rename->OldPath, &oldParent, NULL);
+	if (ret < 0)
+		return ret;
+
+	const u16 source = (u16)ret;
+	if (source == FST_ROOT_ENTRY)
+		return FS_EINVAL;
+
+	s32 target = ResolvePath(rename->NewPath, &newParent, name);
+	if (target < 0 && (target != FS_ENOENT || newParent == FST_NONE))
+		return target;
+
+	if (!HasPermission(&FsSuperblock.Fst[oldParent], handle->UserId, handle->GroupId, Write) ||
+	    !HasPermission(&FsSuperblock.Fst[newParent], handle->UserId, handle->GroupId, Write))
+		return FS_EACCESS;
+
+	//a directory can't be moved into itself
+	if (IsInTree(newParent, source))
+		return FS_EINVAL;
+
+	if (target == source)
+		return IPC_SUCCESS;
+
+	//only files can replace an existing entry
+	if (target >= 0)
+	{
+		if (FST_ENTRY_TYPE(source) != FST_TYPE_FILE || FST_ENTRY_TYPE(target) != FST_TYPE_FILE)
+			return FS_EEXIST;
+
+		if (IsTreeOpen((u16)target))
+			return FS_EBUSY;
+
+		DeleteTree((u16)target);
+	}
+
+	ret = FlushFileCache();
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	const FstEntry oldEntry = FsSuperblock.Fst[source];
+	MoveFstEntry(source, newParent, name);
+
+	if (FST_ENTRY_TYPE(source) == FST_TYPE_FILE &&
+	    memcmp(oldEntry.Name, name, FS_MAX_NAME) != 0)
+	{
+		ret = RekeyFileClusters(source, &oldEntry);
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+
+	ScheduleCommit();
+	return IPC_SUCCESS;
+}
+
+static s32 ReadDirectory(const FsHandle *handle, IoctlvMessage *ioctlv)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	const IoctlvMessageData *countVector;
+	char *names = NULL;
+	u32 maxEntries = 0;
+
+	//without a name buffer only the amount of entries is returned
+	if (ioctlv->InputArgc == 1 && ioctlv->IoArgc == 1)
+		countVector = &vector[1];
+	else if (ioctlv->InputArgc == 2 && ioctlv->IoArgc == 2)
+	{
+		if (vector[1].Length < sizeof(u32) || vector[1].Data == NULL)
+			return FS_EINVAL;
+
+		//divide rather than multiply, so a huge maxEntries can't wrap around the size check
+		maxEntries = *(u32 *)vector[1].Data;
+		names = (char *)vector[2].Data;
+		if (names == NULL || vector[2].Length / (FS_MAX_NAME + 1) < maxEntries)
+			return FS_EINVAL;
+
+		countVector = &vector[3];
+	}
+	else
+		return FS_EINVAL;
+
+	if (countVector->Length < sizeof(u32) || countVector->Data == NULL)
+		return FS_EINVAL;
+
+	s32 ret = ResolvePath((const char *)vector[0].Data, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	const FstEntry *directory = &FsSuperblock.Fst[ret];
+	if ((directory->Mode & FST_TYPE_MASK) != FST_TYPE_DIRECTORY)
+		return FS_EINVAL;
+
+	if (!HasPermission(directory, handle->UserId, handle->GroupId, Read))
+		return FS_EACCESS;
+
+	//a corrupt fst could link the siblings into a loop, so never walk more than all entries
+	u32 entries = 0;
+	u16 child = directory->Sub;
+	for (u32 steps = 0; child < FST_ENTRY_COUNT && steps < FST_ENTRY_COUNT;
+	     steps++, child = FsSuperblock.Fst[child].Sibling)
+	{
+		if (names != NULL)
+		{
+			if (entries >= maxEntries)
+				break;
+
+			const u32 length = strnlen(FsSuperblock.Fst[child].Name, FS_MAX_NAME);
+			memcpy(names, FsSuperblock.Fst[child].Name, length);
+			names[length] = '\0';
+			names += length + 1;
+		}
+		entries++;
+	}
+
+	*(u32 *)countVector->Data = entries;
+	return IPC_SUCCESS;
+}
+
+static s32 GetUsage(IoctlvMessage *ioctlv)
+{
+	IoctlvMessageData *vector = ioctlv->MessageData;
+	u32 clusters = 0;
+	u32 inodes = 0;
+
+	if (ioctlv->InputArgc != 1 || ioctlv->IoArgc != 2 || vector[1].Data == NULL ||
+	    vector[1].Length < sizeof(u32) || vector[2].Data == NULL || vector[2].Length < sizeof(u32))
+		return FS_EINVAL;
+
+	s32 ret = ResolvePath((const char *)vector[0].Data, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	const u16 root = (u16)ret;
+	const FstEntry *fst = FsSuperblock.Fst;
+	u16 current = root;
+	for (u32 visited = 0; visited < FST_ENTRY_COUNT; visited++)
+	{
+		inodes++;
+		if ((fst[current].Mode & FST_TYPE_MASK) == FST_TYPE_FILE)
+			clusters += (fst[current].Size + FLASH_CLUSTER_SIZE - 1) / FLASH_CLUSTER_SIZE;
+
+		if ((fst[current].Mode & FST_TYPE_MASK) == FST_TYPE_DIRECTORY &&
+		    fst[current].Sub < FST_ENTRY_COUNT)
+		{
+			current = fst[current].Sub;
+			continue;
+		}
+
+		while (current != root && fst[current].Sibling >= FST_ENTRY_COUNT)
+			current = GetFstParent(current);
+
+		if (current == root)
+			break;
+
+		current = fst[current].Sibling;
+	}
+
+	*(u32 *)vector[1].Data = clusters;
+	*(u32 *)vector[2].Data = inodes;
+	return IPC_SUCCESS;
+}
+
+static s32 HandleOpen(const IpcRequest *request)
+{
+	const OpenMessage *open = &request->Message.Open;
+	FsHandleType type = HandleManager;
+	u16 entry = FST_NONE;
+
+	if (strncmp(open->Filepath, FS_DEVICE_NAME, FS_DEVICE_NAME_SIZE) != 0)
+	{
+		//other devices are served by their own resource managers
+		if (strncmp(open->Filepath, FS_DEVICE_PREFIX, sizeof(FS_DEVICE_PREFIX) - 1) == 0)
+			return IPC_ENOENT;
+
+		s32 ret = ResolvePath(open->Filepath, NULL, NULL);
+		if (ret < 0)
+			return ret;
+
+		entry = (u16)ret;
+		if (FST_ENTRY_TYPE(entry) != FST_TYPE_FILE)
+			return FS_EACCESS;
+
+		if (!HasPermission(&FsSuperblock.Fst[entry], open->UID, open->GID, open->Mode & ReadWrite))
+			return FS_EACCESS;
+
+		type = HandleFile;
+	}
+
+	for (s32 fd = 0; fd < FS_MAX_HANDLES; fd++)
+	{
+		FsHandle *handle = &FsHandles[fd];
+		if (handle->Type != HandleUnused)
+			continue;
+
+		memset(handle, 0, sizeof(FsHandle));
+		handle->Type = type;
+		handle->UserId = open->UID;
+		handle->GroupId = open->GID;
+		handle->Entry = entry;
+		handle->Mode = open->Mode;
+		return fd;
+	}
+
+	return FS_EFDEXHAUSTED;
+}
+
+static s32 HandleIoctl(FsHandle *handle, IoctlMessage *ioctl)
+{
+	if (handle->Type == HandleFile)
+	{
+		if (ioctl->Ioctl != FS_IOCTL_GETFILESTATS || ioctl->IoLength < sizeof(FsFileStats) ||
+		    ioctl->IoBuffer == NULL)
+			return FS_EINVAL;
+
+		FsFileStats *stats = (FsFileStats *)ioctl->IoBuffer;
+		stats->Size = FsSuperblock.Fst[handle->Entry].Size;
+		stats->Position = handle->Position;
+		return IPC_SUCCESS;
+	}
+
+	switch (ioctl->Ioctl)
+	{
+		case FS_IOCTL_GETSTATS:
+			if (ioctl->IoLength < sizeof(FsStats) || ioctl->IoBuffer == NULL)
+				return FS_EINVAL;
+			return GetStats((FsStats *)ioctl->IoBuffer);
+		case FS_IOCTL_CREATEDIR:
+		case FS_IOCTL_CREATEFILE:
+			if (ioctl->InputLength < sizeof(FsAttributes) || ioctl->InputBuffer == NULL)
+				return FS_EINVAL;
+			return CreateEntry(handle, (const FsAttributes *)ioctl->InputBuffer,
+			                   ioctl->Ioctl == FS_IOCTL_CREATEDIR ? FST_TYPE_DIRECTORY :
+			                                                        FST_TYPE_FILE);
+		case FS_IOCTL_SETATTR:
+			if (ioctl->InputLength < sizeof(FsAttributes) || ioctl->InputBuffer == NULL)
+				return FS_EINVAL;
+			return SetAttributes(handle, (const FsAttributes *)ioctl->InputBuffer);
+		case FS_IOCTL_GETATTR:
+			if (ioctl->InputLength < FS_MAX_PATH || ioctl->InputBuffer == NULL ||
+			    ioctl->IoLength < sizeof(FsAttributes) || ioctl->IoBuffer == NULL)
+				return FS_EINVAL;
+			return GetAttributes((const char *)ioctl->InputBuffer,
+			                     (FsAttributes *)ioctl->IoBuffer);
+		case FS_IOCTL_DELETE:
+			if (ioctl->InputLength < FS_MAX_PATH || ioctl->InputBuffer == NULL)
+				return FS_EINVAL;
+			return DeleteEntry(handle, (const char *)ioctl->InputBuffer);
+		case FS_IOCTL_RENAME:
+			if (ioctl->InputLength < sizeof(FsRename) || ioctl->InputBuffer == NULL)
+				return FS_EINVAL;
+			return RenameEntry(handle, (const FsRename *)ioctl->InputBuffer);
+		//acts as the flush of all pending changes
+		case FS_IOCTL_SHUTDOWN:
+			return SyncFileSystem();
+		case FS_IOCTL_FORMAT:
+			return FormatFileSystem(handle);
+		default:
+			return FS_EINVAL;
+	}
+}
+
+static s32 HandleIoctlv(FsHandle *handle, IoctlvMessage *ioctlv)
+{
+	if (handle->Type != HandleManager || ioctlv->InputArgc == 0 ||
+	    ioctlv->MessageData[0].Length < FS_MAX_PATH || ioctlv->MessageData[0].Data == NULL)
+		return FS_EINVAL;
+
+	switch (ioctlv->Ioctl)
+	{
+		case FS_IOCTLV_READDIR:
+			return ReadDirectory(handle, ioctlv);
+		case FS_IOCTLV_GETUSAGE:
+			return GetUsage(ioctlv);
+		default:
+			return FS_EINVAL;
+	}
+}
+
+static s32 HandleRequest(IpcRequest *request)
+{
+	if (request->Command == IOS_OPEN)
+		return HandleOpen(request);
+
+	if (request->FileDescriptor < 0 || request->FileDescriptor >= FS_MAX_HANDLES ||
+	    FsHandles[request->FileDescriptor].Type == HandleUnused)
+		return FS_EINVAL;
+
+	FsHandle *handle = &FsHandles[request->FileDescriptor];
+	s32 ret = IPC_SUCCESS;
+	switch (request->Command)
+	{
+		case IOS_CLOSE:
+			//the last writer going away is a good moment to get everything onto the nand
+			handle->Type = HandleUnused;
+			if (handle->Modified && !HasOpenWriters())
+				ret = SyncFileSystem();
+			return ret;
+		case IOS_READ:
+			if (handle->Type != HandleFile || (handle->Mode & Read) == 0)
+				return FS_EACCESS;
+			return ReadFile(handle, request->Message.Read.MessageData,
+			                request->Message.Read.Length);
+		case IOS_WRITE:
+			if (handle->Type != HandleFile || (handle->Mode & Write) == 0)
+				return FS_EACCESS;
+			ret = WriteFile(handle, request->Message.Write.MessageData,
+			                request->Message.Write.Length);
+			if (ret > 0)
+				ScheduleCommit();
+			return ret;
+		case IOS_SEEK:
+			if (handle->Type != HandleFile)
+				return FS_EINVAL;
+			return SeekFile(handle, request->Message.Seek.Where, request->Message.Seek.Whence);
+		case IOS_IOCTL:
+			return HandleIoctl(handle, &request->Message.Ioctl);
+		case IOS_IOCTLV:
+			return HandleIoctlv(handle, &request->Message.Ioctlv);
+		default:
+			return IPC_EINVAL;
+	}
+}
 
 int main(void)
 {
 	u32 messageQueueMessages[8] ALIGNED(0x10);
-	u32 *message;
+	IpcMessage *message;
 	printk("$IOSVersion:  FFSP: %s %s 64M $", __DATE__, __TIME__);
 	s32 messageQueueId = OSCreateMessageQueue((void **)&messageQueueMessages, 8);
 	if (messageQueueId < 0)
@@ -23,11 +618,51 @@ int main(void)
 		return -408;
 	}
 
+	s32 ret = MountSuperblock();
+	if (ret < 0)
+	{
+		printk("failed to mount nand filesystem! %d\n", ret);
+		return ret;
+	}
+
+	BuildFstIndex();
+	memset(FsHandles, 0, sizeof(FsHandles));
+
+	//created stopped, it gets armed by the first change after a commit
+	CommitTimerId = OSCreateTimer(0, 0, messageQueueId, &CommitTimerMessage);
+	if (CommitTimerId < 0)
+	{
+		printk("failed to create commit timer! %d\n", CommitTimerId);
+		return CommitTimerId;
+	}
+
+	//all paths that aren't claimed by another resource manager end up in the filesystem
+	ret = OSRegisterResourceManager(FS_DEVICE_NAME, messageQueueId);
+	if (ret >= 0)
+		ret = OSRegisterResourceManager(FS_ROOT_PATH, messageQueueId);
+	if (ret < 0)
+	{
+		printk("failed to register resource manager! %d\n", ret);
+		return ret;
+	}
+
 	while (1)
 	{
-		s32 ret = OSReceiveMessage(messageQueueId, &message, 0);
+		ret = OSReceiveMessage(messageQueueId, &message, 0);
 		if (ret < 0)
 			break;
+
+		if ((void *)message == &CommitTimerMessage)
+		{
+			CommitTimerArmed = false;
+			OSStopTimer(CommitTimerId);
+			ret = SyncFileSystem();
+			if (ret != IPC_SUCCESS)
+				printk("FS: failed to commit superblock: %d\n", ret);
+			continue;
+		}
+
+		OSResourceReply(message, HandleRequest(&message->Request));
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -9,7 +9,91 @@
 #ifndef __FS_H__
 #define __FS_H__
 
+#include <types.h>
+
 #define FS_DEVICE_NAME      "/dev/fs"
 #define FS_DEVICE_NAME_SIZE sizeof(FS_DEVICE_NAME)
+#define FS_ROOT_PATH        "/"
+#define FS_DEVICE_PREFIX    "/dev/"
+
+#define FS_MAX_PATH    0x40
+#define FS_MAX_NAME    0x0C
+#define FS_MAX_DEPTH   0x08
+#define FS_MAX_HANDLES 0x20
+
+//metadata changes are collected in memory & committed in one superblock after this delay (us)
+#ifndef FS_COMMIT_DELAY
+#define FS_COMMIT_DELAY 2000000
+#endif
+
+#define FS_IOCTL_FORMAT       0x01
+#define FS_IOCTL_GETSTATS     0x02
+#define FS_IOCTL_CREATEDIR    0x03
+#define FS_IOCTLV_READDIR     0x04
+#define FS_IOCTL_SETATTR      0x05
+#define FS_IOCTL_GETATTR      0x06
+#define FS_IOCTL_DELETE       0x07
+#define FS_IOCTL_RENAME       0x08
+#define FS_IOCTL_CREATEFILE   0x09
+#define FS_IOCTL_GETFILESTATS 0x0B
+#define FS_IOCTLV_GETUSAGE    0x0C
+#define FS_IOCTL_SHUTDOWN     0x0D
+
+typedef struct
+{
+	u32 OwnerId;
+	u16 GroupId;
+	char Path[FS_MAX_PATH];
+	u8 OwnerPermissions;
+	u8 GroupPermissions;
+	u8 OtherPermissions;
+	u8 Attributes;
+	u8 Padding[2];
+} FsAttributes;
+CHECK_SIZE(FsAttributes, 0x4C);
+CHECK_OFFSET(FsAttributes, 0x00, OwnerId);
+CHECK_OFFSET(FsAttributes, 0x04, GroupId);
+CHECK_OFFSET(FsAttributes, 0x06, Path);
+CHECK_OFFSET(FsAttributes, 0x46, OwnerPermissions);
+CHECK_OFFSET(FsAttributes, 0x47, GroupPermissions);
+CHECK_OFFSET(FsAttributes, 0x48, OtherPermissions);
+CHECK_OFFSET(FsAttributes, 0x49, Attributes);
+
+typedef struct
+{
+	char OldPath[FS_MAX_PATH];
+	char NewPath[FS_MAX_PATH];
+} FsRename;
+CHECK_SIZE(FsRename, 0x80);
+CHECK_OFFSET(FsRename, 0x00, OldPath);
+CHECK_OFFSET(FsRename, 0x40, NewPath);
+
+typedef struct
+{
+	u32 ClusterSize;
+	u32 FreeClusters;
+	u32 UsedClusters;
+	u32 BadClusters;
+	u32 ReservedClusters;
+	u32 FreeInodes;
+	u32 UsedInodes;
+} FsStats;
+CHECK_SIZE(FsStats, 0x1C);
+CHECK_OFFSET(FsStats, 0x00, ClusterSize);
+CHECK_OFFSET(FsStats, 0x04, FreeClusters);
+CHECK_OFFSET(FsStats, 0x08, UsedClusters);
+CHECK_OFFSET(FsStats, 0x0C, BadClusters);
+CHECK_OFFSET(FsStats, 0x10, ReservedClusters);
+CHECK_OFFSET(FsStats, 0x14, FreeInodes);
+CHECK_OFFSET(FsStats, 0x18, UsedInodes);
+
+typedef struct
+{
+	u32 Size;
+	u32 Position;
+} FsFileStats;
+CHECK_SIZE(FsFileStats, 0x08);
+CHECK_OFFSET(FsFileStats, 0x00, Size);
+CHECK_OFFSET(FsFileStats, 0x04, Position);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,243 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	fst - path lookup & directory tree of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+
+#include "fst.h"
+
+#define FST_HASH_BUCKETS 0x400
+
+//the fst on the nand only links parents to children, so looking up a path means walking
+//every sibling list along the way. we keep a hash of (parent, name) -> entry next to it,
+//together with the parent of every entry, so a lookup only costs one probe per path component
+static u16 FstHashHeads[FST_HASH_BUCKETS];
+static u16 FstHashNext[FST_ENTRY_COUNT];
+static u16 FstParents[FST_ENTRY_COUNT];
+static u16 FstFreeHint = 0;
+
+static u32 HashName(u16 parent, const char name[FS_MAX_NAME])
+{
+	//fnv-1a
+	u32 hash = 0x811C9DC5 ^ parent;
+	for (u32 i = 0; i < FS_MAX_NAME && name[i] != '\0'; i++)
+	{
+		hash ^= (u8)name[i];
+		hash *= 0x01000193;
+	}
+
+	return hash & (FST_HASH_BUCKETS - 1);
+}
+
+static void LinkHash(u16 index)
+{
+	const u32 bucket = HashName(FstParents[index], FsSuperblock.Fst[index].Name);
+	FstHashNext[index] = FstHashHeads[bucket];
+	FstHashHeads[bucket] = index;
+}
+
+static void UnlinkHash(u16 index)
+{
+	const u32 bucket = HashName(FstParents[index], FsSuperblock.Fst[index].Name);
+	u16 *link = &FstHashHeads[bucket];
+
+	while (*link != FST_NONE)
+	{
+		if (*link == index)
+		{
+			*link = FstHashNext[index];
+			break;
+		}
+
+		link = &FstHashNext[*link];
+	}
+
+	FstHashNext[index] = FST_NONE;
+}
+
+static void LinkChild(u16 parent, u16 index)
+{
+	FsSuperblock.Fst[index].Sibling = FsSuperblock.Fst[parent].Sub;
+	FsSuperblock.Fst[parent].Sub = index;
+	FstParents[index] = parent;
+}
+
+static void UnlinkChild(u16 index)
+{
+	const u16 parent = FstParents[index];
+	FstEntry *fst = FsSuperblock.Fst;
+
+	if (fst[parent].Sub == index)
+		fst[parent].Sub = fst[index].Sibling;
+	else
+	{
+		u16 previous = fst[parent].Sub;
+		while (previous < FST_ENTRY_COUNT && fst[previous].Sibling != index)
+			previous = fst[previous].Sibling;
+
+		if (previous < FST_ENTRY_COUNT)
+			fst[previous].Sibling = fst[index].Sibling;
+	}
+
+	fst[index].Sibling = FST_NONE;
+}
+
+static u16 FindChild(u16 parent, const char name[FS_MAX_NAME])
+{
+	u16 index = FstHashHeads[HashName(parent, name)];
+	while (index != FST_NONE)
+	{
+		if (FstParents[index] == parent && FST_ENTRY_TYPE(index) != 0 &&
+		    memcmp(FsSuperblock.Fst[index].Name, name, FS_MAX_NAME) == 0)
+			break;
+
+		index = FstHashNext[index];
+	}
+
+	return index;
+}
+
+void BuildFstIndex(void)
+{
+	const FstEntry *fst = FsSuperblock.Fst;
+	u16 parent = FST_ROOT_ENTRY;
+	u16 current = fst[FST_ROOT_ENTRY].Sub;
+
+	memset(FstHashHeads, 0xFF, sizeof(FstHashHeads));
+	memset(FstHashNext, 0xFF, sizeof(FstHashNext));
+	memset(FstParents, 0xFF, sizeof(FstParents));
+	FstFreeHint = 0;
+
+	//walk the tree depth first without recursion. the visit count protects us from a corrupt fst
+	for (u32 visited = 0; current < FST_ENTRY_COUNT && visited < FST_ENTRY_COUNT; visited++)
+	{
+		FstParents[current] = parent;
+		LinkHash(current);
+
+		if (FST_ENTRY_TYPE(current) == FST_TYPE_DIRECTORY && fst[current].Sub < FST_ENTRY_COUNT)
+		{
+			parent = current;
+			current = fst[current].Sub;
+			continue;
+		}
+
+		//climb back up until we find a directory with siblings left to visit
+		while (current != FST_ROOT_ENTRY && fst[current].Sibling >= FST_ENTRY_COUNT)
+			current = FstParents[current];
+
+		if (current == FST_ROOT_ENTRY)
+			break;
+
+		parent = FstParents[current];
+		current = fst[current].Sibling;
+	}
+}
+
+s32 ResolvePath(const char *path, u16 *parent, char name[FS_MAX_NAME])
+{
+	char component[FS_MAX_NAME];
+	u16 current = FST_ROOT_ENTRY;
+
+	if (parent != NULL)
+		*parent = FST_NONE;
+
+	if (path == NULL || path[0] != '/' || strnlen(path, FS_MAX_PATH) >= FS_MAX_PATH)
+		return FS_EINVAL;
+
+	const char *cursor = &path[1];
+	if (*cursor == '\0')
+		return FST_ROOT_ENTRY;
+
+	for (u32 depth = 1;; depth++)
+	{
+		const char *end = strchr(cursor, '/');
+		const u32 length = end != NULL ? (u32)(end - cursor) : strlen(cursor);
+		if (length == 0 || length > FS_MAX_NAME)
+			return FS_EINVAL;
+
+		if (depth > FS_MAX_DEPTH)
+			return FS_EDIRDEPTH;
+
+		if (FST_ENTRY_TYPE(current) != FST_TYPE_DIRECTORY)
+			return FS_ENOENT;
+
+		memset(component, 0, sizeof(component));
+		memcpy(component, cursor, length);
+		const u16 found = FindChild(current, component);
+
+		if (end == NULL)
+		{
+			if (parent != NULL)
+				*parent = current;
+			if (name != NULL)
+				memcpy(name, component, FS_MAX_NAME);
+			return found == FST_NONE ? FS_ENOENT : found;
+		}
+
+		if (found == FST_NONE)
+			return FS_ENOENT;
+
+		current = found;
+		cursor = end + 1;
+	}
+}
+
+u16 GetFstParent(u16 index)
+{
+	return FstParents[index];
+}
+
+s32 CreateFstEntry(u16 parent, const char name[FS_MAX_NAME], u8 mode, u8 attributes,
+                   u32 userId, u16 groupId)
+{
+	u16 index = FST_NONE;
+	for (u32 i = 0; i < FST_ENTRY_COUNT && index == FST_NONE; i++)
+	{
+		const u16 candidate = (u16)((FstFreeHint + i) % FST_ENTRY_COUNT);
+		if (candidate != FST_ROOT_ENTRY && FST_ENTRY_TYPE(candidate) == 0)
+			index = candidate;
+	}
+
+	if (index == FST_NONE)
+		return FS_EFBIG;
+
+	FstEntry *entry = &FsSuperblock.Fst[index];
+	memset(entry, 0, sizeof(FstEntry));
+	memcpy(entry->Name, name, FS_MAX_NAME);
+	entry->Mode = mode;
+	entry->Attributes = attributes;
+	entry->Sub = FST_NONE;
+	entry->UserId = userId;
+	entry->GroupId = groupId;
+
+	LinkChild(parent, index);
+	LinkHash(index);
+	FstFreeHint = (u16)(index + 1);
+	return index;
+}
+
+void DeleteFstEntry(u16 index)
+{
+	UnlinkHash(index);
+	UnlinkChild(index);
+	memset(&FsSuperblock.Fst[index], 0, sizeof(FstEntry));
+	FstParents[index] = FST_NONE;
+	if (index < FstFreeHint)
+		FstFreeHint = index;
+}
+
+void MoveFstEntry(u16 index, u16 parent, const char name[FS_MAX_NAME])
+{
+	UnlinkHash(index);
+	UnlinkChild(index);
+	memcpy(FsSuperblock.Fst[index].Name, name, FS_MAX_NAME);
+	LinkChild(parent, index);
+	LinkHash(index);
+}
@@ -0,0 +1,32 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	fst - path lookup & directory tree of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __FST_H__
+#define __FST_H__
+
+#include <types.h>
+
+#include "superblock.h"
+
+#define FST_ROOT_ENTRY 0x0000
+
+void BuildFstIndex(void);
+
+//resolves a path to its entry index. if the last component doesn't exist FS_ENOENT is returned,
+//but parent & name are still filled in as long as the parent directory exists
+s32 ResolvePath(const char *path, u16 *parent, char name[FS_MAX_NAME]);
+u16 GetFstParent(u16 index);
+
+s32 CreateFstEntry(u16 parent, const char name[FS_MAX_NAME], u8 mode, u8 attributes,
+                   u32 userId, u16 groupId);
+void DeleteFstEntry(u16 index);
+void MoveFstEntry(u16 index, u16 parent, const char name[FS_MAX_NAME]);
+
+#endif
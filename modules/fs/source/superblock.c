@@ -0,0 +1,366 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	superblock - fat, fst & cluster allocation of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+
+#include "superblock.h"
+#include "crypto.h"
+
+#define FLASH_BLOCK_COUNT (FLASH_CLUSTER_COUNT / FLASH_CLUSTERS_PER_BLOCK)
+
+Superblock FsSuperblock ALIGNED(0x40);
+static u32 SuperblockIndex = 0;
+static bool SuperblockDirty = false;
+
+//clusters freed since the last commit are still in use by the superblock on the nand,
+//so their blocks can't be erased until the next superblock is written
+static u8 ReleasedClusters[FLASH_CLUSTER_COUNT / 8];
+
+//new clusters are only handed out of the last block that was erased. [Next, End) are left
+static u16 ErasedClusterNext = 0;
+static u16 ErasedClusterEnd = 0;
+static u16 NextBlockToErase = 0;
+
+static inline bool IsClusterReleased(u16 cluster)
+{
+	return (ReleasedClusters[cluster / 8] & (1 << (cluster % 8))) != 0;
+}
+
+static inline u16 GetSuperblockCluster(u32 index)
+{
+	return (u16)(SUPERBLOCK_FIRST_CLUSTER + (index * SUPERBLOCK_CLUSTERS));
+}
+
+static s32 GenerateSuperblockHmac(u16 cluster, u8 *hmac)
+{
+	u8 salt[HMAC_SALT_SIZE];
+
+	memset(salt, 0, sizeof(salt));
+	salt[0x12] = (u8)(cluster >> 8);
+	salt[0x13] = (u8)cluster;
+	return GenerateHmac(&FsSuperblock, sizeof(Superblock), salt, hmac);
+}
+
+static s32 ReadSuperblock(u32 index)
+{
+	const u16 cluster = GetSuperblockCluster(index);
+	u8 storedHmac[FLASH_HMAC_SIZE];
+	u8 hmac[FLASH_HMAC_SIZE];
+
+	s32 ret = ReadFlashClusters(cluster, SUPERBLOCK_CLUSTERS, &FsSuperblock, storedHmac);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	if (FsSuperblock.Magic != SUPERBLOCK_MAGIC)
+		return FS_ECORRUPT;
+
+	ret = GenerateSuperblockHmac(cluster, hmac);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	return memcmp(hmac, storedHmac, FLASH_HMAC_SIZE) == 0 ? IPC_SUCCESS : FS_ECORRUPT;
+}
+
+static inline u16 GetFirstBlockCluster(u16 cluster)
+{
+	return (u16)(cluster - (cluster % FLASH_CLUSTERS_PER_BLOCK));
+}
+
+//a block is retired once any of its clusters is marked bad in the fat
+static bool IsBlockRetired(u16 cluster)
+{
+	const u16 firstCluster = GetFirstBlockCluster(cluster);
+	for (u16 i = firstCluster; i < firstCluster + FLASH_CLUSTERS_PER_BLOCK; i++)
+	{
+		if (FsSuperblock.Fat[i] == FAT_BAD)
+			return true;
+	}
+
+	return false;
+}
+
+//takes the block of a cluster that failed to program or erase out of the allocator.
+//clusters that are in use stay readable and only turn bad once they are released.
+//the marks are part of the fat, so they survive a reboot once the superblock is committed
+void RetireClusterBlock(u16 cluster)
+{
+	const u16 firstCluster = GetFirstBlockCluster(cluster);
+	for (u16 i = firstCluster; i < firstCluster + FLASH_CLUSTERS_PER_BLOCK; i++)
+	{
+		if (FsSuperblock.Fat[i] != FAT_FREE)
+			continue;
+
+		FsSuperblock.Fat[i] = FAT_BAD;
+		SuperblockDirty = true;
+	}
+
+	if (ErasedClusterNext >= firstCluster &&
+	    ErasedClusterNext < firstCluster + FLASH_CLUSTERS_PER_BLOCK)
+		ErasedClusterNext = ErasedClusterEnd = 0;
+}
+
+//the fat is where bad blocks are kept across reboots, so the kernel gets them from us instead of
+//scanning the nand. blocks the kernel saw going bad since we last committed get retired here
+static void MarkBadBlocks(void)
+{
+	FlashBlockStats stats;
+
+	for (u16 block = 0; block < FLASH_BLOCK_COUNT; block++)
+	{
+		const u16 cluster = (u16)(block * FLASH_CLUSTERS_PER_BLOCK);
+		if (IsBlockRetired(cluster))
+			OSMarkFlashBlockBad(block);
+		else if (OSGetFlashBlockStats(block, &stats) == IPC_SUCCESS && stats.Bad)
+			RetireClusterBlock(cluster);
+	}
+}
+
+s32 MountSuperblock(void)
+{
+	u32 generations[SUPERBLOCK_COUNT];
+
+	//only look at the header first, so we don't read 16 full superblocks on every boot
+	for (u32 i = 0; i < SUPERBLOCK_COUNT; i++)
+	{
+		generations[i] = 0;
+		s32 ret = OSReadFlashPage(GetSuperblockCluster(i) * FLASH_PAGES_PER_CLUSTER,
+		                          &FsSuperblock, NULL);
+		if ((ret == IPC_SUCCESS || ret == IPC_ECC) && FsSuperblock.Magic == SUPERBLOCK_MAGIC)
+			generations[i] = FsSuperblock.Generation;
+	}
+
+	//try the newest superblock first and fall back to older ones if it doesn't verify
+	while (1)
+	{
+		s32 newest = -1;
+		for (u32 i = 0; i < SUPERBLOCK_COUNT; i++)
+		{
+			if (generations[i] != 0 &&
+			    (newest < 0 || generations[i] > generations[newest]))
+				newest = (s32)i;
+		}
+
+		if (newest < 0)
+			return FS_ECORRUPT;
+
+		if (ReadSuperblock((u32)newest) == IPC_SUCCESS)
+		{
+			SuperblockIndex = (u32)newest;
+			break;
+		}
+
+		printk("FS: superblock %d (generation 0x%08X) is corrupt\n", newest,
+		       generations[newest]);
+		generations[newest] = 0;
+	}
+
+	memset(ReleasedClusters, 0, sizeof(ReleasedClusters));
+	ErasedClusterNext = ErasedClusterEnd = 0;
+	NextBlockToErase = 0;
+	SuperblockDirty = false;
+	MarkBadBlocks();
+	return IPC_SUCCESS;
+}
+
+void MarkSuperblockDirty(void)
+{
+	SuperblockDirty = true;
+}
+
+bool IsSuperblockDirty(void)
+{
+	return SuperblockDirty;
+}
+
+//every commit goes to the next slot, so the previous generation stays intact on the nand
+//until the new one is completely written. mounting falls back to it if we lose power halfway
+s32 CommitSuperblock(void)
+{
+	u8 hmac[FLASH_HMAC_SIZE];
+	s32 ret = FS_EIO;
+
+	FsSuperblock.Generation++;
+	for (u32 i = 1; i <= SUPERBLOCK_COUNT; i++)
+	{
+		const u32 index = (SuperblockIndex + i) % SUPERBLOCK_COUNT;
+		const u16 cluster = GetSuperblockCluster(index);
+
+		ret = GenerateSuperblockHmac(cluster, hmac);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		for (u16 j = 0; j < SUPERBLOCK_CLUSTERS && ret == IPC_SUCCESS;
+		     j += FLASH_CLUSTERS_PER_BLOCK)
+			ret = EraseFlashCluster((u16)(cluster + j));
+
+		if (ret == IPC_SUCCESS)
+			ret = WriteFlashClusters(cluster, SUPERBLOCK_CLUSTERS, &FsSuperblock, hmac);
+
+		if (ret != IPC_SUCCESS)
+		{
+			printk("FS: failed to write superblock %d: %d\n", index, ret);
+			ret = FS_EIO;
+			continue;
+		}
+
+		//the nand now matches our fat, so released clusters can be erased & reused
+		SuperblockIndex = index;
+		SuperblockDirty = false;
+		memset(ReleasedClusters, 0, sizeof(ReleasedClusters));
+		return IPC_SUCCESS;
+	}
+
+	//nothing made it to the nand, so the next attempt gets the same generation
+	FsSuperblock.Generation--;
+	return ret;
+}
+
+static bool IsClusterReusable(u16 cluster)
+{
+	return FsSuperblock.Fat[cluster] == FAT_FREE && !IsClusterReleased(cluster);
+}
+
+static bool IsBlockErasable(u16 firstCluster)
+{
+	for (u16 cluster = firstCluster; cluster < firstCluster + FLASH_CLUSTERS_PER_BLOCK; cluster++)
+	{
+		if (!IsClusterReusable(cluster))
+			return false;
+	}
+
+	return true;
+}
+
+//picks the block with the most reusable clusters that holds neither boot nor superblock data
+static s32 FindReclaimableBlock(void)
+{
+	s32 best = -1;
+	u32 bestCount = 0;
+
+	for (u16 block = 0; block < FLASH_BLOCK_COUNT; block++)
+	{
+		const u16 firstCluster = block * FLASH_CLUSTERS_PER_BLOCK;
+		u32 count = 0;
+		for (u16 cluster = firstCluster; cluster < firstCluster + FLASH_CLUSTERS_PER_BLOCK;
+		     cluster++)
+		{
+			if (FsSuperblock.Fat[cluster] == FAT_RESERVED || FsSuperblock.Fat[cluster] == FAT_BAD)
+			{
+				count = 0;
+				break;
+			}
+
+			if (IsClusterReusable(cluster))
+				count++;
+		}
+
+		if (count > bestCount)
+		{
+			best = block;
+			bestCount = count;
+		}
+	}
+
+	return best;
+}
+
+//when no block is free as a whole, the clusters that are still in use in a partly used block are
+//parked in the second block of the next superblock slot, which gets erased by the next commit
+//anyway. the block is then erased & they are copied back, so the fat doesn't change.
+//losing power halfway loses those clusters, but this only happens once the nand is fragmented
+static s32 ReclaimBlock(void)
+{
+	const s32 block = FindReclaimableBlock();
+	if (block < 0)
+		return FS_EFBIG;
+
+	const u16 firstCluster = (u16)(block * FLASH_CLUSTERS_PER_BLOCK);
+	const u16 parkCluster = (u16)(GetSuperblockCluster((SuperblockIndex + 1) % SUPERBLOCK_COUNT) +
+	                              FLASH_CLUSTERS_PER_BLOCK);
+
+	s32 ret = EraseFlashCluster(parkCluster);
+	for (u16 i = 0; i < FLASH_CLUSTERS_PER_BLOCK && ret == IPC_SUCCESS; i++)
+	{
+		if (!IsClusterReusable((u16)(firstCluster + i)))
+			ret = CopyFlashCluster((u16)(firstCluster + i), (u16)(parkCluster + i));
+	}
+
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	ret = EraseFlashCluster(firstCluster);
+	for (u16 i = 0; i < FLASH_CLUSTERS_PER_BLOCK && ret == IPC_SUCCESS; i++)
+	{
+		if (!IsClusterReusable((u16)(firstCluster + i)))
+			ret = CopyFlashCluster((u16)(parkCluster + i), (u16)(firstCluster + i));
+	}
+
+	if (ret != IPC_SUCCESS)
+	{
+		printk("FS: failed to reclaim block %d: %d\n", block, ret);
+		RetireClusterBlock(firstCluster);
+		return FS_EIO;
+	}
+
+	//the clusters in use are skipped when handing out the erased range
+	ErasedClusterNext = firstCluster;
+	ErasedClusterEnd = firstCluster + FLASH_CLUSTERS_PER_BLOCK;
+	return IPC_SUCCESS;
+}
+
+s32 AllocateCluster(u16 *cluster)
+{
+	while (1)
+	{
+		while (ErasedClusterNext < ErasedClusterEnd)
+		{
+			const u16 next = ErasedClusterNext++;
+			if (IsClusterReusable(next))
+			{
+				*cluster = next;
+				return IPC_SUCCESS;
+			}
+		}
+
+		//go round robin over the blocks so writes are spread over the whole nand
+		for (u32 i = 0; i < FLASH_BLOCK_COUNT; i++)
+		{
+			const u16 block = (u16)((NextBlockToErase + i) % FLASH_BLOCK_COUNT);
+			const u16 firstCluster = block * FLASH_CLUSTERS_PER_BLOCK;
+			if (!IsBlockErasable(firstCluster))
+				continue;
+
+			if (EraseFlashCluster(firstCluster) != IPC_SUCCESS)
+			{
+				RetireClusterBlock(firstCluster);
+				continue;
+			}
+
+			NextBlockToErase = (u16)((block + 1) % FLASH_BLOCK_COUNT);
+			ErasedClusterNext = firstCluster + 1;
+			ErasedClusterEnd = firstCluster + FLASH_CLUSTERS_PER_BLOCK;
+			*cluster = firstCluster;
+			return IPC_SUCCESS;
+		}
+
+		s32 ret = ReclaimBlock();
+		if (ret != IPC_SUCCESS)
+			return ret;
+	}
+}
+
+void ReleaseCluster(u16 cluster)
+{
+	FsSuperblock.Fat[cluster] = IsBlockRetired(cluster) ? FAT_BAD : FAT_FREE;
+	ReleasedClusters[cluster / 8] |= (u8)(1 << (cluster % 8));
+}
@@ -0,0 +1,93 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	superblock - fat, fst & cluster allocation of the nand filesystem
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __SUPERBLOCK_H__
+#define __SUPERBLOCK_H__
+
+#include <types.h>
+
+#include "fs.h"
+#include "flash.h"
+
+#define SUPERBLOCK_MAGIC         0x53464653 // SFFS
+#define SUPERBLOCK_FIRST_CLUSTER 0x7F00
+#define SUPERBLOCK_CLUSTERS      0x10
+#define SUPERBLOCK_COUNT         0x10
+#define FST_ENTRY_COUNT          0x17FF
+
+#define FAT_CHAIN_END 0xFFFB
+#define FAT_RESERVED  0xFFFC
+#define FAT_BAD       0xFFFD
+#define FAT_FREE      0xFFFE
+#define FST_NONE      0xFFFF
+
+#define FST_TYPE_MASK      0x03
+#define FST_TYPE_FILE      0x01
+#define FST_TYPE_DIRECTORY 0x02
+
+#define FST_PERMISSIONS_OWNER(mode) (((mode) >> 6) & 0x03)
+#define FST_PERMISSIONS_GROUP(mode) (((mode) >> 4) & 0x03)
+#define FST_PERMISSIONS_OTHER(mode) (((mode) >> 2) & 0x03)
+
+#pragma pack(push, 1)
+typedef struct
+{
+	char Name[FS_MAX_NAME];
+	u8 Mode;
+	u8 Attributes;
+	u16 Sub;
+	u16 Sibling;
+	u32 Size;
+	u32 UserId;
+	u16 GroupId;
+	u32 Unknown;
+} FstEntry;
+#pragma pack(pop)
+CHECK_SIZE(FstEntry, 0x20);
+CHECK_OFFSET(FstEntry, 0x00, Name);
+CHECK_OFFSET(FstEntry, 0x0C, Mode);
+CHECK_OFFSET(FstEntry, 0x0D, Attributes);
+CHECK_OFFSET(FstEntry, 0x0E, Sub);
+CHECK_OFFSET(FstEntry, 0x10, Sibling);
+CHECK_OFFSET(FstEntry, 0x12, Size);
+CHECK_OFFSET(FstEntry, 0x16, UserId);
+CHECK_OFFSET(FstEntry, 0x1A, GroupId);
+CHECK_OFFSET(FstEntry, 0x1C, Unknown);
+
+typedef struct
+{
+	u32 Magic;
+	u32 Generation;
+	u32 Unknown;
+	u16 Fat[FLASH_CLUSTER_COUNT];
+	FstEntry Fst[FST_ENTRY_COUNT];
+	u8 Padding[0x14];
+} Superblock;
+CHECK_SIZE(Superblock, SUPERBLOCK_CLUSTERS * FLASH_CLUSTER_SIZE);
+CHECK_OFFSET(Superblock, 0x00, Magic);
+CHECK_OFFSET(Superblock, 0x04, Generation);
+CHECK_OFFSET(Superblock, 0x08, Unknown);
+CHECK_OFFSET(Superblock, 0x0C, Fat);
+CHECK_OFFSET(Superblock, 0x1000C, Fst);
+
+extern Superblock FsSuperblock;
+
+#define FST_ENTRY_TYPE(index) (FsSuperblock.Fst[(index)].Mode & FST_TYPE_MASK)
+#define FAT_IS_CLUSTER(value) ((value) < FLASH_CLUSTER_COUNT)
+
+s32 MountSuperblock(void);
+void MarkSuperblockDirty(void);
+bool IsSuperblockDirty(void);
+s32 CommitSuperblock(void);
+s32 AllocateCluster(u16 *cluster);
+void ReleaseCluster(u16 cluster);
+void RetireClusterBlock(u16 cluster);
+
+#endif
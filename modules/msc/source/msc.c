@@ -0,0 +1,154 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/ipc.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+
+#include "msc.h"
+#include "storage.h"
+#include "transport.h"
+
+static MscDevice _device = { .HostFileDescriptor = -1 };
+static s32 _messageQueueId = -1;
+static IpcMessage _removalMessage;
+static bool _removalHookArmed = false;
+
+//the device is looked up on demand, so it can be plugged in whenever and the host controller
+//does not have to be up before us
+static s32 AttachDevice(void)
+{
+	const s32 ret = AttachStorage(&_device);
+	if (_removalHookArmed || _device.HostFileDescriptor < 0)
+		return ret;
+
+	if (ArmRemovalHook(&_device, _messageQueueId, &_removalMessage) == IPC_SUCCESS)
+		_removalHookArmed = true;
+
+	return ret;
+}
+
+static s32 HandleIoctl(IoctlMessage *ioctl)
+{
+	if (ioctl->Ioctl != MSC_IOCTL_GETCAPACITY || ioctl->IoLength < sizeof(MscCapacity) ||
+	    ioctl->IoBuffer == NULL)
+		return IPC_EINVAL;
+
+	s32 ret = AttachDevice();
+	if (ret < 0)
+		return ret;
+
+	MscCapacity *capacity = (MscCapacity *)ioctl->IoBuffer;
+	capacity->SectorSize = _device.SectorSize;
+	capacity->SectorCount = _device.SectorCount;
+	OSDCFlushRange(capacity, sizeof(*capacity));
+	return IPC_SUCCESS;
+}
+
+static s32 HandleIoctlv(IoctlvMessage *ioctlv)
+{
+	const IoctlvMessageData *vector = ioctlv->MessageData;
+	bool write;
+
+	if (ioctlv->Ioctl == MSC_IOCTLV_READSECTORS && ioctlv->InputArgc == 2 && ioctlv->IoArgc == 1)
+		write = false;
+	else if (ioctlv->Ioctl == MSC_IOCTLV_WRITESECTORS && ioctlv->InputArgc == 3 &&
+	         ioctlv->IoArgc == 0)
+		write = true;
+	else
+		return IPC_EINVAL;
+
+	if (vector[0].Length != sizeof(u32) || !vector[0].Data || vector[1].Length != sizeof(u32) ||
+	    !vector[1].Data || !vector[2].Data)
+		return IPC_EINVAL;
+
+	s32 ret = AttachDevice();
+	if (ret < 0)
+		return ret;
+
+	const u32 sector = *(u32 *)vector[0].Data;
+	const u32 count = *(u32 *)vector[1].Data;
+	if (count > UINT_MAX / _device.SectorSize || vector[2].Length != count * _device.SectorSize)
+		return IPC_EINVAL;
+
+	return TransferSectors(&_device, sector, count, vector[2].Data, write);
+}
+
+static s32 HandleRequest(IpcRequest *request)
+{
+	switch (request->Command)
+	{
+		case IOS_OPEN:
+			if (strcmp(request->Message.Open.Filepath, MSC_DEVICE_NAME) != 0)
+				return IPC_ENOENT;
+			return IPC_SUCCESS;
+		case IOS_CLOSE:
+			return IPC_SUCCESS;
+		case IOS_IOCTL:
+			return HandleIoctl(&request->Message.Ioctl);
+		case IOS_IOCTLV:
+			return HandleIoctlv(&request->Message.Ioctlv);
+		default:
+			return IPC_EINVAL;
+	}
+}
+
+int main(void)
+{
+	u32 messageQueueMessages[8] ALIGNED(0x10);
+	IpcMessage *message;
+
+	printk("$IOSVersion: MSC: %s %s 64M $\n", __DATE__, __TIME__);
+	s32 ret = OSCreateMessageQueue((void **)&messageQueueMessages, 8);
+	if (ret < 0)
+	{
+		printk("failed to create messagequeue! %d\n", ret);
+		return ret;
+	}
+
+	_messageQueueId = ret;
+	ret = InitialiseStorage();
+	if (ret < 0)
+	{
+		printk("failed to initialise storage! %d\n", ret);
+		goto error;
+	}
+
+	ret = OSRegisterResourceManager(MSC_DEVICE_NAME, _messageQueueId);
+	if (ret < 0)
+	{
+		printk("failed to register resource manager! %d\n", ret);
+		goto error;
+	}
+
+	AttachDevice();
+	while (1)
+	{
+		ret = OSReceiveMessage(_messageQueueId, &message, 0);
+		if (ret < 0)
+			break;
+
+		if (message == &_removalMessage)
+		{
+			printk("MSC: %04x:%04x removed\n", _device.VendorId, _device.ProductId);
+			_removalHookArmed = false;
+			DetachStorage(&_device);
+			continue;
+		}
+
+		OSResourceReply(message, HandleRequest(&message->Request));
+	}
+
+error:
+	OSDestroyMessageQueue(_messageQueueId);
+	return ret;
+}
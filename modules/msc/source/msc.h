@@ -0,0 +1,47 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+
+#define MSC_DEVICE_NAME           "/dev/usb/msc"
+
+//io : MscCapacity
+#define MSC_IOCTL_GETCAPACITY     0x01
+//in : u32 first sector, u32 sector count. io : sector data
+#define MSC_IOCTLV_READSECTORS    0x02
+//in : u32 first sector, u32 sector count, sector data
+#define MSC_IOCTLV_WRITESECTORS   0x03
+
+typedef struct
+{
+	u32 SectorSize;
+	u32 SectorCount;
+} MscCapacity;
+CHECK_SIZE(MscCapacity, 0x08);
+CHECK_OFFSET(MscCapacity, 0x00, SectorSize);
+CHECK_OFFSET(MscCapacity, 0x04, SectorCount);
+
+typedef struct
+{
+	s32 HostFileDescriptor;
+	u16 VendorId;
+	u16 ProductId;
+	u8 InterfaceNumber;
+	u8 BulkInEndpoint;
+	u8 BulkOutEndpoint;
+	u8 Lun;
+	u32 Tag;
+	//read once when the device is attached, and again after the medium changed
+	u32 SectorSize;
+	u32 SectorCount;
+	bool Ready;
+} MscDevice;
@@ -0,0 +1,274 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+#include <usb/msc.h>
+
+#include "storage.h"
+#include "transport.h"
+
+#define MSC_SCRATCH_SIZE       0x40
+#define MSC_INQUIRY_LENGTH     36
+#define MSC_SENSE_LENGTH       18
+#define MSC_CAPACITY_LENGTH    8
+#define MSC_UNIT_READY_TRIES   10
+#define MSC_UNIT_READY_DELAY   100000
+
+static u8 *_scratch = NULL;
+static u8 *_bounceBuffer = NULL;
+
+static inline u32 ReadBigEndian32(const u8 *data)
+{
+	return (u32)data[0] << 24 | (u32)data[1] << 16 | (u32)data[2] << 8 | data[3];
+}
+
+static inline void WriteBigEndian32(u8 *data, u32 value)
+{
+	data[0] = (u8)(value >> 24);
+	data[1] = (u8)(value >> 16);
+	data[2] = (u8)(value >> 8);
+	data[3] = (u8)value;
+}
+
+s32 InitialiseStorage(void)
+{
+	s32 ret;
+
+	_scratch = OSAllocateIOBuf(MSC_SCRATCH_SIZE, 0x20);
+	if (!_scratch)
+		return IPC_ENOMEM;
+
+	_bounceBuffer = OSAllocateIOBuf(MSC_BOUNCE_BUFFER_SIZE, 0x20);
+	if (!_bounceBuffer)
+	{
+		ret = IPC_ENOMEM;
+		goto error_free_scratch;
+	}
+
+	ret = InitialiseTransport();
+	if (ret < 0)
+		goto error_free_bounce_buffer;
+
+	return IPC_SUCCESS;
+
+error_free_bounce_buffer:
+	OSFreeIOBuf(_bounceBuffer);
+	_bounceBuffer = NULL;
+error_free_scratch:
+	OSFreeIOBuf(_scratch);
+	_scratch = NULL;
+	return ret;
+}
+
+static s32 RequestSense(MscDevice *device, u8 *senseKey, u8 *additionalSense)
+{
+	const u8 command[6] = { SCSI_REQUEST_SENSE, 0, 0, 0, MSC_SENSE_LENGTH, 0 };
+	u32 transferred;
+
+	s32 ret = SendCommand(device, command, sizeof(command), _scratch, MSC_SENSE_LENGTH, true,
+	                      &transferred);
+	if (ret < 0)
+		return ret;
+
+	if (transferred <= 12)
+		return IPC_UNKNOWN;
+
+	*senseKey = _scratch[2] & SCSI_SENSE_KEY_MASK;
+	*additionalSense = _scratch[12];
+	return IPC_SUCCESS;
+}
+
+static s32 Inquiry(MscDevice *device)
+{
+	const u8 command[6] = { SCSI_INQUIRY, 0, 0, 0, MSC_INQUIRY_LENGTH, 0 };
+	u32 transferred;
+
+	s32 ret = SendCommand(device, command, sizeof(command), _scratch, MSC_INQUIRY_LENGTH, true,
+	                      &transferred);
+	if (ret < 0)
+		return ret;
+
+	//cd drives and the like speak the same transport, but are no block device we can use
+	if (transferred == 0 || (_scratch[0] & SCSI_TYPE_MASK) != SCSI_TYPE_DIRECT_ACCESS)
+		return IPC_ENOENT;
+
+	return IPC_SUCCESS;
+}
+
+static s32 WaitUnitReady(MscDevice *device)
+{
+	const u8 command[6] = { SCSI_TEST_UNIT_READY, 0, 0, 0, 0, 0 };
+	u8 senseKey = 0, additionalSense = 0;
+	u32 transferred;
+
+	for (u32 tries = 0; tries < MSC_UNIT_READY_TRIES; tries++)
+	{
+		s32 ret = SendCommand(device, command, sizeof(command), NULL, 0, false, &transferred);
+		if (ret != IPC_CHECKVALUE)
+			return ret;
+
+		ret = RequestSense(device, &senseKey, &additionalSense);
+		if (ret < 0)
+			return ret;
+
+		if (senseKey == SCSI_SENSE_NOT_READY && additionalSense == SCSI_ASC_MEDIUM_NOT_PRESENT)
+			return IPC_NOTREADY;
+
+		//a unit attention only reports the medium changed, so that can be asked again right away
+		if (senseKey != SCSI_SENSE_UNIT_ATTENTION)
+			SleepTransport(MSC_UNIT_READY_DELAY);
+	}
+
+	printk("MSC: unit not ready, sense key 0x%x asc 0x%02x\n", senseKey, additionalSense);
+	return IPC_NOTREADY;
+}
+
+static s32 ReadCapacity(MscDevice *device)
+{
+	const u8 command[10] = { SCSI_READ_CAPACITY_10, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	u32 transferred;
+
+	s32 ret = SendCommand(device, command, sizeof(command), _scratch, MSC_CAPACITY_LENGTH, true,
+	                      &transferred);
+	if (ret < 0)
+		return ret;
+
+	if (transferred != MSC_CAPACITY_LENGTH)
+		return IPC_UNKNOWN;
+
+	const u32 lastSector = ReadBigEndian32(&_scratch[0]);
+	const u32 sectorSize = ReadBigEndian32(&_scratch[4]);
+	if (sectorSize < 512 || sectorSize > MSC_BOUNCE_BUFFER_SIZE ||
+	    (sectorSize & (sectorSize - 1)) != 0)
+	{
+		printk("MSC: unsupported sector size %u\n", sectorSize);
+		return IPC_INVALIDSIZE;
+	}
+
+	//READ(10) can not address anything past the first 2^32 - 1 sectors
+	device->SectorSize = sectorSize;
+	device->SectorCount = lastSector == UINT_MAX ? UINT_MAX : lastSector + 1;
+	return IPC_SUCCESS;
+}
+
+s32 AttachStorage(MscDevice *device)
+{
+	s32 ret;
+
+	if (device->Ready)
+		return IPC_SUCCESS;
+
+	if (device->HostFileDescriptor < 0)
+	{
+		ret = AttachTransport(device);
+		if (ret < 0)
+			return ret;
+
+		ret = Inquiry(device);
+		if (ret < 0)
+		{
+			DetachTransport(device);
+			return ret;
+		}
+	}
+
+	//a card reader without a card stays attached, it just is not ready yet
+	ret = WaitUnitReady(device);
+	if (ret == IPC_SUCCESS)
+		ret = ReadCapacity(device);
+	if (ret < 0)
+		return ret;
+
+	device->Ready = true;
+	printk("MSC: %04x:%04x ready, %u sectors of %u bytes\n", device->VendorId, device->ProductId,
+	       device->SectorCount, device->SectorSize);
+	return IPC_SUCCESS;
+}
+
+void DetachStorage(MscDevice *device)
+{
+	DetachTransport(device);
+}
+
+static s32 GetTransferError(MscDevice *device)
+{
+	u8 senseKey = 0, additionalSense = 0;
+
+	if (RequestSense(device, &senseKey, &additionalSense) < 0)
+		return IPC_UNKNOWN;
+
+	//the medium went away or was swapped, so the cached capacity can not be trusted anymore
+	if (senseKey == SCSI_SENSE_UNIT_ATTENTION || senseKey == SCSI_SENSE_NOT_READY)
+	{
+		device->Ready = false;
+		return IPC_NOTREADY;
+	}
+
+	printk("MSC: transfer failed, sense key 0x%x asc 0x%02x\n", senseKey, additionalSense);
+	return IPC_UNKNOWN;
+}
+
+s32 TransferSectors(MscDevice *device, u32 sector, u32 count, void *buffer, bool write)
+{
+	if (!device->Ready)
+		return IPC_NOTREADY;
+
+	if (count == 0 || !buffer || sector >= device->SectorCount ||
+	    count > device->SectorCount - sector)
+		return IPC_EINVAL;
+
+	//the host controller can use the caller's buffer as is, unless invalidating it after a read
+	//would also throw away whatever shares the first or last cache line with it
+	const bool isDirect = ((u32)buffer & 0x1F) == 0;
+	const u32 chunkSectors =
+	    (isDirect ? MSC_MAX_TRANSFER_SIZE : MSC_BOUNCE_BUFFER_SIZE) / device->SectorSize;
+	u8 *data = (u8 *)buffer;
+
+	while (count != 0)
+	{
+		const u32 sectors = count < chunkSectors ? count : chunkSectors;
+		const u32 length = sectors * device->SectorSize;
+		u8 *transfer = isDirect ? data : _bounceBuffer;
+		u8 command[10] = { write ? SCSI_WRITE_10 : SCSI_READ_10, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+		u32 transferred;
+
+		WriteBigEndian32(&command[2], sector);
+		command[7] = (u8)(sectors >> 8);
+		command[8] = (u8)sectors;
+		if (write && !isDirect)
+			memcpy(_bounceBuffer, data, length);
+
+		s32 ret = SendCommand(device, command, sizeof(command), transfer, length, !write,
+		                      &transferred);
+		if (ret == IPC_CHECKVALUE)
+			ret = GetTransferError(device);
+		else if (ret == IPC_SUCCESS && transferred != length)
+			ret = IPC_UNKNOWN;
+
+		if (ret < 0)
+		{
+			if (device->HostFileDescriptor < 0)
+				device->Ready = false;
+			return ret;
+		}
+
+		if (!write && !isDirect)
+			memcpy(data, _bounceBuffer, length);
+
+		data += length;
+		sector += sectors;
+		count -= sectors;
+	}
+
+	return IPC_SUCCESS;
+}
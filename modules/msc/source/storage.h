@@ -0,0 +1,25 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+
+#include "msc.h"
+
+//largest single command when the caller's buffer can be handed to the host controller as is
+#define MSC_MAX_TRANSFER_SIZE  0x20000
+//everything else goes through this
+#define MSC_BOUNCE_BUFFER_SIZE 0x10000
+
+s32 InitialiseStorage(void);
+s32 AttachStorage(MscDevice *device);
+void DetachStorage(MscDevice *device);
+s32 TransferSectors(MscDevice *device, u32 sector, u32 count, void *buffer, bool write);
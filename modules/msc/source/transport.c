@@ -0,0 +1,537 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+#include <usb/usb.h>
+#include <usb/msc.h>
+
+#include "transport.h"
+
+//same interface as oh1 & ehc
+#define USBV0_IOCTL_CTRLMSG        0x0
+#define USBV0_IOCTL_BLKMSG         0x1
+#define USBV0_IOCTL_GETDEVLIST     0xc
+#define USBV0_IOCTL_DEVREMOVALHOOK 0x1a
+
+#define MSC_MAX_HOST_DEVICES       8
+#define MSC_DESCRIPTOR_SIZE        0x100
+#define MSC_PATH_SIZE              0x20
+
+typedef struct
+{
+	u32 Unused;
+	u16 VendorId;
+	u16 ProductId;
+} HostDeviceEntry;
+CHECK_SIZE(HostDeviceEntry, 0x08);
+CHECK_OFFSET(HostDeviceEntry, 0x04, VendorId);
+CHECK_OFFSET(HostDeviceEntry, 0x06, ProductId);
+
+//everything the host controller gets pointed at has to be reachable by its process as well, so it
+//all lives in iobufs. the parts that get dma'd start on their own cache line.
+//the command & status wrappers go out with every command, so they are iobufs of their own which
+//ehc can hand to the controller as a whole, without flushing them by range
+typedef struct
+{
+	u8 Descriptor[MSC_DESCRIPTOR_SIZE] ALIGNED(32);
+	HostDeviceEntry HostDevices[MSC_MAX_HOST_DEVICES] ALIGNED(32);
+	char Path[MSC_PATH_SIZE];
+	u8 OutEndpoint;
+	u8 InEndpoint;
+	u8 ControlEndpoint;
+	u8 RequestType;
+	u8 Request;
+	u8 DeviceCount;
+	u8 DeviceClass;
+	u8 DevicesFound;
+	u16 Value;
+	u16 Index;
+	u16 Length;
+	u32 CommandLength;
+	u32 DataLength;
+	u32 StatusLength;
+	IoctlvMessageData CommandVectors[3];
+	IoctlvMessageData DataVectors[3];
+	IoctlvMessageData StatusVectors[3];
+	IoctlvMessageData ControlVectors[7];
+	IoctlvMessageData ListVectors[4];
+} TransportBuffers;
+
+static TransportBuffers *_buffers = NULL;
+static MscCommandBlockWrapper *_commandBlock = NULL;
+static MscCommandStatusWrapper *_commandStatus = NULL;
+static s32 _hostFileDescriptor = -1;
+static s32 _transferQueue = -1;
+static u32 _transferQueueBuffer[4] ALIGNED(0x10);
+static s32 _timer = -1;
+static u32 _timerMessage;
+static IpcMessage _commandMessage;
+static IpcMessage _dataMessage;
+static IpcMessage _statusMessage;
+
+s32 InitialiseTransport(void)
+{
+	_buffers = OSAllocateIOBuf(sizeof(TransportBuffers), 0x20);
+	if (!_buffers)
+		return IPC_ENOMEM;
+
+	memset(_buffers, 0, sizeof(TransportBuffers));
+	s32 ret = IPC_ENOMEM;
+	_commandBlock = OSAllocateIOBuf(sizeof(MscCommandBlockWrapper), 0x20);
+	if (!_commandBlock)
+		goto error_free_buffers;
+
+	_commandStatus = OSAllocateIOBuf(sizeof(MscCommandStatusWrapper), 0x20);
+	if (!_commandStatus)
+		goto error_free_buffers;
+
+	ret = OSCreateMessageQueue(_transferQueueBuffer, ARRAY_LENGTH(_transferQueueBuffer));
+	if (ret < 0)
+		goto error_free_buffers;
+
+	_transferQueue = ret;
+	//created stopped, it gets armed for every command and every sleep
+	ret = OSCreateTimer(0, 0, _transferQueue, &_timerMessage);
+	if (ret < 0)
+		goto error_destroy_queue;
+
+	_timer = ret;
+	return IPC_SUCCESS;
+
+error_destroy_queue:
+	OSDestroyMessageQueue(_transferQueue);
+	_transferQueue = -1;
+error_free_buffers:
+	if (_commandStatus)
+		OSFreeIOBuf(_commandStatus);
+	if (_commandBlock)
+		OSFreeIOBuf(_commandBlock);
+	OSFreeIOBuf(_buffers);
+	_commandStatus = NULL;
+	_commandBlock = NULL;
+	_buffers = NULL;
+	return ret;
+}
+
+void SleepTransport(u32 delay)
+{
+	void *message = NULL;
+
+	if (OSRestartTimer(_timer, delay, 0) < 0)
+		return;
+
+	while (message != &_timerMessage)
+	{
+		if (OSReceiveMessage(_transferQueue, &message, 0) < 0)
+			break;
+	}
+	OSStopTimer(_timer);
+}
+
+static s32 SendControlRequest(MscDevice *device, u8 requestType, u8 request, u16 value, u16 index,
+                              u16 length)
+{
+	IoctlvMessageData *vectors = _buffers->ControlVectors;
+
+	if (device->HostFileDescriptor < 0)
+		return IPC_NOTREADY;
+
+	if (length > MSC_DESCRIPTOR_SIZE)
+		return IPC_EINVAL;
+
+	_buffers->RequestType = requestType;
+	_buffers->Request = request;
+	_buffers->Value = swap_u16(value);
+	_buffers->Index = swap_u16(index);
+	_buffers->Length = swap_u16(length);
+	_buffers->ControlEndpoint = 0;
+
+	vectors[0].Data = &_buffers->RequestType;
+	vectors[0].Length = sizeof(u8);
+	vectors[1].Data = &_buffers->Request;
+	vectors[1].Length = sizeof(u8);
+	vectors[2].Data = &_buffers->Value;
+	vectors[2].Length = sizeof(u16);
+	vectors[3].Data = &_buffers->Index;
+	vectors[3].Length = sizeof(u16);
+	vectors[4].Data = &_buffers->Length;
+	vectors[4].Length = sizeof(u16);
+	vectors[5].Data = &_buffers->ControlEndpoint;
+	vectors[5].Length = sizeof(u8);
+	vectors[6].Data = length != 0 ? _buffers->Descriptor : NULL;
+	vectors[6].Length = length;
+	return OSIoctlvFD(device->HostFileDescriptor, USBV0_IOCTL_CTRLMSG, 6, 1, vectors);
+}
+
+static s32 ClearHalt(MscDevice *device, u8 endpoint)
+{
+	return SendControlRequest(device, USB_DIR_OUT | USB_RECIP_ENDPOINT, USB_REQ_CLEAR_FEATURE,
+	                          USB_ENDPOINT_HALT, endpoint, 0);
+}
+
+static void ResetRecovery(MscDevice *device)
+{
+	s32 ret = SendControlRequest(device, USB_DIR_OUT | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+	                             MSC_REQ_BULK_ONLY_RESET, 0, device->InterfaceNumber, 0);
+	if (ret < 0)
+		printk("MSC: bulk-only reset failed: %d\n", ret);
+
+	ClearHalt(device, device->BulkInEndpoint);
+	ClearHalt(device, device->BulkOutEndpoint);
+}
+
+static s32 SubmitTransfer(MscDevice *device, IoctlvMessageData *vectors, u8 *endpoint, void *data,
+                          u32 *length, IpcMessage *message)
+{
+	vectors[0].Data = endpoint;
+	vectors[0].Length = sizeof(u8);
+	vectors[1].Data = length;
+	vectors[1].Length = sizeof(u32);
+	vectors[2].Data = data;
+	vectors[2].Length = *length;
+	return OSIoctlvFDAsync(device->HostFileDescriptor, USBV0_IOCTL_BLKMSG, 2, 1, vectors,
+	                       _transferQueue, message);
+}
+
+//collects the replies of the submitted phases. a failed command phase means nothing else will
+//move, so that ends the wait early just like the timeout does
+static s32 WaitForTransfers(u32 *pending)
+{
+	s32 ret = OSRestartTimer(_timer, MSC_COMMAND_TIMEOUT, 0);
+	if (ret < 0)
+		return ret;
+
+	while (*pending != 0)
+	{
+		IpcMessage *message = NULL;
+		ret = OSReceiveMessage(_transferQueue, &message, 0);
+		if (ret < 0)
+			break;
+
+		if ((void *)message == &_timerMessage)
+		{
+			ret = IPC_EINTR;
+			break;
+		}
+
+		(*pending)--;
+		if (message == &_commandMessage && message->Request.Result < 0)
+		{
+			ret = message->Request.Result;
+			break;
+		}
+	}
+
+	OSStopTimer(_timer);
+	return ret;
+}
+
+//closing the device makes the host controller cancel everything that is still queued for it
+static void AbortTransfers(MscDevice *device, u32 pending)
+{
+	OSCloseFD(device->HostFileDescriptor);
+	device->HostFileDescriptor = -1;
+
+	while (pending != 0)
+	{
+		void *message = NULL;
+		if (OSReceiveMessage(_transferQueue, &message, 0) < 0)
+			break;
+
+		if (message != &_timerMessage)
+			pending--;
+	}
+
+	const s32 fd = OSOpenFD(_buffers->Path, 0);
+	if (fd < 0)
+	{
+		printk("MSC: lost %04x:%04x\n", device->VendorId, device->ProductId);
+		return;
+	}
+
+	device->HostFileDescriptor = fd;
+}
+
+static s32 ReadStatus(MscDevice *device)
+{
+	u32 pending = 1;
+
+	_buffers->StatusLength = MSC_CSW_SIZE;
+	s32 ret = SubmitTransfer(device, _buffers->StatusVectors, &_buffers->InEndpoint,
+	                         _commandStatus, &_buffers->StatusLength, &_statusMessage);
+	if (ret < 0)
+		return ret;
+
+	ret = WaitForTransfers(&pending);
+	if (ret < 0)
+	{
+		AbortTransfers(device, pending);
+		return ret;
+	}
+
+	return _statusMessage.Request.Result;
+}
+
+s32 SendCommand(MscDevice *device, const u8 *command, u8 commandLength, void *data, u32 length,
+                bool isInput, u32 *transferred)
+{
+	MscCommandBlockWrapper *commandBlock = _commandBlock;
+	const MscCommandStatusWrapper *commandStatus = _commandStatus;
+	u32 pending = 0;
+	s32 ret;
+
+	*transferred = 0;
+	if (device->HostFileDescriptor < 0)
+		return IPC_NOTREADY;
+
+	if (commandLength > MSC_CBW_MAX_COMMAND_LENGTH || (length != 0 && !data))
+		return IPC_EINVAL;
+
+	const u32 tag = ++device->Tag;
+	memset(commandBlock, 0, sizeof(*commandBlock));
+	commandBlock->Signature = swap_u32(MSC_CBW_SIGNATURE);
+	commandBlock->Tag = swap_u32(tag);
+	commandBlock->DataTransferLength = swap_u32(length);
+	commandBlock->Flags = isInput ? MSC_CBW_DATA_IN : 0;
+	commandBlock->Lun = device->Lun;
+	commandBlock->CommandLength = commandLength;
+	memcpy(commandBlock->Command, command, commandLength);
+
+	_buffers->OutEndpoint = device->BulkOutEndpoint;
+	_buffers->InEndpoint = device->BulkInEndpoint;
+	_buffers->CommandLength = MSC_CBW_SIZE;
+	_buffers->DataLength = length;
+	_buffers->StatusLength = MSC_CSW_SIZE;
+	u8 *dataEndpoint = isInput ? &_buffers->InEndpoint : &_buffers->OutEndpoint;
+
+	//bulk-only allows no new command before the status of the previous one, but all phases of a
+	//command can be queued up front. the controller then runs them back to back, without a round
+	//trip through this module between them
+	ret = SubmitTransfer(device, _buffers->CommandVectors, &_buffers->OutEndpoint, commandBlock,
+	                     &_buffers->CommandLength, &_commandMessage);
+	if (ret < 0)
+		return ret;
+	pending++;
+
+	if (length != 0)
+	{
+		ret = SubmitTransfer(device, _buffers->DataVectors, dataEndpoint, data,
+		                     &_buffers->DataLength, &_dataMessage);
+		if (ret < 0)
+			goto abort;
+		pending++;
+	}
+
+	ret = SubmitTransfer(device, _buffers->StatusVectors, &_buffers->InEndpoint,
+	                     _commandStatus, &_buffers->StatusLength, &_statusMessage);
+	if (ret < 0)
+		goto abort;
+	pending++;
+
+	ret = WaitForTransfers(&pending);
+	if (ret < 0)
+		goto abort;
+
+	//a stalled data phase is how the device ends it early. the status follows once the halt is cleared
+	const s32 dataResult = length != 0 ? _dataMessage.Request.Result : 0;
+	if (dataResult < 0 && dataResult != IPC_EINVAL)
+	{
+		ret = dataResult;
+		goto reset;
+	}
+
+	if (dataResult == IPC_EINVAL)
+		ClearHalt(device, *dataEndpoint);
+
+	s32 statusResult = _statusMessage.Request.Result;
+	if (statusResult == IPC_EINVAL)
+	{
+		if (dataResult != IPC_EINVAL || !isInput)
+			ClearHalt(device, device->BulkInEndpoint);
+		statusResult = ReadStatus(device);
+	}
+
+	if (statusResult != MSC_CSW_SIZE || swap_u32(commandStatus->Signature) != MSC_CSW_SIGNATURE ||
+	    swap_u32(commandStatus->Tag) != tag || commandStatus->Status == MSC_CSW_PHASE_ERROR)
+	{
+		printk("MSC: command 0x%02x ended with an invalid status (%d)\n", command[0], statusResult);
+		ret = statusResult < 0 ? statusResult : IPC_UNKNOWN;
+		goto reset;
+	}
+
+	const u32 residue = swap_u32(commandStatus->DataResidue);
+	u32 done = residue < length ? length - residue : 0;
+	if (dataResult >= 0 && (u32)dataResult < done)
+		done = (u32)dataResult;
+
+	*transferred = done;
+	//the device reported a check condition, the sense data tells what went wrong
+	return commandStatus->Status == MSC_CSW_PASSED ? IPC_SUCCESS : IPC_CHECKVALUE;
+
+abort:
+	AbortTransfers(device, pending);
+reset:
+	if (device->HostFileDescriptor >= 0)
+		ResetRecovery(device);
+	return ret;
+}
+
+static void BuildDevicePath(char *path, u16 vendorId, u16 productId)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	const u16 ids[] = { vendorId, productId };
+	const size_t nameLength = strlen(MSC_HOST_DEVICE_NAME);
+
+	memcpy(path, MSC_HOST_DEVICE_NAME, nameLength);
+	path += nameLength;
+	for (u32 i = 0; i < ARRAY_LENGTH(ids); i++)
+	{
+		*path++ = '/';
+		for (s32 shift = 12; shift >= 0; shift -= 4) *path++ = hexDigits[(ids[i] >> shift) & 0x0F];
+	}
+	*path = '\0';
+}
+
+//picks the first bulk-only scsi interface out of the configuration, along with its bulk endpoints
+static s32 ParseConfiguration(MscDevice *device, const u8 *descriptor, u32 length)
+{
+	const u8 *lastDescriptor = descriptor + length;
+	bool found = false;
+
+	device->BulkInEndpoint = 0;
+	device->BulkOutEndpoint = 0;
+	for (; descriptor + 2 <= lastDescriptor && descriptor[0] != 0 &&
+	       descriptor + descriptor[0] <= lastDescriptor;
+	     descriptor += descriptor[0])
+	{
+		const UsbDescriptor *parsed = (const UsbDescriptor *)descriptor;
+		if (parsed->Header.DescriptorType == USB_DT_INTERFACE)
+		{
+			if (found)
+				break;
+
+			found = parsed->Interface.AlternateSetting == 0 &&
+			        parsed->Interface.InterfaceClass == USB_DEVICE_CLASS_MASS_STORAGE &&
+			        parsed->Interface.InterfaceSubClass == MSC_SUBCLASS_SCSI &&
+			        parsed->Interface.InterfaceProtocol == MSC_PROTOCOL_BULK_ONLY;
+			if (found)
+				device->InterfaceNumber = parsed->Interface.InterfaceNumber;
+			continue;
+		}
+
+		if (!found || parsed->Header.DescriptorType != USB_DT_ENDPOINT ||
+		    (parsed->Endpoint.Attributes & USB_ENDPOINT_XFERTYPE_MASK) != USB_ENDPOINT_XFER_BULK)
+			continue;
+
+		if (parsed->Endpoint.EndpointAddress & USB_DIR_IN)
+			device->BulkInEndpoint = parsed->Endpoint.EndpointAddress;
+		else
+			device->BulkOutEndpoint = parsed->Endpoint.EndpointAddress;
+	}
+
+	return found && device->BulkInEndpoint != 0 && device->BulkOutEndpoint != 0 ? IPC_SUCCESS :
+	                                                                             IPC_ENOENT;
+}
+
+static s32 OpenStorageInterface(MscDevice *device, const HostDeviceEntry *entry)
+{
+	BuildDevicePath(_buffers->Path, entry->VendorId, entry->ProductId);
+	s32 ret = OSOpenFD(_buffers->Path, 0);
+	if (ret < 0)
+		return ret;
+
+	device->HostFileDescriptor = ret;
+	device->VendorId = entry->VendorId;
+	device->ProductId = entry->ProductId;
+	ret = SendControlRequest(device, USB_DIR_IN, USB_REQ_GET_DESCRIPTOR, USB_DT_CONFIG << 8, 0,
+	                         MSC_DESCRIPTOR_SIZE);
+	if (ret >= 0)
+		ret = ParseConfiguration(device, _buffers->Descriptor, (u32)ret);
+
+	if (ret < 0)
+	{
+		OSCloseFD(device->HostFileDescriptor);
+		device->HostFileDescriptor = -1;
+	}
+
+	return ret;
+}
+
+s32 AttachTransport(MscDevice *device)
+{
+	IoctlvMessageData *vectors = _buffers->ListVectors;
+	s32 ret;
+
+	if (_hostFileDescriptor < 0)
+	{
+		ret = OSOpenFD(MSC_HOST_DEVICE_NAME, 0);
+		if (ret < 0)
+			return IPC_NOTREADY;
+
+		_hostFileDescriptor = ret;
+	}
+
+	_buffers->DeviceCount = MSC_MAX_HOST_DEVICES;
+	_buffers->DeviceClass = USB_DEVICE_CLASS_MASS_STORAGE;
+	_buffers->DevicesFound = 0;
+	vectors[0].Data = &_buffers->DeviceCount;
+	vectors[0].Length = sizeof(u8);
+	vectors[1].Data = &_buffers->DeviceClass;
+	vectors[1].Length = sizeof(u8);
+	vectors[2].Data = &_buffers->DevicesFound;
+	vectors[2].Length = sizeof(u8);
+	vectors[3].Data = _buffers->HostDevices;
+	vectors[3].Length = sizeof(_buffers->HostDevices);
+	ret = OSIoctlvFD(_hostFileDescriptor, USBV0_IOCTL_GETDEVLIST, 2, 2, vectors);
+	if (ret < 0)
+		return ret;
+
+	device->HostFileDescriptor = -1;
+	for (u8 i = 0; i < _buffers->DevicesFound && i < MSC_MAX_HOST_DEVICES; i++)
+	{
+		if (OpenStorageInterface(device, &_buffers->HostDevices[i]) == IPC_SUCCESS)
+			break;
+	}
+
+	if (device->HostFileDescriptor < 0)
+		return IPC_NOTREADY;
+
+	//devices with a single lun are allowed to stall this
+	ret = SendControlRequest(device, USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+	                         MSC_REQ_GET_MAX_LUN, 0, device->InterfaceNumber, 1);
+	if (ret == 1 && _buffers->Descriptor[0] != 0)
+		printk("MSC: %04x:%04x has %u luns, only lun 0 is used\n", device->VendorId,
+		       device->ProductId, _buffers->Descriptor[0] + 1);
+
+	device->Lun = 0;
+	device->Tag = 0;
+	return IPC_SUCCESS;
+}
+
+s32 ArmRemovalHook(MscDevice *device, s32 queueId, IpcMessage *message)
+{
+	if (device->HostFileDescriptor < 0)
+		return IPC_NOTREADY;
+
+	return OSIoctlFDAsync(device->HostFileDescriptor, USBV0_IOCTL_DEVREMOVALHOOK, NULL, 0, NULL, 0,
+	                      queueId, message);
+}
+
+void DetachTransport(MscDevice *device)
+{
+	if (device->HostFileDescriptor >= 0)
+		OSCloseFD(device->HostFileDescriptor);
+
+	memset(device, 0, sizeof(*device));
+	device->HostFileDescriptor = -1;
+}
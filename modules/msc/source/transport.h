@@ -0,0 +1,32 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - usb mass storage block device
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+#include <ios/ipc.h>
+
+#include "msc.h"
+
+#define MSC_HOST_DEVICE_NAME  "/dev/usb/ehc"
+
+//a spinning disk can take a while to come out of standby
+#define MSC_COMMAND_TIMEOUT   10000000
+
+#define swap_u16(value)       __builtin_bswap16(value)
+#define swap_u32(value)       __builtin_bswap32(value)
+
+s32 InitialiseTransport(void);
+void SleepTransport(u32 delay);
+s32 AttachTransport(MscDevice *device);
+s32 ArmRemovalHook(MscDevice *device, s32 queueId, IpcMessage *message);
+void DetachTransport(MscDevice *device);
+s32 SendCommand(MscDevice *device, const u8 *command, u8 commandLength, void *data, u32 length,
+                bool isInput, u32 *transferred);
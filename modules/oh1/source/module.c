@@ -423,11 +423,20 @@ static int SendControlMessage(OH1ModuleControl *module, s8 deviceIndex,
 {
 	int rc;
 	void *receivedMessage;
+	void *data = message->Oh1.Data;
+
+	//the enumeration buffers are iobufs, so handing them over also takes care of the cache.
+	//the reply only goes back to the timer queue, which does not invalidate the data for us
+	if (data)
+		OSIOBufToDevice(data, (AHBDEV)module->AHBDevice);
 
 	rc = SendControlMessageAsync(module, message, NULL, module->TimerQueue, deviceIndex);
 	if (rc >= 0)
 		rc = OSReceiveMessage(module->TimerQueue, &receivedMessage, 0);
 
+	if (data)
+		OSIOBufFromDevice(data, (AHBDEV)module->AHBDevice);
+
 	return rc;
 }
 
@@ -589,7 +598,7 @@ static int ConfigureDevice(OH1ModuleControl *module, s8 deviceIndex,
 	configuration->TotalLength = swap_u16(configuration->TotalLength);
 	SetMaxPower(deviceIndex, configuration->MaxPower);
 	u16 total_length = configuration->TotalLength;
-	configurationReply = OSAlignedAllocateMemory(_moduleHeap, total_length, 32);
+	configurationReply = OSAllocateIOBuf(total_length, 0x20);
 	if (configurationReply)
 	{
 		memset(configurationReply, 0, total_length);
@@ -607,7 +616,7 @@ static int ConfigureDevice(OH1ModuleControl *module, s8 deviceIndex,
 		if (rc == 0)
 			ParseDescriptors(module, deviceIndex, configurationReply, total_length);
 
-		OSFreeMemory(_moduleHeap, configurationReply);
+		OSFreeIOBuf(configurationReply);
 	}
 	u8 conf_value = configuration->ConfigurationValue;
 	memset(_controlRequest, 0, sizeof(*_controlRequest));
@@ -730,7 +739,7 @@ int QueryModuleDevices(OH1ModuleControl *module)
 	oldRootHubDescription = module->HardwareRegisters->RootHubDiscriptorA;
 	rootHubDescription = oldRootHubDescription & ~RH_A_RESERVED;
 	ret = IPC_SUCCESS;
-	_controlRequest = OSAlignedAllocateMemory(_moduleHeap, sizeof(USBControlMessage), 32);
+	_controlRequest = OSAllocateIOBuf(sizeof(USBControlMessage), 0x20);
 	if (_controlRequest == NULL)
 		return IPC_EMAX;
 
@@ -788,11 +797,20 @@ int QueryModuleDevices(OH1ModuleControl *module)
 		}
 
 		size_t descriptorSize = PADDED4_SIZEOF(*device);
-		device = OSAlignedAllocateMemory(_moduleHeap, descriptorSize, 32);
-		memset(device, 0, descriptorSize);
-
 		size_t configurationSize = PADDED4_SIZEOF(*configuration);
-		configuration = OSAlignedAllocateMemory(_moduleHeap, configurationSize, 32);
+		device = OSAllocateIOBuf(descriptorSize, 0x20);
+		configuration = OSAllocateIOBuf(configurationSize, 0x20);
+		if (device == NULL || configuration == NULL)
+		{
+			if (device != NULL)
+				OSFreeIOBuf(device);
+			if (configuration != NULL)
+				OSFreeIOBuf(configuration);
+			ret = IPC_EMAX;
+			break;
+		}
+
+		memset(device, 0, descriptorSize);
 		memset(configuration, 0, configurationSize);
 
 		ret = ConfigureDevice(module, deviceIndex, device, configuration);
@@ -805,8 +823,8 @@ int QueryModuleDevices(OH1ModuleControl *module)
 			       deviceName, portIndex, swap_u16(device->VendorId),
 			       swap_u16(device->ProductId));
 		}
-		OSFreeMemory(_moduleHeap, device);
-		OSFreeMemory(_moduleHeap, configuration);
+		OSFreeIOBuf(device);
+		OSFreeIOBuf(configuration);
 	}
 
 	for (portIndex = 0; portIndex < numberOfPorts; portIndex++)
@@ -814,7 +832,7 @@ int QueryModuleDevices(OH1ModuleControl *module)
 		                                          RH_PS_PSSC | RH_PS_OCIC;
 
 	module->State |= OH1_STATE_DEVICE_QUERIED;
-	OSFreeMemory(_moduleHeap, _controlRequest);
+	OSFreeIOBuf(_controlRequest);
 	return ret;
 }
 
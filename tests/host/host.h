@@ -0,0 +1,72 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	host - the bits of a libc the host side tests need
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <types.h>
+
+//the tests are built as freestanding 32 bit binaries, so the code under test sees the same
+//type sizes as on the starlet without needing a 32 bit libc. this is all they get instead
+int HostPrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void HostExit(s32 code) __attribute__((noreturn));
+
+//microseconds since some point in the past
+u32 HostGetTicks(void);
+
+//zeroed memory, straight from the host's kernel
+void *HostAllocate(u32 size);
+void HostFree(void *ptr, u32 size);
+
+s32 HostOpenFile(const char *path);
+void HostCloseFile(s32 fd);
+void HostDeleteFile(const char *path);
+s32 HostReadFile(s32 fd, void *data, u32 size, u64 offset);
+s32 HostWriteFile(s32 fd, const void *data, u32 size, u64 offset);
+
+//every test binary is a list of these. a test passes when none of its checks failed
+extern u32 TestFailures;
+
+#define TEST_CHECK(condition)                                                                 \
+	do                                                                                        \
+	{                                                                                         \
+		if (!(condition))                                                                     \
+		{                                                                                     \
+			TestFailures++;                                                                   \
+			HostPrintf("  %s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);        \
+		}                                                                                     \
+	} while (0)
+
+#define TEST_EQUAL(actual, expected)                                                          \
+	do                                                                                        \
+	{                                                                                         \
+		const s32 _actual = (s32)(actual);                                                    \
+		const s32 _expected = (s32)(expected);                                                \
+		if (_actual != _expected)                                                             \
+		{                                                                                     \
+			TestFailures++;                                                                   \
+			HostPrintf("  %s:%d: %s is %d (0x%08X), expected %d (0x%08X)\n", __FILE__,       \
+			           __LINE__, #actual, _actual, _actual, _expected, _expected);            \
+		}                                                                                     \
+	} while (0)
+
+typedef void (*TestFunction)(void);
+typedef struct
+{
+	const char *Name;
+	TestFunction Function;
+} TestCase;
+
+#define TEST_CASE(function) { #function, function }
+
+//runs all tests & returns the exit code of the binary
+s32 RunTests(const char *suite, const TestCase *tests, u32 count);
+
+#endif
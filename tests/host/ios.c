@@ -0,0 +1,326 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ios - the syscalls the modules use, run on the host
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <stdarg.h>
+#include <string.h>
+#include <vsprintf.h>
+#include <ios/errno.h>
+#include <ios/printk.h>
+#include <ios/syscalls.h>
+
+#include "host.h"
+#include "ios.h"
+
+#define MAX_QUEUES    0x08
+#define MAX_TIMERS    0x08
+#define MAX_RESOURCES 0x08
+
+typedef struct
+{
+	void **Messages;
+	u32 Size;
+	u32 First;
+	u32 Count;
+} HostQueue;
+
+typedef struct
+{
+	bool Used;
+	bool Armed;
+	s32 QueueId;
+	void *Message;
+	u32 PeriodUs;
+} HostTimer;
+
+typedef struct
+{
+	const char *Path;
+	s32 QueueId;
+} HostResource;
+
+static HostQueue Queues[MAX_QUEUES];
+static HostTimer Timers[MAX_TIMERS];
+static HostResource Resources[MAX_RESOURCES];
+u32 HmacCount = 0;
+
+void ResetHostIos(void)
+{
+	memset(Queues, 0, sizeof(Queues));
+	memset(Timers, 0, sizeof(Timers));
+	memset(Resources, 0, sizeof(Resources));
+	HmacCount = 0;
+}
+
+int printk(const char *fmt, ...)
+{
+	char buffer[0x200];
+	va_list args;
+
+	va_start(args, fmt);
+	const int length = vsnprintf(buffer, sizeof(buffer), fmt, args);
+	va_end(args);
+
+	HostPrintf("  | %s", buffer);
+	if (length <= 0 || buffer[strnlen(buffer, sizeof(buffer)) - 1] != '\n')
+		HostPrintf("\n");
+	return length;
+}
+
+void OSPrintk(const char *str)
+{
+	printk("%s", str);
+}
+
+s32 OSCreateMessageQueue(void *ptr, u32 size)
+{
+	for (s32 i = 0; i < MAX_QUEUES; i++)
+	{
+		if (Queues[i].Messages != NULL)
+			continue;
+
+		Queues[i].Messages = (void **)ptr;
+		Queues[i].Size = size;
+		Queues[i].First = 0;
+		Queues[i].Count = 0;
+		return i;
+	}
+
+	return IPC_EMAX;
+}
+
+s32 OSDestroyMessageQueue(s32 queueid)
+{
+	if (queueid < 0 || queueid >= MAX_QUEUES || Queues[queueid].Messages == NULL)
+		return IPC_EINVAL;
+
+	Queues[queueid].Messages = NULL;
+	return IPC_SUCCESS;
+}
+
+s32 OSSendMessage(s32 queueid, void *message, MessageQueueFlags flags)
+{
+	(void)flags;
+	if (queueid < 0 || queueid >= MAX_QUEUES || Queues[queueid].Messages == NULL)
+		return IPC_EINVAL;
+
+	HostQueue *queue = &Queues[queueid];
+	if (queue->Count >= queue->Size)
+		return IPC_EQUEUEFULL;
+
+	queue->Messages[(queue->First + queue->Count) % queue->Size] = message;
+	queue->Count++;
+	return IPC_SUCCESS;
+}
+
+s32 OSReceiveMessage(s32 queueid, void *message, MessageQueueFlags flags)
+{
+	(void)flags;
+	if (queueid < 0 || queueid >= MAX_QUEUES || Queues[queueid].Messages == NULL)
+		return IPC_EINVAL;
+
+	HostQueue *queue = &Queues[queueid];
+	if (queue->Count == 0)
+		return IPC_EQUEUEEMPTY;
+
+	*(void **)message = queue->Messages[queue->First];
+	queue->First = (queue->First + 1) % queue->Size;
+	queue->Count--;
+	return IPC_SUCCESS;
+}
+
+s32 QueueRequest(s32 queueId, IpcMessage *message)
+{
+	message->Request.Result = IPC_NOTREADY;
+	message->IsInQueue = 1;
+	return OSSendMessage(queueId, message, None);
+}
+
+s32 OSResourceReply(IpcMessage *message, s32 requestReturnValue)
+{
+	message->Request.Result = requestReturnValue;
+	message->IsInQueue = 0;
+	return IPC_SUCCESS;
+}
+
+s32 OSRegisterResourceManager(const char *devicePath, const s32 queueid)
+{
+	for (u32 i = 0; i < MAX_RESOURCES; i++)
+	{
+		if (Resources[i].Path != NULL && strcmp(Resources[i].Path, devicePath) != 0)
+			continue;
+
+		Resources[i].Path = devicePath;
+		Resources[i].QueueId = queueid;
+		return IPC_SUCCESS;
+	}
+
+	return IPC_EMAX;
+}
+
+s32 GetResourceQueue(const char *path)
+{
+	for (u32 i = 0; i < MAX_RESOURCES; i++)
+	{
+		if (Resources[i].Path != NULL && strcmp(Resources[i].Path, path) == 0)
+			return Resources[i].QueueId;
+	}
+
+	return IPC_ENOENT;
+}
+
+s32 OSCreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message)
+{
+	for (s32 i = 0; i < MAX_TIMERS; i++)
+	{
+		if (Timers[i].Used)
+			continue;
+
+		Timers[i].Used = true;
+		Timers[i].Armed = delayUs != 0 || periodUs != 0;
+		Timers[i].QueueId = queueid;
+		Timers[i].Message = message;
+		Timers[i].PeriodUs = periodUs;
+		return i;
+	}
+
+	return IPC_EMAX;
+}
+
+static HostTimer *GetTimer(s32 timerId)
+{
+	if (timerId < 0 || timerId >= MAX_TIMERS || !Timers[timerId].Used)
+		return NULL;
+
+	return &Timers[timerId];
+}
+
+s32 OSDestroyTimer(s32 timerId)
+{
+	HostTimer *timer = GetTimer(timerId);
+	if (timer == NULL)
+		return IPC_EINVAL;
+
+	timer->Used = false;
+	return IPC_SUCCESS;
+}
+
+s32 OSStopTimer(s32 timerId)
+{
+	HostTimer *timer = GetTimer(timerId);
+	if (timer == NULL)
+		return IPC_EINVAL;
+
+	timer->Armed = false;
+	return IPC_SUCCESS;
+}
+
+s32 OSRestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
+{
+	HostTimer *timer = GetTimer(timerId);
+	if (timer == NULL)
+		return IPC_EINVAL;
+
+	timer->Armed = timeUs != 0 || repeatTimeUs != 0;
+	timer->PeriodUs = repeatTimeUs;
+	return IPC_SUCCESS;
+}
+
+//the starlet's timer ticks about once a microsecond, which is what the host counts in
+u32 OSGetTimerValue(void)
+{
+	return HostGetTicks();
+}
+
+bool IsTimerArmed(s32 timerId)
+{
+	const HostTimer *timer = GetTimer(timerId);
+	return timer != NULL && timer->Armed;
+}
+
+u32 FireTimers(void)
+{
+	u32 fired = 0;
+	for (s32 i = 0; i < MAX_TIMERS; i++)
+	{
+		HostTimer *timer = &Timers[i];
+		if (!timer->Used || !timer->Armed)
+			continue;
+
+		//like the kernel, a full queue just drops the message
+		OSSendMessage(timer->QueueId, timer->Message, None);
+		if (timer->PeriodUs == 0)
+			timer->Armed = false;
+		fired++;
+	}
+
+	return fired;
+}
+
+//fnv-1a spread over the 5 words of the context. not a mac, but any changed byte changes it
+static void MixHmac(ShaContext *context, const void *data, u32 size)
+{
+	const u8 *input = (const u8 *)data;
+	for (u32 i = 0; i < size; i++)
+	{
+		u32 *state = &context->ShaStates[(u32)context->Length % SHA_NUM_WORDS];
+		*state = (*state ^ input[i]) * 0x01000193;
+		context->Length++;
+	}
+}
+
+s32 OSIOSCGenerateBlockMAC(ShaContext *context, const void *inputData, u32 inputSize,
+                           const void *customData, u32 customDataSize, u32 keyHandle,
+                           HMacCommandType hmacCommand, void *signData)
+{
+	switch (hmacCommand)
+	{
+		case InitHMacState:
+			for (u32 i = 0; i < SHA_NUM_WORDS; i++)
+				context->ShaStates[i] = 0x811C9DC5 ^ keyHandle ^ i;
+			context->Length = 0;
+			MixHmac(context, customData, customDataSize);
+			MixHmac(context, inputData, inputSize);
+			return IPC_SUCCESS;
+		case ContributeHMacState:
+			MixHmac(context, inputData, inputSize);
+			return IPC_SUCCESS;
+		case FinalizeHmacState:
+			MixHmac(context, inputData, inputSize);
+			memcpy(signData, context->ShaStates, sizeof(context->ShaStates));
+			HmacCount++;
+			return IPC_SUCCESS;
+		default:
+			return IPC_EINVAL;
+	}
+}
+
+static void CryptData(u32 keyHandle, const void *inputData, u32 dataSize, void *outputData)
+{
+	const u8 *input = (const u8 *)inputData;
+	u8 *output = (u8 *)outputData;
+	for (u32 i = 0; i < dataSize; i++)
+		output[i] = input[i] ^ (u8)((keyHandle * 0x1F) + (i * 0x3B) + 0x5A);
+}
+
+s32 OSIOSCEncrypt(u32 keyHandle, void *ivData, const void *inputData, u32 dataSize,
+                  void *outputData)
+{
+	(void)ivData;
+	CryptData(keyHandle, inputData, dataSize, outputData);
+	return IPC_SUCCESS;
+}
+
+s32 OSIOSCDecrypt(u32 keyHandle, void *ivData, const void *inputData, u32 dataSize,
+                  void *outputData)
+{
+	(void)ivData;
+	CryptData(keyHandle, inputData, dataSize, outputData);
+	return IPC_SUCCESS;
+}
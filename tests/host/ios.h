@@ -0,0 +1,30 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ios - the syscalls the modules use, run on the host
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __HOST_IOS_H__
+#define __HOST_IOS_H__
+
+#include <types.h>
+#include <ios/ipc.h>
+
+//nothing ever blocks: receiving from an empty queue fails, which ends a module's main loop.
+//so a test queues up its requests & then runs the module's main until it has handled them all
+void ResetHostIos(void);
+s32 GetResourceQueue(const char *path);
+s32 QueueRequest(s32 queueId, IpcMessage *message);
+
+//sends the message of every armed timer, as if all of their delays passed
+u32 FireTimers(void);
+bool IsTimerArmed(s32 timerId);
+
+//the aes & hmac engines are replaced by something cheap that still catches corruption
+extern u32 HmacCount;
+
+#endif
@@ -0,0 +1,211 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	nandImage - the flash syscalls of the kernel, backed by an image file
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/syscalls.h>
+
+#include "host.h"
+#include "nandImage.h"
+
+#define NAND_RAW_PAGE_SIZE (NAND_PAGE_SIZE + NAND_SPARE_SIZE)
+
+static s32 ImageFd = -1;
+static const char *ImagePath = NULL;
+static u8 RawPage[NAND_RAW_PAGE_SIZE];
+static u8 ErasedBlock[NAND_RAW_PAGE_SIZE * NAND_PAGES_PER_BLOCK];
+
+static u8 BlockFaults[NAND_BLOCK_COUNT];
+static bool BadBlocks[NAND_BLOCK_COUNT];
+static u32 PageReads[NAND_BLOCK_COUNT];
+static u32 PageWrites[NAND_BLOCK_COUNT];
+static u32 BlockErases[NAND_BLOCK_COUNT];
+
+static inline u64 GetPageOffset(u32 page)
+{
+	return (u64)page * NAND_RAW_PAGE_SIZE;
+}
+
+//the image holds every byte inverted, so the holes of a sparse file read as erased
+static s32 ReadRawPage(u32 page)
+{
+	memset(RawPage, 0, sizeof(RawPage));
+	const s32 ret = HostReadFile(ImageFd, RawPage, NAND_RAW_PAGE_SIZE, GetPageOffset(page));
+	if (ret < 0)
+		return ret;
+
+	for (u32 i = 0; i < NAND_RAW_PAGE_SIZE; i++)
+		RawPage[i] = (u8)~RawPage[i];
+	return IPC_SUCCESS;
+}
+
+s32 OpenNandImage(const char *path)
+{
+	ImageFd = HostOpenFile(path);
+	if (ImageFd < 0)
+		return ImageFd;
+
+	ImagePath = path;
+	memset(BlockFaults, NandFaultNone, sizeof(BlockFaults));
+	memset(BadBlocks, 0, sizeof(BadBlocks));
+	ResetNandImageStats();
+	return IPC_SUCCESS;
+}
+
+void CloseNandImage(void)
+{
+	if (ImageFd < 0)
+		return;
+
+	HostCloseFile(ImageFd);
+	HostDeleteFile(ImagePath);
+	ImageFd = -1;
+}
+
+void SetNandFault(u32 block, NandFault fault)
+{
+	BlockFaults[block] = (u8)fault;
+}
+
+bool IsNandBlockBad(u32 block)
+{
+	return BadBlocks[block];
+}
+
+void ForgetNandBadBlocks(void)
+{
+	memset(BadBlocks, 0, sizeof(BadBlocks));
+}
+
+void GetNandImageStats(u32 firstBlock, u32 count, NandImageStats *stats)
+{
+	memset(stats, 0, sizeof(NandImageStats));
+	for (u32 block = firstBlock; block < firstBlock + count && block < NAND_BLOCK_COUNT; block++)
+	{
+		stats->PageReads += PageReads[block];
+		stats->PageWrites += PageWrites[block];
+		stats->BlockErases += BlockErases[block];
+	}
+}
+
+void ResetNandImageStats(void)
+{
+	memset(PageReads, 0, sizeof(PageReads));
+	memset(PageWrites, 0, sizeof(PageWrites));
+	memset(BlockErases, 0, sizeof(BlockErases));
+}
+
+//same checks & results as the kernel's flash syscalls, minus the caller & pointer checks
+s32 OSReadFlashPage(u32 page, void *data, void *spare)
+{
+	if (ImageFd < 0 || page >= NAND_PAGE_COUNT)
+		return IPC_EINVAL;
+
+	const u32 block = page / NAND_PAGES_PER_BLOCK;
+	if (ReadRawPage(page) != IPC_SUCCESS)
+		return IPC_EINVAL;
+
+	PageReads[block]++;
+	if (data != NULL)
+		memcpy(data, RawPage, NAND_PAGE_SIZE);
+	if (spare != NULL)
+		memcpy(spare, &RawPage[NAND_PAGE_SIZE], NAND_SPARE_SIZE);
+
+	switch (BlockFaults[block])
+	{
+		case NandFaultUncorrectable:
+			return IPC_ECC_CRIT;
+		case NandFaultCorrectable:
+			return IPC_ECC;
+		default:
+			return IPC_SUCCESS;
+	}
+}
+
+s32 OSWriteFlashPage(u32 page, const void *data, const void *spare)
+{
+	if (ImageFd < 0 || page >= NAND_PAGE_COUNT || data == NULL || spare == NULL)
+		return IPC_EINVAL;
+
+	const u32 block = page / NAND_PAGES_PER_BLOCK;
+	if (BadBlocks[block])
+		return IPC_BADBLOCK;
+
+	if (page < NAND_PROTECTED_PAGES)
+		return IPC_EACCES;
+
+	if (BlockFaults[block] == NandFaultProgram || BlockFaults[block] == NandFaultFactoryBad)
+	{
+		BadBlocks[block] = true;
+		return IPC_BADBLOCK;
+	}
+
+	//programming can only clear bits, anything else needs an erase first
+	if (ReadRawPage(page) != IPC_SUCCESS)
+		return IPC_EINVAL;
+
+	const u8 *pageData = (const u8 *)data;
+	const u8 *spareData = (const u8 *)spare;
+	for (u32 i = 0; i < NAND_PAGE_SIZE; i++)
+		RawPage[i] = (u8)~(RawPage[i] & pageData[i]);
+	for (u32 i = 0; i < NAND_SPARE_SIZE; i++)
+		RawPage[NAND_PAGE_SIZE + i] = (u8)~(RawPage[NAND_PAGE_SIZE + i] & spareData[i]);
+
+	if (HostWriteFile(ImageFd, RawPage, NAND_RAW_PAGE_SIZE, GetPageOffset(page)) !=
+	    NAND_RAW_PAGE_SIZE)
+		return IPC_EINVAL;
+
+	PageWrites[block]++;
+	return IPC_SUCCESS;
+}
+
+s32 OSEraseFlashBlock(u32 block)
+{
+	if (ImageFd < 0 || block >= NAND_BLOCK_COUNT)
+		return IPC_EINVAL;
+
+	if (BadBlocks[block])
+		return IPC_BADBLOCK;
+
+	if (block * NAND_PAGES_PER_BLOCK < NAND_PROTECTED_PAGES)
+		return IPC_EACCES;
+
+	if (BlockFaults[block] == NandFaultErase || BlockFaults[block] == NandFaultFactoryBad)
+	{
+		BadBlocks[block] = true;
+		return IPC_BADBLOCK;
+	}
+
+	if (HostWriteFile(ImageFd, ErasedBlock, sizeof(ErasedBlock),
+	                  GetPageOffset(block * NAND_PAGES_PER_BLOCK)) != sizeof(ErasedBlock))
+		return IPC_EINVAL;
+
+	BlockErases[block]++;
+	return IPC_SUCCESS;
+}
+
+s32 OSGetFlashBlockStats(u32 block, FlashBlockStats *stats)
+{
+	if (block >= NAND_BLOCK_COUNT)
+		return IPC_EINVAL;
+
+	memset(stats, 0, sizeof(FlashBlockStats));
+	stats->Bad = BadBlocks[block];
+	return IPC_SUCCESS;
+}
+
+s32 OSMarkFlashBlockBad(u32 block)
+{
+	if (block >= NAND_BLOCK_COUNT)
+		return IPC_EINVAL;
+
+	BadBlocks[block] = true;
+	return IPC_SUCCESS;
+}
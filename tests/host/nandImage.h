@@ -0,0 +1,59 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	nandImage - the flash syscalls of the kernel, backed by an image file
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __NANDIMAGE_H__
+#define __NANDIMAGE_H__
+
+#include <types.h>
+
+#define NAND_PAGE_SIZE        0x800
+#define NAND_SPARE_SIZE       0x40
+#define NAND_PAGES_PER_BLOCK  0x40
+#define NAND_PAGE_COUNT       0x40000
+#define NAND_BLOCK_COUNT      (NAND_PAGE_COUNT / NAND_PAGES_PER_BLOCK)
+#define NAND_PROTECTED_PAGES  0x200
+
+//what the next access to a block runs into
+typedef enum
+{
+	NandFaultNone = 0,
+	//bad from the factory. the kernel only learns this from the filesystem's fat
+	NandFaultFactoryBad = 1,
+	//programming any page of the block fails & the kernel marks it bad
+	NandFaultProgram = 2,
+	//erasing the block fails & the kernel marks it bad
+	NandFaultErase = 3,
+	//reads of the block return an uncorrectable ecc error
+	NandFaultUncorrectable = 4,
+	//reads of the block return a corrected ecc error
+	NandFaultCorrectable = 5,
+} NandFault;
+
+typedef struct
+{
+	u32 PageReads;
+	u32 PageWrites;
+	u32 BlockErases;
+} NandImageStats;
+
+//the image is sparse & starts out erased. pages are stored inverted, so holes read as 0xFF
+s32 OpenNandImage(const char *path);
+void CloseNandImage(void);
+
+void SetNandFault(u32 block, NandFault fault);
+bool IsNandBlockBad(u32 block);
+//the kernel's bad block table only lives in memory, this is what a reboot does to it
+void ForgetNandBadBlocks(void);
+
+//counts accesses to the blocks in [firstBlock, firstBlock + count)
+void GetNandImageStats(u32 firstBlock, u32 count, NandImageStats *stats);
+void ResetNandImageStats(void);
+
+#endif
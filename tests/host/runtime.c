@@ -0,0 +1,317 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	host - the bits of a libc the host side tests need
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <stdarg.h>
+#include <string.h>
+#include <vsprintf.h>
+
+#include "host.h"
+
+//i386 linux system calls
+#define SYS_EXIT_GROUP    252
+#define SYS_WRITE         4
+#define SYS_OPEN          5
+#define SYS_CLOSE         6
+#define SYS_UNLINK        10
+#define SYS_MMAP          90
+#define SYS_MUNMAP        91
+#define SYS_PREAD64       180
+#define SYS_PWRITE64      181
+#define SYS_CLOCK_GETTIME 265
+
+#define O_RDWR      0x0002
+#define O_CREAT     0x0040
+#define O_TRUNC     0x0200
+#define O_LARGEFILE 0x8000
+
+#define PROT_READWRITE     0x03
+#define MAP_PRIVATE_ANON   0x22
+#define CLOCK_MONOTONIC    1
+#define HOST_PAGE_SIZE     0x1000
+
+u32 TestFailures = 0;
+
+int main(void);
+
+__asm__(".globl _start\n"
+        "_start:\n"
+        "	xor %ebp, %ebp\n"
+        "	and $-16, %esp\n"
+        "	call main\n"
+        "	mov %eax, %ebx\n"
+        "	mov $252, %eax\n"
+        "	int $0x80\n"
+        "	hlt\n");
+
+static s32 SystemCall(u32 number, u32 arg0, u32 arg1, u32 arg2, u32 arg3, u32 arg4)
+{
+	s32 ret;
+	__asm__ volatile("int $0x80"
+	                 : "=a"(ret)
+	                 : "a"(number), "b"(arg0), "c"(arg1), "d"(arg2), "S"(arg3), "D"(arg4)
+	                 : "memory");
+	return ret;
+}
+
+void HostExit(s32 code)
+{
+	SystemCall(SYS_EXIT_GROUP, (u32)code, 0, 0, 0, 0);
+	while (1)
+		;
+}
+
+static void HostWrite(const char *text, u32 length)
+{
+	while (length > 0)
+	{
+		const s32 written = SystemCall(SYS_WRITE, 1, (u32)text, length, 0, 0);
+		if (written <= 0)
+			return;
+
+		text += written;
+		length -= (u32)written;
+	}
+}
+
+int HostPrintf(const char *fmt, ...)
+{
+	char buffer[0x400];
+	va_list args;
+
+	va_start(args, fmt);
+	int length = vsnprintf(buffer, sizeof(buffer), fmt, args);
+	va_end(args);
+
+	if (length > (int)sizeof(buffer) - 1)
+		length = sizeof(buffer) - 1;
+	if (length > 0)
+		HostWrite(buffer, (u32)length);
+	return length;
+}
+
+u32 HostGetTicks(void)
+{
+	s32 time[2];
+	SystemCall(SYS_CLOCK_GETTIME, CLOCK_MONOTONIC, (u32)time, 0, 0, 0);
+	return ((u32)time[0] * 1000000) + ((u32)time[1] / 1000);
+}
+
+void *HostAllocate(u32 size)
+{
+	//the old mmap takes its arguments as an array
+	u32 arguments[6] = { 0, size, PROT_READWRITE, MAP_PRIVATE_ANON, (u32)-1, 0 };
+	const s32 ret = SystemCall(SYS_MMAP, (u32)arguments, 0, 0, 0, 0);
+	if (ret < 0 && ret > -HOST_PAGE_SIZE)
+	{
+		HostPrintf("failed to allocate 0x%X bytes: %d\n", size, ret);
+		HostExit(2);
+	}
+
+	return (void *)ret;
+}
+
+void HostFree(void *ptr, u32 size)
+{
+	if (ptr != NULL)
+		SystemCall(SYS_MUNMAP, (u32)ptr, size, 0, 0, 0);
+}
+
+s32 HostOpenFile(const char *path)
+{
+	return SystemCall(SYS_OPEN, (u32)path, O_RDWR | O_CREAT | O_TRUNC | O_LARGEFILE, 0644, 0, 0);
+}
+
+void HostCloseFile(s32 fd)
+{
+	SystemCall(SYS_CLOSE, (u32)fd, 0, 0, 0, 0);
+}
+
+void HostDeleteFile(const char *path)
+{
+	SystemCall(SYS_UNLINK, (u32)path, 0, 0, 0, 0);
+}
+
+s32 HostReadFile(s32 fd, void *data, u32 size, u64 offset)
+{
+	return SystemCall(SYS_PREAD64, (u32)fd, (u32)data, size, (u32)offset, (u32)(offset >> 32));
+}
+
+s32 HostWriteFile(s32 fd, const void *data, u32 size, u64 offset)
+{
+	return SystemCall(SYS_PWRITE64, (u32)fd, (u32)data, size, (u32)offset,
+	                  (u32)(offset >> 32));
+}
+
+s32 RunTests(const char *suite, const TestCase *tests, u32 count)
+{
+	u32 failed = 0;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const u32 failures = TestFailures;
+		tests[i].Function();
+
+		const bool passed = TestFailures == failures;
+		HostPrintf("%s: %s %s\n", suite, tests[i].Name, passed ? "ok" : "FAILED");
+		if (!passed)
+			failed++;
+	}
+
+	HostPrintf("%s: %u of %u tests passed\n", suite, count - failed, count);
+	return failed == 0 ? 0 : 1;
+}
+
+//the string functions of core are written in arm assembly, so the host gets plain c ones
+size_t strlen(const char *str)
+{
+	size_t length = 0;
+	while (str[length] != '\0')
+		length++;
+	return length;
+}
+
+size_t strnlen(const char *str, size_t count)
+{
+	size_t length = 0;
+	while (length < count && str[length] != '\0')
+		length++;
+	return length;
+}
+
+void *memset(void *dst, int value, size_t count)
+{
+	u8 *out = (u8 *)dst;
+	while (count-- > 0)
+		*out++ = (u8)value;
+	return dst;
+}
+
+void *memcpy(void *dst, const void *src, size_t count)
+{
+	u8 *out = (u8 *)dst;
+	const u8 *in = (const u8 *)src;
+	while (count-- > 0)
+		*out++ = *in++;
+	return dst;
+}
+
+void *memmove(void *dst, const void *src, size_t count)
+{
+	u8 *out = (u8 *)dst;
+	const u8 *in = (const u8 *)src;
+	if (out <= in)
+		return memcpy(dst, src, count);
+
+	while (count-- > 0)
+		out[count] = in[count];
+	return dst;
+}
+
+int memcmp(const void *left, const void *right, size_t count)
+{
+	const u8 *a = (const u8 *)left;
+	const u8 *b = (const u8 *)right;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (a[i] != b[i])
+			return a[i] - b[i];
+	}
+	return 0;
+}
+
+int strncmp(const char *left, const char *right, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (left[i] != right[i] || left[i] == '\0')
+			return (u8)left[i] - (u8)right[i];
+	}
+	return 0;
+}
+
+int strcmp(const char *left, const char *right)
+{
+	return strncmp(left, right, (size_t)-1);
+}
+
+char *strncpy(char *dst, const char *src, size_t count)
+{
+	size_t i = 0;
+	for (; i < count && src[i] != '\0'; i++)
+		dst[i] = src[i];
+	for (; i < count; i++)
+		dst[i] = '\0';
+	return dst;
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	const size_t length = strlen(src);
+	if (size > 0)
+	{
+		const size_t copied = length < size - 1 ? length : size - 1;
+		memcpy(dst, src, copied);
+		dst[copied] = '\0';
+	}
+	return length;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+	const size_t length = strnlen(dst, size);
+	if (length == size)
+		return length + strlen(src);
+	return length + strlcpy(dst + length, src, size - length);
+}
+
+char *strchr(const char *str, int character)
+{
+	for (; *str != '\0'; str++)
+	{
+		if (*str == (char)character)
+			return (char *)str;
+	}
+	return character == '\0' ? (char *)str : NULL;
+}
+
+size_t strspn(const char *str, const char *accept)
+{
+	size_t length = 0;
+	while (str[length] != '\0' && strchr(accept, str[length]) != NULL)
+		length++;
+	return length;
+}
+
+size_t strcspn(const char *str, const char *reject)
+{
+	size_t length = 0;
+	while (str[length] != '\0' && strchr(reject, str[length]) == NULL)
+		length++;
+	return length;
+}
+
+//64 bit divisions are a libgcc call on x86, & the host has no 32 bit libgcc
+u64 __udivdi3(u64 dividend, u64 divisor)
+{
+	u64 quotient = 0;
+	u64 remainder = 0;
+
+	for (s32 bit = 63; bit >= 0; bit--)
+	{
+		remainder = (remainder << 1) | ((dividend >> bit) & 1);
+		if (remainder >= divisor)
+		{
+			remainder -= divisor;
+			quotient |= 1ULL << bit;
+		}
+	}
+
+	return quotient;
+}
@@ -0,0 +1,266 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ecc - known answers of the sect233r1 operations
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <host.h>
+
+#include "crypto/ecc.h"
+#include "crypto/sha_software.h"
+
+#define BENCHMARK_ROUNDS 20
+
+//the answers come from a plain textbook implementation of the curve, not from this code.
+//keys are 1, n - 1, a key below n & a full 30 byte key above n
+static const u8 PrivateKey0[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+};
+static const u8 PublicKey0[] = {
+	0x00, 0xFA, 0xC9, 0xDF, 0xCB, 0xAC, 0x83, 0x13, 0xBB, 0x21, 0x39, 0xF1,
+	0xBB, 0x75, 0x5F, 0xEF, 0x65, 0xBC, 0x39, 0x1F, 0x8B, 0x36, 0xF8, 0xF8,
+	0xEB, 0x73, 0x71, 0xFD, 0x55, 0x8B, 0x01, 0x00, 0x6A, 0x08, 0xA4, 0x19,
+	0x03, 0x35, 0x06, 0x78, 0xE5, 0x85, 0x28, 0xBE, 0xBF, 0x8A, 0x0B, 0xEF,
+	0xF8, 0x67, 0xA7, 0xCA, 0x36, 0x71, 0x6F, 0x7E, 0x01, 0xF8, 0x10, 0x52,
+};
+
+static const u8 PrivateKey1[] = {
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x13, 0xE9, 0x74, 0xE7, 0x2F, 0x8A, 0x69, 0x22, 0x03,
+	0x1D, 0x26, 0x03, 0xCF, 0xE0, 0xD6,
+};
+static const u8 PublicKey1[] = {
+	0x00, 0xFA, 0xC9, 0xDF, 0xCB, 0xAC, 0x83, 0x13, 0xBB, 0x21, 0x39, 0xF1,
+	0xBB, 0x75, 0x5F, 0xEF, 0x65, 0xBC, 0x39, 0x1F, 0x8B, 0x36, 0xF8, 0xF8,
+	0xEB, 0x73, 0x71, 0xFD, 0x55, 0x8B, 0x01, 0xFA, 0xA3, 0xD7, 0x6F, 0xB5,
+	0x80, 0x26, 0xBD, 0x59, 0xDC, 0x74, 0x93, 0xCB, 0xE0, 0x65, 0x6E, 0x53,
+	0xC1, 0x78, 0x2C, 0xFC, 0xCE, 0x89, 0x84, 0x0D, 0x70, 0x05, 0x45, 0xD9,
+};
+
+static const u8 PrivateKey2[] = {
+	0x00, 0xB4, 0xC0, 0xD1, 0xE2, 0xF3, 0xA5, 0x96, 0x87, 0x78, 0x69, 0x5A,
+	0x4B, 0x3C, 0x2D, 0x1E, 0x0F, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0x0A, 0xAB, 0xBC, 0xCD,
+};
+static const u8 PublicKey2[] = {
+	0x01, 0x01, 0xC6, 0x8C, 0x8B, 0xA4, 0x67, 0xEF, 0x5D, 0xB8, 0x72, 0x00,
+	0x58, 0x15, 0x80, 0x38, 0x56, 0x6F, 0xD7, 0x76, 0x39, 0x68, 0xD3, 0x53,
+	0x04, 0x3A, 0x91, 0xF2, 0x8F, 0x15, 0x01, 0xC4, 0xB3, 0xED, 0x11, 0xF8,
+	0xDA, 0xD7, 0x2B, 0x0C, 0x5B, 0x5F, 0xAB, 0x35, 0x68, 0x5A, 0x74, 0x58,
+	0xDC, 0x23, 0x8B, 0x6A, 0x9D, 0x98, 0xFA, 0x00, 0x5D, 0xC9, 0x11, 0x9E,
+};
+
+static const u8 PrivateKey3[] = {
+	0xFF, 0xEF, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45,
+	0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD,
+	0xEF, 0x01, 0x23, 0x45, 0x67, 0x89,
+};
+static const u8 PublicKey3[] = {
+	0x00, 0x63, 0xA9, 0xF6, 0xDB, 0x95, 0xC8, 0x24, 0x69, 0x95, 0x37, 0x20,
+	0x6E, 0x0E, 0x6B, 0x17, 0xBB, 0xB8, 0xAB, 0x92, 0x9B, 0x30, 0x9C, 0x75,
+	0x1D, 0xB1, 0x92, 0x52, 0x59, 0xDF, 0x00, 0x36, 0x0C, 0x30, 0x3A, 0x88,
+	0x57, 0x88, 0xFA, 0x56, 0x41, 0x2D, 0x04, 0xC6, 0xA0, 0xAA, 0x3D, 0x53,
+	0x99, 0x1D, 0x77, 0xF0, 0xB1, 0x92, 0xF2, 0xE2, 0x0C, 0xEE, 0xD9, 0x45,
+};
+
+//x of PrivateKey2 * PublicKey3
+static const u8 SharedSecret[] = {
+	0x01, 0x73, 0xD6, 0x5E, 0xC6, 0x64, 0xEB, 0xD3, 0x4D, 0x48, 0xE2, 0xED,
+	0x46, 0x7B, 0x87, 0x21, 0xD7, 0xAB, 0x73, 0x37, 0x3E, 0x87, 0x14, 0xA3,
+	0x54, 0xE8, 0xBA, 0xB9, 0x74, 0x0E,
+};
+
+//sha-1 of "StarStruck"
+static const u8 MessageHash[] = {
+	0x43, 0x32, 0x05, 0x82, 0x92, 0xE4, 0x0C, 0xD2, 0x81, 0x4A, 0x43, 0xAA,
+	0x81, 0x63, 0xB3, 0xA5, 0x35, 0x52, 0xD1, 0xFE,
+};
+
+//MessageHash signed with PrivateKey2 & a nonce of our own
+static const u8 Signature[] = {
+	0x00, 0xE5, 0xCF, 0xB3, 0x18, 0x33, 0xA9, 0xF3, 0x6A, 0xFE, 0x44, 0x30,
+	0xD7, 0xD8, 0xDB, 0xD5, 0x61, 0x8C, 0x9C, 0xA6, 0x72, 0xC9, 0x24, 0xDB,
+	0x1C, 0xAB, 0xC2, 0x13, 0x44, 0xBB, 0x00, 0x86, 0x9C, 0x70, 0x65, 0x1C,
+	0x73, 0x86, 0x61, 0x71, 0xCC, 0x4E, 0xE2, 0x1D, 0x2E, 0xD4, 0x34, 0xBC,
+	0x9B, 0x0B, 0x68, 0xDD, 0x7D, 0x82, 0x7B, 0xE4, 0x0D, 0x44, 0xF5, 0x86,
+};
+
+//the signature of the kernel for the same hash & key, with its deterministic nonce
+static const u8 KernelSignature[] = {
+	0x00, 0x2E, 0x90, 0xAB, 0x25, 0x12, 0x4E, 0xAD, 0xB2, 0x89, 0x30, 0x94,
+	0x68, 0xAF, 0xCF, 0x38, 0xBB, 0x79, 0x24, 0xD9, 0x80, 0x4D, 0x7E, 0xC3,
+	0xA6, 0x4A, 0x24, 0x5B, 0x16, 0x87, 0x00, 0x0D, 0x2E, 0xD4, 0x42, 0x14,
+	0x87, 0x17, 0xB0, 0x1E, 0xEA, 0xCE, 0x3F, 0x9B, 0xDE, 0x1D, 0xC5, 0x7A,
+	0xEE, 0xCC, 0x80, 0xA4, 0x89, 0xAA, 0xA9, 0xAF, 0x9D, 0x82, 0xC7, 0xE0,
+};
+
+//sha-1 of the bytes 0 to 199, which is 4 blocks
+static const u8 ShaDigest[] = {
+	0x54, 0xD1, 0x1E, 0x99, 0x12, 0x7D, 0x15, 0x97, 0x99, 0xDB, 0xCE, 0x10,
+	0xF5, 0x1A, 0x75, 0xE6, 0x97, 0x78, 0x04, 0x78,
+};
+
+typedef struct
+{
+	const u8 *PrivateKey;
+	const u8 *PublicKey;
+} KeyPair;
+
+static const KeyPair KeyPairs[] = {
+	{ PrivateKey0, PublicKey0 },
+	{ PrivateKey1, PublicKey1 },
+	{ PrivateKey2, PublicKey2 },
+	{ PrivateKey3, PublicKey3 },
+};
+
+static void TestSoftwareSha(void)
+{
+	u8 data[200];
+	u8 hash[SHA_HASH_SIZE];
+
+	for (u32 i = 0; i < sizeof(data); i++)
+		data[i] = (u8)i;
+
+	SHA_SoftwareCalculate(data, sizeof(data), hash);
+	TEST_CHECK(memcmp(hash, ShaDigest, sizeof(hash)) == 0);
+	SHA_SoftwareCalculate("StarStruck", 10, hash);
+	TEST_CHECK(memcmp(hash, MessageHash, sizeof(hash)) == 0);
+}
+
+static void TestPublicKeys(void)
+{
+	u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+
+	for (u32 i = 0; i < ARRAY_LENGTH(KeyPairs); i++)
+	{
+		memset(publicKey, 0, sizeof(publicKey));
+		TEST_EQUAL(ECC_GeneratePublicKey(KeyPairs[i].PrivateKey, publicKey), IPC_SUCCESS);
+		TEST_CHECK(memcmp(publicKey, KeyPairs[i].PublicKey, sizeof(publicKey)) == 0);
+	}
+
+	//0 is the point at infinity, which is no key
+	const u8 zero[ECC_PRIVATE_KEY_SIZE] = { 0 };
+	TEST_EQUAL(ECC_GeneratePublicKey(zero, publicKey), IOSC_INVALID_FORMAT);
+}
+
+static void TestSharedSecret(void)
+{
+	u8 secret[ECC_NUMBER_SIZE];
+	u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+
+	TEST_EQUAL(ECC_GenerateSharedSecret(PrivateKey2, PublicKey3, secret), IPC_SUCCESS);
+	TEST_CHECK(memcmp(secret, SharedSecret, sizeof(secret)) == 0);
+	TEST_EQUAL(ECC_GenerateSharedSecret(PrivateKey3, PublicKey2, secret), IPC_SUCCESS);
+	TEST_CHECK(memcmp(secret, SharedSecret, sizeof(secret)) == 0);
+
+	//a point that isn't on the curve is refused
+	memcpy(publicKey, PublicKey2, sizeof(publicKey));
+	publicKey[ECC_PUBLIC_KEY_SIZE - 1] ^= 1;
+	TEST_CHECK(ECC_GenerateSharedSecret(PrivateKey3, publicKey, secret) != IPC_SUCCESS);
+}
+
+static void TestVerify(void)
+{
+	u8 signature[ECC_SIGNATURE_SIZE];
+	u8 hash[SHA_HASH_SIZE];
+
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, Signature),
+	           IPC_SUCCESS);
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, KernelSignature),
+	           IPC_SUCCESS);
+	TEST_EQUAL(ECC_VerifySignature(PublicKey3, MessageHash, SHA_HASH_SIZE, Signature),
+	           IOSC_FAIL_CHECKVALUE);
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, 0x10, Signature), IOSC_INVALID_SIZE);
+
+	//a single flipped bit anywhere breaks it
+	memcpy(signature, Signature, sizeof(signature));
+	signature[ECC_SIGNATURE_SIZE - 1] ^= 1;
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, signature),
+	           IOSC_FAIL_CHECKVALUE);
+	memcpy(signature, Signature, sizeof(signature));
+	signature[ECC_NUMBER_SIZE - 1] ^= 1;
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, signature),
+	           IOSC_FAIL_CHECKVALUE);
+	memcpy(hash, MessageHash, sizeof(hash));
+	hash[0] ^= 0x80;
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, hash, SHA_HASH_SIZE, Signature),
+	           IOSC_FAIL_CHECKVALUE);
+
+	//r & s have to be in [1, n)
+	memset(signature, 0, sizeof(signature));
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, signature),
+	           IOSC_FAIL_CHECKVALUE);
+	memcpy(signature, Signature, sizeof(signature));
+	memset(signature, 0xFF, ECC_NUMBER_SIZE);
+	TEST_EQUAL(ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, signature),
+	           IOSC_FAIL_CHECKVALUE);
+}
+
+static void TestSign(void)
+{
+	u8 signature[ECC_SIGNATURE_SIZE];
+
+	TEST_EQUAL(ECC_GenerateSignature(PrivateKey2, MessageHash, SHA_HASH_SIZE, signature),
+	           IPC_SUCCESS);
+	TEST_CHECK(memcmp(signature, KernelSignature, sizeof(signature)) == 0);
+
+	//every key signs something its public key verifies, including the one above n
+	for (u32 i = 0; i < ARRAY_LENGTH(KeyPairs); i++)
+	{
+		TEST_EQUAL(ECC_GenerateSignature(KeyPairs[i].PrivateKey, MessageHash, SHA_HASH_SIZE,
+		                                 signature),
+		           IPC_SUCCESS);
+		TEST_EQUAL(ECC_VerifySignature(KeyPairs[i].PublicKey, MessageHash, SHA_HASH_SIZE,
+		                               signature),
+		           IPC_SUCCESS);
+	}
+
+	TEST_EQUAL(ECC_GenerateSignature(PrivateKey2, MessageHash, 0x10, signature),
+	           IOSC_INVALID_SIZE);
+}
+
+static void TestSpeed(void)
+{
+	u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+	u8 signature[ECC_SIGNATURE_SIZE];
+
+	u32 start = HostGetTicks();
+	for (u32 i = 0; i < BENCHMARK_ROUNDS; i++)
+		ECC_GeneratePublicKey(PrivateKey3, publicKey);
+	const u32 multiply = (HostGetTicks() - start) / BENCHMARK_ROUNDS;
+
+	start = HostGetTicks();
+	for (u32 i = 0; i < BENCHMARK_ROUNDS; i++)
+		ECC_VerifySignature(PublicKey2, MessageHash, SHA_HASH_SIZE, Signature);
+	const u32 verify = (HostGetTicks() - start) / BENCHMARK_ROUNDS;
+
+	start = HostGetTicks();
+	for (u32 i = 0; i < BENCHMARK_ROUNDS; i++)
+		ECC_GenerateSignature(PrivateKey2, MessageHash, SHA_HASH_SIZE, signature);
+	const u32 sign = (HostGetTicks() - start) / BENCHMARK_ROUNDS;
+
+	HostPrintf("  point multiply %uus, verify %uus, sign %uus\n", multiply, verify, sign);
+	TEST_CHECK(memcmp(publicKey, PublicKey3, sizeof(publicKey)) == 0);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestSoftwareSha),
+	TEST_CASE(TestPublicKeys),
+	TEST_CASE(TestSharedSecret),
+	TEST_CASE(TestVerify),
+	TEST_CASE(TestSign),
+	TEST_CASE(TestSpeed),
+};
+
+int main(void)
+{
+	return RunTests("ecc", Tests, ARRAY_LENGTH(Tests));
+}
@@ -0,0 +1,844 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	filesystem - the fs module on top of a nand image
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <host.h>
+#include <ios.h>
+#include <nandImage.h>
+
+//pulled in whole, so the tests can get to the request handlers without going through ipc
+#define main FsMain
+#include "../../modules/fs/source/fs.c"
+#undef main
+
+#define NAND_IMAGE_PATH "filesystem.nand"
+#define BOOT_CLUSTERS   (NAND_PROTECTED_PAGES / FLASH_PAGES_PER_CLUSTER)
+#define FULL_ACCESS     0xFC
+
+#define SUPERBLOCK_FIRST_BLOCK (SUPERBLOCK_FIRST_CLUSTER / FLASH_CLUSTERS_PER_BLOCK)
+#define SUPERBLOCK_BLOCKS      (SUPERBLOCK_COUNT * SUPERBLOCK_CLUSTERS / FLASH_CLUSTERS_PER_BLOCK)
+#define SUPERBLOCK_PAGES       (SUPERBLOCK_CLUSTERS * FLASH_PAGES_PER_CLUSTER)
+
+//lays down what a fresh nand holds: a root directory & the boot & superblock clusters reserved
+static void FormatNand(void)
+{
+	memset(&FsSuperblock, 0, sizeof(Superblock));
+	FsSuperblock.Magic = SUPERBLOCK_MAGIC;
+	for (u32 i = 0; i < FLASH_CLUSTER_COUNT; i++)
+	{
+		FsSuperblock.Fat[i] = i < BOOT_CLUSTERS || i >= SUPERBLOCK_FIRST_CLUSTER ? FAT_RESERVED :
+		                                                                           FAT_FREE;
+	}
+
+	FstEntry *root = &FsSuperblock.Fst[FST_ROOT_ENTRY];
+	root->Name[0] = '/';
+	root->Mode = FST_TYPE_DIRECTORY | FULL_ACCESS;
+	root->Sub = FST_NONE;
+	root->Sibling = FST_NONE;
+}
+
+//what the module does when it gets (re)launched. whatever wasn't committed is gone
+static s32 BootFileSystem(void)
+{
+	for (u16 i = 0; i < FST_ENTRY_COUNT; i++)
+		InvalidateFileCache(i);
+
+	CommitTimerArmed = false;
+	ResetHostIos();
+	return FsMain();
+}
+
+static void SetUp(void)
+{
+	TEST_EQUAL(OpenNandImage(NAND_IMAGE_PATH), IPC_SUCCESS);
+	FormatNand();
+	TEST_EQUAL(CommitSuperblock(), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	ResetNandImageStats();
+}
+
+static void TearDown(void)
+{
+	CloseNandImage();
+}
+
+//superblocks written since the stats were last reset
+static u32 CountSuperblockWrites(void)
+{
+	NandImageStats stats;
+	GetNandImageStats(SUPERBLOCK_FIRST_BLOCK, SUPERBLOCK_BLOCKS, &stats);
+	TEST_EQUAL(stats.PageWrites % SUPERBLOCK_PAGES, 0);
+	return stats.PageWrites / SUPERBLOCK_PAGES;
+}
+
+//what the module's main loop does when the message of the commit timer comes in
+static bool FireCommitTimer(void)
+{
+	if (!IsTimerArmed(CommitTimerId))
+		return false;
+
+	CommitTimerArmed = false;
+	OSStopTimer(CommitTimerId);
+	TEST_EQUAL(SyncFileSystem(), IPC_SUCCESS);
+	return true;
+}
+
+static s32 OpenPath(const char *path, u32 mode)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_OPEN;
+	request.Message.Open.Filepath = (char *)path;
+	request.Message.Open.Mode = mode;
+	return HandleRequest(&request);
+}
+
+static s32 Close(s32 fd)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_CLOSE;
+	request.FileDescriptor = fd;
+	return HandleRequest(&request);
+}
+
+static s32 Ioctl(s32 fd, u32 ioctl, void *input, u32 inputLength, void *output,
+                 u32 outputLength)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_IOCTL;
+	request.FileDescriptor = fd;
+	request.Message.Ioctl.Ioctl = ioctl;
+	request.Message.Ioctl.InputBuffer = input;
+	request.Message.Ioctl.InputLength = inputLength;
+	request.Message.Ioctl.IoBuffer = output;
+	request.Message.Ioctl.IoLength = outputLength;
+	return HandleRequest(&request);
+}
+
+static s32 Ioctlv(s32 fd, u32 ioctl, u32 inputCount, u32 ioCount, IoctlvMessageData *vectors)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_IOCTLV;
+	request.FileDescriptor = fd;
+	request.Message.Ioctlv.Ioctl = ioctl;
+	request.Message.Ioctlv.InputArgc = inputCount;
+	request.Message.Ioctlv.IoArgc = ioCount;
+	request.Message.Ioctlv.MessageData = vectors;
+	return HandleRequest(&request);
+}
+
+static s32 CreatePath(s32 fd, const char *path, bool directory)
+{
+	FsAttributes attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	strlcpy(attributes.Path, path, sizeof(attributes.Path));
+	attributes.OwnerPermissions = ReadWrite;
+	attributes.GroupPermissions = ReadWrite;
+	attributes.OtherPermissions = ReadWrite;
+	return Ioctl(fd, directory ? FS_IOCTL_CREATEDIR : FS_IOCTL_CREATEFILE, &attributes,
+	             sizeof(attributes), NULL, 0);
+}
+
+static s32 ResolveTestPath(const char *path)
+{
+	char buffer[FS_MAX_PATH];
+	strncpy(buffer, path, sizeof(buffer));
+	return ResolvePath(buffer, NULL, NULL);
+}
+
+static void FormatName(char *name, const char *prefix, u32 index)
+{
+	const char digits[] = "0123456789abcdef";
+	const u32 length = strlcpy(name, prefix, FS_MAX_NAME);
+	name[length] = digits[(index >> 8) & 0x0F];
+	name[length + 1] = digits[(index >> 4) & 0x0F];
+	name[length + 2] = digits[index & 0x0F];
+	name[length + 3] = '\0';
+}
+
+static void TestCreateAndResolve(void)
+{
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_CHECK(fd >= 0);
+
+	TEST_EQUAL(CreatePath(fd, "/shared2", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/shared2/sys", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/shared2/sys/SYSCONF", false), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/shared2/sys/SYSCONF", false), FS_EEXIST);
+
+	const s32 directory = ResolveTestPath("/shared2/sys");
+	const s32 file = ResolveTestPath("/shared2/sys/SYSCONF");
+	TEST_CHECK(directory > 0 && file > 0);
+	TEST_EQUAL(FST_ENTRY_TYPE(directory), FST_TYPE_DIRECTORY);
+	TEST_EQUAL(FST_ENTRY_TYPE(file), FST_TYPE_FILE);
+	TEST_EQUAL(GetFstParent((u16)file), directory);
+	TEST_EQUAL(ResolveTestPath("/"), FST_ROOT_ENTRY);
+
+	//a missing last component still hands out its parent, a missing directory doesn't
+	u16 parent;
+	char name[FS_MAX_NAME];
+	char path[FS_MAX_PATH] = "/shared2/sys/missing";
+	TEST_EQUAL(ResolvePath(path, &parent, name), FS_ENOENT);
+	TEST_EQUAL(parent, directory);
+	TEST_CHECK(strncmp(name, "missing", FS_MAX_NAME) == 0);
+
+	strncpy(path, "/shared2/missing/file", sizeof(path));
+	TEST_EQUAL(ResolvePath(path, &parent, name), FS_ENOENT);
+	TEST_EQUAL(parent, FST_NONE);
+	TEST_EQUAL(CreatePath(fd, "/shared2/missing/file", false), FS_ENOENT);
+	TEST_EQUAL(CreatePath(fd, "/shared2/sys/SYSCONF/file", false), FS_ENOENT);
+
+	TEST_EQUAL(Close(fd), IPC_SUCCESS);
+	TearDown();
+}
+
+//the lookup index only lives in memory, so it has to come back the same from the nand
+static void TestLookupsAfterReboot(void)
+{
+	char name[FS_MAX_NAME];
+	char path[FS_MAX_PATH];
+	s32 entries[0x100];
+
+	SetUp();
+	s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/title", true), IPC_SUCCESS);
+	for (u32 i = 0; i < ARRAY_LENGTH(entries); i++)
+	{
+		FormatName(name, "entry", i);
+		strlcpy(path, "/title/", sizeof(path));
+		strlcat(path, name, sizeof(path));
+		TEST_EQUAL(CreatePath(fd, path, (i & 1) != 0), IPC_SUCCESS);
+		entries[i] = ResolveTestPath(path);
+		TEST_CHECK(entries[i] > 0);
+	}
+
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+
+	for (u32 i = 0; i < ARRAY_LENGTH(entries); i++)
+	{
+		FormatName(name, "entry", i);
+		strlcpy(path, "/title/", sizeof(path));
+		strlcat(path, name, sizeof(path));
+		TEST_EQUAL(ResolveTestPath(path), entries[i]);
+	}
+
+	//deleting & renaming has to keep the index in line with the tree
+	fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	char deletePath[FS_MAX_PATH] = "/title/entry000";
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_DELETE, deletePath, sizeof(deletePath), NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(ResolveTestPath("/title/entry000"), FS_ENOENT);
+
+	FsRename rename;
+	memset(&rename, 0, sizeof(rename));
+	strlcpy(rename.OldPath, "/title/entry001", sizeof(rename.OldPath));
+	strlcpy(rename.NewPath, "/moved", sizeof(rename.NewPath));
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_RENAME, &rename, sizeof(rename), NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(ResolveTestPath("/title/entry001"), FS_ENOENT);
+	TEST_EQUAL(ResolveTestPath("/moved"), entries[1]);
+	TEST_EQUAL(GetFstParent((u16)entries[1]), FST_ROOT_ENTRY);
+
+	Close(fd);
+	TearDown();
+}
+
+static s32 CountDirectory(s32 fd, const char *directory, u32 countLength, u32 *count)
+{
+	char path[FS_MAX_PATH];
+	IoctlvMessageData vectors[2];
+
+	strncpy(path, directory, sizeof(path));
+	vectors[0].Data = path;
+	vectors[0].Length = sizeof(path);
+	vectors[1].Data = count;
+	vectors[1].Length = countLength;
+	return Ioctlv(fd, FS_IOCTLV_READDIR, 1, 1, vectors);
+}
+
+static s32 ListDirectory(s32 fd, const char *directory, u32 *maxEntries, u32 maxEntriesLength,
+                         char *names, u32 namesLength, u32 *count)
+{
+	char path[FS_MAX_PATH];
+	IoctlvMessageData vectors[4];
+
+	strncpy(path, directory, sizeof(path));
+	vectors[0].Data = path;
+	vectors[0].Length = sizeof(path);
+	vectors[1].Data = maxEntries;
+	vectors[1].Length = maxEntriesLength;
+	vectors[2].Data = names;
+	vectors[2].Length = namesLength;
+	vectors[3].Data = count;
+	vectors[3].Length = sizeof(u32);
+	return Ioctlv(fd, FS_IOCTLV_READDIR, 2, 2, vectors);
+}
+
+static void TestReadDirectory(void)
+{
+	char names[4 * (FS_MAX_NAME + 1)];
+	u32 maxEntries;
+	u32 count = 0;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/tmp", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/a", false), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/bb", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/ccc", false), IPC_SUCCESS);
+
+	TEST_EQUAL(CountDirectory(fd, "/tmp", sizeof(count), &count), IPC_SUCCESS);
+	TEST_EQUAL(count, 3);
+	TEST_EQUAL(CountDirectory(fd, "/tmp/a", sizeof(count), &count), FS_EINVAL);
+	TEST_EQUAL(CountDirectory(fd, "/missing", sizeof(count), &count), FS_ENOENT);
+
+	//names are packed one after the other, each with its own terminator
+	memset(names, 0xAA, sizeof(names));
+	maxEntries = 2;
+	count = 0;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           IPC_SUCCESS);
+	TEST_EQUAL(count, 2);
+
+	u32 found = 0;
+	for (const char *name = names; name < names + sizeof(names) && (u8)*name != 0xAA;
+	     name += strlen(name) + 1)
+	{
+		TEST_CHECK(strcmp(name, "a") == 0 || strcmp(name, "bb") == 0 || strcmp(name, "ccc") == 0);
+		found++;
+	}
+	TEST_EQUAL(found, 2);
+
+	maxEntries = 4;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           IPC_SUCCESS);
+	TEST_EQUAL(count, 3);
+
+	Close(fd);
+	TearDown();
+}
+
+static void TestReadDirectoryRejectsShortVectors(void)
+{
+	char names[FS_MAX_NAME + 1];
+	u32 count = 0x12345678;
+	u32 maxEntries = 1;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/tmp", true), IPC_SUCCESS);
+
+	//the count is always written as a whole word
+	TEST_EQUAL(CountDirectory(fd, "/tmp", sizeof(u16), &count), FS_EINVAL);
+	TEST_EQUAL(CountDirectory(fd, "/tmp", 0, &count), FS_EINVAL);
+	TEST_EQUAL(CountDirectory(fd, "/tmp", sizeof(count), NULL), FS_EINVAL);
+	TEST_EQUAL(count, 0x12345678);
+
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(u16), names, sizeof(names), &count),
+	           FS_EINVAL);
+	TEST_EQUAL(ListDirectory(fd, "/tmp", NULL, sizeof(u32), names, sizeof(names), &count),
+	           FS_EINVAL);
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(u32), NULL, sizeof(names), &count),
+	           FS_EINVAL);
+	TEST_EQUAL(count, 0x12345678);
+
+	Close(fd);
+	TearDown();
+}
+
+static void TestReadDirectoryRejectsHugeMaxEntries(void)
+{
+	char names[2 * (FS_MAX_NAME + 1)];
+	u32 count = 0x12345678;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/tmp", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/a", false), IPC_SUCCESS);
+
+	//0x13B13B14 * 13 wraps around to 4, which would pass a multiplied size check
+	u32 maxEntries = 0x13B13B14;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           FS_EINVAL);
+	maxEntries = 3;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           FS_EINVAL);
+	TEST_EQUAL(count, 0x12345678);
+
+	maxEntries = 2;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           IPC_SUCCESS);
+	TEST_EQUAL(count, 1);
+
+	Close(fd);
+	TearDown();
+}
+
+static void TestReadDirectoryStopsOnSiblingLoop(void)
+{
+	char names[2 * (FS_MAX_NAME + 1)];
+	u32 count = 0;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/tmp", true), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/a", false), IPC_SUCCESS);
+	TEST_EQUAL(CreatePath(fd, "/tmp/b", false), IPC_SUCCESS);
+
+	//link the last child back to the first, as a corrupt fst on the nand could
+	const u16 first = FsSuperblock.Fst[ResolveTestPath("/tmp")].Sub;
+	const u16 second = FsSuperblock.Fst[first].Sibling;
+	TEST_EQUAL(FsSuperblock.Fst[second].Sibling, FST_NONE);
+	FsSuperblock.Fst[second].Sibling = first;
+
+	TEST_EQUAL(CountDirectory(fd, "/tmp", sizeof(count), &count), IPC_SUCCESS);
+	TEST_EQUAL(count, FST_ENTRY_COUNT);
+
+	u32 maxEntries = 2;
+	TEST_EQUAL(ListDirectory(fd, "/tmp", &maxEntries, sizeof(maxEntries), names, sizeof(names),
+	                         &count),
+	           IPC_SUCCESS);
+	TEST_EQUAL(count, 2);
+
+	Close(fd);
+	TearDown();
+}
+
+static s32 WriteData(s32 fd, const void *data, u32 length)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_WRITE;
+	request.FileDescriptor = fd;
+	request.Message.Write.MessageData = data;
+	request.Message.Write.Length = length;
+	return HandleRequest(&request);
+}
+
+static s32 ReadData(s32 fd, void *data, u32 length)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_READ;
+	request.FileDescriptor = fd;
+	request.Message.Read.MessageData = data;
+	request.Message.Read.Length = length;
+	return HandleRequest(&request);
+}
+
+static void BuildSavePath(char *path, u32 index)
+{
+	char name[FS_MAX_NAME];
+	FormatName(name, "level", index);
+	strlcpy(path, "/save/", FS_MAX_PATH);
+	strlcat(path, name, FS_MAX_PATH);
+}
+
+//a burst of metadata changes ends up in one superblock, once the commit timer fires
+static void TestMetadataChangesShareACommit(void)
+{
+	char path[FS_MAX_PATH];
+	const u32 operations = 0x40;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/save", true), IPC_SUCCESS);
+	for (u32 i = 0; i < operations; i++)
+	{
+		BuildSavePath(path, i);
+		TEST_EQUAL(CreatePath(fd, path, false), IPC_SUCCESS);
+	}
+
+	TEST_EQUAL(CountSuperblockWrites(), 0);
+	TEST_CHECK(FireCommitTimer());
+	TEST_EQUAL(CountSuperblockWrites(), 1);
+	TEST_CHECK(!FireCommitTimer());
+	HostPrintf("  %u creates: %u superblock writes\n", operations + 1, CountSuperblockWrites());
+
+	//deletes are batched the same way
+	ResetNandImageStats();
+	for (u32 i = 0; i < operations; i += 2)
+	{
+		BuildSavePath(path, i);
+		TEST_EQUAL(Ioctl(fd, FS_IOCTL_DELETE, path, sizeof(path), NULL, 0), IPC_SUCCESS);
+	}
+
+	TEST_CHECK(FireCommitTimer());
+	TEST_EQUAL(CountSuperblockWrites(), 1);
+	HostPrintf("  %u deletes: %u superblock writes\n", operations / 2, CountSuperblockWrites());
+
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	for (u32 i = 0; i < operations; i++)
+	{
+		BuildSavePath(path, i);
+		TEST_EQUAL(ResolveTestPath(path) >= 0, (i & 1) != 0);
+	}
+
+	Close(fd);
+	TearDown();
+}
+
+//nothing reaches the nand before the timer fires or someone flushes
+static void TestUncommittedChangesAreLostOnReboot(void)
+{
+	SetUp();
+	s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/kept", true), IPC_SUCCESS);
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(CountSuperblockWrites(), 1);
+	TEST_CHECK(!IsTimerArmed(CommitTimerId));
+
+	TEST_EQUAL(CreatePath(fd, "/lost", true), IPC_SUCCESS);
+	TEST_EQUAL(CountSuperblockWrites(), 1);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(ResolveTestPath("/kept") > 0);
+	TEST_EQUAL(ResolveTestPath("/lost"), FS_ENOENT);
+	TearDown();
+}
+
+//a save is only done once its writer closes the file, so that commits right away
+static void TestLastWriterCloseCommits(void)
+{
+	char path[FS_MAX_PATH];
+	u8 data[0x80];
+	const u32 saves = 0x10;
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/save", true), IPC_SUCCESS);
+	for (u32 i = 0; i < saves; i++)
+	{
+		BuildSavePath(path, i);
+		TEST_EQUAL(CreatePath(fd, path, false), IPC_SUCCESS);
+	}
+
+	//two writers at once only commit when the second one goes away
+	BuildSavePath(path, 0);
+	const s32 first = OpenPath(path, ReadWrite);
+	BuildSavePath(path, 1);
+	const s32 second = OpenPath(path, ReadWrite);
+	TEST_CHECK(first >= 0 && second >= 0);
+
+	memset(data, 0x5A, sizeof(data));
+	TEST_EQUAL(WriteData(first, data, sizeof(data)), sizeof(data));
+	TEST_EQUAL(WriteData(second, data, sizeof(data)), sizeof(data));
+	TEST_EQUAL(Close(first), IPC_SUCCESS);
+	TEST_EQUAL(CountSuperblockWrites(), 0);
+	TEST_EQUAL(Close(second), IPC_SUCCESS);
+	TEST_EQUAL(CountSuperblockWrites(), 1);
+	TEST_CHECK(!IsTimerArmed(CommitTimerId));
+
+	//a game writing its saves one after the other commits once per save
+	ResetNandImageStats();
+	for (u32 i = 2; i < saves; i++)
+	{
+		BuildSavePath(path, i);
+		const s32 file = OpenPath(path, ReadWrite);
+		memset(data, (int)i, sizeof(data));
+		TEST_EQUAL(WriteData(file, data, sizeof(data)), sizeof(data));
+		TEST_EQUAL(Close(file), IPC_SUCCESS);
+	}
+
+	TEST_EQUAL(CountSuperblockWrites(), saves - 2);
+	HostPrintf("  %u saves: %u superblock writes\n", saves - 2, CountSuperblockWrites());
+
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	for (u32 i = 2; i < saves; i++)
+	{
+		BuildSavePath(path, i);
+		const s32 file = OpenPath(path, Read);
+		memset(data, 0, sizeof(data));
+		TEST_EQUAL(ReadData(file, data, sizeof(data)), sizeof(data));
+		TEST_EQUAL(data[0], i);
+		TEST_EQUAL(data[sizeof(data) - 1], i);
+		Close(file);
+	}
+
+	Close(fd);
+	TearDown();
+}
+
+//a superblock that didn't make it to the nand in one piece leaves the previous one in charge
+static void TestTornCommitFallsBack(void)
+{
+	u32 header[FLASH_PAGE_SIZE / sizeof(u32)];
+
+	SetUp();
+	const s32 fd = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(fd, "/first", true), IPC_SUCCESS);
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	const u32 generation = FsSuperblock.Generation;
+
+	TEST_EQUAL(CreatePath(fd, "/second", true), IPC_SUCCESS);
+	TEST_EQUAL(Ioctl(fd, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(FsSuperblock.Generation, generation + 1);
+
+	//erase the second half of the newest superblock, as if power went away while writing it
+	u32 tornBlock = 0;
+	for (u32 i = 0; i < SUPERBLOCK_COUNT; i++)
+	{
+		const u32 firstCluster = SUPERBLOCK_FIRST_CLUSTER + (i * SUPERBLOCK_CLUSTERS);
+		TEST_EQUAL(OSReadFlashPage(firstCluster * FLASH_PAGES_PER_CLUSTER, header, NULL),
+		           IPC_SUCCESS);
+		if (header[0] == SUPERBLOCK_MAGIC && header[1] == generation + 1)
+			tornBlock = (firstCluster / FLASH_CLUSTERS_PER_BLOCK) + 1;
+	}
+
+	TEST_CHECK(tornBlock != 0);
+	TEST_EQUAL(OSEraseFlashBlock(tornBlock), IPC_SUCCESS);
+
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(FsSuperblock.Generation, generation);
+	TEST_CHECK(ResolveTestPath("/first") > 0);
+	TEST_EQUAL(ResolveTestPath("/second"), FS_ENOENT);
+
+	//the next commit goes past the torn one & wins
+	const s32 manager = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(manager, "/third", true), IPC_SUCCESS);
+	TEST_EQUAL(Ioctl(manager, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(ResolveTestPath("/third") > 0);
+	TEST_CHECK(FsSuperblock.Generation > generation);
+	TearDown();
+}
+
+#define FIRST_DATA_BLOCK (BOOT_CLUSTERS / FLASH_CLUSTERS_PER_BLOCK)
+
+static bool IsBlockRetiredInFat(u32 block)
+{
+	for (u32 i = 0; i < FLASH_CLUSTERS_PER_BLOCK; i++)
+	{
+		if (FsSuperblock.Fat[(block * FLASH_CLUSTERS_PER_BLOCK) + i] != FAT_BAD)
+			return false;
+	}
+
+	return true;
+}
+
+static void FillPattern(u8 *data, u32 length, u32 seed)
+{
+	for (u32 i = 0; i < length; i++)
+		data[i] = (u8)((i * 7) + seed);
+}
+
+static bool CheckPattern(const u8 *data, u32 length, u32 seed)
+{
+	for (u32 i = 0; i < length; i++)
+	{
+		if (data[i] != (u8)((i * 7) + seed))
+			return false;
+	}
+
+	return true;
+}
+
+//creates a file of one cluster & commits it
+static s32 WriteTestFile(const char *path, u32 seed)
+{
+	static u8 data[FLASH_CLUSTER_SIZE];
+
+	const s32 manager = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	s32 ret = CreatePath(manager, path, false);
+	Close(manager);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	const s32 fd = OpenPath(path, ReadWrite);
+	FillPattern(data, sizeof(data), seed);
+	ret = WriteData(fd, data, sizeof(data));
+	const s32 closed = Close(fd);
+	return ret < 0 ? ret : closed;
+}
+
+static s32 ReadTestFile(const char *path, u32 seed)
+{
+	static u8 data[FLASH_CLUSTER_SIZE];
+
+	const s32 fd = OpenPath(path, Read);
+	if (fd < 0)
+		return fd;
+
+	memset(data, 0, sizeof(data));
+	s32 ret = ReadData(fd, data, sizeof(data));
+	Close(fd);
+	if (ret < 0)
+		return ret;
+
+	return ret == sizeof(data) && CheckPattern(data, sizeof(data), seed) ? IPC_SUCCESS : FS_ECORRUPT;
+}
+
+static u32 GetFileBlock(const char *path)
+{
+	const s32 entry = ResolveTestPath(path);
+	TEST_CHECK(entry > 0);
+	return FsSuperblock.Fst[entry].Sub / FLASH_CLUSTERS_PER_BLOCK;
+}
+
+//the fat is the only place bad blocks are kept, so it has to fill the kernel's table on boot
+static void TestFatBadBlocksReachTheKernel(void)
+{
+	static u8 data[0x4000];
+	NandImageStats stats;
+	const u32 badBlock = FIRST_DATA_BLOCK + 2;
+
+	TEST_EQUAL(OpenNandImage(NAND_IMAGE_PATH), IPC_SUCCESS);
+	FormatNand();
+	for (u32 i = 0; i < FLASH_CLUSTERS_PER_BLOCK; i++)
+		FsSuperblock.Fat[(badBlock * FLASH_CLUSTERS_PER_BLOCK) + i] = FAT_BAD;
+	SetNandFault(badBlock, NandFaultFactoryBad);
+	TEST_EQUAL(CommitSuperblock(), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(IsNandBlockBad(badBlock));
+	TEST_CHECK(!IsNandBlockBad(badBlock + 1));
+
+	//write enough that the allocator goes past the bad block, without ever touching it
+	const s32 manager = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(manager, "/big", false), IPC_SUCCESS);
+	const s32 fd = OpenPath("/big", ReadWrite);
+	for (u32 i = 0; i < 0x20; i++)
+	{
+		FillPattern(data, sizeof(data), i);
+		TEST_EQUAL(WriteData(fd, data, sizeof(data)), sizeof(data));
+	}
+
+	TEST_EQUAL(Close(fd), IPC_SUCCESS);
+	GetNandImageStats(badBlock, 1, &stats);
+	TEST_EQUAL(stats.BlockErases + stats.PageWrites, 0);
+	GetNandImageStats(badBlock + 1, 1, &stats);
+	TEST_CHECK(stats.PageWrites > 0);
+
+	//the kernel forgets on a reboot, the fat doesn't
+	ForgetNandBadBlocks();
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(IsNandBlockBad(badBlock));
+	Close(manager);
+	TearDown();
+}
+
+//the kernel marks a block bad when programming it fails, and the fs takes it out of its fat
+static void TestProgramFailureRetiresBlock(void)
+{
+	SetUp();
+	SetNandFault(FIRST_DATA_BLOCK, NandFaultProgram);
+	TEST_EQUAL(WriteTestFile("/file", 1), IPC_SUCCESS);
+	TEST_CHECK(IsNandBlockBad(FIRST_DATA_BLOCK));
+	TEST_CHECK(IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	TEST_EQUAL(GetFileBlock("/file"), FIRST_DATA_BLOCK + 1);
+
+	ForgetNandBadBlocks();
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(IsNandBlockBad(FIRST_DATA_BLOCK));
+	TEST_CHECK(IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	TEST_EQUAL(ReadTestFile("/file", 1), IPC_SUCCESS);
+	TearDown();
+}
+
+static void TestEraseFailureRetiresBlock(void)
+{
+	SetUp();
+	SetNandFault(FIRST_DATA_BLOCK, NandFaultErase);
+	TEST_EQUAL(WriteTestFile("/file", 2), IPC_SUCCESS);
+	TEST_CHECK(IsNandBlockBad(FIRST_DATA_BLOCK));
+	TEST_CHECK(IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	TEST_EQUAL(GetFileBlock("/file"), FIRST_DATA_BLOCK + 1);
+
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	TEST_EQUAL(ReadTestFile("/file", 2), IPC_SUCCESS);
+	TearDown();
+}
+
+//a block the kernel found bad since the last commit gets retired when mounting
+static void TestKernelBadBlocksAreRetired(void)
+{
+	SetUp();
+	TEST_CHECK(!IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	OSMarkFlashBlockBad(FIRST_DATA_BLOCK);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_CHECK(IsBlockRetiredInFat(FIRST_DATA_BLOCK));
+	TEST_CHECK(IsSuperblockDirty());
+
+	TEST_EQUAL(WriteTestFile("/file", 3), IPC_SUCCESS);
+	TEST_EQUAL(GetFileBlock("/file"), FIRST_DATA_BLOCK + 1);
+	TearDown();
+}
+
+static void TestEccErrorsOnRead(void)
+{
+	SetUp();
+	TEST_EQUAL(WriteTestFile("/file", 4), IPC_SUCCESS);
+	const u32 block = GetFileBlock("/file");
+
+	//corrected errors are the controller's business, the data is fine
+	SetNandFault(block, NandFaultCorrectable);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(ReadTestFile("/file", 4), IPC_SUCCESS);
+
+	SetNandFault(block, NandFaultUncorrectable);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(ReadTestFile("/file", 4), FS_EIO);
+
+	//the rest of the filesystem keeps working
+	TEST_EQUAL(WriteTestFile("/other", 5), IPC_SUCCESS);
+	TEST_EQUAL(ReadTestFile("/other", 5), IPC_SUCCESS);
+	TearDown();
+}
+
+//a superblock slot that can't be programmed is skipped, the commit goes to the next one
+static void TestSuperblockSlotFailure(void)
+{
+	SetUp();
+	for (u32 i = 0; i < SUPERBLOCK_BLOCKS; i++)
+	{
+		if (i / (SUPERBLOCK_CLUSTERS / FLASH_CLUSTERS_PER_BLOCK) != 5)
+			SetNandFault(SUPERBLOCK_FIRST_BLOCK + i, NandFaultProgram);
+	}
+
+	const s32 manager = OpenPath(FS_DEVICE_NAME, ReadWrite);
+	TEST_EQUAL(CreatePath(manager, "/dir", true), IPC_SUCCESS);
+	TEST_EQUAL(Ioctl(manager, FS_IOCTL_SHUTDOWN, NULL, 0, NULL, 0), IPC_SUCCESS);
+	const u32 generation = FsSuperblock.Generation;
+
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(FsSuperblock.Generation, generation);
+	TEST_CHECK(ResolveTestPath("/dir") > 0);
+	TearDown();
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestCreateAndResolve),
+	TEST_CASE(TestLookupsAfterReboot),
+	TEST_CASE(TestReadDirectory),
+	TEST_CASE(TestReadDirectoryRejectsShortVectors),
+	TEST_CASE(TestReadDirectoryRejectsHugeMaxEntries),
+	TEST_CASE(TestReadDirectoryStopsOnSiblingLoop),
+	TEST_CASE(TestMetadataChangesShareACommit),
+	TEST_CASE(TestUncommittedChangesAreLostOnReboot),
+	TEST_CASE(TestLastWriterCloseCommits),
+	TEST_CASE(TestTornCommitFallsBack),
+	TEST_CASE(TestFatBadBlocksReachTheKernel),
+	TEST_CASE(TestProgramFailureRetiresBlock),
+	TEST_CASE(TestEraseFailureRetiresBlock),
+	TEST_CASE(TestKernelBadBlocksAreRetired),
+	TEST_CASE(TestEccErrorsOnRead),
+	TEST_CASE(TestSuperblockSlotFailure),
+};
+
+int main(void)
+{
+	return RunTests("filesystem", Tests, ARRAY_LENGTH(Tests));
+}
@@ -0,0 +1,395 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	iosc - the decrypt and hash pipeline against models of the aes & sha engines
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <types.h>
+#include <ios/errno.h>
+#include <host.h>
+
+#include "../../kernel/source/crypto/iosc.c"
+
+#define AES_HANDLE   0x20
+#define HMAC_HANDLE  0x21
+#define BUFFER_SIZE  0x800000
+#define NO_CHUNK     0xFFFFFFFF
+//the engines are modelled at the same speed, plus the ipc round trip of every request.
+//they are made up numbers, the point is how much of the two engines' time overlaps
+#define TICKS_PER_KB  64
+#define REQUEST_TICKS 40
+
+typedef struct
+{
+	IpcMessage *Reply;
+	u32 Request;
+	IoctlvMessageData *Vectors;
+	bool Busy;
+	u32 DoneAt;
+	u32 Requests;
+	//the request that fails, counted from the first one
+	u32 FailingRequest;
+} Engine;
+
+static Engine AesEngine;
+static Engine ShaEngine;
+static u32 Now;
+static u32 Allocations;
+static u8 *Cipher;
+static u8 *Plain;
+static u8 *Output;
+
+static const u8 TestKey[AES_KEY_SIZE] = { 0x3C, 0x91, 0x07, 0xD2, 0x5E, 0x68, 0xA4, 0x1F,
+	                                      0xB0, 0x2D, 0x73, 0xE9, 0x84, 0x16, 0xCA, 0x55 };
+static const u8 TestIv[AES_BLOCK_SIZE] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	                                       0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+s32 KernelHeapId = 0;
+MessageQueue MessageQueues[MAX_MESSAGEQUEUES];
+
+void *AllocateOnHeap(s32 heapid, u32 size)
+{
+	(void)heapid;
+	u32 *block = HostAllocate(size + 0x10);
+	block[0] = size + 0x10;
+	Allocations++;
+	return &block[4];
+}
+
+s32 FreeOnHeap(s32 heapid, void *ptr)
+{
+	(void)heapid;
+	u32 *block = (u32 *)ptr - 4;
+	TEST_CHECK(Allocations > 0);
+	Allocations--;
+	HostFree(block, block[0]);
+	return IPC_SUCCESS;
+}
+
+u32 DisableInterrupts(void)
+{
+	return 0;
+}
+
+void RestoreInterrupts(u32 cookie)
+{
+	(void)cookie;
+}
+
+s32 Keyring_FindKeySize(u32 *keySize, u32 keyHandle)
+{
+	if (keyHandle != AES_HANDLE && keyHandle != HMAC_HANDLE)
+		return IOSC_EINVAL;
+
+	*keySize = keyHandle == AES_HANDLE ? AES_KEY_SIZE : 0x14;
+	return IPC_SUCCESS;
+}
+
+s32 Keyring_GetKey(u32 keyHandle, void *keyPtr, u32 keySize)
+{
+	if (keyHandle != AES_HANDLE || keySize != AES_KEY_SIZE)
+		return IOSC_EINVAL;
+
+	memcpy(keyPtr, TestKey, keySize);
+	return IPC_SUCCESS;
+}
+
+void panic(const char *fmt, ...)
+{
+	HostPrintf("panic: %s", fmt);
+	HostExit(1);
+}
+
+//what /dev/aes does with a decrypt, including handing back the iv of the next chunk
+static s32 RunAes(IoctlvMessageData *vectors)
+{
+	const u32 size = vectors[0].Length;
+	if (AesEngine.Request != AES_DECRYPT || vectors[2].Length != size ||
+	    ((size - 0x10) & 0xFFFF000F) != 0 || vectors[1].Length != AES_KEY_SIZE ||
+	    vectors[3].Length != AES_BLOCK_SIZE)
+		return IPC_EINVAL;
+
+	AES_SoftwareDecrypt(vectors[1].Data, vectors[3].Data, vectors[0].Data, vectors[2].Data, size);
+	FreeOnHeap(KernelHeapId, vectors[1].Data);
+	FreeOnHeap(KernelHeapId, vectors);
+	return IPC_SUCCESS;
+}
+
+//what /dev/sha does with a sha request, it keeps the state in the caller's context
+static s32 RunSha(IoctlvMessageData *vectors)
+{
+	const u8 *input = vectors[0].Data;
+	const u32 size = vectors[0].Length;
+	const u32 blocksSize = size & (u32)~(SHA_BLOCK_SIZE - 1);
+	ShaContext *context = vectors[1].Data;
+
+	if (blocksSize > 0x400 * SHA_BLOCK_SIZE ||
+	    (ShaEngine.Request == ContributeShaState && blocksSize == 0) ||
+	    (ShaEngine.Request != FinalizeShaState && blocksSize != size))
+		return IOSC_INVALID_SIZE;
+
+	if (ShaEngine.Request == InitShaState)
+	{
+		static const u32 initialState[SHA_NUM_WORDS] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE,
+			                                             0x10325476, 0xC3D2E1F0 };
+		memcpy(context->ShaStates, initialState, sizeof(initialState));
+		context->Length = 0;
+	}
+
+	SHA_SoftwareTransform(context->ShaStates, input, blocksSize);
+	context->Length += (u64)size * 8;
+	if (ShaEngine.Request == FinalizeShaState)
+	{
+		u8 last[SHA_BLOCK_SIZE * 2] = { 0 };
+		const u32 rest = size - blocksSize;
+		const u32 lastSize = rest + 9 <= SHA_BLOCK_SIZE ? SHA_BLOCK_SIZE : sizeof(last);
+		memcpy(last, &input[blocksSize], rest);
+		last[rest] = 0x80;
+		for (u32 i = 0; i < 8; i++)
+			last[lastSize - 1 - i] = (u8)(context->Length >> (i * 8));
+
+		u32 *hash = vectors[2].Data;
+		memcpy(hash, context->ShaStates, sizeof(FinalShaHash));
+		SHA_SoftwareTransform(hash, last, lastSize);
+	}
+
+	FreeOnHeap(KernelHeapId, vectors);
+	return IPC_SUCCESS;
+}
+
+//the engines take a request each, so a second one for a busy engine would queue behind it
+int IoctlvFD_InnerWithFlag(s32 fd, u32 requestId, u32 vectorInputCount, u32 vectorIOCount,
+                           IoctlvMessageData *vectors, MessageQueue *messageQueue,
+                           IpcMessage *message, const int checkBeforeSend)
+{
+	(void)vectorInputCount;
+	(void)vectorIOCount;
+	(void)checkBeforeSend;
+	Engine *engine = fd == AES_STATIC_FILEDESC ? &AesEngine : &ShaEngine;
+	TEST_CHECK(fd == AES_STATIC_FILEDESC || fd == SHA_STATIC_FILEDESC);
+	TEST_CHECK(messageQueue == &MessageQueues[IOSC_PipelineQueueId]);
+	TEST_CHECK(!engine->Busy);
+
+	const u32 startAt = engine->DoneAt > Now ? engine->DoneAt : Now;
+	engine->Reply = message;
+	engine->Request = requestId;
+	engine->Vectors = vectors;
+	engine->Busy = true;
+	engine->DoneAt = startAt + REQUEST_TICKS + ((vectors[0].Length * TICKS_PER_KB) >> 10);
+	return IPC_SUCCESS;
+}
+
+//time moves on to whichever engine is done first, which then does its work & replies
+s32 ReceiveMessageUnsafe(const s32 queueId, void **message, u32 flags)
+{
+	TEST_EQUAL(queueId, IOSC_PipelineQueueId);
+	TEST_EQUAL(flags, None);
+
+	Engine *engine = AesEngine.Busy ? &AesEngine : &ShaEngine;
+	if (AesEngine.Busy && ShaEngine.Busy && ShaEngine.DoneAt < AesEngine.DoneAt)
+		engine = &ShaEngine;
+
+	if (!engine->Busy)
+	{
+		HostPrintf("  waiting without a request on an engine\n");
+		HostExit(1);
+	}
+
+	Now = engine->DoneAt;
+	engine->Busy = false;
+	s32 ret = -1;
+	if (engine->Requests++ != engine->FailingRequest)
+		ret = engine == &AesEngine ? RunAes(engine->Vectors) : RunSha(engine->Vectors);
+
+	engine->Reply->Request.Result = ret;
+	*message = engine->Reply;
+	return IPC_SUCCESS;
+}
+
+static u32 RandomState;
+static u32 Random(void)
+{
+	RandomState = (RandomState * 1103515245) + 12345;
+	return RandomState >> 16;
+}
+
+static void SetUp(void)
+{
+	if (Cipher == NULL)
+	{
+		Cipher = HostAllocate(BUFFER_SIZE);
+		Plain = HostAllocate(BUFFER_SIZE);
+		Output = HostAllocate(BUFFER_SIZE);
+		RandomState = 1;
+		for (u32 i = 0; i < BUFFER_SIZE; i++)
+			Plain[i] = (u8)Random();
+
+		u8 iv[AES_BLOCK_SIZE];
+		memcpy(iv, TestIv, sizeof(iv));
+		AES_SoftwareEncrypt(TestKey, iv, Plain, Cipher, BUFFER_SIZE);
+	}
+
+	//the queue IOSC_InitInformation creates at boot
+	IOSC_PipelineQueueId = 0;
+	memset(&AesEngine, 0, sizeof(AesEngine));
+	memset(&ShaEngine, 0, sizeof(ShaEngine));
+	AesEngine.FailingRequest = NO_CHUNK;
+	ShaEngine.FailingRequest = NO_CHUNK;
+	Now = 0;
+	Allocations = 0;
+	memset(Output, 0, BUFFER_SIZE);
+}
+
+static void ExpectedHash(const void *input, u32 inputSize, FinalShaHash expected)
+{
+	u8 hash[SHA_HASH_SIZE];
+	SHA_SoftwareCalculate(input, inputSize, hash);
+	for (u32 i = 0; i < SHA_NUM_WORDS; i++)
+		expected[i] = (u32)hash[i * 4] << 24 | (u32)hash[i * 4 + 1] << 16 |
+		              (u32)hash[i * 4 + 2] << 8 | hash[i * 4 + 3];
+}
+
+//how a caller got the same without the pipeline: decrypt a chunk, then hash it
+static s32 DecryptThenHash(const void *input, u32 size, void *output, u8 *iv, FinalShaHash hash)
+{
+	s32 ret = IPC_SUCCESS;
+	u8 *plain = output;
+	for (u32 offset = 0; ret == IPC_SUCCESS && offset < size; offset += IOSC_PIPELINE_CHUNK_SIZE)
+	{
+		const u32 chunkSize = size - offset < IOSC_PIPELINE_CHUNK_SIZE ?
+		                          size - offset :
+		                          IOSC_PIPELINE_CHUNK_SIZE;
+		ret = IOSC_PipelineDecrypt(TestKey, iv, (const u8 *)input + offset, chunkSize,
+		                           &plain[offset]);
+		if (ret == IPC_SUCCESS)
+			ret = IOSC_PipelineWaitAes();
+
+		const u32 hashSize = chunkSize & (u32)~(SHA_BLOCK_SIZE - 1);
+		const bool last = offset + chunkSize == size;
+		if (ret == IPC_SUCCESS && (offset == 0 || hashSize != 0 || last))
+		{
+			ret = IOSC_PipelineHash(&plain[offset], last ? chunkSize : hashSize,
+			                        last ? FinalizeShaState :
+			                        offset == 0 ? InitShaState : ContributeShaState,
+			                        last ? hash : NULL);
+			if (ret == IPC_SUCCESS)
+				ret = IOSC_PipelineWaitSha();
+		}
+	}
+
+	return ret;
+}
+
+static void TestDecryptAndHash(void)
+{
+	static const u32 sizes[] = { 0x10, 0x40, 0x1230, IOSC_PIPELINE_CHUNK_SIZE,
+		                         IOSC_PIPELINE_CHUNK_SIZE + 0x10, 0x345670, BUFFER_SIZE };
+
+	for (u32 i = 0; i < ARRAY_LENGTH(sizes); i++)
+	{
+		const u32 size = sizes[i];
+		const u32 chunks = (size + IOSC_PIPELINE_CHUNK_SIZE - 1) / IOSC_PIPELINE_CHUNK_SIZE;
+		FinalShaHash hash, expected;
+		u8 iv[AES_BLOCK_SIZE];
+
+		SetUp();
+		memcpy(iv, TestIv, sizeof(iv));
+		TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, size, Output, hash),
+		           IPC_SUCCESS);
+		TEST_CHECK(memcmp(Output, Plain, size) == 0);
+		if (size < BUFFER_SIZE)
+			TEST_EQUAL(Output[size], 0);
+		ExpectedHash(Plain, size, expected);
+		TEST_CHECK(memcmp(hash, expected, sizeof(expected)) == 0);
+
+		//the iv is left for decrypting whatever comes after the buffer
+		TEST_CHECK(memcmp(iv, &Cipher[size - AES_BLOCK_SIZE], sizeof(iv)) == 0);
+		TEST_EQUAL(AesEngine.Requests, chunks);
+		TEST_EQUAL(Allocations, 0);
+		TEST_EQUAL(IOSC_Pipeline.Busy, 0);
+	}
+}
+
+static void TestErrors(void)
+{
+	FinalShaHash hash;
+	u8 iv[AES_BLOCK_SIZE];
+
+	SetUp();
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, 0x1000, &Output[0x20], hash),
+	           -2016);
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, 0x1008, Output, hash),
+	           IPC_EINVAL);
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, 0, Output, hash), IPC_EINVAL);
+	TEST_EQUAL(_IOSC_DecryptAndHash(HMAC_HANDLE, iv, Cipher, 0x1000, Output, hash),
+	           IPC_EINVAL);
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE + 0x10, iv, Cipher, 0x1000, Output, hash),
+	           IOSC_EINVAL);
+
+	IOSC_Pipeline.Busy = 1;
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, 0x1000, Output, hash), IOSC_EMAX);
+	TEST_EQUAL(IOSC_Pipeline.Busy, 1);
+	IOSC_Pipeline.Busy = 0;
+	TEST_EQUAL(AesEngine.Requests + ShaEngine.Requests, 0);
+
+	//an engine failing halfway through stops the pipeline, once the other engine is done too
+	for (u32 i = 0; i < 2; i++)
+	{
+		SetUp();
+		Engine *engine = i == 0 ? &AesEngine : &ShaEngine;
+		engine->FailingRequest = 3;
+		memcpy(iv, TestIv, sizeof(iv));
+		TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, 0x80000, Output, hash), -1);
+		TEST_EQUAL(engine->Requests, 4);
+		TEST_CHECK(!AesEngine.Busy && !ShaEngine.Busy);
+		TEST_EQUAL(Allocations, 0);
+		TEST_EQUAL(IOSC_Pipeline.Busy, 0);
+	}
+}
+
+static void TestSpeed(void)
+{
+	FinalShaHash hash, sequentialHash;
+	u8 iv[AES_BLOCK_SIZE];
+
+	SetUp();
+	memcpy(iv, TestIv, sizeof(iv));
+	u32 start = HostGetTicks();
+	TEST_EQUAL(DecryptThenHash(Cipher, BUFFER_SIZE, Output, iv, sequentialHash), IPC_SUCCESS);
+	const u32 sequentialElapsed = HostGetTicks() - start;
+	const u32 sequential = Now;
+	TEST_CHECK(memcmp(Output, Plain, BUFFER_SIZE) == 0);
+
+	SetUp();
+	memcpy(iv, TestIv, sizeof(iv));
+	start = HostGetTicks();
+	TEST_EQUAL(_IOSC_DecryptAndHash(AES_HANDLE, iv, Cipher, BUFFER_SIZE, Output, hash),
+	           IPC_SUCCESS);
+	const u32 pipelinedElapsed = HostGetTicks() - start;
+	const u32 pipelined = Now;
+	TEST_CHECK(memcmp(Output, Plain, BUFFER_SIZE) == 0);
+	TEST_CHECK(memcmp(hash, sequentialHash, sizeof(hash)) == 0);
+
+	HostPrintf("  %uMB: decrypt then hash %u engine ticks (%uus), pipelined %u engine ticks "
+	           "(%uus)\n",
+	           BUFFER_SIZE >> 20, sequential, sequentialElapsed, pipelined, pipelinedElapsed);
+
+	//all but one chunk of hashing hides behind the decrypting
+	const u32 chunkTicks = REQUEST_TICKS + ((IOSC_PIPELINE_CHUNK_SIZE * TICKS_PER_KB) >> 10);
+	TEST_CHECK(pipelined <= (sequential / 2) + (2 * chunkTicks));
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestDecryptAndHash),
+	TEST_CASE(TestErrors),
+	TEST_CASE(TestSpeed),
+};
+
+int main(void)
+{
+	return RunTests("iosc", Tests, ARRAY_LENGTH(Tests));
+}
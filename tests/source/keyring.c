@@ -0,0 +1,234 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	keyring - key storage of the iosc keyring
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <ios/keyring.h>
+#include <host.h>
+
+#include "crypto/keyring.h"
+#include "crypto/otp.h"
+#include "crypto/seeprom.h"
+#include "crypto/iosc.h"
+
+#define CHURN_ROUNDS 200000
+
+//the otp & seeprom contents the keyring boots with
+void OTP_GetNgId(u32 *ngId)
+{
+	*ngId = 0x0403AC68;
+}
+
+void OTP_GetRngSeed(u8 seed[OTP_RNGSEED_SIZE])
+{
+	memset(seed, 0x11, OTP_RNGSEED_SIZE);
+}
+
+void OTP_GetKeys(u8 ng_privkey_out[OTP_NGPRIVKEY_SIZE], u8 common_key_out[OTP_COMMONKEY_SIZE],
+                 u8 nand_hmac_out[OTP_NANDHMAC_SIZE], u8 nand_key_out[OTP_NANDKEY_SIZE])
+{
+	memset(ng_privkey_out, 0x22, OTP_NGPRIVKEY_SIZE);
+	memset(common_key_out, 0x33, OTP_COMMONKEY_SIZE);
+	memset(nand_hmac_out, 0x44, OTP_NANDHMAC_SIZE);
+	memset(nand_key_out, 0x55, OTP_NANDKEY_SIZE);
+}
+
+void SEEPROM_GetKoreanCommonKey(u8 data[OTP_COMMONKEY_SIZE])
+{
+	memset(data, 0x66, OTP_COMMONKEY_SIZE);
+}
+
+s32 IOSC_BOOT2_GetVersion(void)
+{
+	return 4;
+}
+
+s32 IOSC_BOOT2_GetUnk1(void)
+{
+	return 0;
+}
+
+s32 IOSC_BOOT2_GetUnk2(void)
+{
+	return 0;
+}
+
+s32 IOSC_NAND_GetGen(void)
+{
+	return 1;
+}
+
+static u32 RandomState;
+static u32 Random(void)
+{
+	RandomState = (RandomState * 1103515245) + 12345;
+	return RandomState >> 16;
+}
+
+static void FillKey(u8 *key, u32 keySize, u32 keyHandle)
+{
+	for (u32 i = 0; i < keySize; i++)
+		key[i] = (u8)((keyHandle * 0x35) + i);
+}
+
+static bool CheckKey(const u8 *key, u32 keySize, u32 keyHandle)
+{
+	for (u32 i = 0; i < keySize; i++)
+	{
+		if (key[i] != (u8)((keyHandle * 0x35) + i))
+			return false;
+	}
+
+	return true;
+}
+
+static s32 CreateKey(u32 *keyHandle, u32 keySize)
+{
+	u8 key[KEYRING_ARENA_MAX_KEY];
+
+	s32 ret = Keyring_GetHandleFitSize(keyHandle, keySize);
+	if (ret != IPC_SUCCESS)
+		return ret;
+
+	FillKey(key, keySize, *keyHandle);
+	return Keyring_SetKey(*keyHandle, key, keySize);
+}
+
+//what IOSC_DeleteObject does with the keyring
+static void DeleteKey(u32 keyHandle)
+{
+	KeyringMetadata[keyHandle].IsUsed = 0;
+	Keyring_FreeKeyIndex(KeyringMetadata[keyHandle].KeyringIndex);
+	KeyringMetadata[keyHandle].KeyringIndex = -1;
+}
+
+//creates as many rsa-4096 keys as fit & deletes them again
+static u32 CountLargestKeys(void)
+{
+	u32 handles[KEYRING_METADATA_TOTAL_ENTRIES];
+	u32 count = 0;
+
+	while (count < ARRAY_LENGTH(handles) &&
+	       CreateKey(&handles[count], KEYRING_ARENA_MAX_KEY) == IPC_SUCCESS)
+		count++;
+
+	for (u32 i = 0; i < count; i++)
+		DeleteKey(handles[i]);
+	return count;
+}
+
+static void TestBootKeys(void)
+{
+	u8 key[OTP_NANDHMAC_SIZE];
+	u8 expected[OTP_NANDHMAC_SIZE];
+
+	Keyring_Init();
+	memset(expected, 0x44, sizeof(expected));
+	TEST_EQUAL(Keyring_GetKey(KEYRING_CONST_NAND_HMAC, key, sizeof(key)), IPC_SUCCESS);
+	TEST_CHECK(memcmp(key, expected, sizeof(key)) == 0);
+	TEST_CHECK(memcmp(Keyring_GetKeyPointer(KEYRING_CONST_NAND_HMAC), expected,
+	                  sizeof(expected)) == 0);
+
+	memset(expected, 0x66, OTP_COMMONKEY_SIZE);
+	TEST_EQUAL(Keyring_GetKey(KEYRING_CONST_EEPROM_COMMON_KEY, key, OTP_COMMONKEY_SIZE),
+	           IPC_SUCCESS);
+	TEST_CHECK(memcmp(key, expected, OTP_COMMONKEY_SIZE) == 0);
+
+	//metadata only entries have no key data
+	TEST_CHECK(Keyring_GetKeyPointer(KEYRING_CONST_NG_ID) == NULL);
+	TEST_EQUAL(Keyring_GetKey(KEYRING_CONST_NG_ID, key, 4), IOSC_EINVAL);
+}
+
+//an rsa-4096 key is one piece of the arena, so a pointer to it is all it takes to use it
+static void TestLargeKeysAreContiguous(void)
+{
+	u8 key[KEYRING_ARENA_MAX_KEY];
+	u32 keyHandle;
+
+	Keyring_Init();
+	TEST_EQUAL(CreateKey(&keyHandle, KEYRING_ARENA_MAX_KEY), IPC_SUCCESS);
+	TEST_CHECK(CheckKey(Keyring_GetKeyPointer(keyHandle), KEYRING_ARENA_MAX_KEY, keyHandle));
+	TEST_EQUAL(Keyring_GetKey(keyHandle, key, sizeof(key)), IPC_SUCCESS);
+	TEST_CHECK(CheckKey(key, sizeof(key), keyHandle));
+	DeleteKey(keyHandle);
+
+	//a key can't be read or written past the block it got
+	TEST_EQUAL(CreateKey(&keyHandle, 0x14), IPC_SUCCESS);
+	TEST_EQUAL(Keyring_GetKey(keyHandle, key, KEYRING_ARENA_BLOCK_SIZE), IPC_SUCCESS);
+	TEST_EQUAL(Keyring_GetKey(keyHandle, key, KEYRING_ARENA_BLOCK_SIZE + 1), IOSC_EINVAL);
+	TEST_EQUAL(Keyring_SetKey(keyHandle, key, KEYRING_ARENA_BLOCK_SIZE + 1), IOSC_EINVAL);
+	DeleteKey(keyHandle);
+
+	TEST_EQUAL(Keyring_GetHandleFitSize(&keyHandle, KEYRING_ARENA_MAX_KEY + 1), IOSC_FAIL_ALLOC);
+}
+
+//creating & deleting keys of all sizes in random order must not break the arena into pieces
+static void TestKeyChurn(void)
+{
+	static const u32 sizes[] = { 0x10, 0x14, 0x1E, 0x3C, 0x5A, 0x100, 0x200 };
+	u32 handles[KEYRING_METADATA_TOTAL_ENTRIES];
+	u32 keySizes[KEYRING_METADATA_TOTAL_ENTRIES];
+	u32 count = 0;
+	u32 failed = 0;
+
+	Keyring_Init();
+	RandomState = 1;
+	const u32 largestKeys = CountLargestKeys();
+	TEST_CHECK(largestKeys > 0);
+
+	const u32 start = HostGetTicks();
+	for (u32 round = 0; round < CHURN_ROUNDS; round++)
+	{
+		if (count > 0 && (Random() & 1) != 0)
+		{
+			const u32 victim = Random() % count;
+			TEST_CHECK(CheckKey(Keyring_GetKeyPointer(handles[victim]), keySizes[victim],
+			                    handles[victim]));
+			DeleteKey(handles[victim]);
+			count--;
+			handles[victim] = handles[count];
+			keySizes[victim] = keySizes[count];
+			continue;
+		}
+
+		const u32 keySize = sizes[Random() % ARRAY_LENGTH(sizes)];
+		if (CreateKey(&handles[count], keySize) != IPC_SUCCESS)
+		{
+			failed++;
+			continue;
+		}
+
+		keySizes[count] = keySize;
+		count++;
+	}
+
+	const u32 elapsed = HostGetTicks() - start;
+	while (count > 0)
+	{
+		count--;
+		TEST_CHECK(CheckKey(Keyring_GetKeyPointer(handles[count]), keySizes[count],
+		                    handles[count]));
+		DeleteKey(handles[count]);
+	}
+
+	HostPrintf("  %u rounds in %uus, %u creates didn't fit\n", CHURN_ROUNDS, elapsed, failed);
+	TEST_EQUAL(CountLargestKeys(), largestKeys);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestBootKeys),
+	TEST_CASE(TestLargeKeysAreContiguous),
+	TEST_CASE(TestKeyChurn),
+};
+
+int main(void)
+{
+	return RunTests("keyring", Tests, ARRAY_LENGTH(Tests));
+}
@@ -0,0 +1,331 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	logring - the printk side of a process' log ring against the kernel's drain
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <stdarg.h>
+#include <string.h>
+#include <vsprintf.h>
+#include <ios/errno.h>
+#include <host.h>
+
+//both sides keep their state in statics, so they are pulled in whole.
+//the process' printk is renamed, the host already has one that prints to the console
+#define printk ProcessPrintk
+#include "../../core/source/ios/printk.c"
+#undef printk
+#include "../../kernel/source/messaging/logRing.c"
+
+#define PROCESS_ID    1
+#define STREAM_SIZE   0x100000
+#define SPEED_ROUNDS  1000000
+#define SPEED_MESSAGE 80
+
+static ThreadInfo ProcessThread = { .ProcessId = PROCESS_ID };
+ThreadInfo *CurrentThread = &ProcessThread;
+
+static u8 Gecko[STREAM_SIZE];
+static u32 GeckoLength;
+static char GeckoMessage[0x100];
+static u32 StatusRegister = SPSR_USER_MODE;
+
+u32 GetCurrentStatusRegister(void)
+{
+	return StatusRegister;
+}
+
+u32 SwapWord(volatile u32 *address, u32 value)
+{
+	const u32 old = *address;
+	*address = value;
+	return old;
+}
+
+u32 DisableInterrupts(void)
+{
+	return 0;
+}
+
+void RestoreInterrupts(u32 cookie)
+{
+	(void)cookie;
+}
+
+s32 CheckMemoryPointer(const void *ptr, u32 size, u32 type, u32 pid, u32 domainPid)
+{
+	(void)size;
+	(void)type;
+	(void)domainPid;
+	return ptr != NULL && pid == PROCESS_ID ? IPC_SUCCESS : IPC_EACCES;
+}
+
+s32 OSRegisterLogRing(LogRing *ring)
+{
+	return RegisterLogRing(ring);
+}
+
+u32 gecko_write(const void *buffer, u32 size)
+{
+	if (size > STREAM_SIZE - GeckoLength)
+		size = STREAM_SIZE - GeckoLength;
+
+	memcpy(&Gecko[GeckoLength], buffer, size);
+	GeckoLength += size;
+	return size;
+}
+
+//the kernel's own reports are kept apart from what the process wrote
+u32 gecko_printf(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	const int length = vsnprintf(GeckoMessage, sizeof(GeckoMessage), fmt, args);
+	va_end(args);
+	return (u32)length;
+}
+
+//only LogRingHandler uses these, which never returns & isn't run here
+s32 CreateMessageQueue(void **ptr, u32 numberOfMessages)
+{
+	(void)ptr;
+	(void)numberOfMessages;
+	return IPC_EMAX;
+}
+
+s32 CreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message)
+{
+	(void)delayUs;
+	(void)periodUs;
+	(void)queueid;
+	(void)message;
+	return IPC_EMAX;
+}
+
+s32 ReceiveMessage(const s32 queueId, void **message, u32 flags)
+{
+	(void)queueId;
+	(void)message;
+	(void)flags;
+	return IPC_EINVAL;
+}
+
+void panic(const char *fmt, ...)
+{
+	HostPrintf("panic: %s", fmt);
+	HostExit(1);
+	while (1);
+}
+
+static u32 RandomState;
+static u32 Random(void)
+{
+	RandomState = (RandomState * 1103515245) + 12345;
+	return RandomState >> 16;
+}
+
+//what one wake up of LogRingHandler does
+static void DrainLogRings(void)
+{
+	for (u32 processId = 0; processId < MAX_PROCESSES; processId++)
+	{
+		LogRing *ring = LogRings[processId];
+		if (ring != NULL)
+			DrainLogRing(processId, ring);
+	}
+}
+
+//a process that just started, with nothing registered yet
+static void ResetProcess(void)
+{
+	ReleaseLogRing(PROCESS_ID);
+	memset(&ProcessLogRing, 0, sizeof(ProcessLogRing));
+	ProcessLogRingState = 0;
+	StatusRegister = SPSR_USER_MODE;
+	GeckoLength = 0;
+	GeckoMessage[0] = '\0';
+}
+
+static void TestFirstPrintkRegisters(void)
+{
+	ResetProcess();
+	TEST_CHECK(LogRings[PROCESS_ID] == NULL);
+	TEST_EQUAL(ProcessPrintk("hello %s", "world"), 11);
+	TEST_CHECK(LogRings[PROCESS_ID] == &ProcessLogRing);
+
+	//nothing reaches the gecko before the kernel drains, & the missing newline is added
+	TEST_EQUAL(GeckoLength, 0);
+	DrainLogRings();
+	TEST_EQUAL(GeckoLength, 12);
+	TEST_CHECK(memcmp(Gecko, "hello world\n", 12) == 0);
+	TEST_EQUAL(ProcessLogRing.Tail, ProcessLogRing.Head);
+}
+
+//writes of random sizes with drains at random points. the ring wraps around many times, &
+//what comes out of the gecko has to be exactly the messages that were taken
+static void TestWraparound(void)
+{
+	static u8 expected[STREAM_SIZE];
+	char message[0x100];
+	u32 expectedLength = 0;
+	u32 dropped = 0;
+	u32 written = 0;
+
+	ResetProcess();
+	RandomState = 1;
+	while (expectedLength < STREAM_SIZE - sizeof(message))
+	{
+		const u32 length = 1 + Random() % 0xFE;
+		for (u32 i = 0; i < length; i++)
+			message[i] = (char)('a' + Random() % 26);
+		message[length - 1] = Random() % 4 == 0 ? '\n' : message[length - 1];
+		message[length] = '\0';
+
+		const u32 before = ProcessLogRing.DroppedMessages;
+		TEST_EQUAL(ProcessPrintk("%s", message), (int)length);
+		if (ProcessLogRing.DroppedMessages == before)
+		{
+			memcpy(&expected[expectedLength], message, length);
+			expectedLength += length;
+			if (message[length - 1] != '\n')
+				expected[expectedLength++] = '\n';
+			written++;
+		}
+		else
+			dropped++;
+
+		if (Random() % 12 == 0)
+			DrainLogRings();
+	}
+
+	DrainLogRings();
+	HostPrintf("  %u messages, %u dropped, %u bytes\n", written, dropped, GeckoLength);
+	TEST_CHECK(dropped > 0);
+	TEST_EQUAL(GeckoLength, expectedLength);
+	TEST_CHECK(memcmp(Gecko, expected, expectedLength) == 0);
+	TEST_EQUAL(ProcessLogRing.DroppedMessages, dropped);
+}
+
+static void TestDroppedMessagesAreReported(void)
+{
+	char message[0x100];
+
+	ResetProcess();
+	memset(message, 'x', 0xFF);
+	message[0xFF] = '\0';
+
+	//8 messages of 0x100 bytes fill the ring, the rest is dropped
+	for (u32 i = 0; i < 10; i++)
+		ProcessPrintk("%s", message);
+
+	TEST_EQUAL(ProcessLogRing.Head - ProcessLogRing.Tail, LOG_RING_SIZE);
+	TEST_EQUAL(ProcessLogRing.DroppedMessages, 2);
+	DrainLogRings();
+	TEST_EQUAL(GeckoLength, LOG_RING_SIZE);
+	TEST_CHECK(strcmp(GeckoMessage, "process 1 dropped 2 log messages\n") == 0);
+
+	//reported once, not on every drain
+	GeckoMessage[0] = '\0';
+	DrainLogRings();
+	TEST_EQUAL(GeckoMessage[0], '\0');
+}
+
+//the ring is process memory, so the kernel can't trust the head it finds in it
+static void TestHeadIsClamped(void)
+{
+	ResetProcess();
+	ProcessPrintk("booted");
+	DrainLogRings();
+	GeckoLength = 0;
+
+	const u32 tail = ProcessLogRing.Tail;
+	ProcessLogRing.Head = tail + 0x10000;
+	DrainLogRings();
+	TEST_EQUAL(GeckoLength, LOG_RING_SIZE);
+	TEST_EQUAL(ProcessLogRing.Tail, tail + 0x10000);
+	TEST_CHECK(strcmp(GeckoMessage, "process 1 skipped 63488 bytes of its log ring\n") == 0);
+
+	//a head behind the tail is a huge distance as well
+	GeckoLength = 0;
+	ProcessLogRing.Head = ProcessLogRing.Tail - 1;
+	DrainLogRings();
+	TEST_EQUAL(GeckoLength, LOG_RING_SIZE);
+	TEST_EQUAL(ProcessLogRing.Tail, ProcessLogRing.Head);
+}
+
+static void TestBusyRingFallsBack(void)
+{
+	ResetProcess();
+	ProcessPrintk("registers the ring");
+
+	//another thread of the process holds the lock, so this goes out through the syscall
+	const u32 head = ProcessLogRing.Head;
+	ProcessLogRing.Lock = 1;
+	TEST_EQUAL(ProcessPrintk("busy"), 4);
+	TEST_EQUAL(ProcessLogRing.Head, head);
+	ProcessLogRing.Lock = 0;
+
+	//the kernel itself never writes to a ring
+	StatusRegister = SPSR_SUPERVISOR_MODE;
+	ProcessPrintk("kernel");
+	TEST_EQUAL(ProcessLogRing.Head, head);
+}
+
+static void TestReleasedRingIsNotDrained(void)
+{
+	ResetProcess();
+	ProcessPrintk("before the process died");
+	ReleaseLogRing(PROCESS_ID);
+	DrainLogRings();
+	TEST_EQUAL(GeckoLength, 0);
+
+	//a ring outside of the process' memory can't be registered
+	CurrentThread->ProcessId = 2;
+	TEST_EQUAL(RegisterLogRing(&ProcessLogRing), IPC_EACCES);
+	CurrentThread->ProcessId = PROCESS_ID;
+	TEST_CHECK(LogRings[2] == NULL);
+}
+
+static void TestSpeed(void)
+{
+	char message[SPEED_MESSAGE];
+
+	ResetProcess();
+	memset(message, 'x', sizeof(message) - 1);
+	message[sizeof(message) - 1] = '\0';
+
+	const u32 start = HostGetTicks();
+	for (u32 i = 0; i < SPEED_ROUNDS; i++)
+	{
+		ProcessPrintk("%s", message);
+		if ((i & 0x0F) == 0x0F)
+		{
+			GeckoLength = 0;
+			DrainLogRings();
+		}
+	}
+
+	const u32 elapsed = HostGetTicks() - start;
+	HostPrintf("  %u printks of %u bytes in %uus\n", SPEED_ROUNDS, SPEED_MESSAGE, elapsed);
+	TEST_EQUAL(ProcessLogRing.DroppedMessages, 0);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestFirstPrintkRegisters),
+	TEST_CASE(TestWraparound),
+	TEST_CASE(TestDroppedMessagesAreReported),
+	TEST_CASE(TestHeadIsClamped),
+	TEST_CASE(TestBusyRingFallsBack),
+	TEST_CASE(TestReleasedRingIsNotDrained),
+	TEST_CASE(TestSpeed),
+};
+
+int main(void)
+{
+	return RunTests("logring", Tests, ARRAY_LENGTH(Tests));
+}
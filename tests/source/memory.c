@@ -0,0 +1,402 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	memory - the page tables the kernel builds for its memory maps
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <types.h>
+#include <ios/errno.h>
+#include <host.h>
+
+//processor.h is arm assembly, which is swapped for the few accessors memory.c uses
+#define __PROCESSOR_H__
+u32 read32(u32 address);
+u16 read16(u32 address);
+void write16(u32 address, u16 data);
+
+#include "../../kernel/source/memory/memory.c"
+
+#define MAP_PHYSICAL 0x13000000
+#define MAP_VIRTUAL  0x10000000
+#define MAP_DOMAIN   0x0F
+#define MAP_PROCESS  1
+#define WRITE_ACCESS 4
+
+//the page table & the heap the course page tables come from. both are only ever read by the
+//code under test, so on the host the virtual addresses in them never have to be real
+static u32 TranslationTable[0x1000] ALIGNED(0x4000);
+static u8 PageHeap[0x4000] ALIGNED(0x400);
+static u32 FlushedLines;
+static u32 TlbInvalidations;
+
+//the symbols of the kernel's linker script
+const u32 __kmalloc_heap_start[1];
+const u32 __kmalloc_heap_end[1];
+const u32 __kmalloc_heap_size[1];
+const u32 __ipc_heap_start[1];
+const u32 __ipc_heap_size[1];
+const u32 __thread_stacks_area_start[1];
+const u32 __thread_stacks_area_size[1];
+const u32 __iobuf_heap_area_start[1];
+const u32 __iobuf_heap_area_size[1];
+const u32 __headers_addr[1];
+const u32 __headers_size[1];
+const u32 __crypto_addr[1];
+const u32 __crypto_size[1];
+ThreadInfo *CurrentThread = NULL;
+
+u32 read32(u32 address)
+{
+	(void)address;
+	return 0;
+}
+
+u16 read16(u32 address)
+{
+	(void)address;
+	return 0;
+}
+
+void write16(u32 address, u16 data)
+{
+	(void)address;
+	(void)data;
+}
+
+void _dc_flush_entries(const void *start, u32 count)
+{
+	(void)start;
+	FlushedLines += count;
+}
+
+u32 TlbInvalidate(void)
+{
+	TlbInvalidations++;
+	return 0;
+}
+
+//the rest of the cache, mmu & bus maintenance only matters on the real hardware
+void _dc_inval_entries(const void *start, u32 count)
+{
+	(void)start;
+	(void)count;
+}
+
+void _dc_flush(void) {}
+void _ic_invalidate(void) {}
+void _dc_invalidate(void) {}
+void FlushMemory(void) {}
+void AhbFlushTo(AHBDEV dev)
+{
+	(void)dev;
+}
+
+void _ahb_flush_from(AHBDEV dev)
+{
+	(void)dev;
+}
+
+u32 GetControlRegister(void)
+{
+	return 0;
+}
+
+void SetControlRegister(u32 data)
+{
+	(void)data;
+}
+
+void SetTranslationTableBaseRegister(u32 data)
+{
+	(void)data;
+}
+
+void SetDomainAccessControlRegister(u32 data)
+{
+	(void)data;
+}
+
+void SetDataFaultStatusRegister(u32 data)
+{
+	(void)data;
+}
+
+void SetInstructionFaultStatusRegister(u32 data)
+{
+	(void)data;
+}
+
+void SetFaultAddressRegister(u32 data)
+{
+	(void)data;
+}
+
+u32 DisableInterrupts(void)
+{
+	return 0;
+}
+
+void RestoreInterrupts(u32 cookie)
+{
+	(void)cookie;
+}
+
+void udelay(u32 d)
+{
+	(void)d;
+}
+
+u32 gecko_printf(const char *fmt, ...)
+{
+	(void)fmt;
+	return 0;
+}
+
+//what InitializeMemory sets up, minus the kernel's own maps
+static void SetUp(void)
+{
+	memset(TranslationTable, 0, sizeof(TranslationTable));
+	MemoryTranslationTable = TranslationTable;
+	heapCurrent = PageHeap;
+	heapEnd = PageHeap + sizeof(PageHeap);
+	DomainAccessControlTable[MAP_PROCESS] = DOMAIN_VALUE(MAP_DOMAIN, DOMAIN_CLIENT);
+	FlushedLines = 0;
+	TlbInvalidations = 0;
+}
+
+static MemorySection Section(u32 offset, u32 size, u32 accessRights, u32 isCached)
+{
+	return (MemorySection) {
+		.PhysicalAddress = MAP_PHYSICAL + offset,
+		.VirtualAddress = MAP_VIRTUAL + offset,
+		.Size = size,
+		.Domain = MAP_DOMAIN,
+		.AccessRights = accessRights,
+		.IsCached = isCached,
+	};
+}
+
+//the second level table that maps the given 1MB
+static u32 *GetPageTable(u32 offset)
+{
+	const u32 entry = TranslationTable[PAGE_ENTRY(MAP_VIRTUAL + offset)];
+	if ((entry & PAGE_MASK) != COURSE_PAGE)
+		return NULL;
+
+	return (u32 *)(entry & 0xFFFFFC00);
+}
+
+static u32 SmallPage(u32 offset, u32 accessRights, u32 isCached)
+{
+	return (MAP_PHYSICAL + offset) | COURSE_SECTION | (isCached ? WRITEBACK_CACHE : 0) |
+	       APX_VALUE(3, accessRights) | APX_VALUE(2, accessRights) |
+	       APX_VALUE(1, accessRights) | APX_VALUE(0, accessRights);
+}
+
+static u32 LargePage(u32 offset, u32 accessRights, u32 isCached)
+{
+	return (SmallPage(offset, accessRights, isCached) & ~(u32)PAGE_TYPE_MASK) |
+	       LARGE_COURSE_SECTION;
+}
+
+static bool IsMappedAt(u32 offset, u32 size)
+{
+	for (u32 page = 0; page < size; page += 0x1000)
+	{
+		if (VirtualToPhysical(MAP_VIRTUAL + offset + page + 0x123) !=
+		    MAP_PHYSICAL + offset + page + 0x123)
+			return false;
+	}
+
+	return true;
+}
+
+//a section, 2 large pages & 3 small ones
+static s32 MapTestRange(void)
+{
+	MemorySection section = Section(0, 0x123000, AP_RWUSER, 1);
+	return MapMemorySections(&section, 1);
+}
+
+static void TestPageSizes(void)
+{
+	SetUp();
+	TEST_EQUAL(MapTestRange(), IPC_SUCCESS);
+	TEST_EQUAL(TranslationTable[PAGE_ENTRY(MAP_VIRTUAL)],
+	           MAP_PHYSICAL | SECTION_PAGE | WRITEBACK_CACHE | AP_VALUE(AP_RWUSER) |
+	               PAGE_DOMAIN(MAP_DOMAIN));
+
+	const u32 *pageTable = GetPageTable(0x100000);
+	TEST_CHECK(pageTable != NULL);
+	if (pageTable == NULL)
+		return;
+
+	for (u32 i = 0; i < LARGE_PAGE_ENTRIES; i++)
+	{
+		TEST_EQUAL(pageTable[i], LargePage(0x100000, AP_RWUSER, 1));
+		TEST_EQUAL(pageTable[LARGE_PAGE_ENTRIES + i], LargePage(0x110000, AP_RWUSER, 1));
+	}
+
+	for (u32 i = 0; i < 3; i++)
+		TEST_EQUAL(pageTable[0x20 + i], SmallPage(0x120000 + (i << 12), AP_RWUSER, 1));
+	TEST_EQUAL(pageTable[0x23], 0);
+
+	TEST_CHECK(IsMappedAt(0, 0x123000));
+	TEST_EQUAL(VirtualToPhysical(MAP_VIRTUAL + 0x123000), 0);
+
+	//a pointer check walks a large page in one step
+	u32 blockSize = 0;
+	TEST_EQUAL(CheckMemoryBlock((u8 *)(MAP_VIRTUAL + 0x10F000), WRITE_ACCESS, MAP_PROCESS,
+	                            MAP_PROCESS, &blockSize),
+	           IPC_SUCCESS);
+	TEST_EQUAL(blockSize, LARGE_PAGE_SIZE);
+	TEST_EQUAL(CheckMemoryBlock((u8 *)(MAP_VIRTUAL + 0x121000), WRITE_ACCESS, MAP_PROCESS,
+	                            MAP_PROCESS, &blockSize),
+	           IPC_SUCCESS);
+	TEST_EQUAL(blockSize, 0x1000);
+	TEST_EQUAL(CheckMemoryPointer((void *)MAP_VIRTUAL, 0x123000, WRITE_ACCESS, MAP_PROCESS,
+	                              MAP_PROCESS),
+	           IPC_SUCCESS);
+	TEST_EQUAL(CheckMemoryPointer((void *)MAP_VIRTUAL, 0x124000, WRITE_ACCESS, MAP_PROCESS,
+	                              MAP_PROCESS),
+	           IPC_EACCES);
+}
+
+//only the entries that changed are written back, & the tlb is invalidated once per batch
+static void TestMaintenanceIsBatched(void)
+{
+	SetUp();
+	TEST_EQUAL(MapTestRange(), IPC_SUCCESS);
+
+	//section 1 line, new course page table 32 + 1, 2 large pages 2 each, 3 small pages 1 each
+	TEST_EQUAL(FlushedLines, 41);
+	TEST_EQUAL(TlbInvalidations, 1);
+
+	MemorySection sections[] = {
+		Section(0x200000, 0x1000, AP_RWUSER, 1),
+		Section(0x201000, 0x1000, AP_RWUSER, 1),
+		Section(0x210000, 0x10000, AP_RWUSER, 1),
+	};
+	FlushedLines = 0;
+	TlbInvalidations = 0;
+	TEST_EQUAL(MapMemorySections(sections, ARRAY_LENGTH(sections)), IPC_SUCCESS);
+	TEST_EQUAL(FlushedLines, 33 + 1 + 1 + 2);
+	TEST_EQUAL(TlbInvalidations, 1);
+}
+
+static void TestMappedMemoryIsRefused(void)
+{
+	SetUp();
+	TEST_EQUAL(MapTestRange(), IPC_SUCCESS);
+
+	MemorySection smallPage = Section(0x122000, 0x1000, AP_NOUSER, 0);
+	TEST_EQUAL(MapMemorySections(&smallPage, 1), IPC_EINVAL);
+	MemorySection insideLargePage = Section(0x105000, 0x1000, AP_NOUSER, 0);
+	TEST_EQUAL(MapMemorySections(&insideLargePage, 1), IPC_EINVAL);
+	MemorySection overSmallPages = Section(0x120000, 0x10000, AP_NOUSER, 0);
+	TEST_EQUAL(MapMemorySections(&overSmallPages, 1), IPC_EINVAL);
+	TEST_EQUAL(GetPageTable(0x100000)[5], LargePage(0x100000, AP_RWUSER, 1));
+
+	MemorySection unaligned = Section(0x130800, 0x1000, AP_NOUSER, 0);
+	TEST_EQUAL(MapMemorySections(&unaligned, 1), IPC_EINVAL);
+}
+
+//remapping one page of a large page has to leave the other 15 pages mapped as they were
+static void TestRemapSplitsLargePage(void)
+{
+	SetUp();
+	TEST_EQUAL(MapTestRange(), IPC_SUCCESS);
+
+	MemorySection page = Section(0x105000, 0x1000, AP_NOUSER, 0);
+	FlushedLines = 0;
+	TEST_EQUAL(RemapMemorySections(&page, 1), IPC_SUCCESS);
+
+	//the first level entry, the 16 entries of the split & the page itself
+	TEST_EQUAL(FlushedLines, 1 + 2 + 1);
+
+	const u32 *pageTable = GetPageTable(0x100000);
+	for (u32 i = 0; i < LARGE_PAGE_ENTRIES; i++)
+	{
+		if (i == 5)
+			TEST_EQUAL(pageTable[i], SmallPage(0x105000, AP_NOUSER, 0));
+		else
+			TEST_EQUAL(pageTable[i], SmallPage(0x100000 + (i << 12), AP_RWUSER, 1));
+	}
+
+	//the large page next to it is untouched
+	for (u32 i = LARGE_PAGE_ENTRIES; i < LARGE_PAGE_ENTRIES * 2; i++)
+		TEST_EQUAL(pageTable[i], LargePage(0x110000, AP_RWUSER, 1));
+
+	TEST_CHECK(IsMappedAt(0, 0x123000));
+	TEST_EQUAL(CheckMemoryPointer((void *)(MAP_VIRTUAL + 0x100000), 0x5000, WRITE_ACCESS,
+	                              MAP_PROCESS, MAP_PROCESS),
+	           IPC_SUCCESS);
+	TEST_EQUAL(CheckMemoryPointer((void *)(MAP_VIRTUAL + 0x100000), 0x6000, WRITE_ACCESS,
+	                              MAP_PROCESS, MAP_PROCESS),
+	           IPC_EACCES);
+	TEST_EQUAL(CheckMemoryPointer((void *)(MAP_VIRTUAL + 0x106000), 0x1D000, WRITE_ACCESS,
+	                              MAP_PROCESS, MAP_PROCESS),
+	           IPC_SUCCESS);
+
+	//once split, remapping another page of it only touches that page
+	page = Section(0x10A000, 0x1000, AP_NOUSER, 0);
+	TEST_EQUAL(RemapMemorySections(&page, 1), IPC_SUCCESS);
+	TEST_EQUAL(pageTable[5], SmallPage(0x105000, AP_NOUSER, 0));
+	TEST_EQUAL(pageTable[0x0A], SmallPage(0x10A000, AP_NOUSER, 0));
+	TEST_EQUAL(pageTable[0x0B], SmallPage(0x10B000, AP_RWUSER, 1));
+}
+
+static void TestRemapLargePage(void)
+{
+	SetUp();
+	TEST_EQUAL(MapTestRange(), IPC_SUCCESS);
+
+	//split one large page, then put a large page back over all of it
+	MemorySection page = Section(0x10F000, 0x1000, AP_ROUSER, 0);
+	TEST_EQUAL(RemapMemorySections(&page, 1), IPC_SUCCESS);
+	MemorySection largePage = Section(0x100000, LARGE_PAGE_SIZE, AP_NOUSER, 0);
+	TEST_EQUAL(RemapMemorySections(&largePage, 1), IPC_SUCCESS);
+
+	const u32 *pageTable = GetPageTable(0x100000);
+	for (u32 i = 0; i < LARGE_PAGE_ENTRIES; i++)
+		TEST_EQUAL(pageTable[i], LargePage(0x100000, AP_NOUSER, 0));
+
+	TEST_CHECK(IsMappedAt(0x100000, LARGE_PAGE_SIZE));
+	TEST_EQUAL(CheckMemoryPointer((void *)(MAP_VIRTUAL + 0x10F000), 1, 0, MAP_PROCESS,
+	                              MAP_PROCESS),
+	           IPC_EACCES);
+	TEST_EQUAL(CheckMemoryPointer((void *)(MAP_VIRTUAL + 0x110000), LARGE_PAGE_SIZE,
+	                              WRITE_ACCESS, MAP_PROCESS, MAP_PROCESS),
+	           IPC_SUCCESS);
+}
+
+static void TestOutOfPageTables(void)
+{
+	SetUp();
+	heapEnd = heapCurrent + 0x400;
+
+	MemorySection first = Section(0x101000, 0x1000, AP_RWUSER, 1);
+	TEST_EQUAL(MapMemorySections(&first, 1), IPC_SUCCESS);
+	MemorySection second = Section(0x201000, 0x1000, AP_RWUSER, 1);
+	TEST_EQUAL(MapMemorySections(&second, 1), IPC_ENOMEM);
+	TEST_EQUAL(TranslationTable[PAGE_ENTRY(MAP_VIRTUAL + 0x200000)], 0);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestPageSizes),
+	TEST_CASE(TestMaintenanceIsBatched),
+	TEST_CASE(TestMappedMemoryIsRefused),
+	TEST_CASE(TestRemapSplitsLargePage),
+	TEST_CASE(TestRemapLargePage),
+	TEST_CASE(TestOutOfPageTables),
+};
+
+int main(void)
+{
+	return RunTests("memory", Tests, ARRAY_LENGTH(Tests));
+}
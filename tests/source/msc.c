@@ -0,0 +1,348 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	msc - the storage layer of the msc module on a ram disk
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <ios/errno.h>
+#include <usb/msc.h>
+#include <host.h>
+
+#include "storage.h"
+#include "transport.h"
+
+#define DISK_SECTOR_SIZE  0x200
+#define DISK_SIZE         0x4000000
+#define DISK_SECTORS      (DISK_SIZE / DISK_SECTOR_SIZE)
+#define BUFFER_SIZE       0x100000
+#define BUFFER_GUARD      0x40
+#define DEVICE_DESCRIPTOR 1
+
+//the usb disk behind the transport. SendCommand answers the scsi commands from memory
+typedef struct
+{
+	u8 *Data;
+	u8 DeviceType;
+	//the next unit ready checks & transfers fail with a check condition & this sense
+	u32 FailingCommands;
+	u8 SenseKey;
+	u8 AdditionalSense;
+	u32 Commands;
+	u32 LargestTransfer;
+	u32 Sleeps;
+} RamDisk;
+
+static RamDisk Disk;
+
+void *OSAllocateIOBuf(u32 size, u32 alignment)
+{
+	(void)alignment;
+	return HostAllocate(size);
+}
+
+s32 OSFreeIOBuf(void *ptr)
+{
+	(void)ptr;
+	return IPC_SUCCESS;
+}
+
+s32 InitialiseTransport(void)
+{
+	return IPC_SUCCESS;
+}
+
+void SleepTransport(u32 delay)
+{
+	(void)delay;
+	Disk.Sleeps++;
+}
+
+s32 AttachTransport(MscDevice *device)
+{
+	device->HostFileDescriptor = DEVICE_DESCRIPTOR;
+	device->VendorId = 0x0781;
+	device->ProductId = 0x5567;
+	return IPC_SUCCESS;
+}
+
+void DetachTransport(MscDevice *device)
+{
+	device->HostFileDescriptor = -1;
+	device->Ready = false;
+}
+
+static u32 ReadBigEndian32(const u8 *data)
+{
+	return (u32)data[0] << 24 | (u32)data[1] << 16 | (u32)data[2] << 8 | data[3];
+}
+
+static void WriteBigEndian32(u8 *data, u32 value)
+{
+	data[0] = (u8)(value >> 24);
+	data[1] = (u8)(value >> 16);
+	data[2] = (u8)(value >> 8);
+	data[3] = (u8)value;
+}
+
+s32 SendCommand(MscDevice *device, const u8 *command, u8 commandLength, void *data, u32 length,
+                bool isInput, u32 *transferred)
+{
+	(void)commandLength;
+	(void)isInput;
+	u8 *buffer = (u8 *)data;
+
+	if (device->HostFileDescriptor != DEVICE_DESCRIPTOR)
+		return IPC_EINVAL;
+
+	Disk.Commands++;
+	if (length > Disk.LargestTransfer)
+		Disk.LargestTransfer = length;
+
+	*transferred = length;
+	if (command[0] == SCSI_REQUEST_SENSE)
+	{
+		memset(buffer, 0, length);
+		buffer[2] = Disk.SenseKey;
+		buffer[12] = Disk.AdditionalSense;
+		return IPC_SUCCESS;
+	}
+
+	const bool canFail = command[0] == SCSI_TEST_UNIT_READY || command[0] == SCSI_READ_10 ||
+	                     command[0] == SCSI_WRITE_10;
+	if (canFail && Disk.FailingCommands != 0)
+	{
+		Disk.FailingCommands--;
+		*transferred = 0;
+		return IPC_CHECKVALUE;
+	}
+
+	switch (command[0])
+	{
+		case SCSI_TEST_UNIT_READY:
+			return IPC_SUCCESS;
+		case SCSI_INQUIRY:
+			memset(buffer, 0, length);
+			buffer[0] = Disk.DeviceType;
+			return IPC_SUCCESS;
+		case SCSI_READ_CAPACITY_10:
+			WriteBigEndian32(&buffer[0], DISK_SECTORS - 1);
+			WriteBigEndian32(&buffer[4], DISK_SECTOR_SIZE);
+			return IPC_SUCCESS;
+		case SCSI_READ_10:
+		case SCSI_WRITE_10:
+		{
+			const u32 sector = ReadBigEndian32(&command[2]);
+			const u32 count = (u32)command[7] << 8 | command[8];
+			if (count * DISK_SECTOR_SIZE != length || sector + count > DISK_SECTORS)
+				return IPC_EINVAL;
+
+			u8 *disk = &Disk.Data[sector * DISK_SECTOR_SIZE];
+			if (command[0] == SCSI_READ_10)
+				memcpy(buffer, disk, length);
+			else
+				memcpy(disk, buffer, length);
+			return IPC_SUCCESS;
+		}
+		default:
+			*transferred = 0;
+			return IPC_EINVAL;
+	}
+}
+
+//a fresh disk, plugged in & attached
+static void SetUp(MscDevice *device)
+{
+	if (Disk.Data == NULL)
+	{
+		Disk.Data = HostAllocate(DISK_SIZE);
+		TEST_EQUAL(InitialiseStorage(), IPC_SUCCESS);
+	}
+
+	u8 *data = Disk.Data;
+	memset(&Disk, 0, sizeof(Disk));
+	Disk.Data = data;
+	Disk.DeviceType = SCSI_TYPE_DIRECT_ACCESS;
+
+	memset(device, 0, sizeof(MscDevice));
+	device->HostFileDescriptor = -1;
+	TEST_EQUAL(AttachStorage(device), IPC_SUCCESS);
+}
+
+static void FillPattern(u8 *data, u32 size, u32 seed)
+{
+	for (u32 i = 0; i < size; i++)
+		data[i] = (u8)((i * 7) + (i >> 9) + seed);
+}
+
+static void TestAttach(void)
+{
+	MscDevice device;
+
+	SetUp(&device);
+	TEST_CHECK(device.Ready);
+	TEST_EQUAL(device.SectorSize, DISK_SECTOR_SIZE);
+	TEST_EQUAL(device.SectorCount, DISK_SECTORS);
+	TEST_EQUAL(Disk.Sleeps, 0);
+
+	//a cd drive speaks the same protocol, but it isn't a disk
+	DetachStorage(&device);
+	Disk.DeviceType = 0x05;
+	TEST_EQUAL(AttachStorage(&device), IPC_ENOENT);
+	TEST_EQUAL(device.HostFileDescriptor, -1);
+	TEST_CHECK(!device.Ready);
+}
+
+//sizes around the chunk sizes, from a buffer the controller can use as is & one it can't.
+//the bytes around the caller's buffer must never be touched
+static void TestTransfers(void)
+{
+	static const u32 counts[] = { 1, 0x7F, 0x80, 0x81, 0xFF, 0x100, 0x101, 0x800 };
+	MscDevice device;
+
+	SetUp(&device);
+	u8 *source = HostAllocate(BUFFER_SIZE + BUFFER_GUARD * 2);
+	u8 *check = HostAllocate(BUFFER_SIZE + BUFFER_GUARD * 2);
+	for (u32 offset = 0; offset < 8; offset += 4)
+	{
+		for (u32 i = 0; i < ARRAY_LENGTH(counts); i++)
+		{
+			const u32 sector = 1000 + i * 0x1000;
+			const u32 size = counts[i] * DISK_SECTOR_SIZE;
+			u8 *input = &source[BUFFER_GUARD + offset];
+			u8 *output = &check[BUFFER_GUARD + offset];
+
+			Disk.LargestTransfer = 0;
+			FillPattern(input, size, i + offset);
+			TEST_EQUAL(TransferSectors(&device, sector, counts[i], input, true), IPC_SUCCESS);
+			TEST_CHECK(memcmp(&Disk.Data[sector * DISK_SECTOR_SIZE], input, size) == 0);
+
+			memset(check, 0xA5, BUFFER_SIZE + BUFFER_GUARD * 2);
+			TEST_EQUAL(TransferSectors(&device, sector, counts[i], output, false), IPC_SUCCESS);
+			TEST_CHECK(memcmp(output, input, size) == 0);
+			TEST_EQUAL(check[BUFFER_GUARD + offset - 1], 0xA5);
+			TEST_EQUAL(output[size], 0xA5);
+			TEST_CHECK(Disk.LargestTransfer <=
+			           (offset == 0 ? MSC_MAX_TRANSFER_SIZE : MSC_BOUNCE_BUFFER_SIZE));
+		}
+	}
+
+	HostFree(source, BUFFER_SIZE + BUFFER_GUARD * 2);
+	HostFree(check, BUFFER_SIZE + BUFFER_GUARD * 2);
+}
+
+static void TestOutOfRange(void)
+{
+	u8 buffer[DISK_SECTOR_SIZE * 2] ALIGNED(0x20);
+	MscDevice device;
+
+	SetUp(&device);
+	const u32 commands = Disk.Commands;
+	TEST_EQUAL(TransferSectors(&device, DISK_SECTORS - 1, 2, buffer, false), IPC_EINVAL);
+	TEST_EQUAL(TransferSectors(&device, DISK_SECTORS, 1, buffer, false), IPC_EINVAL);
+	TEST_EQUAL(TransferSectors(&device, 0xFFFFFFFF, 2, buffer, false), IPC_EINVAL);
+	TEST_EQUAL(TransferSectors(&device, 0, 0, buffer, false), IPC_EINVAL);
+	TEST_EQUAL(TransferSectors(&device, 0, 1, NULL, false), IPC_EINVAL);
+	TEST_EQUAL(Disk.Commands, commands);
+
+	TEST_EQUAL(TransferSectors(&device, DISK_SECTORS - 1, 1, buffer, false), IPC_SUCCESS);
+}
+
+static void TestMediumNotPresent(void)
+{
+	MscDevice device;
+
+	SetUp(&device);
+	DetachStorage(&device);
+
+	//a card reader without a card
+	Disk.FailingCommands = 1;
+	Disk.SenseKey = SCSI_SENSE_NOT_READY;
+	Disk.AdditionalSense = SCSI_ASC_MEDIUM_NOT_PRESENT;
+	TEST_EQUAL(AttachStorage(&device), IPC_NOTREADY);
+	TEST_EQUAL(device.HostFileDescriptor, DEVICE_DESCRIPTOR);
+	TEST_CHECK(!device.Ready);
+
+	//a disk that is still spinning up is waited on
+	Disk.FailingCommands = 3;
+	Disk.AdditionalSense = 0x04;
+	TEST_EQUAL(AttachStorage(&device), IPC_SUCCESS);
+	TEST_EQUAL(Disk.Sleeps, 3);
+
+	//a unit attention is asked again right away
+	device.Ready = false;
+	Disk.Sleeps = 0;
+	Disk.FailingCommands = 1;
+	Disk.SenseKey = SCSI_SENSE_UNIT_ATTENTION;
+	TEST_EQUAL(AttachStorage(&device), IPC_SUCCESS);
+	TEST_EQUAL(Disk.Sleeps, 0);
+}
+
+//a swapped medium has to be attached again before it is used, its size might have changed
+static void TestMediumChanged(void)
+{
+	u8 buffer[DISK_SECTOR_SIZE] ALIGNED(0x20);
+	MscDevice device;
+
+	SetUp(&device);
+	Disk.FailingCommands = 1;
+	Disk.SenseKey = SCSI_SENSE_UNIT_ATTENTION;
+	TEST_EQUAL(TransferSectors(&device, 0, 1, buffer, false), IPC_NOTREADY);
+	TEST_CHECK(!device.Ready);
+	TEST_EQUAL(TransferSectors(&device, 0, 1, buffer, false), IPC_NOTREADY);
+
+	TEST_EQUAL(AttachStorage(&device), IPC_SUCCESS);
+	TEST_EQUAL(TransferSectors(&device, 0, 1, buffer, false), IPC_SUCCESS);
+
+	//any other error leaves the device as it is
+	Disk.FailingCommands = 1;
+	Disk.SenseKey = 0x03;
+	TEST_EQUAL(TransferSectors(&device, 0, 1, buffer, false), IPC_UNKNOWN);
+	TEST_CHECK(device.Ready);
+}
+
+//sequential reads of the whole disk, straight into the caller's buffer & through the bounce buffer
+static void TestSpeed(void)
+{
+	MscDevice device;
+
+	SetUp(&device);
+	u8 *buffer = HostAllocate(BUFFER_SIZE + 0x20);
+	for (u32 offset = 0; offset < 8; offset += 4)
+	{
+		const u32 chunk = BUFFER_SIZE / DISK_SECTOR_SIZE;
+		Disk.Commands = 0;
+
+		const u32 start = HostGetTicks();
+		for (u32 sector = 0; sector < DISK_SECTORS; sector += chunk)
+			TEST_EQUAL(TransferSectors(&device, sector, chunk, &buffer[offset], false),
+			           IPC_SUCCESS);
+
+		u32 elapsed = HostGetTicks() - start;
+		elapsed = elapsed == 0 ? 1 : elapsed;
+		HostPrintf("  %s: %uMB in %u commands, %u MB/s\n", offset == 0 ? "aligned" : "unaligned",
+		           DISK_SIZE >> 20, Disk.Commands, DISK_SIZE / elapsed);
+		TEST_EQUAL(Disk.Commands, DISK_SIZE / (offset == 0 ? MSC_MAX_TRANSFER_SIZE
+		                                                   : MSC_BOUNCE_BUFFER_SIZE));
+	}
+
+	HostFree(buffer, BUFFER_SIZE + 0x20);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestAttach),
+	TEST_CASE(TestTransfers),
+	TEST_CASE(TestOutOfRange),
+	TEST_CASE(TestMediumNotPresent),
+	TEST_CASE(TestMediumChanged),
+	TEST_CASE(TestSpeed),
+};
+
+int main(void)
+{
+	return RunTests("msc", Tests, ARRAY_LENGTH(Tests));
+}
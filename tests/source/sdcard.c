@@ -0,0 +1,650 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	sdcard - the sd host controller driver against a model of the controller & a card
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <stdarg.h>
+#include <string.h>
+#include <types.h>
+#include <vsprintf.h>
+#include <ios/errno.h>
+#include <host.h>
+
+//processor.h is arm assembly. the register accessors are swapped for the controller model
+#define __PROCESSOR_H__
+u32 read32(u32 address);
+void write32(u32 address, u32 data);
+u32 mask32(u32 address, u32 clear, u32 set);
+
+#include "../../kernel/source/sdhc.c"
+
+#define CARD_SECTORS   0x20000
+#define CARD_SIZE      (CARD_SECTORS * SDMMC_DEFAULT_BLOCKLEN)
+#define CARD_RCA       0x4D32
+#define BUFFER_SIZE    0x200000
+#define MAX_BLOCKS     SDHC_BLOCK_COUNT_MAX
+#define SPEED_SIZE     0x2000000
+#define NO_BLOCK       0xFFFFFFFF
+
+#define SDHC_REGISTER(offset) (*(u32 *)&Controller.Registers[(offset) & ~3])
+
+typedef struct
+{
+	u8 Registers[0x100];
+	bool AppCommand;
+	bool TimeoutArmed;
+	//the running sdma transfer. it stops at every dma boundary until the address is rewritten
+	bool Transferring;
+	bool Paused;
+	bool Read;
+	u32 Address;
+	u8 *Card;
+	u32 Remaining;
+	u8 SwitchStatus[SD_SWITCH_STATUS_LEN];
+	//a block that the card never answers for
+	u32 FailingBlock;
+	u32 Commands;
+	u32 DmaPauses;
+	u32 Interrupts;
+	u32 Wakeups;
+	u32 Timeouts;
+} SdController;
+
+static SdController Controller;
+static u8 *CardData;
+static u8 *Buffer;
+static char GeckoMessage[0x100];
+
+static void Raise(u16 status)
+{
+	const u16 enabled = (u16)SDHC_REGISTER(SDHC_NINTR_STATUS_EN);
+	SDHC_REGISTER(SDHC_NINTR_STATUS) |= status & enabled;
+}
+
+static void RaiseError(u16 error)
+{
+	const u16 enabled = (u16)(SDHC_REGISTER(SDHC_EINTR_STATUS_EN) >> 16);
+	SDHC_REGISTER(SDHC_EINTR_STATUS) |= (u32)(error & enabled) << 16;
+	SDHC_REGISTER(SDHC_NINTR_STATUS) |= SDHC_ERROR_INTERRUPT;
+}
+
+static bool IsInterruptSignaled(void)
+{
+	//both words hold the normal interrupts in the low & the error interrupts in the high half
+	return (SDHC_REGISTER(SDHC_NINTR_STATUS) & SDHC_REGISTER(SDHC_NINTR_SIGNAL_EN)) != 0;
+}
+
+static void Respond(u32 response)
+{
+	SDHC_REGISTER(SDHC_RESPONSE) = response;
+}
+
+static void StartTransfer(u8 *card, bool read)
+{
+	const u32 blocks = SDHC_REGISTER(SDHC_BLOCK_COUNT) >> 16;
+	const u32 blockSize = SDHC_REGISTER(SDHC_BLOCK_SIZE) & 0xFFF;
+
+	Controller.Transferring = true;
+	Controller.Paused = false;
+	Controller.Read = read;
+	Controller.Address = SDHC_REGISTER(SDHC_DMA_ADDR);
+	Controller.Card = card;
+	Controller.Remaining = blocks * blockSize;
+}
+
+//what the card answers. data commands start an sdma transfer, everything else is done at once
+static void ExecuteCommand(u32 command)
+{
+	const u32 index = (command >> SDHC_COMMAND_INDEX_SHIFT) & SDHC_COMMAND_INDEX_MASK;
+	const u32 argument = SDHC_REGISTER(SDHC_ARGUMENT);
+	const bool appCommand = Controller.AppCommand;
+	u8 *response = &Controller.Registers[SDHC_RESPONSE];
+
+	Controller.Commands++;
+	Controller.AppCommand = false;
+	memset(response, 0, 0x10);
+	switch (index)
+	{
+		case MMC_GO_IDLE_STATE:
+		case MMC_SELECT_CARD:
+		case MMC_SET_BLOCKLEN:
+		case MMC_STOP_TRANSMISSION:
+			Respond(MMC_R1_READY_FOR_DATA);
+			break;
+		case SD_SEND_IF_COND:
+			Respond(argument & 0xFFF);
+			break;
+		case MMC_APP_CMD:
+			Controller.AppCommand = true;
+			Respond(MMC_R1_READY_FOR_DATA | MMC_R1_APP_CMD);
+			break;
+		case SD_APP_OP_COND:
+			if (!appCommand)
+				goto no_response;
+			Respond(MMC_OCR_MEM_READY | SD_OCR_SDHC_CAP | SD_OCR_VOL_MASK);
+			break;
+		case MMC_ALL_SEND_CID:
+			memcpy(&response[8], "DRASTS", 6);
+			response[14] = 0x03;
+			break;
+		case SD_SEND_RELATIVE_ADDR:
+			Respond((u32)CARD_RCA << 16);
+			break;
+		//a version 2 csd. the size is in units of 512KB
+		case MMC_SEND_CSD:
+			response[13] = 0x0E;
+			response[7] = 0;
+			response[6] = (u8)(((CARD_SECTORS / 1024) - 1) >> 8);
+			response[5] = (u8)((CARD_SECTORS / 1024) - 1);
+			break;
+		case SD_SWITCH_FUNC:
+			//the same index is the bus width command after an app command
+			if (appCommand)
+			{
+				Respond(MMC_R1_READY_FOR_DATA);
+				break;
+			}
+
+			memset(Controller.SwitchStatus, 0, sizeof(Controller.SwitchStatus));
+			Controller.SwitchStatus[13] = 1 << 1;
+			Controller.SwitchStatus[16] = (argument & SD_SWITCH_MODE_SET) != 0 ? 1 : 0;
+			Respond(MMC_R1_READY_FOR_DATA);
+			StartTransfer(Controller.SwitchStatus, true);
+			break;
+		case MMC_READ_BLOCK_SINGLE:
+		case MMC_READ_BLOCK_MULTIPLE:
+		case MMC_WRITE_BLOCK_SINGLE:
+		case MMC_WRITE_BLOCK_MULTIPLE:
+			Respond(MMC_R1_READY_FOR_DATA);
+			StartTransfer(&CardData[argument * SDMMC_DEFAULT_BLOCKLEN],
+			              index == MMC_READ_BLOCK_SINGLE || index == MMC_READ_BLOCK_MULTIPLE);
+			break;
+		default:
+		no_response:
+			RaiseError(SDHC_CMD_TIMEOUT_ERROR);
+			return;
+	}
+
+	Raise(SDHC_COMMAND_COMPLETE);
+}
+
+//moves the data up to the next dma boundary. false if there was nothing left to do
+static bool StepController(void)
+{
+	if (!Controller.Transferring || Controller.Paused)
+		return false;
+
+	const u32 boundary = 0x1000 << ((SDHC_REGISTER(SDHC_BLOCK_SIZE) >> 12) & 7);
+	u32 length = boundary - (Controller.Address & (boundary - 1));
+	if (length > Controller.Remaining)
+		length = Controller.Remaining;
+
+	const u32 block = (u32)(Controller.Card - CardData) / SDMMC_DEFAULT_BLOCKLEN;
+	if (Controller.Card != Controller.SwitchStatus && Controller.FailingBlock >= block &&
+	    Controller.FailingBlock < block + (length / SDMMC_DEFAULT_BLOCKLEN))
+	{
+		Controller.Transferring = false;
+		RaiseError(SDHC_DATA_TIMEOUT_ERROR);
+		return true;
+	}
+
+	void *memory = (void *)Controller.Address;
+	if (Controller.Read)
+		memcpy(memory, Controller.Card, length);
+	else
+		memcpy(Controller.Card, memory, length);
+
+	Controller.Address += length;
+	Controller.Card += length;
+	Controller.Remaining -= length;
+	if (Controller.Remaining == 0)
+	{
+		Controller.Transferring = false;
+		Raise(SDHC_TRANSFER_COMPLETE);
+		return true;
+	}
+
+	SDHC_REGISTER(SDHC_DMA_ADDR) = Controller.Address;
+	Controller.Paused = true;
+	Controller.DmaPauses++;
+	Raise(SDHC_DMA_INTERRUPT);
+	return true;
+}
+
+static void ResetController(u8 mask)
+{
+	if (mask & (SDHC_RESET_CMD | SDHC_RESET_DAT | SDHC_RESET_ALL))
+		Controller.Transferring = false;
+
+	if (mask & SDHC_RESET_ALL)
+	{
+		memset(Controller.Registers, 0, sizeof(Controller.Registers));
+		SDHC_REGISTER(SDHC_CAPABILITIES) = SDHC_VOLTAGE_SUPP_3_3V | SDHC_DMA_SUPPORT |
+		                                   SDHC_HIGH_SPEED_SUPP | (48 << SDHC_BASE_FREQ_SHIFT);
+	}
+}
+
+u32 read32(u32 address)
+{
+	const u32 offset = address - SDHC_REG_BASE;
+	if (offset >= sizeof(Controller.Registers))
+	{
+		HostPrintf("  read of 0x%08X outside of the controller\n", address);
+		HostExit(1);
+	}
+
+	if (offset == SDHC_PRESENT_STATE)
+	{
+		return SDHC_CARD_INSERTED | SDHC_CARD_STATE_STABLE | SDHC_CARD_DETECT_PIN_LEVEL |
+		       (Controller.Transferring ? SDHC_CMD_INHIBIT_DAT | SDHC_DAT_ACTIVE : 0);
+	}
+
+	return SDHC_REGISTER(offset);
+}
+
+void write32(u32 address, u32 data)
+{
+	const u32 offset = address - SDHC_REG_BASE;
+	switch (offset)
+	{
+		case SDHC_DMA_ADDR:
+			SDHC_REGISTER(offset) = data;
+			if (Controller.Paused)
+			{
+				Controller.Address = data;
+				Controller.Paused = false;
+			}
+			break;
+		case SDHC_TRANSFER_MODE:
+			SDHC_REGISTER(offset) = data;
+			ExecuteCommand(data >> 16);
+			break;
+		//the status bits are cleared by writing a 1 to them
+		case SDHC_NINTR_STATUS:
+			SDHC_REGISTER(offset) &= ~data;
+			break;
+		case SDHC_CLOCK_CTL:
+			if (data & SDHC_INTCLK_ENABLE)
+				data |= SDHC_INTCLK_STABLE;
+			SDHC_REGISTER(offset) = data & 0x00FFFFFF;
+			ResetController((u8)(data >> 24));
+			break;
+		case SDHC_PRESENT_STATE:
+		case SDHC_CAPABILITIES:
+			break;
+		default:
+			if (offset >= sizeof(Controller.Registers))
+			{
+				HostPrintf("  write of 0x%08X outside of the controller\n", address);
+				HostExit(1);
+			}
+
+			SDHC_REGISTER(offset) = data;
+			break;
+	}
+}
+
+u32 mask32(u32 address, u32 clear, u32 set)
+{
+	const u32 data = (read32(address) & ~clear) | set;
+	write32(address, data);
+	return data;
+}
+
+//the kernel's side of the controller's interrupt: sdhc_irq runs & says if the waiter is woken
+s32 ReceiveMessageUnsafe(const s32 queueId, void **message, u32 flags)
+{
+	(void)queueId;
+	if (flags != None)
+		return IPC_EQUEUEEMPTY;
+
+	while (true)
+	{
+		if (IsInterruptSignaled())
+		{
+			Controller.Interrupts++;
+			if (sdhc_irq())
+			{
+				Controller.Wakeups++;
+				*message = NULL;
+				return IPC_SUCCESS;
+			}
+			continue;
+		}
+
+		if (StepController())
+			continue;
+
+		//nothing left that can raise an interrupt, so only the timeout can end the wait
+		if (!Controller.TimeoutArmed)
+		{
+			HostPrintf("  waiting without a timeout\n");
+			HostExit(1);
+		}
+
+		Controller.TimeoutArmed = false;
+		Controller.Timeouts++;
+		*message = &sdhc_timeout_message;
+		return IPC_SUCCESS;
+	}
+}
+
+s32 CreateMessageQueue(void **ptr, u32 numberOfMessages)
+{
+	(void)ptr;
+	(void)numberOfMessages;
+	return 0;
+}
+
+s32 DestroyMessageQueue(const s32 queueId)
+{
+	(void)queueId;
+	return IPC_SUCCESS;
+}
+
+s32 RegisterEventHandler(const u8 device, const s32 queueid, void *message)
+{
+	(void)device;
+	(void)queueid;
+	(void)message;
+	return IPC_SUCCESS;
+}
+
+s32 UnregisterEventHandler(const u8 device)
+{
+	(void)device;
+	return IPC_SUCCESS;
+}
+
+s32 CreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message)
+{
+	(void)delayUs;
+	(void)periodUs;
+	(void)queueid;
+	(void)message;
+	return 0;
+}
+
+s32 DestroyTimer(s32 timerId)
+{
+	(void)timerId;
+	return IPC_SUCCESS;
+}
+
+s32 RestartTimerUnsafe(s32 timerId, u32 timeUs, u32 repeatTimeUs)
+{
+	(void)timerId;
+	(void)repeatTimeUs;
+	Controller.TimeoutArmed = timeUs != 0;
+	return IPC_SUCCESS;
+}
+
+s32 StopTimerUnsafe(s32 timerId)
+{
+	(void)timerId;
+	Controller.TimeoutArmed = false;
+	return IPC_SUCCESS;
+}
+
+u32 GetTimerValue(void)
+{
+	return HostGetTicks();
+}
+
+u32 ConvertDelayToTicks(u32 delay)
+{
+	return delay;
+}
+
+void udelay(u32 d)
+{
+	(void)d;
+}
+
+void irq_enable(u32 irq)
+{
+	(void)irq;
+}
+
+void irq_disable(u32 irq)
+{
+	(void)irq;
+}
+
+//the model moves the data with memcpy, so there is no cache or ahb to keep coherent
+void DCInvalidateRange(const void *start, u32 size)
+{
+	(void)start;
+	(void)size;
+}
+
+void DCFlushRange(const void *start, u32 size)
+{
+	(void)start;
+	(void)size;
+}
+
+void AhbFlushTo(AHBDEV dev)
+{
+	(void)dev;
+}
+
+void _ahb_flush_from(AHBDEV dev)
+{
+	(void)dev;
+}
+
+u32 gecko_printf(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	const int length = vsnprintf(GeckoMessage, sizeof(GeckoMessage), fmt, args);
+	va_end(args);
+	return (u32)length;
+}
+
+static u32 RandomState;
+static u32 Random(void)
+{
+	RandomState = (RandomState * 1103515245) + 12345;
+	return RandomState >> 16;
+}
+
+static void FillBuffer(u8 *data, u32 length)
+{
+	for (u32 i = 0; i < length; i++)
+		data[i] = (u8)Random();
+}
+
+//a controller with a card in it, discovered & acknowledged like the sdio module does at boot
+static void SetUp(void)
+{
+	if (CardData == NULL)
+	{
+		CardData = HostAllocate(CARD_SIZE);
+		Buffer = HostAllocate(BUFFER_SIZE);
+	}
+
+	memset(&Controller, 0, sizeof(Controller));
+	Controller.FailingBlock = NO_BLOCK;
+	ResetController(SDHC_RESET_ALL);
+	RandomState = 1;
+	FillBuffer(CardData, CARD_SIZE);
+
+	sdhc_init();
+	TEST_EQUAL(sdmmc_check_card(), SDMMC_NEW_CARD);
+	TEST_EQUAL(sdmmc_ack_card(), 0);
+	TEST_EQUAL(sdmmc_check_card(), SDMMC_INSERTED);
+}
+
+static void TearDown(void)
+{
+	sdhc_exit();
+}
+
+static void ResetCounters(void)
+{
+	Controller.Commands = 0;
+	Controller.DmaPauses = 0;
+	Controller.Interrupts = 0;
+	Controller.Wakeups = 0;
+	Controller.Timeouts = 0;
+}
+
+static void TestDiscover(void)
+{
+	SetUp();
+	TEST_EQUAL(sdmmc_get_sectors(), CARD_SECTORS);
+	TEST_CHECK(strncmp(GeckoMessage, "sdmmc: reading at ", 18) == 0);
+
+	//the card said it can do high speed, so the host followed it onto the 4-bit 50MHz bus
+	const u8 hostControl = Controller.Registers[SDHC_HOST_CTL];
+	TEST_CHECK((hostControl & SDHC_4BIT_MODE) != 0);
+	TEST_CHECK((hostControl & SDHC_HIGH_SPEED) != 0);
+	TEST_EQUAL(Controller.Registers[SDHC_CLOCK_CTL + 1], 0);
+	TEST_EQUAL(Controller.Timeouts, 0);
+	TearDown();
+}
+
+static void TestReadWrite(void)
+{
+	static const u32 counts[] = { 1, 2, 7, 8, 0x3F, 0x80, 0xFF, MAX_BLOCKS };
+	u8 *written = &Buffer[BUFFER_SIZE / 2];
+
+	SetUp();
+	for (u32 i = 0; i < ARRAY_LENGTH(counts); i++)
+	{
+		const u32 block = 0x100 + (i * 0x1000) + i;
+		const u32 length = counts[i] * SDMMC_DEFAULT_BLOCKLEN;
+
+		FillBuffer(written, length);
+		ResetCounters();
+		TEST_EQUAL(sdmmc_write(block, counts[i], written), 0);
+		TEST_CHECK(memcmp(&CardData[block * SDMMC_DEFAULT_BLOCKLEN], written, length) == 0);
+
+		memset(Buffer, 0, length + 1);
+		TEST_EQUAL(sdmmc_read(block, counts[i], Buffer), 0);
+		TEST_CHECK(memcmp(Buffer, written, length) == 0);
+		TEST_EQUAL(Buffer[length], 0);
+
+		//the thread is woken up for the command & once more when all of the data moved
+		TEST_EQUAL(Controller.Commands, 2);
+		TEST_EQUAL(Controller.Wakeups, 4);
+	}
+
+	//the block count register is 9 bits, the driver has to refuse anything bigger
+	ResetCounters();
+	TEST_EQUAL(sdmmc_read(0, MAX_BLOCKS + 1, Buffer), -1);
+	TEST_EQUAL(Controller.Commands, 0);
+	TearDown();
+}
+
+//the controller stops at every dma boundary. the interrupt handler restarts it on its own,
+//without waking up the thread that waits for the transfer
+static void TestDmaBoundary(void)
+{
+	const u32 boundary = 0x80000;
+	const u32 length = MAX_BLOCKS * SDMMC_DEFAULT_BLOCKLEN;
+	const u32 start = (((u32)Buffer + boundary) & ~(boundary - 1)) - 0x1000;
+
+	SetUp();
+	ResetCounters();
+	TEST_EQUAL(sdmmc_read(0x40, MAX_BLOCKS, (void *)start), 0);
+	TEST_CHECK(memcmp((void *)start, &CardData[0x40 * SDMMC_DEFAULT_BLOCKLEN], length) == 0);
+	TEST_EQUAL(Controller.DmaPauses, 1);
+	TEST_EQUAL(Controller.Interrupts, 3);
+	TEST_EQUAL(Controller.Wakeups, 2);
+
+	FillBuffer((u8 *)start, length);
+	TEST_EQUAL(sdmmc_write(0x1000, MAX_BLOCKS, (void *)start), 0);
+	TEST_CHECK(memcmp((void *)start, &CardData[0x1000 * SDMMC_DEFAULT_BLOCKLEN], length) == 0);
+	TEST_EQUAL(Controller.DmaPauses, 2);
+	TEST_EQUAL(Controller.Wakeups, 4);
+	TEST_EQUAL(Controller.Timeouts, 0);
+	TearDown();
+}
+
+//a transfer runs while the caller does something else. the next command waits for it first
+static void TestAsyncTransfers(void)
+{
+	struct sdmmc_command first, second;
+	const u32 length = 0x10 * SDMMC_DEFAULT_BLOCKLEN;
+
+	SetUp();
+	TEST_EQUAL(sdmmc_read_async(0x200, 0x10, Buffer, &first), 0);
+	TEST_CHECK(!ISSET(first.c_flags, SCF_ITSDONE));
+	TEST_EQUAL(sdmmc_read_async(0x300, 0x10, &Buffer[length], &second), 0);
+	TEST_CHECK(ISSET(first.c_flags, SCF_ITSDONE));
+	TEST_EQUAL(sdmmc_wait(&first), 0);
+	TEST_EQUAL(sdmmc_wait(&second), 0);
+	TEST_CHECK(memcmp(Buffer, &CardData[0x200 * SDMMC_DEFAULT_BLOCKLEN], length) == 0);
+	TEST_CHECK(memcmp(&Buffer[length], &CardData[0x300 * SDMMC_DEFAULT_BLOCKLEN], length) == 0);
+	TearDown();
+}
+
+static void TestDataTimeout(void)
+{
+	SetUp();
+	Controller.FailingBlock = 0x2010;
+	ResetCounters();
+	TEST_EQUAL(sdmmc_read(0x2000, 0x20, Buffer), -1);
+	TEST_CHECK(strcmp(GeckoMessage, "sdmmc: command 18 failed with 60\n") == 0);
+
+	//the controller got reset, so the next transfer works again
+	Controller.FailingBlock = NO_BLOCK;
+	TEST_EQUAL(sdmmc_read(0x2000, 0x20, Buffer), 0);
+	TEST_CHECK(memcmp(Buffer, &CardData[0x2000 * SDMMC_DEFAULT_BLOCKLEN], 0x20 * 0x200) == 0);
+	TEST_EQUAL(Controller.Timeouts, 0);
+	TearDown();
+}
+
+static void TestSpeed(void)
+{
+	const u32 blocks = MAX_BLOCKS;
+	const u32 length = blocks * SDMMC_DEFAULT_BLOCKLEN;
+
+	SetUp();
+	FillBuffer(Buffer, BUFFER_SIZE);
+	ResetCounters();
+	u32 start = HostGetTicks();
+	for (u32 offset = 0; offset < SPEED_SIZE; offset += length)
+		sdmmc_write(offset / SDMMC_DEFAULT_BLOCKLEN, blocks, &Buffer[offset % BUFFER_SIZE]);
+	u32 elapsed = HostGetTicks() - start;
+	HostPrintf("  write: %uMB in %u commands, %u interrupts, %u wakeups, %uus\n",
+	           SPEED_SIZE >> 20, Controller.Commands, Controller.Interrupts,
+	           Controller.Wakeups, elapsed);
+	TEST_CHECK(memcmp(CardData, Buffer, BUFFER_SIZE) == 0);
+
+	ResetCounters();
+	start = HostGetTicks();
+	for (u32 offset = 0; offset < SPEED_SIZE; offset += length)
+		sdmmc_read(offset / SDMMC_DEFAULT_BLOCKLEN, blocks, &Buffer[offset % BUFFER_SIZE]);
+	elapsed = HostGetTicks() - start;
+	HostPrintf("  read: %uMB in %u commands, %u interrupts, %u wakeups, %uus\n",
+	           SPEED_SIZE >> 20, Controller.Commands, Controller.Interrupts,
+	           Controller.Wakeups, elapsed);
+	TEST_EQUAL(Controller.Wakeups, 2 * (SPEED_SIZE / length));
+	TEST_EQUAL(Controller.Timeouts, 0);
+	TEST_CHECK(memcmp(CardData, Buffer, BUFFER_SIZE) == 0);
+	TearDown();
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestDiscover),
+	TEST_CASE(TestReadWrite),
+	TEST_CASE(TestDmaBoundary),
+	TEST_CASE(TestAsyncTransfers),
+	TEST_CASE(TestDataTimeout),
+	TEST_CASE(TestSpeed),
+};
+
+int main(void)
+{
+	return RunTests("sdcard", Tests, ARRAY_LENGTH(Tests));
+}
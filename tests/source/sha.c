@@ -0,0 +1,499 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	sha - the /dev/sha sessions against a model of the sha engine
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+#include <types.h>
+#include <ios/errno.h>
+#include <host.h>
+
+//processor.h is arm assembly. the register accessors are swapped for the engine model
+#define __PROCESSOR_H__
+u32 read32(u32 address);
+void write32(u32 address, u32 data);
+
+#include "../../kernel/source/crypto/sha.c"
+
+#define MAX_REQUEST_SIZE (0x400 * SHA_BLOCK_SIZE)
+#define MAX_REQUESTS     8
+#define HMAC_HANDLE      0x1A
+#define DATA_SIZE        0x80000
+
+typedef struct
+{
+	u32 Registers[7];
+	bool IrqPending;
+	//every block run the engine did, the cpu fallback for small runs doesn't count
+	u32 Runs;
+	u32 Blocks;
+} ShaEngine;
+
+typedef struct
+{
+	IpcMessage Message;
+	IoctlvMessageData Vectors[5];
+	ShaContext Context;
+	FinalShaHash Hash;
+	u32 Handle;
+	//the engine run the request shows up in the resource manager queue
+	u32 ArrivesAt;
+	bool Replied;
+	s32 Result;
+	u32 RunsAtReply;
+} ShaRequest;
+
+static ShaEngine Engine;
+static ShaRequest *Queue[MAX_REQUESTS];
+static u32 QueueCount;
+static u32 QueueHead;
+static ShaRequest *Replies[MAX_REQUESTS];
+static u32 ReplyCount;
+static u32 MostActiveSessions;
+static u32 Frees;
+static s32 NextQueueId = 1;
+static void *EngineIdle[5];
+static u8 *Data;
+
+static const u8 TestKey[0x14] = { 0x5F, 0x10, 0x83, 0x2A, 0xC4, 0x77, 0x01, 0xE9, 0x3B, 0x62,
+	                              0xD8, 0x0C, 0x95, 0x4E, 0xA1, 0x36, 0xFB, 0x28, 0x70, 0x4D };
+u8 HmacKey[SHA_BLOCK_SIZE];
+s32 KernelHeapId = 0;
+
+static u32 *EngineRegister(u32 address)
+{
+	if (address < SHA_REG_BASE || address >= SHA_REG_BASE + sizeof(Engine.Registers))
+		return NULL;
+
+	return &Engine.Registers[(address - SHA_REG_BASE) / 4];
+}
+
+//the engine hashes the blocks as soon as it is started, so it is never seen running
+static void RunEngine(void)
+{
+	ShaControl control = { .Value = Engine.Registers[0] };
+	const u32 blocks = control.Fields.NumberOfBlocks + 1;
+
+	SHA_SoftwareTransform(&Engine.Registers[2], (const void *)Engine.Registers[1],
+	                      blocks * SHA_BLOCK_SIZE);
+	Engine.Runs++;
+	Engine.Blocks += blocks;
+	control.Fields.Execute = 0;
+	Engine.Registers[0] = control.Value;
+	if (control.Fields.GenerateIrq)
+		Engine.IrqPending = true;
+}
+
+u32 read32(u32 address)
+{
+	const u32 *reg = EngineRegister(address);
+	if (reg != NULL)
+		return *reg;
+
+	const u8 *memory = (const u8 *)address;
+	return (u32)memory[0] << 24 | (u32)memory[1] << 16 | (u32)memory[2] << 8 | memory[3];
+}
+
+void write32(u32 address, u32 data)
+{
+	u32 *reg = EngineRegister(address);
+	if (reg == NULL)
+	{
+		//the length of the last block is written to memory, which is big endian on the starlet
+		u8 *memory = (u8 *)address;
+		memory[0] = (u8)(data >> 24);
+		memory[1] = (u8)(data >> 16);
+		memory[2] = (u8)(data >> 8);
+		memory[3] = (u8)data;
+		return;
+	}
+
+	*reg = data;
+	if (address == SHA_CMD && ((ShaControl)data).Fields.Execute)
+		RunEngine();
+}
+
+//the engine irq & the resource manager queue. once the handler would block with nothing left
+//to hash or receive it has gone idle, and the test gets control back
+s32 ReceiveMessage(const s32 queueId, void **message, u32 flags)
+{
+	if (queueId == ShaEventMessageQueueId)
+	{
+		TEST_CHECK(Engine.IrqPending);
+		Engine.IrqPending = false;
+		*message = NULL;
+		return IPC_SUCCESS;
+	}
+
+	//nothing is being hashed, so the time until the next request arrives just passes
+	if (QueueHead < QueueCount &&
+	    (Queue[QueueHead]->ArrivesAt <= Engine.Runs || ActiveShaSessions == 0))
+	{
+		*message = &Queue[QueueHead++]->Message;
+		return IPC_SUCCESS;
+	}
+
+	if (flags == None)
+		__builtin_longjmp(EngineIdle, 1);
+
+	return IPC_EQUEUEEMPTY;
+}
+
+s32 ResourceReply(IpcMessage *message, s32 requestReturnValue)
+{
+	ShaRequest *request = (ShaRequest *)message;
+	TEST_CHECK(!request->Replied);
+	TEST_CHECK(ReplyCount < MAX_REQUESTS);
+	request->Replied = true;
+	request->Result = requestReturnValue;
+	request->RunsAtReply = Engine.Runs;
+	if (ActiveShaSessions > MostActiveSessions)
+		MostActiveSessions = ActiveShaSessions;
+	Replies[ReplyCount++] = request;
+	return IPC_SUCCESS;
+}
+
+s32 CreateMessageQueue(void **ptr, u32 numberOfMessages)
+{
+	(void)ptr;
+	(void)numberOfMessages;
+	return NextQueueId++;
+}
+
+s32 RegisterEventHandler(const u8 device, const s32 queueid, void *message)
+{
+	(void)device;
+	(void)queueid;
+	(void)message;
+	return IPC_SUCCESS;
+}
+
+s32 RegisterResourceManager(const char *devicePath, const s32 queueid)
+{
+	(void)devicePath;
+	(void)queueid;
+	return IPC_SUCCESS;
+}
+
+s32 FreeOnHeap(s32 heapid, void *ptr)
+{
+	(void)heapid;
+	(void)ptr;
+	Frees++;
+	return IPC_SUCCESS;
+}
+
+//the engine reads the data straight from memory, so there is no cache or ahb to keep coherent
+void DCFlushRange(const void *start, u32 size)
+{
+	(void)start;
+	(void)size;
+}
+
+void AhbFlushTo(AHBDEV dev)
+{
+	(void)dev;
+}
+
+u32 VirtualToPhysical(u32 virtualAddress)
+{
+	return virtualAddress;
+}
+
+s32 Keyring_FindKeySize(u32 *keySize, u32 keyHandle)
+{
+	if (keyHandle != HMAC_HANDLE)
+		return IOSC_EINVAL;
+
+	*keySize = sizeof(TestKey);
+	return IPC_SUCCESS;
+}
+
+s32 Keyring_GetKey(u32 keyHandle, void *keyPtr, u32 keySize)
+{
+	if (keyHandle != HMAC_HANDLE || keySize != sizeof(TestKey))
+		return IOSC_EINVAL;
+
+	memcpy(keyPtr, TestKey, keySize);
+	return IPC_SUCCESS;
+}
+
+void HMAC_Panic(const char *msg, void *hash_to_invalidate)
+{
+	(void)hash_to_invalidate;
+	HostPrintf("HMAC_Panic: %s", msg);
+	HostExit(1);
+}
+
+void panic(const char *fmt, ...)
+{
+	HostPrintf("panic: %s", fmt);
+	HostExit(1);
+}
+
+static void SetUp(void)
+{
+	if (Data == NULL)
+	{
+		Data = HostAllocate(DATA_SIZE);
+		u32 state = 1;
+		for (u32 i = 0; i < DATA_SIZE; i++)
+		{
+			state = (state * 1103515245) + 12345;
+			Data[i] = (u8)(state >> 16);
+		}
+	}
+
+	memset(&Engine, 0, sizeof(Engine));
+	QueueCount = 0;
+	QueueHead = 0;
+	ReplyCount = 0;
+	MostActiveSessions = 0;
+	Frees = 0;
+}
+
+static void Submit(ShaRequest *request, u32 arrivesAt)
+{
+	TEST_CHECK(QueueCount < MAX_REQUESTS);
+	request->ArrivesAt = arrivesAt;
+	Queue[QueueCount++] = request;
+}
+
+static void PrepareRequest(ShaRequest *request, u32 ioctl)
+{
+	request->Replied = false;
+	request->Result = 1;
+	memset(&request->Message, 0, sizeof(request->Message));
+	request->Message.Request.Command = IOS_IOCTLV;
+	request->Message.Request.Message.Ioctlv.Ioctl = ioctl;
+	request->Message.Request.Message.Ioctlv.MessageData = request->Vectors;
+	memset(request->Vectors, 0, sizeof(request->Vectors));
+	request->Vectors[1] = (IoctlvMessageData) { &request->Context, sizeof(ShaContext) };
+	request->Vectors[2] = (IoctlvMessageData) { request->Hash, sizeof(FinalShaHash) };
+}
+
+static ShaRequest *SubmitSha(ShaRequest *request, ShaCommandType command, const void *input,
+                             u32 inputSize, u32 arrivesAt)
+{
+	PrepareRequest(request, command);
+	request->Message.Request.Message.Ioctlv.InputArgc = 1;
+	request->Message.Request.Message.Ioctlv.IoArgc = 2;
+	request->Vectors[0] = (IoctlvMessageData) { (void *)input, inputSize };
+	Submit(request, arrivesAt);
+	return request;
+}
+
+static ShaRequest *SubmitHmac(ShaRequest *request, HMacCommandType command, const void *first,
+                              u32 firstSize, const void *second, u32 secondSize, u32 handle)
+{
+	PrepareRequest(request, command);
+	request->Handle = handle;
+	request->Vectors[0] = (IoctlvMessageData) { (void *)second, secondSize };
+	request->Vectors[3] = (IoctlvMessageData) { &request->Handle, sizeof(request->Handle) };
+	request->Vectors[4] = (IoctlvMessageData) { (void *)first, firstSize };
+	Submit(request, 0);
+	return request;
+}
+
+//a finalize continues from the context, this is what an init without data leaves behind
+static void StartContext(ShaRequest *request)
+{
+	memcpy(request->Context.ShaStates, Sha1InitialState, sizeof(Sha1InitialState));
+	request->Context.Length = 0;
+}
+
+//runs the handler until everything in the queue is answered
+static void RunShaEngine(void)
+{
+	if (__builtin_setjmp(EngineIdle) == 0)
+		ShaEngineHandler();
+
+	TEST_EQUAL(QueueHead, QueueCount);
+	TEST_EQUAL(ActiveShaSessions, 0);
+}
+
+static void ExpectedHash(const void *input, u32 inputSize, FinalShaHash expected)
+{
+	u8 hash[SHA_HASH_SIZE];
+	SHA_SoftwareCalculate(input, inputSize, hash);
+	for (u32 i = 0; i < SHA_NUM_WORDS; i++)
+		expected[i] = read32((u32)&hash[i * 4]);
+}
+
+//the outer hash runs over the inner hash as it sits in memory, like the engine reads it
+static void ExpectedHmac(const void *input, u32 inputSize, FinalShaHash expected)
+{
+	u8 *buffer = HostAllocate(SHA_BLOCK_SIZE + inputSize);
+	memset(buffer, 0, SHA_BLOCK_SIZE);
+	memcpy(buffer, TestKey, sizeof(TestKey));
+	for (u32 i = 0; i < SHA_BLOCK_SIZE; i++)
+		buffer[i] ^= 0x36;
+	memcpy(&buffer[SHA_BLOCK_SIZE], input, inputSize);
+
+	FinalShaHash inner;
+	ExpectedHash(buffer, SHA_BLOCK_SIZE + inputSize, inner);
+	memset(buffer, 0, SHA_BLOCK_SIZE);
+	memcpy(buffer, TestKey, sizeof(TestKey));
+	for (u32 i = 0; i < SHA_BLOCK_SIZE; i++)
+		buffer[i] ^= 0x5C;
+	memcpy(&buffer[SHA_BLOCK_SIZE], inner, sizeof(inner));
+	ExpectedHash(buffer, SHA_BLOCK_SIZE + sizeof(inner), expected);
+	HostFree(buffer, SHA_BLOCK_SIZE + inputSize);
+}
+
+static void TestShaDigests(void)
+{
+	static const FinalShaHash abc = { 0xA9993E36, 0x4706816A, 0xBA3E2571, 0x7850C26C,
+		                              0x9CD0D89D };
+	ShaRequest request;
+
+	//a few bytes are hashed on the cpu, without the engine
+	SetUp();
+	SubmitSha(&request, InitShaState, NULL, 0, 0);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_SUCCESS);
+	SubmitSha(&request, FinalizeShaState, "abc", 3, 0);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_SUCCESS);
+	TEST_CHECK(memcmp(request.Hash, abc, sizeof(abc)) == 0);
+	TEST_EQUAL(Engine.Runs, 0);
+
+	//a hash chained over 3 requests, in slices on the engine
+	const u32 sizes[] = { MAX_REQUEST_SIZE, MAX_REQUEST_SIZE, 0x8123 };
+	const ShaCommandType commands[] = { InitShaState, ContributeShaState, FinalizeShaState };
+	u32 offset = 0;
+	SetUp();
+	for (u32 i = 0; i < ARRAY_LENGTH(sizes); i++)
+	{
+		SubmitSha(&request, commands[i], &Data[offset], sizes[i], 0);
+		RunShaEngine();
+		TEST_EQUAL(request.Result, IPC_SUCCESS);
+		offset += sizes[i];
+	}
+
+	FinalShaHash expected;
+	ExpectedHash(Data, offset, expected);
+	TEST_CHECK(memcmp(request.Hash, expected, sizeof(expected)) == 0);
+	TEST_EQUAL(request.Context.Length, (u64)offset * 8);
+	TEST_EQUAL(Engine.Blocks, offset / SHA_BLOCK_SIZE);
+	TEST_EQUAL(Engine.Runs, (offset + SHA_SLICE_SIZE - 1) / SHA_SLICE_SIZE);
+	TEST_EQUAL(Frees, 3);
+
+	//anything but the last request has to be whole blocks, and is refused before hashing
+	SetUp();
+	SubmitSha(&request, ContributeShaState, Data, 0x1001, 0);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IOSC_INVALID_SIZE);
+	TEST_EQUAL(Engine.Runs, 0);
+	TEST_EQUAL(Frees, 0);
+}
+
+static void TestHmac(void)
+{
+	ShaRequest request;
+
+	SetUp();
+	SubmitHmac(&request, InitHMacState, Data, 0x1000, NULL, 0, HMAC_HANDLE);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_SUCCESS);
+	SubmitHmac(&request, ContributeHMacState, &Data[0x1000], 0x2000, &Data[0x3000], 0x40,
+	           HMAC_HANDLE);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_SUCCESS);
+
+	//the last part shares the engine with a plain hash, each with its own pads & context
+	ShaRequest other;
+	StartContext(&other);
+	SubmitSha(&other, FinalizeShaState, &Data[0x10000], MAX_REQUEST_SIZE - 0x1C, 0);
+	SubmitHmac(&request, FinalizeHmacState, &Data[0x3040], 0x2400, &Data[0x5440], 0x33,
+	           HMAC_HANDLE);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_SUCCESS);
+	TEST_EQUAL(other.Result, IPC_SUCCESS);
+	TEST_CHECK(Replies[0] == &request);
+
+	FinalShaHash expected;
+	ExpectedHmac(Data, 0x5473, expected);
+	TEST_CHECK(memcmp(request.Hash, expected, sizeof(expected)) == 0);
+	ExpectedHash(&Data[0x10000], MAX_REQUEST_SIZE - 0x1C, expected);
+	TEST_CHECK(memcmp(other.Hash, expected, sizeof(expected)) == 0);
+
+	SetUp();
+	SubmitHmac(&request, InitHMacState, Data, 0x1000, NULL, 0, HMAC_HANDLE + 1);
+	RunShaEngine();
+	TEST_EQUAL(request.Result, IPC_EINVAL);
+	TEST_EQUAL(Engine.Runs, 0);
+}
+
+//more requests than sessions. the handler holds on to the rest until a session frees up
+static void TestInterleavedSessions(void)
+{
+	const u32 size = 0xC000 + 0x37;
+	ShaRequest requests[6];
+
+	SetUp();
+	for (u32 i = 0; i < ARRAY_LENGTH(requests); i++)
+	{
+		StartContext(&requests[i]);
+		SubmitSha(&requests[i], FinalizeShaState, &Data[i * 0x10000], size - (i * 0x1000), 0);
+	}
+	RunShaEngine();
+
+	TEST_EQUAL(ReplyCount, ARRAY_LENGTH(requests));
+	TEST_EQUAL(MostActiveSessions, SHA_MAX_SESSIONS);
+	TEST_EQUAL(Frees, ARRAY_LENGTH(requests));
+	for (u32 i = 0; i < ARRAY_LENGTH(requests); i++)
+	{
+		FinalShaHash expected;
+		ExpectedHash(&Data[i * 0x10000], size - (i * 0x1000), expected);
+		TEST_EQUAL(requests[i].Result, IPC_SUCCESS);
+		TEST_CHECK(memcmp(requests[i].Hash, expected, sizeof(expected)) == 0);
+	}
+
+	//the sessions took turns, so the smallest of the first four finished first
+	TEST_CHECK(Replies[0] == &requests[3]);
+}
+
+//a small request that comes in while a big one is hashing only waits for a slice or two
+static void TestFairness(void)
+{
+	ShaRequest big, small;
+
+	SetUp();
+	StartContext(&big);
+	StartContext(&small);
+	SubmitSha(&big, FinalizeShaState, Data, MAX_REQUEST_SIZE + 0x20, 0);
+	SubmitSha(&small, FinalizeShaState, &Data[MAX_REQUEST_SIZE], SHA_SLICE_SIZE + 0x10, 2);
+	RunShaEngine();
+
+	HostPrintf("  %u runs for the big request, the small one was answered after run %u\n",
+	           big.RunsAtReply, small.RunsAtReply);
+	TEST_EQUAL(big.Result, IPC_SUCCESS);
+	TEST_EQUAL(small.Result, IPC_SUCCESS);
+	TEST_CHECK(Replies[0] == &small);
+	TEST_CHECK(small.RunsAtReply <= small.ArrivesAt + 2);
+	TEST_EQUAL(big.RunsAtReply, (MAX_REQUEST_SIZE / SHA_SLICE_SIZE) + 1);
+
+	FinalShaHash expected;
+	ExpectedHash(Data, MAX_REQUEST_SIZE + 0x20, expected);
+	TEST_CHECK(memcmp(big.Hash, expected, sizeof(expected)) == 0);
+	ExpectedHash(&Data[MAX_REQUEST_SIZE], SHA_SLICE_SIZE + 0x10, expected);
+	TEST_CHECK(memcmp(small.Hash, expected, sizeof(expected)) == 0);
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestShaDigests),
+	TEST_CASE(TestHmac),
+	TEST_CASE(TestInterleavedSessions),
+	TEST_CASE(TestFairness),
+};
+
+int main(void)
+{
+	return RunTests("sha", Tests, ARRAY_LENGTH(Tests));
+}
@@ -0,0 +1,463 @@
+/*
+	StarStruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	titles - the es title index on top of the fs module & a nand image
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/processor.h>
+#include <host.h>
+#include <ios.h>
+#include <nandImage.h>
+
+//pulled in whole, so the file syscalls of es can be handed straight to its request handler
+#define main FsMain
+#include "../../modules/fs/source/fs.c"
+#undef main
+
+#include "titles.h"
+
+#define NAND_IMAGE_PATH "titles.nand"
+#define BOOT_CLUSTERS   (NAND_PROTECTED_PAGES / FLASH_PAGES_PER_CLUSTER)
+#define FULL_ACCESS     0xFC
+
+#define SIGNATURE_SIZE (4 + 0x100 + 0x3C)
+#define TICKET_SIZE    (SIGNATURE_SIZE + sizeof(Ticket))
+
+#define CHANNEL_TYPE      0x00010001
+#define CHANNEL_COUNT     0x20
+#define SYSTEM_TYPE       0x00000001
+#define SYSTEM_COUNT      0x04
+#define TITLE_CONTENTS    0x08
+#define MULTI_TICKETS     0x03
+#define LOOKUP_ROUNDS     1000
+
+#define CHANNEL_ID(index)  (((u64)CHANNEL_TYPE << 32) | (0x48414100 + (index)))
+#define SYSTEM_ID(index)   (((u64)SYSTEM_TYPE << 32) | (0x00000030 + (index)))
+//a title that has only been bought, & one with more tickets than the others
+#define TICKET_ONLY_ID     (((u64)CHANNEL_TYPE << 32) | 0x48414158)
+#define MULTI_TICKET_ID    SYSTEM_ID(0)
+
+//what es did through the syscalls since the last reset
+static u32 FileOpens;
+static u32 FileReads;
+
+static void FormatNand(void)
+{
+	memset(&FsSuperblock, 0, sizeof(Superblock));
+	FsSuperblock.Magic = SUPERBLOCK_MAGIC;
+	for (u32 i = 0; i < FLASH_CLUSTER_COUNT; i++)
+	{
+		FsSuperblock.Fat[i] = i < BOOT_CLUSTERS || i >= SUPERBLOCK_FIRST_CLUSTER ? FAT_RESERVED :
+		                                                                           FAT_FREE;
+	}
+
+	FstEntry *root = &FsSuperblock.Fst[FST_ROOT_ENTRY];
+	root->Name[0] = '/';
+	root->Mode = FST_TYPE_DIRECTORY | FULL_ACCESS;
+	root->Sub = FST_NONE;
+	root->Sibling = FST_NONE;
+}
+
+//a freshly booted fs, with the file cache cold like after a reboot of the console
+static s32 BootFileSystem(void)
+{
+	for (u16 i = 0; i < FST_ENTRY_COUNT; i++)
+		InvalidateFileCache(i);
+
+	CommitTimerArmed = false;
+	ResetHostIos();
+	return FsMain();
+}
+
+s32 OSOpenFD(const char *path, int mode)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_OPEN;
+	request.Message.Open.Filepath = (char *)path;
+	request.Message.Open.Mode = (u32)mode;
+	FileOpens++;
+	return HandleRequest(&request);
+}
+
+s32 OSCloseFD(s32 fd)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_CLOSE;
+	request.FileDescriptor = fd;
+	return HandleRequest(&request);
+}
+
+s32 OSReadFD(s32 fd, void *buf, u32 len)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_READ;
+	request.FileDescriptor = fd;
+	request.Message.Read.MessageData = buf;
+	request.Message.Read.Length = len;
+	FileReads++;
+	return HandleRequest(&request);
+}
+
+s32 OSWriteFD(s32 fd, const void *buf, u32 len)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_WRITE;
+	request.FileDescriptor = fd;
+	request.Message.Write.MessageData = (void *)buf;
+	request.Message.Write.Length = len;
+	return HandleRequest(&request);
+}
+
+s32 OSSeekFD(s32 fd, s32 offset, s32 origin)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_SEEK;
+	request.FileDescriptor = fd;
+	request.Message.Seek.Where = offset;
+	request.Message.Seek.Whence = origin;
+	return HandleRequest(&request);
+}
+
+s32 OSIoctlFD(s32 fd, u32 requestId, void *inputBuffer, u32 inputBufferLength,
+              void *ioBuffer, u32 ioBufferLength)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_IOCTL;
+	request.FileDescriptor = fd;
+	request.Message.Ioctl.Ioctl = requestId;
+	request.Message.Ioctl.InputBuffer = inputBuffer;
+	request.Message.Ioctl.InputLength = inputBufferLength;
+	request.Message.Ioctl.IoBuffer = ioBuffer;
+	request.Message.Ioctl.IoLength = ioBufferLength;
+	return HandleRequest(&request);
+}
+
+s32 OSIoctlvFD(s32 fd, u32 requestId, u32 vectorInputCount, u32 vectorIOCount,
+               IoctlvMessageData *vectors)
+{
+	IpcRequest request;
+	memset(&request, 0, sizeof(request));
+	request.Command = IOS_IOCTLV;
+	request.FileDescriptor = fd;
+	request.Message.Ioctlv.Ioctl = requestId;
+	request.Message.Ioctlv.InputArgc = vectorInputCount;
+	request.Message.Ioctlv.IoArgc = vectorIOCount;
+	request.Message.Ioctlv.MessageData = vectors;
+	return HandleRequest(&request);
+}
+
+//creates what is missing of the path. the last component is a file if data is given
+static void CreatePath(s32 fd, const char *path, const void *data, u32 length)
+{
+	FsAttributes attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.OwnerPermissions = ReadWrite;
+	attributes.GroupPermissions = ReadWrite;
+	attributes.OtherPermissions = ReadWrite;
+
+	for (u32 i = 1; path[i] != '\0'; i++)
+	{
+		if (path[i] != '/')
+			continue;
+
+		strlcpy(attributes.Path, path, i + 1);
+		const s32 ret = OSIoctlFD(fd, FS_IOCTL_CREATEDIR, &attributes, sizeof(attributes),
+		                          NULL, 0);
+		TEST_CHECK(ret == IPC_SUCCESS || ret == FS_EEXIST);
+	}
+
+	strlcpy(attributes.Path, path, sizeof(attributes.Path));
+	TEST_EQUAL(OSIoctlFD(fd, data == NULL ? FS_IOCTL_CREATEDIR : FS_IOCTL_CREATEFILE,
+	                     &attributes, sizeof(attributes), NULL, 0),
+	           IPC_SUCCESS);
+	if (data == NULL)
+		return;
+
+	const s32 file = OSOpenFD(path, ReadWrite);
+	TEST_CHECK(file >= 0);
+	TEST_EQUAL(OSWriteFD(file, data, length), (s32)length);
+	TEST_EQUAL(OSCloseFD(file), IPC_SUCCESS);
+}
+
+static void FillContent(TmdContent *content, u64 titleId, u32 index)
+{
+	content->ContentId = ((u32)titleId << 12) | index;
+	content->Index = (u16)index;
+	content->Type = index == 0 ? 0x0001 : 0x4001;
+	content->Size = 0x8000 + ((u64)index * 0x40);
+}
+
+static bool CheckContent(const TmdViewContent *content, u64 titleId, u32 index)
+{
+	TmdContent expected;
+	FillContent(&expected, titleId, index);
+	return content->ContentId == expected.ContentId && content->Index == expected.Index &&
+	       content->Type == expected.Type && content->Size == expected.Size;
+}
+
+static u64 TicketIdOf(u64 titleId, u32 index)
+{
+	return (titleId ^ 0x0005000000000000ULL) + index;
+}
+
+static void InstallMetadata(s32 fd, u64 titleId, u32 contents)
+{
+	char path[FS_MAX_PATH];
+	const u32 size = SIGNATURE_SIZE + sizeof(TmdHeader) + (contents * sizeof(TmdContent));
+	u8 *data = HostAllocate(size);
+
+	*(u32 *)data = SIGNATURE_RSA2048;
+	TmdHeader *header = (TmdHeader *)&data[SIGNATURE_SIZE];
+	header->TitleId = titleId;
+	header->TitleType = 1;
+	header->GroupId = (u16)(titleId >> 8);
+	header->TitleVersion = (u16)titleId;
+	header->NumberOfContents = (u16)contents;
+	TmdContent *content = (TmdContent *)&header[1];
+	for (u32 i = 0; i < contents; i++)
+		FillContent(&content[i], titleId, i);
+
+	snprintf(path, sizeof(path), "/title/%08x/%08x/content/title.tmd", (u32)(titleId >> 32),
+	         (u32)titleId);
+	CreatePath(fd, path, data, size);
+	HostFree(data, size);
+}
+
+static void InstallTickets(s32 fd, u64 titleId, u32 tickets)
+{
+	char path[FS_MAX_PATH];
+	const u32 size = tickets * TICKET_SIZE;
+	u8 *data = HostAllocate(size);
+
+	for (u32 i = 0; i < tickets; i++)
+	{
+		Ticket *ticket = (Ticket *)&data[(i * TICKET_SIZE) + SIGNATURE_SIZE];
+		*(u32 *)&data[i * TICKET_SIZE] = SIGNATURE_RSA2048;
+		ticket->TicketId = TicketIdOf(titleId, i);
+		ticket->TitleId = titleId;
+		ticket->AccessMask = 0xFFFF;
+	}
+
+	snprintf(path, sizeof(path), "/ticket/%08x/%08x.tik", (u32)(titleId >> 32), (u32)titleId);
+	CreatePath(fd, path, data, size);
+	HostFree(data, size);
+}
+
+//a nand with some system titles & channels on it, all of them with a ticket
+static void SetUp(void)
+{
+	TEST_EQUAL(OpenNandImage(NAND_IMAGE_PATH), IPC_SUCCESS);
+	FormatNand();
+	TEST_EQUAL(CommitSuperblock(), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+
+	const s32 fd = OSOpenFD(FS_DEVICE_NAME, ReadWrite);
+	TEST_CHECK(fd >= 0);
+	for (u32 i = 0; i < SYSTEM_COUNT; i++)
+	{
+		InstallMetadata(fd, SYSTEM_ID(i), TITLE_CONTENTS);
+		InstallTickets(fd, SYSTEM_ID(i), SYSTEM_ID(i) == MULTI_TICKET_ID ? MULTI_TICKETS : 1);
+	}
+
+	for (u32 i = 0; i < CHANNEL_COUNT; i++)
+	{
+		InstallMetadata(fd, CHANNEL_ID(i), TITLE_CONTENTS);
+		InstallTickets(fd, CHANNEL_ID(i), 1);
+	}
+
+	InstallTickets(fd, TICKET_ONLY_ID, 1);
+	TEST_EQUAL(OSCloseFD(fd), IPC_SUCCESS);
+
+	//es starts with what is on the nand, not with what the fs still has cached
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	ResetNandImageStats();
+	FileOpens = 0;
+	FileReads = 0;
+}
+
+static void TearDown(void)
+{
+	CloseNandImage();
+}
+
+static u32 CountPageReads(void)
+{
+	NandImageStats stats;
+	GetNandImageStats(0, FLASH_CLUSTER_COUNT / FLASH_CLUSTERS_PER_BLOCK, &stats);
+	return stats.PageReads;
+}
+
+static void CheckTitle(u64 titleId, u32 tickets)
+{
+	TmdViewContent contents[TITLE_CONTENTS];
+	TicketView views[MULTI_TICKETS];
+
+	const TitleInfo *title = GetTitleInfo(titleId);
+	TEST_CHECK(title != NULL);
+	if (title == NULL)
+		return;
+
+	TEST_CHECK(title->HasMetadata);
+	TEST_CHECK(title->View.TitleId == titleId);
+	TEST_EQUAL(title->View.TitleVersion, (u16)titleId);
+	TEST_EQUAL(title->View.NumberOfContents, TITLE_CONTENTS);
+	TEST_EQUAL(GetTitleContents(title, 0, contents, TITLE_CONTENTS), IPC_SUCCESS);
+	for (u32 i = 0; i < TITLE_CONTENTS; i++)
+		TEST_CHECK(CheckContent(&contents[i], titleId, i));
+
+	TEST_EQUAL(title->TicketCount, tickets);
+	TEST_EQUAL(GetTicketViews(title, views, tickets), IPC_SUCCESS);
+	for (u32 i = 0; i < tickets; i++)
+	{
+		TEST_EQUAL(views[i].View, i);
+		TEST_CHECK(views[i].TicketId == TicketIdOf(titleId, i));
+		TEST_CHECK(views[i].TitleId == titleId);
+	}
+}
+
+static void TestIndexBuild(void)
+{
+	u64 titleIds[ES_MAX_TITLES];
+
+	SetUp();
+	const u32 start = HostGetTicks();
+	TEST_EQUAL(InitializeTitleIndex(), IPC_SUCCESS);
+	const u32 elapsed = HostGetTicks() - start;
+	HostPrintf("  indexed in %uus: %u opens, %u reads, %u nand pages read\n", elapsed, FileOpens,
+	           FileReads, CountPageReads());
+
+	//the ticket only title is owned, but isn't installed
+	const u32 installed = SYSTEM_COUNT + CHANNEL_COUNT;
+	TEST_EQUAL(GetTitleIds(NULL, 0, false), installed);
+	TEST_EQUAL(GetTitleIds(NULL, 0, true), installed + 1);
+	TEST_EQUAL(GetTitleIds(titleIds, ARRAY_LENGTH(titleIds), false), installed);
+	for (u32 i = 0; i < installed; i++)
+		TEST_CHECK(titleIds[i] != TICKET_ONLY_ID);
+	TEST_EQUAL(GetTitleIds(titleIds, 2, true), 2);
+
+	const TitleInfo *title = GetTitleInfo(TICKET_ONLY_ID);
+	TEST_CHECK(title != NULL && !title->HasMetadata && title->TicketCount == 1);
+	TEST_CHECK(GetTitleInfo(CHANNEL_ID(CHANNEL_COUNT)) == NULL);
+	TearDown();
+}
+
+//once the index is built, none of the queries go to the fs anymore
+static void TestQueriesStayInMemory(void)
+{
+	SetUp();
+	TEST_EQUAL(InitializeTitleIndex(), IPC_SUCCESS);
+	ResetNandImageStats();
+	FileOpens = 0;
+	FileReads = 0;
+
+	const u32 start = HostGetTicks();
+	for (u32 round = 0; round < LOOKUP_ROUNDS; round++)
+	{
+		for (u32 i = 0; i < SYSTEM_COUNT; i++)
+			CheckTitle(SYSTEM_ID(i), SYSTEM_ID(i) == MULTI_TICKET_ID ? MULTI_TICKETS : 1);
+		for (u32 i = 0; i < CHANNEL_COUNT; i++)
+			CheckTitle(CHANNEL_ID(i), 1);
+		GetTitleIds(NULL, 0, false);
+	}
+
+	const u32 elapsed = HostGetTicks() - start;
+	HostPrintf("  %u rounds over all titles in %uus\n", LOOKUP_ROUNDS, elapsed);
+	TEST_EQUAL(FileOpens, 0);
+	TEST_EQUAL(FileReads, 0);
+	TEST_EQUAL(CountPageReads(), 0);
+	TearDown();
+}
+
+static void TestDeleteInvalidatesIndex(void)
+{
+	TicketView views[MULTI_TICKETS];
+
+	SetUp();
+	TEST_EQUAL(InitializeTitleIndex(), IPC_SUCCESS);
+	const u32 installed = GetTitleIds(NULL, 0, false);
+
+	//the title keeps its ticket, so it is still owned but no longer installed
+	TEST_EQUAL(DeleteTitle(CHANNEL_ID(3)), IPC_SUCCESS);
+	TEST_EQUAL(GetTitleIds(NULL, 0, false), installed - 1);
+	const TitleInfo *title = GetTitleInfo(CHANNEL_ID(3));
+	TEST_CHECK(title != NULL && !title->HasMetadata && title->TicketCount == 1);
+	TEST_EQUAL(DeleteTitle(CHANNEL_ID(3)), ES_EINVAL);
+	TEST_EQUAL(DeleteTitle(TICKET_ONLY_ID), ES_EINVAL);
+
+	//nothing but the deleted title changed
+	CheckTitle(CHANNEL_ID(2), 1);
+	CheckTitle(MULTI_TICKET_ID, MULTI_TICKETS);
+
+	title = GetTitleInfo(CHANNEL_ID(3));
+	TEST_EQUAL(GetTicketViews(title, views, 1), IPC_SUCCESS);
+	TEST_EQUAL(DeleteTicket(&views[0]), IPC_SUCCESS);
+	TEST_CHECK(GetTitleInfo(CHANNEL_ID(3)) == NULL);
+
+	//the index doesn't survive a reboot either, it is rebuilt from what the commit put on the nand
+	TEST_EQUAL(SyncFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(BootFileSystem(), IPC_SUCCESS);
+	TEST_EQUAL(InitializeTitleIndex(), IPC_SUCCESS);
+	TEST_EQUAL(GetTitleIds(NULL, 0, false), installed - 1);
+	TEST_CHECK(GetTitleInfo(CHANNEL_ID(3)) == NULL);
+	TearDown();
+}
+
+//a title too big for the content pool is still indexed, its contents come from the tmd
+static void TestContentPoolOverflow(void)
+{
+	TmdViewContent contents[0x10];
+	const u64 titleId = CHANNEL_ID(CHANNEL_COUNT);
+	const u32 count = ES_MAX_CONTENTS + 1;
+
+	SetUp();
+	const s32 fd = OSOpenFD(FS_DEVICE_NAME, ReadWrite);
+	InstallMetadata(fd, titleId, count);
+	InstallTickets(fd, titleId, 1);
+	OSCloseFD(fd);
+
+	TEST_EQUAL(InitializeTitleIndex(), IPC_SUCCESS);
+	const TitleInfo *title = GetTitleInfo(titleId);
+	TEST_CHECK(title != NULL && title->HasMetadata && !title->ContentsCached);
+	if (title == NULL)
+	{
+		TearDown();
+		return;
+	}
+
+	FileOpens = 0;
+	TEST_EQUAL(GetTitleContents(title, count - ARRAY_LENGTH(contents), contents,
+	                            ARRAY_LENGTH(contents)),
+	           IPC_SUCCESS);
+	for (u32 i = 0; i < ARRAY_LENGTH(contents); i++)
+		TEST_CHECK(CheckContent(&contents[i], titleId, count - ARRAY_LENGTH(contents) + i));
+	TEST_EQUAL(FileOpens, 1);
+	TEST_EQUAL(GetTitleContents(title, count - 1, contents, 2), ES_EINVAL);
+
+	//the others still fit
+	FileOpens = 0;
+	CheckTitle(CHANNEL_ID(0), 1);
+	TEST_EQUAL(FileOpens, 0);
+	TearDown();
+}
+
+static const TestCase Tests[] = {
+	TEST_CASE(TestIndexBuild),
+	TEST_CASE(TestQueriesStayInMemory),
+	TEST_CASE(TestDeleteInvalidatesIndex),
+	TEST_CASE(TestContentPoolOverflow),
+};
+
+int main(void)
+{
+	return RunTests("titles", Tests, ARRAY_LENGTH(Tests));
+}